@@ -0,0 +1,2242 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Command line benchmarks for the OSR plugin code paths. They drive OSRStandInPlugin or
+ * OSRCpuPlugin so that they can run on devices without the NPU plugin.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <memory>
+#include <set>
+#include <thread>
+#include "Material/CgmatLoader.h"
+#include "MathKernels/BoundingBox.h"
+#include "MathKernels/FastMath.h"
+#include "MathKernels/MatrixBatch.h"
+#include "MathKernels/MatrixKernels.h"
+#include "MathKernels/PodMath.h"
+#include "OSRPlugin/ImageQuality.h"
+#include "OSRPlugin/OSRCpuPlugin.h"
+#include "OSRPlugin/OSRPlugin.h"
+#include "OSRPlugin/OSRSession.h"
+#include "OSRPlugin/OSRStandInPlugin.h"
+#include "OSRPlugin/PNMCodec.h"
+#include "OSRPlugin/PixelConverter.h"
+#include "OSRPlugin/PluginCallFrame.h"
+#include "Param/CompactParam.h"
+#include "Param/ParamBinary.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+// every heap allocation of the process and the bytes still allocated, so benchmarks can report
+// allocations per call and the memory a data structure holds
+atomic<u64> g_allocations {0};
+atomic<s64> g_liveBytes {0};
+// each block starts with its size, the header keeps the 16-byte alignment malloc gives
+constexpr size_t ALLOCATION_HEADER = 16;
+
+void* Allocate(size_t size)
+{
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    g_liveBytes.fetch_add(static_cast<s64>(size), memory_order_relaxed);
+    u8* block = static_cast<u8*>(malloc(size + ALLOCATION_HEADER));
+    if (block == nullptr) {
+        throw bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    return block + ALLOCATION_HEADER;
+}
+
+// kept out of line: inlined into a delete expression GCC sees the header read and free as misusing new
+__attribute__((noinline)) void Deallocate(void* p)
+{
+    if (p == nullptr) {
+        return;
+    }
+    u8* block = static_cast<u8*>(p) - ALLOCATION_HEADER;
+    g_liveBytes.fetch_sub(static_cast<s64>(*reinterpret_cast<size_t*>(block)), memory_order_relaxed);
+    free(block);
+}
+}
+
+// every form counts, sized deletes included, which C++14 calls whenever the size is known
+void* operator new(size_t size)
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return Allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    Deallocate(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    Deallocate(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    Deallocate(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    Deallocate(p);
+}
+
+namespace {
+const f32 DEFAULT_COST_MS = 20.0f;
+using Clock = chrono::steady_clock;
+
+f64 ElapsedMs(const Clock::time_point& start)
+{
+    return chrono::duration<f64, milli>(Clock::now() - start).count();
+}
+
+void PrintStage(const char* name, const OSRStageStats& stage)
+{
+    printf("  %-8s frames %4u failed %2u busy %9.2fms %8.2ffps %8.2fMPix/s\n", name, stage.frames, stage.failures,
+           stage.busyMs, stage.FramesPerSecond(), stage.MegaPixelsPerSecond());
+}
+
+/*
+ * pipeline <assetsDir> <inputDir> <outputDir> [costMs]
+ * Runs the batch pipeline at several queue depths. The sum of the stage busy times is what the serial
+ * ExecuteOSR loop would have cost for the same frames.
+ */
+int RunPipeline(int argc, char** argv)
+{
+    if (argc < 3) {
+        printf("usage: pipeline <assetsDir> <inputDir> <outputDir> [costMs]\n");
+        return 1;
+    }
+    f32 costMs = argc > 3 ? static_cast<f32>(atof(argv[3])) : DEFAULT_COST_MS;
+    OSRStandInPlugin standIn(costMs);
+    OSRPlugin osr(&standIn);
+    const u32 depths[] = {1, 2, 4, 8};
+    for (u32 depth : depths) {
+        OSRPipelineConfig config;
+        config.queueDepth = depth;
+        OSRPipelineStats stats;
+        osr.ExecuteOSRDirectory(argv[0], argv[1], argv[2], config, &stats);
+        f64 serialMs = stats.read.busyMs + stats.enhance.busyMs + stats.write.busyMs;
+        printf("queueDepth %u: %u frames wall %.2fms serial %.2fms speedup %.2fx\n", depth, stats.write.frames,
+               stats.wallMs, serialMs, stats.wallMs > 0.0 ? serialMs / stats.wallMs : 0.0);
+        PrintStage("read", stats.read);
+        PrintStage("enhance", stats.enhance);
+        PrintStage("write", stats.write);
+        OSRBufferPoolStats poolStats = osr.GetBufferPoolStats();
+        printf("  pool     hit rate %.2f (%llu misses) resident %.2fMB\n", poolStats.HitRate(),
+               static_cast<unsigned long long>(poolStats.misses), poolStats.residentBytes / (1024.0 * 1024.0));
+    }
+    return 0;
+}
+
+/*
+ * Runs one query + enhance round on a synthetic RGB frame.
+ */
+bool EnhanceOnce(OSRSession& session, BufferDescriptor& inBuffer, vector<u8>& outPixels)
+{
+    PluginConfig config;
+    if (!session.QueryImage(inBuffer, config)) {
+        return false;
+    }
+    outPixels.resize(static_cast<size_t>(config.output.width) * config.output.height * 3);
+    BufferDescriptor outBuffer {outPixels.data(), static_cast<int>(outPixels.size()), config.output.width,
+        config.output.height, config.output.format};
+    return session.ImageEnhancingSync(inBuffer, outBuffer);
+}
+
+/*
+ * session <assetsDir> [iterations] [width] [height] [costMs]
+ * Cold runs open and close a session per image, as ExecuteOSR used to do. Warm runs reuse one session.
+ */
+int RunSession(int argc, char** argv)
+{
+    if (argc < 1) {
+        printf("usage: session <assetsDir> [iterations] [width] [height] [costMs]\n");
+        return 1;
+    }
+    const u32 iterations = argc > 1 ? max(1, atoi(argv[1])) : 20;
+    const s32 width = argc > 2 ? atoi(argv[2]) : 1920;
+    const s32 height = argc > 3 ? atoi(argv[3]) : 1080;
+    f32 costMs = argc > 4 ? static_cast<f32>(atof(argv[4])) : DEFAULT_COST_MS;
+    OSRStandInPlugin standIn(costMs, 1);
+    vector<u8> inPixels(static_cast<size_t>(width) * height * 3, 0x80);
+    vector<u8> outPixels;
+    BufferDescriptor inBuffer {inPixels.data(), static_cast<int>(inPixels.size()), width, height,
+        PIXEL_FORMAT_R8G8B8_UNORM};
+
+    f64 coldMs = 0.0;
+    for (u32 i = 0; i < iterations; i++) {
+        Clock::time_point t = Clock::now();
+        OSRSession session(&standIn);
+        if (!session.Open(argv[0]) || !EnhanceOnce(session, inBuffer, outPixels)) {
+            printf("cold run %u failed\n", i);
+            return 1;
+        }
+        session.Close();
+        coldMs += ElapsedMs(t);
+    }
+
+    OSRSession session(&standIn);
+    Clock::time_point t = Clock::now();
+    if (!session.Open(argv[0])) {
+        printf("open failed\n");
+        return 1;
+    }
+    f64 openMs = ElapsedMs(t);
+    f64 warmMs = 0.0;
+    for (u32 i = 0; i < iterations; i++) {
+        t = Clock::now();
+        if (!EnhanceOnce(session, inBuffer, outPixels)) {
+            printf("warm run %u failed\n", i);
+            return 1;
+        }
+        warmMs += ElapsedMs(t);
+    }
+    printf("%dx%d, %u images, plugin cost %.2fms\n", width, height, iterations, costMs);
+    printf("  cold %.3fms/image\n", coldMs / iterations);
+    printf("  warm %.3fms/image (open once %.3fms, query cache %u hits %u misses)\n", warmMs / iterations, openMs,
+           session.GetQueryCacheHits(), session.GetQueryCacheMisses());
+    return 0;
+}
+
+/*
+ * Sums every 64th byte so that lazily mapped pages are really read.
+ */
+u64 Touch(const u8* data, size_t size)
+{
+    u64 sum = 0;
+    for (size_t i = 0; i < size; i += 64) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+/*
+ * The stream based reader ReadPPM used before PNMCodec, kept as the baseline.
+ */
+bool StreamRead(const String& path, vector<u8>& pixels)
+{
+    ifstream fIn(path, ios::in | ios::binary);
+    String line;
+    u32 width = 0;
+    u32 height = 0;
+    if (!getline(fIn, line) || !getline(fIn, line)) {
+        return false;
+    }
+    stringstream ss(line);
+    if (!(ss >> width >> height) || !getline(fIn, line)) {
+        return false;
+    }
+    pixels.resize(static_cast<size_t>(width) * height * 3);
+    return static_cast<bool>(fIn.read(reinterpret_cast<c8*>(pixels.data()), pixels.size()));
+}
+
+bool StreamWrite(const String& path, const vector<u8>& pixels, u32 width, u32 height)
+{
+    ofstream fOut(path, ios::out | ios::binary);
+    fOut << "P6\n" << width << ' ' << height << "\n255\n";
+    fOut.write(reinterpret_cast<const c8*>(pixels.data()), pixels.size());
+    return static_cast<bool>(fOut);
+}
+
+/*
+ * pnm <workDir> [iterations]
+ * Reads and writes a 3840x2160 P6 frame with the stream baseline and with PNMCodec. The frame stays in
+ * the page cache, so this measures parsing and copying rather than storage.
+ */
+int RunPNM(int argc, char** argv)
+{
+    if (argc < 1) {
+        printf("usage: pnm <workDir> [iterations]\n");
+        return 1;
+    }
+    const u32 iterations = argc > 1 ? max(1, atoi(argv[1])) : 20;
+    const u32 width = 3840;
+    const u32 height = 2160;
+    const String inPath = String(argv[0]) + "/pnm_bench_in.ppm";
+    const String outPath = String(argv[0]) + "/pnm_bench_out.ppm";
+    vector<u8> pixels(static_cast<size_t>(width) * height * 3);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = static_cast<u8>(i * 31);
+    }
+    if (!StreamWrite(inPath, pixels, width, height)) {
+        printf("cannot write %s\n", inPath.c_str());
+        return 1;
+    }
+    const f64 megaBytes = pixels.size() / (1024.0 * 1024.0) * iterations;
+    u64 checksum = 0;
+
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        vector<u8> frame;
+        if (!StreamRead(inPath, frame)) {
+            return 1;
+        }
+        checksum += Touch(frame.data(), frame.size());
+    }
+    f64 streamReadMs = ElapsedMs(t);
+
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        BufferDescriptor buffer;
+        if (!PNMCodec::Read(inPath, buffer)) {
+            return 1;
+        }
+        checksum += Touch(static_cast<const u8*>(buffer.addr), buffer.len);
+        PNMCodec::Release(buffer);
+    }
+    f64 mmapReadMs = ElapsedMs(t);
+
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        StreamWrite(outPath, pixels, width, height);
+    }
+    f64 streamWriteMs = ElapsedMs(t);
+
+    BufferDescriptor outBuffer {pixels.data(), static_cast<int>(pixels.size()), static_cast<int>(width),
+        static_cast<int>(height), PIXEL_FORMAT_R8G8B8_UNORM};
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        PNMCodec::Write(outPath, outBuffer);
+    }
+    f64 mmapWriteMs = ElapsedMs(t);
+
+    printf("%ux%u P6, %u iterations (checksum %llu)\n", width, height, iterations,
+           static_cast<unsigned long long>(checksum));
+    printf("  read   stream %8.2fms/frame %8.1fMB/s   mmap %8.2fms/frame %8.1fMB/s\n", streamReadMs / iterations,
+           megaBytes * 1000.0 / streamReadMs, mmapReadMs / iterations, megaBytes * 1000.0 / mmapReadMs);
+    printf("  write  stream %8.2fms/frame %8.1fMB/s   mmap %8.2fms/frame %8.1fMB/s\n", streamWriteMs / iterations,
+           megaBytes * 1000.0 / streamWriteMs, mmapWriteMs / iterations, megaBytes * 1000.0 / mmapWriteMs);
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+    return 0;
+}
+
+/*
+ * Writes one byte per page, so that fresh allocations pay for their page faults like a real frame would.
+ */
+void TouchPages(u8* data, size_t size)
+{
+    const size_t pageSize = 4096;
+    for (size_t i = 0; i < size; i += pageSize) {
+        data[i] = static_cast<u8>(i);
+    }
+}
+
+/*
+ * pool [iterations] [hugePages]
+ * Allocates, touches and frees a 3840x2160 RGB output buffer per frame with new[]/delete[] and with
+ * OSRBufferPool, and counts the heap allocations per frame of the pool.
+ */
+int RunPool(int argc, char** argv)
+{
+    const u32 iterations = argc > 0 ? max(1, atoi(argv[0])) : 200;
+    OSRBufferPoolConfig config;
+    config.hugePages = argc > 1 && atoi(argv[1]) != 0;
+    const u32 len = 3840 * 2160 * 3;
+
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        u8* pixels = CG_NEW_ARRAY(u8, len);
+        if (pixels == nullptr) {
+            return 1;
+        }
+        TouchPages(pixels, len);
+        CG_DELETE_ARRAY(u8, pixels);
+    }
+    f64 heapMs = ElapsedMs(t);
+
+    OSRBufferPool pool(config);
+    const u64 allocations = g_allocations.load();
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        BufferDescriptor buffer;
+        if (!pool.Acquire(buffer, len)) {
+            return 1;
+        }
+        TouchPages(static_cast<u8*>(buffer.addr), len);
+        pool.Release(buffer);
+    }
+    f64 poolMs = ElapsedMs(t);
+    f64 poolAllocations = static_cast<f64>(g_allocations.load() - allocations) / iterations;
+
+    OSRBufferPoolStats stats = pool.GetStats();
+    printf("3840x2160 RGB, %u frames, huge pages %s\n", iterations, config.hugePages ? "on" : "off");
+    printf("  new[]  %8.3fms/frame\n", heapMs / iterations);
+    printf("  pool   %8.3fms/frame hit rate %.3f resident %.2fMB allocations %.3f/frame\n", poolMs / iterations,
+           stats.HitRate(), stats.residentBytes / (1024.0 * 1024.0), poolAllocations);
+    return 0;
+}
+
+/*
+ * pixel [iterations]
+ * Times every conversion kernel on a 3840x2160 frame with each instruction set the CPU supports.
+ */
+int RunPixel(int argc, char** argv)
+{
+    const u32 iterations = argc > 0 ? max(1, atoi(argv[0])) : 20;
+    const s32 width = 3840;
+    const s32 height = 2160;
+    const size_t pixels = static_cast<size_t>(width) * height;
+    const PixelFormat formats[] = {PIXEL_FORMAT_R8G8B8A8_UNORM, PIXEL_FORMAT_B8G8R8A8_UNORM,
+        PIXEL_FORMAT_R16G16B16A16_FLOAT};
+    const c8* names[] = {"rgba8", "bgra8", "rgba16f"};
+    vector<u8> rgb(pixels * 3);
+    vector<u8> other(pixels * 8);
+    vector<u8> yPlane(pixels);
+    vector<u8> uvPlane(pixels / 2);
+    for (size_t i = 0; i < rgb.size(); i++) {
+        rgb[i] = static_cast<u8>(i * 13);
+    }
+    BufferDescriptor rgbBuffer {rgb.data(), static_cast<int>(rgb.size()), width, height, PIXEL_FORMAT_R8G8B8_UNORM};
+    PixelConverter::RGBToYUV(rgbBuffer, YUV_LAYOUT_NV21, yPlane.data(), uvPlane.data());
+    auto report = [&](const c8* kernel, f64 ms) {
+        printf("  %-16s %8.3fms/frame %8.1fMPix/s\n", kernel, ms / iterations, pixels * iterations / (ms * 1000.0));
+    };
+
+    const PixelIsa best = PixelConverter::GetIsa();
+    for (u32 isa = PIXEL_ISA_SCALAR; isa < PIXEL_ISA_MAX; isa++) {
+        if (!PixelConverter::SetIsa(static_cast<PixelIsa>(isa))) {
+            continue;
+        }
+        printf("%s, %dx%d, %u iterations\n", PixelConverter::GetIsaName(static_cast<PixelIsa>(isa)), width, height,
+               iterations);
+        for (u32 f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            BufferDescriptor otherBuffer {other.data(), static_cast<int>(other.size()), width, height, formats[f]};
+            Clock::time_point t = Clock::now();
+            for (u32 i = 0; i < iterations; i++) {
+                PixelConverter::Convert(rgbBuffer, otherBuffer);
+            }
+            report((String("rgb8->") + names[f]).c_str(), ElapsedMs(t));
+            t = Clock::now();
+            for (u32 i = 0; i < iterations; i++) {
+                PixelConverter::Convert(otherBuffer, rgbBuffer);
+            }
+            report((String(names[f]) + "->rgb8").c_str(), ElapsedMs(t));
+        }
+        Clock::time_point t = Clock::now();
+        for (u32 i = 0; i < iterations; i++) {
+            PixelConverter::YUVToRGB(yPlane.data(), uvPlane.data(), YUV_LAYOUT_NV21, rgbBuffer);
+        }
+        report("nv21->rgb8", ElapsedMs(t));
+        t = Clock::now();
+        for (u32 i = 0; i < iterations; i++) {
+            PixelConverter::YUVToRGB(yPlane.data(), uvPlane.data(), YUV_LAYOUT_NV12, rgbBuffer);
+        }
+        report("nv12->rgb8", ElapsedMs(t));
+        t = Clock::now();
+        for (u32 i = 0; i < iterations; i++) {
+            PixelConverter::RGBToYUV(rgbBuffer, YUV_LAYOUT_NV21, yPlane.data(), uvPlane.data());
+        }
+        report("rgb8->nv21", ElapsedMs(t));
+    }
+    PixelConverter::SetIsa(best);
+    return 0;
+}
+
+/*
+ * snapshot <assetsDir> [iterations] [width] [height] [costMs]
+ * Enhances an RGBA8 screen snapshot through input.ppm and output_ie_sync.ppm in assetsDir, as the app did
+ * before, and through ExecuteOSRFrame, which keeps the frame in memory.
+ */
+int RunSnapshot(int argc, char** argv)
+{
+    if (argc < 1) {
+        printf("usage: snapshot <assetsDir> [iterations] [width] [height] [costMs]\n");
+        return 1;
+    }
+    const u32 iterations = argc > 1 ? max(1, atoi(argv[1])) : 20;
+    const s32 width = argc > 2 ? atoi(argv[2]) : 1920;
+    const s32 height = argc > 3 ? atoi(argv[3]) : 1080;
+    f32 costMs = argc > 4 ? static_cast<f32>(atof(argv[4])) : DEFAULT_COST_MS;
+    OSRStandInPlugin standIn(costMs);
+    OSRPlugin osr(&standIn);
+    const String dir = argv[0];
+    const String inPath = dir + "/input.ppm";
+    const String outPath = dir + "/output_ie_sync.ppm";
+    vector<u8> snapshot(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        snapshot[i] = static_cast<u8>(i * 7);
+    }
+    BufferDescriptor snapshotBuffer {snapshot.data(), static_cast<int>(snapshot.size()), width, height,
+        PIXEL_FORMAT_R8G8B8A8_UNORM};
+    vector<u8> rgb(static_cast<size_t>(width) * height * 3);
+    BufferDescriptor rgbBuffer {rgb.data(), static_cast<int>(rgb.size()), width, height, PIXEL_FORMAT_R8G8B8_UNORM};
+    u64 checksum = 0;
+
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        BufferDescriptor result;
+        if (!PixelConverter::Convert(snapshotBuffer, rgbBuffer) ||
+            !PNMCodec::Write(inPath, rgbBuffer)) {
+            printf("cannot write input.ppm\n");
+            return 1;
+        }
+        osr.ExecuteOSR(dir);
+        if (!PNMCodec::Read(outPath, result)) {
+            printf("file run %u failed\n", i);
+            return 1;
+        }
+        checksum += Touch(static_cast<const u8*>(result.addr), result.len);
+        PNMCodec::Release(result);
+    }
+    f64 fileMs = ElapsedMs(t);
+
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        promise<bool> done;
+        bool submitted = osr.ExecuteOSRFrame(dir, snapshotBuffer,
+            [&done, &checksum](bool success, const BufferDescriptor& outBuffer) {
+                if (success) {
+                    checksum += Touch(static_cast<const u8*>(outBuffer.addr), outBuffer.len);
+                }
+                done.set_value(success);
+            });
+        if (!submitted || !done.get_future().get()) {
+            printf("memory run %u failed\n", i);
+            return 1;
+        }
+    }
+    f64 memoryMs = ElapsedMs(t);
+
+    printf("%dx%d RGBA8 snapshot, %u frames, plugin cost %.2fms (checksum %llu)\n", width, height, iterations,
+           costMs, static_cast<unsigned long long>(checksum));
+    printf("  file   %8.2fms/frame\n", fileMs / iterations);
+    printf("  memory %8.2fms/frame, %.2fms/frame saved\n", memoryMs / iterations,
+           (fileMs - memoryMs) / iterations);
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+    return 0;
+}
+
+/*
+ * cpu [iterations] [width] [height]
+ * Runs the CPU fallback enhancer on an RGB8 frame for every instruction set and worker count and checks
+ * that all of them produce the bytes of the scalar single worker run.
+ */
+int RunCpu(int argc, char** argv)
+{
+    const u32 iterations = argc > 0 ? max(1, atoi(argv[0])) : 10;
+    const s32 width = argc > 1 ? atoi(argv[1]) : 3840;
+    const s32 height = argc > 2 ? atoi(argv[2]) : 2160;
+    const size_t bytes = static_cast<size_t>(width) * height * 3;
+    vector<u8> inPixels(bytes);
+    for (size_t i = 0; i < bytes; i++) {
+        inPixels[i] = static_cast<u8>((i * 37) ^ (i / 4096));
+    }
+    vector<u8> reference(bytes);
+    vector<u8> outPixels(bytes);
+    BufferDescriptor inBuffer {inPixels.data(), static_cast<int>(bytes), width, height, PIXEL_FORMAT_R8G8B8_UNORM};
+    BufferDescriptor refBuffer {reference.data(), static_cast<int>(bytes), width, height, PIXEL_FORMAT_R8G8B8_UNORM};
+    BufferDescriptor outBuffer {outPixels.data(), static_cast<int>(bytes), width, height, PIXEL_FORMAT_R8G8B8_UNORM};
+    const f32 sharpness = 0.9f;
+
+    const PixelIsa best = PixelConverter::GetIsa();
+    PixelConverter::SetIsa(PIXEL_ISA_SCALAR);
+    OSRCpuPlugin(1).Enhance(inBuffer, refBuffer, sharpness, true);
+    const u32 cores = max(1u, thread::hardware_concurrency());
+    printf("%dx%d RGB8, sharpness %.2f + tone mapping, %u iterations\n", width, height, sharpness, iterations);
+    bool identical = true;
+    for (u32 isa = PIXEL_ISA_SCALAR; isa < PIXEL_ISA_MAX; isa++) {
+        if (!PixelConverter::SetIsa(static_cast<PixelIsa>(isa))) {
+            continue;
+        }
+        for (u32 workers = 1; workers <= cores; workers *= 2) {
+            OSRCpuPlugin plugin(workers);
+            Clock::time_point t = Clock::now();
+            for (u32 i = 0; i < iterations; i++) {
+                plugin.Enhance(inBuffer, outBuffer, sharpness, true);
+            }
+            f64 ms = ElapsedMs(t) / iterations;
+            bool same = (outPixels == reference);
+            identical = identical && same;
+            printf("  %-6s workers %2u %8.2fms/frame %8.1fMPix/s %s\n",
+                   PixelConverter::GetIsaName(static_cast<PixelIsa>(isa)), workers, ms,
+                   static_cast<f64>(width) * height / (ms * 1000.0), same ? "" : "MISMATCH");
+        }
+    }
+    PixelConverter::SetIsa(best);
+    return identical ? 0 : 1;
+}
+
+/*
+ * upscale <assetsDir> [iterations] [width] [height] [costMs]
+ * Upscales an RGB8 frame 2x with both CPU modes on every instruction set and worker count, checks that
+ * the instruction sets agree and compares the measured cost with the estimatedCostTime the plugin
+ * reports for QUERY_SUPER_SAMPLING.
+ */
+int RunUpscale(int argc, char** argv)
+{
+    if (argc < 1) {
+        printf("usage: upscale <assetsDir> [iterations] [width] [height] [costMs]\n");
+        return 1;
+    }
+    const u32 iterations = argc > 1 ? max(1, atoi(argv[1])) : 10;
+    const s32 width = argc > 2 ? atoi(argv[2]) : 1920;
+    const s32 height = argc > 3 ? atoi(argv[3]) : 1080;
+    f32 costMs = argc > 4 ? static_cast<f32>(atof(argv[4])) : DEFAULT_COST_MS;
+    const s32 scale = 2;
+    const size_t inBytes = static_cast<size_t>(width) * height * 3;
+    const size_t outBytes = inBytes * scale * scale;
+    vector<u8> inPixels(inBytes);
+    for (size_t i = 0; i < inBytes; i++) {
+        inPixels[i] = static_cast<u8>((i * 37) ^ (i / 4096));
+    }
+    vector<u8> reference(outBytes);
+    vector<u8> outPixels(outBytes);
+    BufferDescriptor inBuffer {inPixels.data(), static_cast<int>(inBytes), width, height, PIXEL_FORMAT_R8G8B8_UNORM};
+    BufferDescriptor refBuffer {reference.data(), static_cast<int>(outBytes), width * scale, height * scale,
+        PIXEL_FORMAT_R8G8B8_UNORM};
+    BufferDescriptor outBuffer {outPixels.data(), static_cast<int>(outBytes), width * scale, height * scale,
+        PIXEL_FORMAT_R8G8B8_UNORM};
+    const f64 outMegaPixels = static_cast<f64>(outBuffer.width) * outBuffer.height / 1000000.0;
+
+    OSRStandInPlugin standIn(costMs, scale);
+    OSRSession pluginSession(&standIn);
+    PluginConfig pluginConfig;
+    if (!pluginSession.Open(argv[0]) || !pluginSession.QuerySuperSampling(inBuffer, pluginConfig)) {
+        printf("plugin query failed\n");
+        return 1;
+    }
+    printf("%dx%d RGB8 -> %dx%d, %u iterations, plugin estimatedCostTime %.2fms (%.2fms/MPix)\n", width, height,
+           outBuffer.width, outBuffer.height, iterations, pluginConfig.estimatedCostTime,
+           pluginConfig.estimatedCostTime / outMegaPixels);
+
+    const PixelIsa best = PixelConverter::GetIsa();
+    const u32 cores = max(1u, thread::hardware_concurrency());
+    const c8* modeNames[] = {"lanczos3", "edge"};
+    bool identical = true;
+    for (u32 mode = 0; mode < OSR_UPSCALE_MODE_MAX; mode++) {
+        PixelConverter::SetIsa(PIXEL_ISA_SCALAR);
+        OSRCpuPlugin scalar(1, scale);
+        scalar.SetUpscaleMode(static_cast<OSRUpscaleMode>(mode));
+        scalar.Upscale(inBuffer, refBuffer);
+        for (u32 isa = PIXEL_ISA_SCALAR; isa < PIXEL_ISA_MAX; isa++) {
+            if (!PixelConverter::SetIsa(static_cast<PixelIsa>(isa))) {
+                continue;
+            }
+            for (u32 workers = 1; workers <= cores; workers *= 2) {
+                OSRCpuPlugin cpu(workers, scale);
+                cpu.SetUpscaleMode(static_cast<OSRUpscaleMode>(mode));
+                Clock::time_point t = Clock::now();
+                for (u32 i = 0; i < iterations; i++) {
+                    cpu.Upscale(inBuffer, outBuffer);
+                }
+                f64 ms = ElapsedMs(t) / iterations;
+                bool same = (outPixels == reference);
+                identical = identical && same;
+
+                // the CPU plugin reports the cost it has just measured
+                OSRSession cpuSession(&cpu);
+                PluginConfig cpuConfig;
+                cpuSession.Open(argv[0]);
+                cpuSession.QuerySuperSampling(inBuffer, cpuConfig);
+                printf("  %-8s %-6s workers %2u %8.2fms/frame %7.2fms/MPix estimate %8.2fms -> %s %s\n",
+                       modeNames[mode], PixelConverter::GetIsaName(static_cast<PixelIsa>(isa)), workers, ms,
+                       ms / outMegaPixels, cpuConfig.estimatedCostTime,
+                       cpuConfig.estimatedCostTime < pluginConfig.estimatedCostTime ? "cpu" : "plugin",
+                       same ? "" : "MISMATCH");
+            }
+        }
+    }
+    PixelConverter::SetIsa(best);
+    return identical ? 0 : 1;
+}
+
+/*
+ * 64-bit FNV-1a, the checksum corpus runs print so that runs on different machines can be matched up.
+ */
+u64 Fnv1a(const u8* data, size_t size, u64 hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/*
+ * makecorpus <dir> [count]
+ * Writes count RGB8 .ppm images of several sizes to dir. Gradients, hard edges, rings and noise come from
+ * a fixed seed, so every machine gets the same corpus.
+ */
+int RunMakeCorpus(int argc, char** argv)
+{
+    if (argc < 1) {
+        printf("usage: makecorpus <dir> [count]\n");
+        return 1;
+    }
+    const u32 count = argc > 1 ? max(1, atoi(argv[1])) : 8;
+    const u32 sizes[][2] = {{1280, 720}, {1920, 1080}, {640, 360}, {333, 197}};
+    u32 seed = 20200907;
+    for (u32 n = 0; n < count; n++) {
+        const u32 width = sizes[n % 4][0];
+        const u32 height = sizes[n % 4][1];
+        vector<u8> pixels(static_cast<size_t>(width) * height * 3);
+        const u32 cell = 8u << (n % 4);
+        for (u32 y = 0; y < height; y++) {
+            for (u32 x = 0; x < width; x++) {
+                seed = seed * 1664525u + 1013904223u;
+                const u32 noise = (seed >> 24) & 0x1F;
+                const s32 dx = static_cast<s32>(x) - static_cast<s32>(width / 2);
+                const s32 dy = static_cast<s32>(y) - static_cast<s32>(height / 2);
+                const u32 ring = (static_cast<u32>(dx * dx + dy * dy) >> (n % 3 + 6)) & 1;
+                const u32 checker = ((x / cell) ^ (y / cell)) & 1;
+                u8* p = &pixels[(static_cast<size_t>(y) * width + x) * 3];
+                p[0] = static_cast<u8>(x * 255 / width * 3 / 4 + noise);
+                p[1] = static_cast<u8>(checker * 160 + ring * 48 + noise);
+                p[2] = static_cast<u8>(y * 255 / height * 3 / 4 + (ring ? 0 : noise));
+            }
+        }
+        BufferDescriptor buffer {pixels.data(), static_cast<int>(pixels.size()), static_cast<int>(width),
+            static_cast<int>(height), PIXEL_FORMAT_R8G8B8_UNORM};
+        c8 name[32];
+        snprintf(name, sizeof(name), "/corpus_%02u.ppm", n);
+        if (!PNMCodec::Write(String(argv[0]) + name, buffer)) {
+            printf("cannot write %s%s\n", argv[0], name);
+            return 1;
+        }
+        printf("%s%s %ux%u checksum %016llx\n", argv[0], name, width, height,
+               static_cast<unsigned long long>(Fnv1a(pixels.data(), pixels.size())));
+    }
+    return 0;
+}
+
+/*
+ * Per image timings of one corpus stage.
+ */
+struct StageSamples {
+    const c8* name;
+    vector<f64> ms;
+    f64 megaPixels = 0.0;
+
+    void Add(f64 sample, f64 imageMegaPixels)
+    {
+        ms.push_back(sample);
+        megaPixels += imageMegaPixels;
+    }
+
+    // Nearest rank percentile, always one of the samples.
+    static f64 Percentile(const vector<f64>& sorted, f64 p)
+    {
+        size_t rank = static_cast<size_t>(ceil(p * sorted.size()));
+        return sorted[max<size_t>(rank, 1) - 1];
+    }
+
+    void Print() const
+    {
+        vector<f64> sorted = ms;
+        sort(sorted.begin(), sorted.end());
+        f64 total = 0.0;
+        for (f64 sample : sorted) {
+            total += sample;
+        }
+        printf("  %-8s p50 %8.3fms p95 %8.3fms p99 %8.3fms max %8.3fms %9.2fMPix/s\n", name,
+               Percentile(sorted, 0.50), Percentile(sorted, 0.95), Percentile(sorted, 0.99), sorted.back(),
+               total > 0.0 ? megaPixels * 1000.0 / total : 0.0);
+    }
+};
+
+/*
+ * Reads path into rgb as packed RGB8, whatever PNM flavour the file has.
+ */
+bool ReadRGB(const String& path, vector<u8>& rgb, BufferDescriptor& buffer)
+{
+    BufferDescriptor mapped;
+    if (!PNMCodec::Read(path, mapped)) {
+        return false;
+    }
+    rgb.resize(static_cast<size_t>(mapped.width) * mapped.height * 3);
+    buffer = {rgb.data(), static_cast<int>(rgb.size()), mapped.width, mapped.height, PIXEL_FORMAT_R8G8B8_UNORM};
+    bool converted = PixelConverter::Convert(mapped, buffer);
+    PNMCodec::Release(mapped);
+    return converted;
+}
+
+/*
+ * corpus <assetsDir> <inputDir> [cpu|standin] [repeats] [costMs] [referenceDir]
+ * Enhances every .ppm of inputDir through an OSRSession and reports per stage latency percentiles and
+ * throughput, how well the estimatedCostTime of the query predicted the enhance stage, and PSNR/SSIM of
+ * the output against the input or against the file of the same name in referenceDir. The first image is
+ * enhanced once before timing starts. The corpus and output checksums tell whether two runs saw the same
+ * pixels, the quality numbers come from exact integer sums and match across instruction sets.
+ */
+int RunCorpus(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf("usage: corpus <assetsDir> <inputDir> [cpu|standin] [repeats] [costMs] [referenceDir]\n");
+        return 1;
+    }
+    const bool useCpu = argc <= 2 || strcmp(argv[2], "standin") != 0;
+    const u32 repeats = argc > 3 ? max(1, atoi(argv[3])) : 3;
+    const f32 costMs = argc > 4 ? static_cast<f32>(atof(argv[4])) : DEFAULT_COST_MS;
+    const String referenceDir = argc > 5 ? argv[5] : "";
+    const vector<String> inputs = OSRPlugin::ListPPMFiles(argv[1]);
+    if (inputs.empty()) {
+        printf("no .ppm in %s\n", argv[1]);
+        return 1;
+    }
+    OSRCpuPlugin cpu;
+    OSRStandInPlugin standIn(costMs, 1);
+    OSRSession session(useCpu ? static_cast<IPlugin*>(&cpu) : static_cast<IPlugin*>(&standIn));
+    session.SetCpuFallback(false);
+    if (!session.Open(argv[0])) {
+        printf("open failed\n");
+        return 1;
+    }
+    const String outPath = String(argv[0]) + "/corpus_bench_out.ppm";
+
+    StageSamples stages[] = {{"read", {}}, {"query", {}}, {"enhance", {}}, {"write", {}}, {"quality", {}}};
+    StageSamples& read = stages[0];
+    StageSamples& query = stages[1];
+    StageSamples& enhance = stages[2];
+    StageSamples& write = stages[3];
+    StageSamples& quality = stages[4];
+    u64 corpusHash = Fnv1a(nullptr, 0);
+    u64 outputHash = Fnv1a(nullptr, 0);
+    f64 estimateMs = 0.0;
+    f64 estimateError = 0.0;
+    f64 psnrSum = 0.0;
+    f64 ssimSum = 0.0;
+    u32 finitePsnr = 0;
+    u32 frames = 0;
+    vector<u8> inPixels;
+    vector<u8> refPixels;
+    vector<u8> outPixels;
+    for (u32 pass = 0; pass <= repeats; pass++) {
+        // pass 0 warms up caches, the thread pool and the query cache on the first image
+        const size_t count = pass == 0 ? 1 : inputs.size();
+        for (size_t n = 0; n < count; n++) {
+            const bool timed = pass > 0;
+            BufferDescriptor inBuffer;
+            Clock::time_point t = Clock::now();
+            if (!ReadRGB(inputs[n], inPixels, inBuffer)) {
+                printf("cannot read %s\n", inputs[n].c_str());
+                return 1;
+            }
+            f64 readMs = ElapsedMs(t);
+            const f64 megaPixels = static_cast<f64>(inBuffer.width) * inBuffer.height / 1000000.0;
+
+            PluginConfig config;
+            t = Clock::now();
+            if (!session.QueryImage(inBuffer, config)) {
+                printf("query failed for %s\n", inputs[n].c_str());
+                return 1;
+            }
+            f64 queryMs = ElapsedMs(t);
+
+            outPixels.resize(static_cast<size_t>(config.output.width) * config.output.height * 3);
+            BufferDescriptor outBuffer {outPixels.data(), static_cast<int>(outPixels.size()), config.output.width,
+                config.output.height, config.output.format};
+            t = Clock::now();
+            if (!session.ImageEnhancingSync(inBuffer, outBuffer)) {
+                printf("enhance failed for %s\n", inputs[n].c_str());
+                return 1;
+            }
+            f64 enhanceMs = ElapsedMs(t);
+
+            t = Clock::now();
+            if (!PNMCodec::Write(outPath, outBuffer)) {
+                printf("cannot write %s\n", outPath.c_str());
+                return 1;
+            }
+            f64 writeMs = ElapsedMs(t);
+
+            BufferDescriptor refBuffer = inBuffer;
+            if (!referenceDir.empty()) {
+                String name = inputs[n].substr(inputs[n].find_last_of('/') + 1);
+                if (!ReadRGB(referenceDir + "/" + name, refPixels, refBuffer)) {
+                    printf("cannot read reference %s/%s\n", referenceDir.c_str(), name.c_str());
+                    return 1;
+                }
+            }
+            f64 psnr = 0.0;
+            f64 ssim = 0.0;
+            t = Clock::now();
+            if (!ImageQuality::PSNR(outBuffer, refBuffer, psnr) || !ImageQuality::SSIM(outBuffer, refBuffer, ssim)) {
+                printf("cannot compare %s, output and reference differ in size\n", inputs[n].c_str());
+                return 1;
+            }
+            f64 qualityMs = ElapsedMs(t);
+            if (!timed) {
+                continue;
+            }
+            read.Add(readMs, megaPixels);
+            query.Add(queryMs, megaPixels);
+            enhance.Add(enhanceMs, megaPixels);
+            write.Add(writeMs, megaPixels);
+            quality.Add(qualityMs, megaPixels);
+            estimateMs += config.estimatedCostTime;
+            estimateError += fabs(config.estimatedCostTime - enhanceMs) / max(enhanceMs, 0.001);
+            frames++;
+            if (pass == 1) {
+                // quality and pixels are the same every pass, count them once
+                corpusHash = Fnv1a(inPixels.data(), inPixels.size(), corpusHash);
+                outputHash = Fnv1a(outPixels.data(), outPixels.size(), outputHash);
+                if (isinf(psnr)) {
+                    printf("  %-40s PSNR      inf SSIM %.5f\n", inputs[n].c_str(), ssim);
+                } else {
+                    printf("  %-40s PSNR %8.3f SSIM %.5f\n", inputs[n].c_str(), psnr, ssim);
+                    psnrSum += psnr;
+                    finitePsnr++;
+                }
+                ssimSum += ssim;
+            }
+        }
+    }
+    remove(outPath.c_str());
+
+    f64 measuredMs = 0.0;
+    for (f64 sample : enhance.ms) {
+        measuredMs += sample;
+    }
+    printf("%s engine, isa %s, %u workers, %zu images x %u repeats, corpus %016llx output %016llx\n",
+           useCpu ? "cpu" : "standin", PixelConverter::GetIsaName(PixelConverter::GetIsa()),
+           max(1u, thread::hardware_concurrency()), inputs.size(), repeats,
+           static_cast<unsigned long long>(corpusHash), static_cast<unsigned long long>(outputHash));
+    for (const StageSamples& stage : stages) {
+        stage.Print();
+    }
+    printf("  estimate mean %8.3fms measured mean %8.3fms mean abs error %.1f%%\n", estimateMs / frames,
+           measuredMs / frames, estimateError * 100.0 / frames);
+    printf("  quality  mean PSNR %.3f dB over %u images (%zu identical) mean SSIM %.5f\n",
+           finitePsnr > 0 ? psnrSum / finitePsnr : 0.0, finitePsnr, inputs.size() - finitePsnr,
+           ssimSum / inputs.size());
+    return 0;
+}
+
+/*
+ * Reads the arguments of an Update style call and does nothing else, so the call costs only the
+ * Param handling around it.
+ */
+class NullPlugin : public IPlugin {
+public:
+    const String& GetPluginInfo() const override
+    {
+        return m_info;
+    }
+
+    bool Execute(const Param& paramIn, Param& paramOut) override
+    {
+        if (!paramIn.IsArray() || paramIn.ArrayLen() < 3 || !paramOut.IsArray()) {
+            return false;
+        }
+        m_sum += paramIn.Get(0).Get<s32>() + paramIn.Get(1).Get<f32>();
+        return paramIn.Get(2).Get() != nullptr && paramOut.Get(0).Get() != nullptr;
+    }
+
+    f64 GetSum() const
+    {
+        return m_sum;
+    }
+
+private:
+    bool Initialize() override
+    {
+        return true;
+    }
+
+    void Uninitialize() override {}
+
+    const String m_info = "null plugin";
+    f64 m_sum = 0.0;
+};
+
+/*
+ * callframe [iterations]
+ * Issues an opcode, f32, pointer call with a fresh Param array per call, as OSRSession did before, and
+ * through a reused PluginCallFrame, and reports the time and heap allocations per call.
+ */
+int RunCallFrame(int argc, char** argv)
+{
+    const u32 iterations = argc > 0 ? max(1, atoi(argv[0])) : 1000000;
+    NullPlugin plugin;
+    s32 target = 0;
+    bool ok = true;
+
+    u64 allocations = g_allocations.load();
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        Param paramIn, paramOut;
+        Param pi0;
+        pi0.Set<s32>(static_cast<s32>(i & 7));
+        Param pi1;
+        pi1.Set<f32>(0.016f);
+        Param pi2;
+        pi2.Set<void*>(static_cast<void*>(&target));
+        paramIn.Set(0, pi0);
+        paramIn.Set(1, pi1);
+        paramIn.Set(2, pi2);
+        Param po0;
+        po0.Set<void*>(static_cast<void*>(&target));
+        paramOut.Set(0, po0);
+        ok = plugin.Execute(paramIn, paramOut) && ok;
+    }
+    f64 paramNs = ElapsedMs(t) * 1000000.0 / iterations;
+    f64 paramAllocations = static_cast<f64>(g_allocations.load() - allocations) / iterations;
+
+    PluginCallFrame<3> frame;
+    allocations = g_allocations.load();
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        frame.Set<s32>(0, static_cast<s32>(i & 7));
+        frame.Set<f32>(1, 0.016f);
+        frame.Set<void*>(2, static_cast<void*>(&target));
+        frame.SetOut<void*>(0, static_cast<void*>(&target));
+        ok = frame.Execute(plugin) && ok;
+    }
+    f64 frameNs = ElapsedMs(t) * 1000000.0 / iterations;
+    f64 frameAllocations = static_cast<f64>(g_allocations.load() - allocations) / iterations;
+
+    printf("%u calls (checksum %.1f)%s\n", iterations, plugin.GetSum(), ok ? "" : " FAILED");
+    printf("  param array %8.1fns/call %6.2f allocations/call\n", paramNs, paramAllocations);
+    printf("  call frame  %8.1fns/call %6.2f allocations/call\n", frameNs, frameAllocations);
+    return ok ? 0 : 1;
+}
+
+/*
+ * Builds a parameter tree from json the way a material loader does, through the Set API that Param and
+ * CompactParam share. Numbers without fraction become s32, the others f32. Param copies the moved
+ * children, CompactParam takes them over.
+ */
+template<typename P>
+void BuildTree(const nlohmann::json& json, P& param)
+{
+    if (json.is_object()) {
+        for (auto it = json.begin(); it != json.end(); ++it) {
+            P member;
+            BuildTree(it.value(), member);
+            param.Set(it.key(), std::move(member));
+        }
+        if (json.empty()) {
+            param.template Set<typename P::Object>(typename P::Object());
+        }
+    } else if (json.is_array()) {
+        u32 idx = 0;
+        for (const nlohmann::json& element : json) {
+            P child;
+            BuildTree(element, child);
+            param.Set(idx++, std::move(child));
+        }
+        if (json.empty()) {
+            param.template Set<typename P::Array>(typename P::Array());
+        }
+    } else if (json.is_string()) {
+        param.template Set<String>(json.template get<String>());
+    } else if (json.is_boolean()) {
+        param.template Set<bool>(json.template get<bool>());
+    } else if (json.is_number_integer()) {
+        param.template Set<s32>(json.template get<s32>());
+    } else if (json.is_number()) {
+        param.template Set<f32>(json.template get<f32>());
+    }
+}
+
+template<typename P>
+u32 CountNodes(const P& param)
+{
+    u32 nodes = 1;
+    if (param.IsArray()) {
+        for (size_t i = 0; i < param.ArrayLen(); i++) {
+            nodes += CountNodes(param.Get(static_cast<u32>(i)));
+        }
+    } else if (param.IsObject()) {
+        for (const String& key : param.Keys()) {
+            nodes += CountNodes(param.Get(key));
+        }
+    }
+    return nodes;
+}
+
+struct TreeLoad {
+    f64 ms = 0.0;
+    s64 bytes = 0;
+    u64 allocations = 0;
+    u32 nodes = 0;
+};
+
+/*
+ * Builds one tree per document with build, iterations times, and keeps the last set alive to measure it.
+ */
+template<typename P, typename Build>
+TreeLoad LoadTrees(const vector<nlohmann::json>& documents, u32 iterations, Build build)
+{
+    TreeLoad load;
+    Clock::time_point t = Clock::now();
+    for (u32 i = 1; i < iterations; i++) {
+        for (const nlohmann::json& document : documents) {
+            P root;
+            build(document, root);
+        }
+    }
+    s64 liveBytes = g_liveBytes.load();
+    u64 allocations = g_allocations.load();
+    vector<P> roots(documents.size());
+    for (size_t i = 0; i < documents.size(); i++) {
+        build(documents[i], roots[i]);
+    }
+    load.ms = ElapsedMs(t) / iterations;
+    load.bytes = g_liveBytes.load() - liveBytes + static_cast<s64>(sizeof(P) * roots.size());
+    load.allocations = g_allocations.load() - allocations;
+    for (const P& root : roots) {
+        load.nodes += CountNodes(root);
+    }
+    return load;
+}
+
+/*
+ * cgmat <iterations> <file.cgmat>...
+ * Parses the material files once, then builds their parameter trees as Param and as CompactParam through
+ * the Set API, and as CompactParam through FromJson. Reports the load time, the heap the trees hold and
+ * their allocations, plus the cost of handing a CompactParam tree to the SDK as Param.
+ */
+int RunCgmat(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf("usage: cgmat <iterations> <file.cgmat>...\n");
+        return 1;
+    }
+    const u32 iterations = max(1, atoi(argv[0]));
+    vector<nlohmann::json> documents;
+    size_t fileBytes = 0;
+    for (s32 i = 1; i < argc; i++) {
+        ifstream file(argv[i], ios::in | ios::binary);
+        stringstream text;
+        text << file.rdbuf();
+        if (!file) {
+            printf("cannot read %s\n", argv[i]);
+            return 1;
+        }
+        fileBytes += text.str().size();
+        documents.push_back(nlohmann::json::parse(text.str(), nullptr, false));
+        if (documents.back().is_discarded()) {
+            printf("%s is not valid json\n", argv[i]);
+            return 1;
+        }
+    }
+
+    TreeLoad param = LoadTrees<Param>(documents, iterations, BuildTree<Param>);
+    TreeLoad compact = LoadTrees<CompactParam>(documents, iterations, BuildTree<CompactParam>);
+    TreeLoad fromJson = LoadTrees<CompactParam>(documents, iterations,
+        [](const nlohmann::json& document, CompactParam& root) { root = CompactParam::FromJson(document); });
+
+    vector<CompactParam> roots(documents.size());
+    for (size_t i = 0; i < documents.size(); i++) {
+        BuildTree(documents[i], roots[i]);
+    }
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const CompactParam& root : roots) {
+            Param converted;
+            root.ToParam(converted);
+        }
+    }
+    f64 toParamMs = ElapsedMs(t) / iterations;
+
+    printf("%zu files, %zu bytes of json, %u nodes, %u iterations\n", documents.size(), fileBytes, param.nodes,
+           iterations);
+    printf("  Param        sizeof %3zu %8.3fms/load %9lld bytes %6llu allocations\n", sizeof(Param), param.ms,
+           static_cast<long long>(param.bytes), static_cast<unsigned long long>(param.allocations));
+    printf("  CompactParam sizeof %3zu %8.3fms/load %9lld bytes %6llu allocations\n", sizeof(CompactParam),
+           compact.ms, static_cast<long long>(compact.bytes), static_cast<unsigned long long>(compact.allocations));
+    printf("  FromJson     sizeof %3zu %8.3fms/load %9lld bytes %6llu allocations\n", sizeof(CompactParam),
+           fromJson.ms, static_cast<long long>(fromJson.bytes), static_cast<unsigned long long>(fromJson.allocations));
+    printf("  CompactParam -> Param %8.3fms/load\n", toParamMs);
+    return (compact.nodes == param.nodes && fromJson.nodes == param.nodes) ? 0 : 1;
+}
+
+/*
+ * parambin <iterations> <outDir> <file.cgmat>...
+ * Encodes each material into outDir/<n>.cgpb, then compares loading it back as Param from the json text
+ * (parse and build) and from the mapped binary (open and decode), plus opening the binary and looking up
+ * every top-level member without decoding anything.
+ */
+int RunParamBin(int argc, char** argv)
+{
+    if (argc < 3) {
+        printf("usage: parambin <iterations> <outDir> <file.cgmat>...\n");
+        return 1;
+    }
+    const u32 iterations = max(1, atoi(argv[0]));
+    vector<String> texts;
+    vector<String> binaries;
+    size_t textBytes = 0;
+    size_t binaryBytes = 0;
+    bool ok = true;
+    for (s32 i = 2; i < argc; i++) {
+        ifstream file(argv[i], ios::in | ios::binary);
+        stringstream text;
+        text << file.rdbuf();
+        nlohmann::json document = nlohmann::json::parse(text.str(), nullptr, false);
+        if (!file || document.is_discarded()) {
+            printf("cannot read %s as json\n", argv[i]);
+            return 1;
+        }
+        Param param;
+        BuildTree(document, param);
+        vector<u8> blob;
+        ParamBinary::Encode(param, blob);
+        binaryBytes += blob.size();
+        String binary = String(argv[1]) + "/" + to_string(i - 2) + ".cgpb";
+        if (!ParamBinary::Save(binary, param)) {
+            printf("cannot write %s\n", binary.c_str());
+            return 1;
+        }
+        ParamFile check;
+        Param decoded;
+        ok = ok && check.Open(binary);
+        check.Root().ToParam(decoded);
+        ok = ok && CountNodes(decoded) == CountNodes(param);
+        texts.push_back(text.str());
+        binaries.push_back(binary);
+        textBytes += text.str().size();
+    }
+
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const String& text : texts) {
+            Param param;
+            BuildTree(nlohmann::json::parse(text), param);
+        }
+    }
+    f64 jsonMs = ElapsedMs(t) / iterations;
+
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const String& binary : binaries) {
+            ParamFile file;
+            Param param;
+            file.Open(binary);
+            file.Root().ToParam(param);
+        }
+    }
+    f64 decodeMs = ElapsedMs(t) / iterations;
+
+    u32 found = 0;
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const String& binary : binaries) {
+            ParamFile file;
+            file.Open(binary);
+            ParamView root = file.Root();
+            for (s32 m = 0; m < root.Size(); m++) {
+                found += root.Get(root.KeyAt(m)).IsValid() ? 1 : 0;
+            }
+        }
+    }
+    f64 lazyMs = ElapsedMs(t) / iterations;
+
+    printf("%zu files, %zu bytes of json, %zu bytes binary, %u iterations\n", texts.size(), textBytes, binaryBytes,
+           iterations);
+    printf("  json parse + build  %8.3fms/load\n", jsonMs);
+    printf("  binary open + decode %7.3fms/load\n", decodeMs);
+    printf("  binary open + lookup %7.3fms/load (%u members)\n", lazyMs, found / iterations);
+    return ok ? 0 : 1;
+}
+
+/*
+ * material <iterations> <cacheDir> <file.cgmat>...
+ * Compares building a json DOM of each material with the streaming parse into MaterialDesc, then loading
+ * through a warm .cgmc cache in cacheDir (read, hash, decode) and decoding the cache alone.
+ */
+int RunMaterial(int argc, char** argv)
+{
+    if (argc < 3) {
+        printf("usage: material <iterations> <cacheDir> <file.cgmat>...\n");
+        return 1;
+    }
+    const u32 iterations = max(1, atoi(argv[0]));
+    const String cacheDir = argv[1];
+    vector<String> paths;
+    vector<String> texts;
+    vector<vector<u8>> caches;
+    size_t textBytes = 0;
+    size_t cacheBytes = 0;
+    for (s32 i = 2; i < argc; i++) {
+        ifstream file(argv[i], ios::in | ios::binary);
+        stringstream text;
+        text << file.rdbuf();
+        MaterialDesc material;
+        if (!file || !CgmatLoader::Load(argv[i], cacheDir, material)) {
+            printf("cannot load %s\n", argv[i]);
+            return 1;
+        }
+        const String& content = text.str();
+        u64 hash = CgmatLoader::ContentHash(reinterpret_cast<const u8*>(content.data()), content.size());
+        caches.emplace_back();
+        CgmatLoader::Encode(material, hash, caches.back());
+        paths.push_back(argv[i]);
+        texts.push_back(content);
+        textBytes += content.size();
+        cacheBytes += caches.back().size();
+    }
+
+    u64 allocations = g_allocations.load();
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const String& text : texts) {
+            nlohmann::json document = nlohmann::json::parse(text);
+        }
+    }
+    f64 domMs = ElapsedMs(t) / iterations;
+    u64 domAllocations = (g_allocations.load() - allocations) / iterations;
+
+    bool ok = true;
+    allocations = g_allocations.load();
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const String& text : texts) {
+            MaterialDesc material;
+            ok = CgmatLoader::Parse(text.data(), text.size(), material) && ok;
+        }
+    }
+    f64 saxMs = ElapsedMs(t) / iterations;
+    u64 saxAllocations = (g_allocations.load() - allocations) / iterations;
+
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const String& path : paths) {
+            MaterialDesc material;
+            ok = CgmatLoader::Load(path, cacheDir, material) && ok;
+        }
+    }
+    f64 loadMs = ElapsedMs(t) / iterations;
+
+    allocations = g_allocations.load();
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (size_t m = 0; m < caches.size(); m++) {
+            MaterialDesc material;
+            u64 hash = CgmatLoader::ContentHash(reinterpret_cast<const u8*>(texts[m].data()), texts[m].size());
+            ok = CgmatLoader::Decode(caches[m].data(), caches[m].size(), hash, material) && ok;
+        }
+    }
+    f64 decodeMs = ElapsedMs(t) / iterations;
+    u64 decodeAllocations = (g_allocations.load() - allocations) / iterations;
+
+    printf("%zu files, %zu bytes of json, %zu bytes of cache, %u iterations\n", texts.size(), textBytes, cacheBytes,
+           iterations);
+    printf("  json DOM parse       %8.3fms/load %6llu allocations\n", domMs,
+           static_cast<unsigned long long>(domAllocations));
+    printf("  SAX parse            %8.3fms/load %6llu allocations\n", saxMs,
+           static_cast<unsigned long long>(saxAllocations));
+    printf("  cached load          %8.3fms/load\n", loadMs);
+    printf("  hash + cache decode  %8.3fms/load %6llu allocations\n", decodeMs,
+           static_cast<unsigned long long>(decodeAllocations));
+    return ok ? 0 : 1;
+}
+
+bool SameStates(const PipelineCreateInfo& a, const PipelineCreateInfo& b)
+{
+    const RasterizationState& ra = a.rasterizationState;
+    const RasterizationState& rb = b.rasterizationState;
+    const DepthStencilState& da = a.depthStencilState;
+    const DepthStencilState& db = b.depthStencilState;
+    const ColorBlendState& ca = a.colorBlendState;
+    const ColorBlendState& cb = b.colorBlendState;
+    auto sameOp = [](const DepthStencilOp& x, const DepthStencilOp& y) {
+        return x.stencilFail == y.stencilFail && x.stencilDepthFail == y.stencilDepthFail &&
+            x.stencilPass == y.stencilPass && x.stencilFunc == y.stencilFunc &&
+            x.stencilCompareMask == y.stencilCompareMask && x.stencilReference == y.stencilReference &&
+            x.stencilReadMask == y.stencilReadMask && x.stencilWriteMask == y.stencilWriteMask;
+    };
+    if (ra.depthClampEnable != rb.depthClampEnable || ra.rasterizerDiscardEnable != rb.rasterizerDiscardEnable ||
+        ra.polygonMode != rb.polygonMode || ra.cullmode != rb.cullmode || ra.frontFace != rb.frontFace ||
+        ra.depthBiasEnable != rb.depthBiasEnable || ra.depthBiasConstantFactor != rb.depthBiasConstantFactor ||
+        ra.depthBiasClamp != rb.depthBiasClamp || ra.depthBiasSlopeFactor != rb.depthBiasSlopeFactor ||
+        ra.lineWidth != rb.lineWidth) {
+        return false;
+    }
+    if (da.depthTestEnable != db.depthTestEnable || da.depthWriteEnable != db.depthWriteEnable ||
+        da.depthFunc != db.depthFunc || da.depthBoundsTestEnable != db.depthBoundsTestEnable ||
+        da.stencilTestEnable != db.stencilTestEnable || !sameOp(da.front, db.front) || !sameOp(da.back, db.back)) {
+        return false;
+    }
+    if (ca.logicOpEnable != cb.logicOpEnable || ca.logicOp != cb.logicOp ||
+        ca.attachments.size() != cb.attachments.size() || ca.blendConstants != cb.blendConstants) {
+        return false;
+    }
+    for (size_t i = 0; i < ca.attachments.size(); i++) {
+        const BlendAttachmentState& x = ca.attachments[i];
+        const BlendAttachmentState& y = cb.attachments[i];
+        if (x.blendingEnable != y.blendingEnable || x.srcColorBlend != y.srcColorBlend ||
+            x.dstColorBlend != y.dstColorBlend || x.colorBlendOp != y.colorBlendOp ||
+            x.srcAlphaBlend != y.srcAlphaBlend || x.dstAlphaBlend != y.dstAlphaBlend ||
+            x.alphaBlendOp != y.alphaBlendOp || x.colorMask != y.colorMask || x.blendFactor != y.blendFactor) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * renderstate <iterations> <file.cgmat>...
+ * Loads the materials and compares keeping every pass's rasterization, depth/stencil and blend blocks with
+ * keeping their RenderStateTable ids: bytes per pass, and the cost of comparing every pair of passes the
+ * way a pipeline cache compares keys, field by field or by id.
+ */
+int RunRenderState(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf("usage: renderstate <iterations> <file.cgmat>...\n");
+        return 1;
+    }
+    const u32 iterations = max(1, atoi(argv[0]));
+    vector<RenderStateIds> ids;
+    vector<PipelineCreateInfo> pipelines;
+    for (s32 i = 1; i < argc; i++) {
+        MaterialDesc material;
+        if (!CgmatLoader::Load(argv[i], "", material)) {
+            printf("cannot load %s\n", argv[i]);
+            return 1;
+        }
+        for (const MaterialTechnique& technique : material.techniques) {
+            for (const MaterialPass& pass : technique.passes) {
+                ids.push_back(pass.states);
+                pipelines.emplace_back();
+                RenderStateTable::Expand(pass.states, pipelines.back());
+            }
+        }
+    }
+    size_t stateBytes = 0;
+    for (const PipelineCreateInfo& pipeline : pipelines) {
+        const ColorBlendState& blend = pipeline.colorBlendState;
+        stateBytes += sizeof(RasterizationState) + sizeof(DepthStencilState) + sizeof(ColorBlendState) +
+            blend.attachments.capacity() * sizeof(BlendAttachmentState) + blend.blendConstants.capacity() * sizeof(f32);
+    }
+    set<u16> rasterizations;
+    set<u16> depthStencils;
+    set<u16> colorBlends;
+    for (const RenderStateIds& id : ids) {
+        rasterizations.insert(id.rasterization);
+        depthStencils.insert(id.depthStencil);
+        colorBlends.insert(id.colorBlend);
+    }
+
+    u64 fieldMatches = 0;
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const PipelineCreateInfo& a : pipelines) {
+            for (const PipelineCreateInfo& b : pipelines) {
+                fieldMatches += SameStates(a, b) ? 1 : 0;
+            }
+        }
+    }
+    f64 fieldMs = ElapsedMs(t) / iterations;
+
+    u64 idMatches = 0;
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        for (const RenderStateIds& a : ids) {
+            for (const RenderStateIds& b : ids) {
+                idMatches += (a.Key() == b.Key()) ? 1 : 0;
+            }
+        }
+    }
+    f64 idMs = ElapsedMs(t) / iterations;
+
+    size_t pairs = ids.size() * ids.size();
+    printf("%zu passes, %zu rasterization, %zu depth/stencil, %zu color blend states, %u iterations\n", ids.size(),
+           rasterizations.size(), depthStencils.size(), colorBlends.size(), iterations);
+    printf("  state blocks  %5zu bytes/pass  %8.2fns/compare\n", stateBytes / max<size_t>(1, ids.size()),
+           fieldMs * 1e6 / max<size_t>(1, pairs));
+    printf("  state ids     %5zu bytes/pass  %8.2fns/compare\n", sizeof(RenderStateIds),
+           idMs * 1e6 / max<size_t>(1, pairs));
+    return (fieldMatches == idMatches) ? 0 : 1;
+}
+
+// Largest difference relative to max(1, |reference|).
+f64 MaxError(const f32* reference, const f32* values, size_t count)
+{
+    f64 error = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        f64 difference = fabs(static_cast<f64>(values[i]) - reference[i]);
+        error = max(error, difference / max(1.0, fabs(static_cast<f64>(reference[i]))));
+    }
+    return error;
+}
+
+/*
+ * matrix [elements]
+ * Times every MatrixBatch operation on batches of 1 to 100k with each instruction set the CPU supports,
+ * repeating each batch until about elements elements are done, and checks the results against scalar.
+ * Time NDEBUG builds, debug builds also check the inputs of the affine inverses.
+ */
+int RunMatrix(int argc, char** argv)
+{
+    const u32 elements = argc > 0 ? max(1, atoi(argv[0])) : 2000000;
+    const u32 sizes[] = {1, 10, 100, 1000, 10000, 100000};
+    const u32 largest = 100000;
+    const c8* operations[] = {"multiply", "multiply shared", "transpose", "inverse", "transform",
+        "transform each", "points", "points each", "points soa", "directions", "make transform", "inverse affine",
+        "inverse rigid", "inverse trs", "normal matrix", "boxes", "boxes each", "bounds"};
+    const u32 operationCount = sizeof(operations) / sizeof(operations[0]);
+    vector<Matrix4> a(largest);
+    vector<Matrix4> b(largest);
+    vector<Vector4> vectors(largest);
+    vector<Vector3> positions(largest);
+    vector<Vector3> scales(largest);
+    vector<Quaternion> orientations(largest);
+    u32 seed = 1;
+    auto random = [&seed](f32 low, f32 high) {
+        seed = seed * 1664525u + 1013904223u;
+        return low + (high - low) * static_cast<f32>(seed >> 8) / static_cast<f32>(1u << 24);
+    };
+    for (u32 i = 0; i < largest; i++) {
+        for (u32 e = 0; e < MATRIX_FLOATS; e++) {
+            a[i].m[e] = random(-2.0f, 2.0f);
+            b[i].m[e] = random(-2.0f, 2.0f);
+        }
+        // well conditioned like scene transforms, so the inverse error shows the kernels, not the input
+        for (u32 d = 0; d < MATRIX_ROWS; d++) {
+            a[i].M[d][d] += 8.0f;
+        }
+        vectors[i] = Vector4(random(-5.0f, 5.0f), random(-5.0f, 5.0f), random(-5.0f, 5.0f), 1.0f);
+        positions[i] = Vector3(random(-10.0f, 10.0f), random(-10.0f, 10.0f), random(-10.0f, 10.0f));
+        scales[i] = Vector3(random(0.1f, 3.0f), random(0.1f, 3.0f), random(0.1f, 3.0f));
+        Quaternion& q = orientations[i];
+        q.x = random(-1.0f, 1.0f);
+        q.y = random(-1.0f, 1.0f);
+        q.z = random(-1.0f, 1.0f);
+        q.w = random(-1.0f, 1.0f);
+        f32 norm = sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        q.x /= norm;
+        q.y /= norm;
+        q.z /= norm;
+        q.w /= norm;
+    }
+    vector<f32> soa(largest * VECTOR3_FLOATS);
+    for (u32 i = 0; i < largest; i++) {
+        soa[i] = positions[i].x;
+        soa[largest + i] = positions[i].y;
+        soa[2 * largest + i] = positions[i].z;
+    }
+    const ConstVector3SoA soaIn(soa.data(), soa.data() + largest, soa.data() + 2 * largest);
+    vector<Matrix4> affine(largest);
+    vector<Matrix4> rigid(largest);
+    const vector<Vector3> units(largest, Vector3(1.0f, 1.0f, 1.0f));
+    MatrixBatch::MakeTransform(positions.data(), scales.data(), orientations.data(), affine.data(), largest);
+    MatrixBatch::MakeTransform(positions.data(), units.data(), orientations.data(), rigid.data(), largest);
+    vector<BoundingBox> boxes(largest);
+    for (u32 i = 0; i < largest; i++) {
+        const Float3 position(positions[i]);
+        const Float3 scale(scales[i]);
+        boxes[i] = BoundingBox(position - scale, position + scale);
+    }
+    vector<BoundingBox> transformedBoxes(largest);
+    BoundingBox bounds;
+    vector<Matrix4> matrices(largest);
+    vector<Vector4> transformed(largest);
+    vector<Vector3> points(largest);
+    vector<f32> soaOut(largest * VECTOR3_FLOATS);
+    const Vector3SoA soaResult = {soaOut.data(), soaOut.data() + largest, soaOut.data() + 2 * largest};
+    // floats of the scalar results of each operation on the largest batch
+    vector<vector<f32>> reference(operationCount);
+    auto run = [&](u32 operation, u32 size) {
+        switch (operation) {
+            case 0:
+                MatrixBatch::Multiply(a.data(), b.data(), matrices.data(), size);
+                break;
+            case 1:
+                MatrixBatch::Multiply(a.data(), b[0], matrices.data(), size);
+                break;
+            case 2:
+                MatrixBatch::Transpose(a.data(), matrices.data(), size);
+                break;
+            case 3:
+                MatrixBatch::Inverse(a.data(), matrices.data(), size);
+                break;
+            case 4:
+                MatrixBatch::Transform(a[0], vectors.data(), transformed.data(), size);
+                break;
+            case 5:
+                MatrixBatch::Transform(a.data(), vectors.data(), transformed.data(), size);
+                break;
+            case 6:
+                MatrixBatch::TransformPoints(a[0], positions.data(), points.data(), size);
+                break;
+            case 7:
+                MatrixBatch::TransformPoints(a.data(), positions.data(), points.data(), size);
+                break;
+            case 8:
+                MatrixBatch::TransformPoints(a[0], soaIn, soaResult, size);
+                break;
+            case 9:
+                MatrixBatch::TransformDirections(a[0], positions.data(), points.data(), size);
+                break;
+            case 10:
+                MatrixBatch::MakeTransform(positions.data(), scales.data(), orientations.data(), matrices.data(), size);
+                break;
+            case 11:
+                MatrixBatch::InverseAffine(affine.data(), matrices.data(), size);
+                break;
+            case 12:
+                MatrixBatch::InverseRigid(rigid.data(), matrices.data(), size);
+                break;
+            case 13:
+                MatrixBatch::InverseTransform(positions.data(), scales.data(), orientations.data(), matrices.data(),
+                    size);
+                break;
+            case 14:
+                MatrixBatch::NormalMatrix(affine.data(), matrices.data(), size);
+                break;
+            case 15:
+                MatrixBatch::TransformBoxes(affine[0], boxes.data(), transformedBoxes.data(), size);
+                break;
+            case 16:
+                MatrixBatch::TransformBoxes(affine.data(), boxes.data(), transformedBoxes.data(), size);
+                break;
+            default:
+                bounds = BoundingBox::Empty();
+                MatrixBatch::AddInternalPoints(positions.data(), size, bounds);
+                break;
+        }
+    };
+    auto result = [&](u32 operation) {
+        if (operation == 4 || operation == 5) {
+            return reinterpret_cast<const f32*>(transformed.data());
+        } else if (operation == 8) {
+            return const_cast<const f32*>(soaOut.data());
+        } else if (operation > 5 && operation < 10) {
+            return reinterpret_cast<const f32*>(points.data());
+        } else if (operation == 15 || operation == 16) {
+            return reinterpret_cast<const f32*>(transformedBoxes.data());
+        } else if (operation > 16) {
+            return reinterpret_cast<const f32*>(&bounds);
+        }
+        return reinterpret_cast<const f32*>(matrices.data());
+    };
+    auto resultFloats = [](u32 operation) {
+        if (operation == 4 || operation == 5) {
+            return static_cast<size_t>(largest) * VECTOR4_FLOATS;
+        } else if (operation > 5 && operation < 10) {
+            return static_cast<size_t>(largest) * VECTOR3_FLOATS;
+        } else if (operation == 15 || operation == 16) {
+            return static_cast<size_t>(largest) * BOX_FLOATS;
+        } else if (operation > 16) {
+            return static_cast<size_t>(BOX_FLOATS);
+        }
+        return static_cast<size_t>(largest) * MATRIX_FLOATS;
+    };
+
+    const MathIsa best = MatrixBatch::GetIsa();
+    for (u32 isa = MATH_ISA_SCALAR; isa < MATH_ISA_MAX; isa++) {
+        if (!MatrixBatch::SetIsa(static_cast<MathIsa>(isa))) {
+            continue;
+        }
+        printf("%s, %u elements per size, ns/element for batches of", MatrixBatch::GetIsaName(static_cast<MathIsa>(isa)),
+               elements);
+        for (u32 size : sizes) {
+            printf(" %u", size);
+        }
+        printf(", max error vs scalar\n");
+        for (u32 operation = 0; operation < operationCount; operation++) {
+            printf("  %-16s", operations[operation]);
+            for (u32 size : sizes) {
+                const u32 repeats = max(1u, elements / size);
+                Clock::time_point t = Clock::now();
+                for (u32 i = 0; i < repeats; i++) {
+                    run(operation, size);
+                }
+                printf(" %8.2f", ElapsedMs(t) * 1e6 / (static_cast<f64>(repeats) * size));
+            }
+            run(operation, largest);
+            const f32* values = result(operation);
+            if (isa == MATH_ISA_SCALAR) {
+                reference[operation].assign(values, values + resultFloats(operation));
+            }
+            printf("  %.2e\n", MaxError(reference[operation].data(), values, resultFloats(operation)));
+        }
+    }
+    MatrixBatch::SetIsa(best);
+    return 0;
+}
+
+// ns per element to copy-construct and destroy source, and to grow an empty vector to its size.
+template<typename T>
+void TimeBulkCopy(const c8* name, const vector<T>& source, u32 iterations)
+{
+    const f64 elements = static_cast<f64>(source.size()) * iterations;
+    u64 check = 0;
+    Clock::time_point t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        vector<T> copy(source);
+        check += copy.size();
+    }
+    const f64 copyMs = ElapsedMs(t);
+    t = Clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        vector<T> grown;
+        for (const T& value : source) {
+            grown.push_back(value);
+        }
+        check += grown.size();
+    }
+    const f64 growMs = ElapsedMs(t);
+    printf("  %-14s %8.2fns/copy %8.2fns/push_back%s\n", name, copyMs * 1e6 / elements, growMs * 1e6 / elements,
+           (check == 2 * static_cast<u64>(elements)) ? "" : " (bad size)");
+}
+
+/*
+ * podcopy [count] [iterations]
+ * Copies and grows arrays of the CGKit math types and of their trivially copyable PodMath mirrors.
+ */
+int RunPodCopy(int argc, char** argv)
+{
+    const u32 count = argc > 0 ? max(1, atoi(argv[0])) : 100000;
+    const u32 iterations = argc > 1 ? max(1, atoi(argv[1])) : 20;
+    vector<Vector3> vectors(count);
+    vector<Float3> floats(count);
+    vector<Matrix4> matrices(count);
+    vector<Float4x4> floatMatrices(count);
+    for (u32 i = 0; i < count; i++) {
+        vectors[i] = Vector3(static_cast<f32>(i), 1.0f, 2.0f);
+        floats[i] = Float3(vectors[i]);
+        matrices[i].m[0] = static_cast<f32>(i);
+        floatMatrices[i] = Float4x4(matrices[i]);
+    }
+    printf("%u elements, %u iterations\n", count, iterations);
+    TimeBulkCopy("Vector3", vectors, iterations);
+    TimeBulkCopy("Float3", floats, iterations);
+    TimeBulkCopy("Matrix4", matrices, iterations);
+    TimeBulkCopy("Float4x4", floatMatrices, iterations);
+    return 0;
+}
+
+/*
+ * cull [boxes]
+ * Frustum culls 1k, 10k and 100k boxes scattered around a camera, repeating each batch until about
+ * boxes boxes are done. First one object at a time through a pointer per object with an early out per
+ * plane, the way a scene graph walk tests them, then MatrixBatch::CullBoxes on center and extent arrays
+ * with each instruction set the CPU supports. Prints ns/box and the visible count of each batch.
+ */
+int RunCull(int argc, char** argv)
+{
+    const u32 boxCount = argc > 0 ? max(1, atoi(argv[0])) : 20000000;
+    const u32 sizes[] = {1000, 10000, 100000};
+    const u32 largest = 100000;
+    // 90 degree field of view looking down -z, near 0.5, far 200, OpenGL ES depth
+    const f32 zNear = 0.5f;
+    const f32 zFar = 200.0f;
+    const Float4x4 projection(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+        (zFar + zNear) / (zNear - zFar), -1.0f, 0.0f, 0.0f, 2.0f * zFar * zNear / (zNear - zFar), 0.0f);
+    PlaneEquation planes[FRUSTUM_PLANE_MAX];
+    MatrixBatch::GetFrustumPlanes(projection.ToMatrix4(), false, planes);
+
+    u32 seed = 1;
+    auto random = [&seed](f32 low, f32 high) {
+        seed = seed * 1664525u + 1013904223u;
+        return low + (high - low) * static_cast<f32>(seed >> 8) / static_cast<f32>(1u << 24);
+    };
+    vector<f32> soa(largest * BOX_FLOATS);
+    vector<unique_ptr<BoundingBox>> storage(largest);
+    for (u32 i = 0; i < largest; i++) {
+        storage[i].reset(new BoundingBox());
+    }
+    // object i lives at a random place among the allocations, like scene objects created over time
+    vector<BoundingBox*> objects(largest);
+    for (u32 i = 0; i < largest; i++) {
+        objects[i] = storage[i].get();
+    }
+    for (u32 i = largest - 1; i > 0; i--) {
+        swap(objects[i], objects[static_cast<u32>(random(0.0f, static_cast<f32>(i + 1))) % (i + 1)]);
+    }
+    for (u32 i = 0; i < largest; i++) {
+        const Float3 center(random(-100.0f, 100.0f), random(-100.0f, 100.0f), random(-100.0f, 100.0f));
+        const Float3 extent(random(0.1f, 2.0f), random(0.1f, 2.0f), random(0.1f, 2.0f));
+        *objects[i] = BoundingBox(center - extent, center + extent);
+        const f32 values[BOX_FLOATS] = {center.x, center.y, center.z, extent.x, extent.y, extent.z};
+        for (u32 e = 0; e < BOX_FLOATS; e++) {
+            soa[e * largest + i] = values[e];
+        }
+    }
+    const ConstVector3SoA centers(soa.data(), soa.data() + largest, soa.data() + 2 * largest);
+    const ConstVector3SoA extents(soa.data() + 3 * largest, soa.data() + 4 * largest, soa.data() + 5 * largest);
+    vector<u32> visible((largest + MASK_BITS - 1) / MASK_BITS);
+
+    auto oneAtATime = [&](u32 size) {
+        u32 count = 0;
+        for (u32 i = 0; i < size; i++) {
+            const BoundingBox& box = *objects[i];
+            const Float3 center = box.GetCenter();
+            const Float3 extent = box.GetHalfSize();
+            bool inside = true;
+            for (u32 p = 0; p < FRUSTUM_PLANE_MAX && inside; p++) {
+                const Float3& normal = planes[p].normal;
+                const Float3 absNormal(fabsf(normal.x), fabsf(normal.y), fabsf(normal.z));
+                inside = Dot(normal, center) + planes[p].distance + Dot(absNormal, extent) >= 0.0f;
+            }
+            count += inside ? 1 : 0;
+        }
+        return count;
+    };
+    auto batch = [&](u32 size) {
+        MatrixBatch::CullBoxes(planes, centers, extents, visible.data(), size);
+        u32 count = 0;
+        for (u32 word = 0; word < (size + MASK_BITS - 1) / MASK_BITS; word++) {
+            count += static_cast<u32>(__builtin_popcount(visible[word]));
+        }
+        return count;
+    };
+    auto measure = [&](const c8* name, const function<u32(u32)>& cull) {
+        printf("  %-14s", name);
+        for (u32 size : sizes) {
+            const u32 repeats = max(1u, boxCount / size);
+            u32 count = 0;
+            Clock::time_point t = Clock::now();
+            for (u32 i = 0; i < repeats; i++) {
+                count = cull(size);
+            }
+            printf(" %8.2f (%u)", ElapsedMs(t) * 1e6 / (static_cast<f64>(repeats) * size), count);
+        }
+        printf("\n");
+    };
+
+    printf("%u boxes per size, ns/box (visible) for batches of", boxCount);
+    for (u32 size : sizes) {
+        printf(" %u", size);
+    }
+    printf("\n");
+    measure("one at a time", oneAtATime);
+    const MathIsa best = MatrixBatch::GetIsa();
+    for (u32 isa = MATH_ISA_SCALAR; isa < MATH_ISA_MAX; isa++) {
+        if (MatrixBatch::SetIsa(static_cast<MathIsa>(isa))) {
+            measure(MatrixBatch::GetIsaName(static_cast<MathIsa>(isa)), batch);
+        }
+    }
+    MatrixBatch::SetIsa(best);
+    return 0;
+}
+
+/*
+ * pose [joints] [frames]
+ * Samples a looping clip of 30 keys for a skeleton and builds the local matrix of every joint, frames
+ * times. First joint by joint with a key search per joint, slerp through acos and sin and one
+ * MakeTransform each, the way per-node controllers do it, then with MatrixBatch on keys stored SoA per
+ * key with each instruction set the CPU supports. Prints us/frame and the max error against the first.
+ */
+int RunPose(int argc, char** argv)
+{
+    const u32 joints = argc > 0 ? max(1, atoi(argv[0])) : 128;
+    const u32 frames = argc > 1 ? max(1, atoi(argv[1])) : 20000;
+    const u32 keys = 30;
+    const f32 duration = 1.0f;
+    u32 seed = 1;
+    auto random = [&seed](f32 low, f32 high) {
+        seed = seed * 1664525u + 1013904223u;
+        return low + (high - low) * static_cast<f32>(seed >> 8) / static_cast<f32>(1u << 24);
+    };
+    vector<f32> times(keys);
+    for (u32 key = 0; key < keys; key++) {
+        times[key] = duration * static_cast<f32>(key) / static_cast<f32>(keys - 1);
+    }
+    // per key: x, y and z of positions and scales, x, y, z and w of rotations, each with an element per joint
+    const u32 keyFloats = (2 * VECTOR3_FLOATS + VECTOR4_FLOATS) * joints;
+    vector<f32> soa(keys * keyFloats);
+    for (u32 key = 0; key < keys; key++) {
+        f32* k = soa.data() + key * keyFloats;
+        for (u32 j = 0; j < joints; j++) {
+            for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+                k[c * joints + j] = random(-1.0f, 1.0f);
+                k[(VECTOR3_FLOATS + c) * joints + j] = random(0.9f, 1.1f);
+            }
+            f32 q[VECTOR4_FLOATS];
+            f32 norm = 0.0f;
+            for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+                q[c] = random(-1.0f, 1.0f);
+                norm += q[c] * q[c];
+            }
+            norm = sqrt(norm);
+            for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+                k[(2 * VECTOR3_FLOATS + c) * joints + j] = q[c] / norm;
+            }
+        }
+    }
+    // the same keys per joint, as separate tracks
+    struct Track {
+        vector<f32> times;
+        vector<Float3> positions;
+        vector<Float3> scales;
+        vector<Float4> rotations;
+    };
+    vector<Track> tracks(joints);
+    for (u32 j = 0; j < joints; j++) {
+        Track& track = tracks[j];
+        track.times = times;
+        for (u32 key = 0; key < keys; key++) {
+            const f32* k = soa.data() + key * keyFloats;
+            track.positions.push_back(Float3(k[j], k[joints + j], k[2 * joints + j]));
+            track.scales.push_back(Float3(k[3 * joints + j], k[4 * joints + j], k[5 * joints + j]));
+            track.rotations.push_back(Float4(k[6 * joints + j], k[7 * joints + j], k[8 * joints + j], k[9 * joints + j]));
+        }
+    }
+    vector<Matrix4> matrices(joints);
+    vector<Matrix4> reference(joints);
+    auto sampleTime = [&](u32 frame) {
+        return fmod(static_cast<f32>(frame) * (1.0f / 60.0f), duration);
+    };
+
+    auto jointByJoint = [&](f32 time) {
+        for (u32 j = 0; j < joints; j++) {
+            const Track& track = tracks[j];
+            const u32 next = static_cast<u32>(upper_bound(track.times.begin(), track.times.end(), time) -
+                track.times.begin());
+            const u32 key = (next == 0) ? 0 : min(next - 1, keys - 2);
+            const f32 t = min(1.0f, max(0.0f, (time - track.times[key]) / (track.times[key + 1] - track.times[key])));
+            const Float3 position = track.positions[key] + (track.positions[key + 1] - track.positions[key]) * t;
+            const Float3 scale = track.scales[key] + (track.scales[key + 1] - track.scales[key]) * t;
+            const Float4& a = track.rotations[key];
+            Float4 b = track.rotations[key + 1];
+            f32 cosine = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+            if (cosine < 0.0f) {
+                cosine = -cosine;
+                b = Float4(-b.x, -b.y, -b.z, -b.w);
+            }
+            f32 weightA = 1.0f - t;
+            f32 weightB = t;
+            if (cosine < 0.9999f) {
+                const f32 angle = acos(cosine);
+                const f32 inverseSine = 1.0f / sin(angle);
+                weightA = sin((1.0f - t) * angle) * inverseSine;
+                weightB = sin(t * angle) * inverseSine;
+            }
+            const Float4 rotation(a.x * weightA + b.x * weightB, a.y * weightA + b.y * weightB,
+                a.z * weightA + b.z * weightB, a.w * weightA + b.w * weightB);
+            MatrixScalar::MakeTransform(&position.x, &scale.x, &rotation.x, matrices[j].m, 1);
+        }
+    };
+    vector<f32> sampled(keyFloats);
+    auto batch = [&](f32 time) {
+        f32 t = 0.0f;
+        const u32 key = MatrixBatch::FindKeyframe(times.data(), keys, time, t);
+        const f32* a = soa.data() + key * keyFloats;
+        const f32* b = a + keyFloats;
+        // positions and scales in one run
+        MatrixBatch::Lerp(a, b, t, sampled.data(), 2 * VECTOR3_FLOATS * joints);
+        const u32 rotation = 2 * VECTOR3_FLOATS * joints;
+        f32* r = sampled.data() + rotation;
+        MatrixBatch::Slerp(ConstQuaternionSoA(a + rotation, a + rotation + joints, a + rotation + 2 * joints,
+            a + rotation + 3 * joints), ConstQuaternionSoA(b + rotation, b + rotation + joints,
+            b + rotation + 2 * joints, b + rotation + 3 * joints), t,
+            QuaternionSoA {r, r + joints, r + 2 * joints, r + 3 * joints}, joints);
+        const f32* s = sampled.data();
+        MatrixBatch::MakeTransform(ConstVector3SoA(s, s + joints, s + 2 * joints),
+            ConstVector3SoA(s + 3 * joints, s + 4 * joints, s + 5 * joints),
+            ConstQuaternionSoA(r, r + joints, r + 2 * joints, r + 3 * joints), matrices.data(), joints);
+    };
+    auto measure = [&](const c8* name, const function<void(f32)>& sample) {
+        Clock::time_point start = Clock::now();
+        for (u32 frame = 0; frame < frames; frame++) {
+            sample(sampleTime(frame));
+        }
+        const f64 us = ElapsedMs(start) * 1e3 / frames;
+        f64 error = 0.0;
+        for (u32 frame = 0; frame < 97; frame++) {
+            jointByJoint(sampleTime(frame));
+            reference = matrices;
+            sample(sampleTime(frame));
+            error = max(error, MaxError(reinterpret_cast<const f32*>(reference.data()),
+                reinterpret_cast<const f32*>(matrices.data()), static_cast<size_t>(joints) * MATRIX_FLOATS));
+        }
+        printf("  %-14s %8.2fus/frame %8.2fns/joint  max error %.2e\n", name, us, us * 1e3 / joints, error);
+    };
+
+    printf("%u joints, %u keys, %u frames\n", joints, keys, frames);
+    measure("joint by joint", jointByJoint);
+    const MathIsa best = MatrixBatch::GetIsa();
+    for (u32 isa = MATH_ISA_SCALAR; isa < MATH_ISA_MAX; isa++) {
+        if (MatrixBatch::SetIsa(static_cast<MathIsa>(isa))) {
+            measure(MatrixBatch::GetIsaName(static_cast<MathIsa>(isa)), batch);
+        }
+    }
+    MatrixBatch::SetIsa(best);
+    return 0;
+}
+
+// Distance in representable f32 values from value to reference rounded to f32.
+u32 UlpDistance(f32 value, f64 reference)
+{
+    const f32 rounded = static_cast<f32>(reference);
+    s32 a;
+    s32 b;
+    memcpy(&a, &value, sizeof(a));
+    memcpy(&b, &rounded, sizeof(b));
+    // negative floats count down from -0, below the positive ones
+    const s64 orderedA = a < 0 ? static_cast<s64>(INT32_MIN) - a : a;
+    const s64 orderedB = b < 0 ? static_cast<s64>(INT32_MIN) - b : b;
+    return static_cast<u32>(min<s64>(UINT32_MAX, llabs(orderedA - orderedB)));
+}
+
+/*
+ * fastmath [count]
+ * Math::Fast against libm. For each function the largest error over a sweep of its domain, in ulp of
+ * the libm result rounded to f32 and absolute, then ns/element over count inputs for libm, the scalar
+ * Math::Fast function and the array overload with each instruction set the CPU supports. Sine and
+ * cosine errors in ulp leave out results under 0.01 in magnitude, which the absolute bound covers.
+ */
+int RunFastMath(int argc, char** argv)
+{
+    const u32 count = argc > 0 ? max(8, atoi(argv[0])) : 4096;
+    const u32 repeats = max(1u, 20000000 / count);
+    const u32 samples = 1 << 22;
+    u32 seed = 1;
+    auto random = [&seed](f32 low, f32 high) {
+        seed = seed * 1664525u + 1013904223u;
+        return low + (high - low) * static_cast<f32>(seed >> 8) / static_cast<f32>(1u << 24);
+    };
+    vector<f32> out(count);
+    vector<f32> second(count);
+    f64 sink = 0.0;
+    // ns/element of run(in, out) over repeats passes
+    auto measure = [&](const c8* name, const function<void()>& run) {
+        run();
+        Clock::time_point start = Clock::now();
+        for (u32 i = 0; i < repeats; i++) {
+            run();
+        }
+        printf(" %s %6.2f", name, ElapsedMs(start) * 1e6 / (static_cast<f64>(repeats) * count));
+        sink += out[count / 2];
+    };
+    auto measureIsas = [&](const function<void()>& run) {
+        const MathIsa best = MatrixBatch::GetIsa();
+        for (u32 isa = MATH_ISA_SCALAR; isa < MATH_ISA_MAX; isa++) {
+            if (MatrixBatch::SetIsa(static_cast<MathIsa>(isa))) {
+                measure((string(MatrixBatch::GetIsaName(static_cast<MathIsa>(isa))) + "[]").c_str(), run);
+            }
+        }
+        MatrixBatch::SetIsa(best);
+        printf("\n");
+    };
+    // absolute errors of functions whose results span the exponents say nothing, those pass none
+    auto printError = [](const c8* name, u32 ulp, const c8* absolute) {
+        printf("%-6s %5u ulp %9s abs  ns/element:", name, ulp, absolute);
+    };
+    auto format = [](f64 absolute) {
+        static c8 text[32];
+        snprintf(text, sizeof(text), "%.2e", absolute);
+        return text;
+    };
+    // the largest errors of fast against reference over samples inputs of input(i)
+    auto sweep = [&](const function<f32(u32)>& input, const function<f32(f32)>& fast,
+        const function<f64(f64)>& reference, f64 ulpFloor, u32& ulp, f64& absolute) {
+        ulp = 0;
+        absolute = 0.0;
+        for (u32 i = 0; i < samples; i++) {
+            const f32 x = input(i);
+            const f32 value = fast(x);
+            const f64 expected = reference(x);
+            absolute = max(absolute, fabs(value - expected));
+            if (fabs(expected) >= ulpFloor) {
+                ulp = max(ulp, UlpDistance(value, expected));
+            }
+        }
+    };
+    auto linear = [samples](f32 low, f32 high) {
+        return [low, high, samples](u32 i) { return low + (high - low) * static_cast<f32>(i) / samples; };
+    };
+    // positive normal floats, evenly spread in exponent
+    auto logarithmic = [samples](u32 i) {
+        return exp2f(-126.0f + 253.9f * static_cast<f32>(i) / samples);
+    };
+    u32 ulp = 0;
+    f64 absolute = 0.0;
+    vector<f32> in(count);
+
+    for (u32 i = 0; i < count; i++) {
+        in[i] = logarithmic(static_cast<u32>(random(0.0f, 1.0f) * samples));
+    }
+    sweep(logarithmic, [](f32 x) { return Math::Fast::ReciprocalSqrt(x); },
+        [](f64 x) { return 1.0 / sqrt(x); }, 0.0, ulp, absolute);
+    printError("rsqrt", ulp, "-");
+    measure("libm", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = 1.0f / sqrtf(in[i]);
+        }
+    });
+    measure("Math", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = Math::ReciprocalSqrt(in[i]);
+        }
+    });
+    measure("fast", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = Math::Fast::ReciprocalSqrt(in[i]);
+        }
+    });
+    measureIsas([&]() { Math::Fast::ReciprocalSqrt(in.data(), out.data(), count); });
+
+    const f32 angle = 8192.0f;
+    for (u32 i = 0; i < count; i++) {
+        in[i] = random(-angle, angle);
+    }
+    sweep(linear(-angle, angle), [](f32 x) { return Math::Fast::Sin(x); }, [](f64 x) { return sin(x); }, 0.01, ulp,
+        absolute);
+    printError("sin", ulp, format(absolute));
+    measure("libm", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = sinf(in[i]);
+        }
+    });
+    measure("fast", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = Math::Fast::Sin(in[i]);
+        }
+    });
+    measureIsas([&]() { Math::Fast::SinCos(in.data(), out.data(), nullptr, count); });
+    sweep(linear(-angle, angle), [](f32 x) { return Math::Fast::Cos(x); }, [](f64 x) { return cos(x); }, 0.01, ulp,
+        absolute);
+    printError("cos", ulp, format(absolute));
+    measure("libm", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = cosf(in[i]);
+        }
+    });
+    measure("fast", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = Math::Fast::Cos(in[i]);
+        }
+    });
+    measureIsas([&]() { Math::Fast::SinCos(in.data(), nullptr, out.data(), count); });
+    printf("%-6s %22s ns/element:", "sincos", "");
+    measure("libm", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = sinf(in[i]);
+            second[i] = cosf(in[i]);
+        }
+    });
+    measure("fast", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            Math::Fast::SinCos(in[i], out[i], second[i]);
+        }
+    });
+    measureIsas([&]() { Math::Fast::SinCos(in.data(), out.data(), second.data(), count); });
+
+    // y over a grid of x, both in [-2, 2], with the zeros of both
+    const u32 side = 1 << 11;
+    ulp = 0;
+    absolute = 0.0;
+    for (u32 i = 0; i <= side; i++) {
+        for (u32 j = 0; j <= side; j++) {
+            const f32 y = -2.0f + 4.0f * static_cast<f32>(i) / side;
+            const f32 x = -2.0f + 4.0f * static_cast<f32>(j) / side;
+            const f32 value = Math::Fast::Atan2(y, x);
+            const f64 expected = atan2(static_cast<f64>(y), static_cast<f64>(x));
+            absolute = max(absolute, fabs(value - expected));
+            ulp = max(ulp, UlpDistance(value, expected));
+        }
+    }
+    for (u32 i = 0; i < count; i++) {
+        in[i] = random(-2.0f, 2.0f);
+        second[i] = random(-2.0f, 2.0f);
+    }
+    printError("atan2", ulp, format(absolute));
+    measure("libm", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = atan2f(in[i], second[i]);
+        }
+    });
+    measure("fast", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = Math::Fast::Atan2(in[i], second[i]);
+        }
+    });
+    measureIsas([&]() { Math::Fast::Atan2(in.data(), second.data(), out.data(), count); });
+
+    for (u32 i = 0; i < count; i++) {
+        in[i] = random(-126.0f, 127.9f);
+    }
+    sweep(linear(-126.0f, 127.9f), [](f32 x) { return Math::Fast::Exp2(x); }, [](f64 x) { return exp2(x); }, 0.0,
+        ulp, absolute);
+    printError("exp2", ulp, "-");
+    measure("libm", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = exp2f(in[i]);
+        }
+    });
+    measure("fast", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = Math::Fast::Exp2(in[i]);
+        }
+    });
+    measureIsas([&]() { Math::Fast::Exp2(in.data(), out.data(), count); });
+
+    for (u32 i = 0; i < count; i++) {
+        in[i] = logarithmic(static_cast<u32>(random(0.0f, 1.0f) * samples));
+    }
+    sweep(logarithmic, [](f32 x) { return Math::Fast::Log2(x); }, [](f64 x) { return log2(x); }, 0.0, ulp,
+        absolute);
+    printError("log2", ulp, format(absolute));
+    measure("libm", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = log2f(in[i]);
+        }
+    });
+    measure("fast", [&]() {
+        for (u32 i = 0; i < count; i++) {
+            out[i] = Math::Fast::Log2(in[i]);
+        }
+    });
+    measureIsas([&]() { Math::Fast::Log2(in.data(), out.data(), count); });
+    printf("(checksum %g)\n", sink);
+    return 0;
+}
+
+struct Benchmark {
+    const char* name;
+    int (*run)(int argc, char** argv);
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"pipeline", RunPipeline},
+    {"session", RunSession},
+    {"pnm", RunPNM},
+    {"pool", RunPool},
+    {"pixel", RunPixel},
+    {"snapshot", RunSnapshot},
+    {"cpu", RunCpu},
+    {"upscale", RunUpscale},
+    {"makecorpus", RunMakeCorpus},
+    {"corpus", RunCorpus},
+    {"callframe", RunCallFrame},
+    {"cgmat", RunCgmat},
+    {"parambin", RunParamBin},
+    {"material", RunMaterial},
+    {"renderstate", RunRenderState},
+    {"matrix", RunMatrix},
+    {"podcopy", RunPodCopy},
+    {"cull", RunCull},
+    {"pose", RunPose},
+    {"fastmath", RunFastMath},
+};
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2) {
+        for (const Benchmark& benchmark : BENCHMARKS) {
+            if (strcmp(argv[1], benchmark.name) == 0) {
+                return benchmark.run(argc - 2, argv + 2);
+            }
+        }
+    }
+    printf("usage: %s <benchmark> [args...]\nbenchmarks:", argv[0]);
+    for (const Benchmark& benchmark : BENCHMARKS) {
+        printf(" %s", benchmark.name);
+    }
+    printf("\n");
+    return 1;
+}
@@ -8,6 +8,10 @@
 
 #include "CGRenderingFramework/Application/CGKitHeaders.h"
 
+namespace CGKit {
+class OSRPlugin;
+}
+
 class MainApplication : public CGKit::BaseApplication {
 public:
     MainApplication();
@@ -31,7 +35,6 @@ private:
 
 private:
     bool m_touchBegin;
-    bool m_osrPluginExecuted = false;
     CGKit::f32 m_touchPosX;
     CGKit::f32 m_touchPosY;
     CGKit::f32 m_deltaTime;
@@ -46,6 +49,7 @@ private:
     CGKit::SceneObject* m_skyObject = nullptr;
     CGKit::SceneObject* m_pointLightObject = nullptr;
     CGKit::Camera* m_mainCamera = nullptr;
+    CGKit::OSRPlugin* m_osrPlugin = nullptr;
 };
 
 CGKit::BaseApplication* CreateMainApplication();
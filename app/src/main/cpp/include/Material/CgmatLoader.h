@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Streaming .cgmat parser and its binary material cache.
+ */
+
+#ifndef CGMAT_LOADER_H
+#define CGMAT_LOADER_H
+
+#include "Material/MaterialDesc.h"
+
+namespace CGKit {
+
+/*
+ * Parse runs the nlohmann SAX interface over the text and fills MaterialDesc as values arrive, so no
+ * json DOM is built. Keys the loader does not know, such as description, level and tag, are skipped
+ * with their whole subtree; an unknown enum name or a value of the wrong kind fails the parse.
+ * Pass render states are interned in RenderStateTable as each pass ends.
+ * A parsed material can be compiled into a .cgmc cache, a flat little-endian dump of MaterialDesc
+ * stamped with the FNV-1a 64 hash of the .cgmat text it came from. It holds the pass states themselves,
+ * not their ids. Load keeps one cache file per content hash in cacheDir, so an edited material simply
+ * misses and is compiled again.
+ */
+class CgmatLoader {
+public:
+    static constexpr u32 CACHE_MAGIC = 0x434D4743;  // "CGMC"
+    static constexpr u32 CACHE_VERSION = 3;
+
+    static bool Parse(const c8* text, size_t length, MaterialDesc& material);
+
+    static u64 ContentHash(const u8* data, size_t size);
+
+    static void Encode(const MaterialDesc& material, u64 contentHash, std::vector<u8>& blob);
+
+    /*
+     * Fails if blob is not a cache of this version or was compiled from other content.
+     */
+    static bool Decode(const u8* blob, size_t size, u64 contentHash, MaterialDesc& material);
+
+    /*
+     * Loads a .cgmat through cacheDir/<content hash>.cgmc, parsing and writing the cache on a miss.
+     * An empty cacheDir always parses. A cache that cannot be written only costs the next start.
+     */
+    static bool Load(const String& path, const String& cacheDir, MaterialDesc& material);
+};
+
+}  // namespace CGKit
+
+#endif
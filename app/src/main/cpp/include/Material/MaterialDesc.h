@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: In-memory form of a .cgmat material.
+ */
+
+#ifndef MATERIAL_DESC_H
+#define MATERIAL_DESC_H
+
+#include "Material/RenderStateTable.h"
+#include "Rendering/SamplerCreateInfo.h"
+
+namespace CGKit {
+
+struct MaterialSampler {
+    // createInfo.addressMode holds addressModeU
+    SamplerCreateInfo createInfo;
+    SamplerAddress addressModeV = SAMPLER_ADDRESS_WRAP;
+    SamplerAddress addressModeW = SAMPLER_ADDRESS_WRAP;
+    f32 mipLODBias = 0.0f;
+    f32 maxAnisotropy = 0.0f;
+    f32 minLOD = 0.0f;
+    f32 maxLOD = 0.0f;
+    u32 borderColor = 0;
+};
+
+struct MaterialTexture {
+    String uri;
+    String name;
+    s32 samplerIndex = 0;
+};
+
+struct MaterialConstantValue {
+    String name;
+    String type;
+    std::vector<f32> value;
+};
+
+struct MaterialConstant {
+    String name;
+    String type;
+    std::vector<MaterialConstantValue> values;
+};
+
+struct MaterialShader {
+    String uri;
+    ShaderStageType type = SHADER_STAGE_NONE;
+};
+
+/*
+ * One pass of a technique. Its rasterization, depth/stencil and blend blocks are interned in
+ * RenderStateTable, RenderStateTable::Expand turns states back into the blocks of a PipelineCreateInfo.
+ * The fields PipelineCreateInfo has no room for are kept beside the ids. depthClampEnable is written in
+ * the depthStencilState block of a .cgmat but belongs to the rasterization state.
+ */
+struct MaterialPass {
+    String name;
+    RenderStateIds states;
+    bool scissorEnable = false;
+    f32 pointSize = 1.0f;
+    std::vector<MaterialShader> shaders;
+};
+
+struct MaterialTechnique {
+    String name;
+    String type;
+    std::vector<MaterialPass> passes;
+};
+
+struct MaterialDesc {
+    s32 version = 0;
+    std::vector<MaterialSampler> samplers;
+    std::vector<MaterialTexture> textures;
+    std::vector<MaterialConstant> constants;
+    std::vector<MaterialTechnique> techniques;
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Process wide tables of distinct pipeline render states.
+ */
+
+#ifndef RENDER_STATE_TABLE_H
+#define RENDER_STATE_TABLE_H
+
+#include "Rendering/Graphics/PipelineCreateInfo.h"
+
+namespace CGKit {
+
+/*
+ * The render states of a pass as ids into RenderStateTable. Equal states always get the same id, so two
+ * passes share a state exactly when the ids match and comparing pipeline keys needs no state compare.
+ */
+struct RenderStateIds {
+    u16 rasterization = 0;
+    u16 depthStencil = 0;
+    u16 colorBlend = 0;
+
+    bool operator==(const RenderStateIds& other) const
+    {
+        return rasterization == other.rasterization && depthStencil == other.depthStencil &&
+            colorBlend == other.colorBlend;
+    }
+
+    bool operator!=(const RenderStateIds& other) const
+    {
+        return !(*this == other);
+    }
+
+    /* The three ids packed into one integer, for hashing and ordering pipeline keys. */
+    u64 Key() const
+    {
+        return (static_cast<u64>(rasterization) << 32) | (static_cast<u64>(depthStencil) << 16) | colorBlend;
+    }
+};
+
+/*
+ * Every distinct rasterization, depth/stencil and color blend state is stored once for the whole process,
+ * with its hash field filled, and is never released: materials only ever use a few dozen of them. Id 0 of
+ * each table is the default constructed state. Intern is thread safe. A state is read by id without a
+ * lock, the id has to come from Intern in the same thread or be handed over like the material holding it.
+ */
+class RenderStateTable {
+public:
+    static constexpr u32 MAX_STATES = 0x10000;
+
+    /* Fails only when the table already holds MAX_STATES states. */
+    static bool Intern(const RasterizationState& state, u16& id);
+    static bool Intern(const DepthStencilState& state, u16& id);
+    static bool Intern(const ColorBlendState& state, u16& id);
+    static bool Intern(const PipelineCreateInfo& pipeline, RenderStateIds& ids);
+
+    /* An id that was never returned by Intern reads as the default state. */
+    static const RasterizationState& Rasterization(u16 id);
+    static const DepthStencilState& DepthStencil(u16 id);
+    static const ColorBlendState& ColorBlend(u16 id);
+
+    /* Copies the states of ids into pipeline, its other fields are left as they are. */
+    static void Expand(const RenderStateIds& ids, PipelineCreateInfo& pipeline);
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Trivially copyable axis aligned bounding box.
+ */
+
+#ifndef BOUNDING_BOX_H
+#define BOUNDING_BOX_H
+
+#include <cfloat>
+#include "Math/AABB.h"
+#include "MathKernels/PodMath.h"
+
+namespace CGKit {
+
+/*
+ * The minimum and maximum of AABB, 24 bytes. AABB also carries a corner array that GetCorners allocates
+ * on first use and copies and assignments free and reallocate; here corners are computed when asked for.
+ * Corners are numbered like CornerType: bit 2 picks the maximum x (right), bit 1 the maximum z (front)
+ * and bit 0 the maximum y (top). Transform arrays of boxes with MatrixBatch::TransformBoxes, and grow a box
+ * by arrays of points or boxes with MatrixBatch::AddInternalPoints and AddInternalBoxes, which use SIMD.
+ * Single calls stay scalar, three lanes of min and max gain nothing over minss and maxss.
+ */
+struct BoundingBox {
+    Float3 minimum;
+    Float3 maximum;
+
+    constexpr BoundingBox() : minimum(), maximum() {}
+
+    constexpr BoundingBox(const Float3& min, const Float3& max) : minimum(min), maximum(max) {}
+
+    explicit BoundingBox(const AABB& box) : minimum(box.GetMinimum()), maximum(box.GetMaximum()) {}
+
+    AABB ToAABB() const
+    {
+        AABB box;
+        box.SetMinimum(minimum.ToVector3());
+        box.SetMaximum(maximum.ToVector3());
+        return box;
+    }
+
+    // A box with no points: minimum above maximum, so adding a point makes it the box of that point.
+    static constexpr BoundingBox Empty()
+    {
+        return BoundingBox(Float3(FLT_MAX, FLT_MAX, FLT_MAX), Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+    }
+
+    constexpr bool IsEmpty() const
+    {
+        return minimum.x > maximum.x || minimum.y > maximum.y || minimum.z > maximum.z;
+    }
+
+    constexpr Float3 GetCenter() const
+    {
+        return (minimum + maximum) * 0.5f;
+    }
+
+    constexpr Float3 GetSize() const
+    {
+        return maximum - minimum;
+    }
+
+    constexpr Float3 GetHalfSize() const
+    {
+        return (maximum - minimum) * 0.5f;
+    }
+
+    constexpr Float3 GetCorner(u32 corner) const
+    {
+        return Float3((corner & 0x4) != 0 ? maximum.x : minimum.x, (corner & 0x1) != 0 ? maximum.y : minimum.y,
+            (corner & 0x2) != 0 ? maximum.z : minimum.z);
+    }
+
+    void GetCorners(Float3 corners[CORNER_TYPE_MAX]) const
+    {
+        for (u32 corner = 0; corner < CORNER_TYPE_MAX; corner++) {
+            corners[corner] = GetCorner(corner);
+        }
+    }
+
+    void AddInternalPoint(const Float3& point)
+    {
+        minimum = Min(minimum, point);
+        maximum = Max(maximum, point);
+    }
+
+    void AddInternalBox(const BoundingBox& box)
+    {
+        minimum = Min(minimum, box.minimum);
+        maximum = Max(maximum, box.maximum);
+    }
+
+    // Boundaries count as inside.
+    constexpr bool Contains(const Float3& point) const
+    {
+        return minimum.x <= point.x && minimum.y <= point.y && minimum.z <= point.z && point.x <= maximum.x &&
+            point.y <= maximum.y && point.z <= maximum.z;
+    }
+
+    constexpr bool Contains(const BoundingBox& box) const
+    {
+        return Contains(box.minimum) && Contains(box.maximum);
+    }
+
+    constexpr bool Intersects(const BoundingBox& box) const
+    {
+        return minimum.x <= box.maximum.x && minimum.y <= box.maximum.y && minimum.z <= box.maximum.z &&
+            box.minimum.x <= maximum.x && box.minimum.y <= maximum.y && box.minimum.z <= maximum.z;
+    }
+};
+
+static_assert(std::is_trivially_copyable<BoundingBox>::value && std::is_standard_layout<BoundingBox>::value,
+    "BoundingBox must stay trivially copyable");
+static_assert(sizeof(BoundingBox) == 2 * sizeof(Float3), "BoundingBox must be the minimum and maximum only");
+static_assert(BoundingBox::Empty().IsEmpty() && !BoundingBox().IsEmpty(), "BoundingBox must be constexpr");
+
+}  // namespace CGKit
+
+#endif
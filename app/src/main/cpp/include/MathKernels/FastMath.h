@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Branch-free approximations of the math library functions for hot loops.
+ */
+
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <cmath>
+#include <cstring>
+#include "Math/Math.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace CGKit {
+namespace Math {
+/*
+ * Math::Sqrt, ReciprocalSqrt and Reciprocal test for their FLOAT_MAX sentinels on every call, and
+ * ReciprocalSqrt takes the square root twice. The functions here have no sentinels and no branches:
+ * callers keep their inputs in the documented domain, outside it the results are undefined. Bounds are
+ * the largest error against the correctly rounded result over the domain, in units in the last place
+ * (ulp) of f32, as measured by the fastmath benchmark; absolute where noted. The array overloads run
+ * 4 (SSE4, NEON) or 8 (AVX2) lanes at a time on the instruction set MatrixBatch picked and keep the
+ * bounds, though not always the last bits of the scalar results: AVX2 fuses multiply-adds. Their
+ * outputs may be their inputs.
+ */
+namespace Fast {
+// Cody-Waite split of pi / 2: PIO2_HIGH has 8 significant bits, so q * PIO2_HIGH is exact for |q| < 2^16.
+constexpr f32 TWO_OVER_PI = 0.636619772367581f;
+constexpr f32 PIO2_HIGH = 1.5703125f;
+constexpr f32 PIO2_MIDDLE = 4.837512969970703125e-4f;
+constexpr f32 PIO2_LOW = 7.54978995489188216e-8f;
+// minimax polynomials on [-pi / 4, pi / 4] (Cephes sinf and cosf)
+constexpr f32 SIN_C1 = -1.6666654611e-1f;
+constexpr f32 SIN_C2 = 8.3321608736e-3f;
+constexpr f32 SIN_C3 = -1.9515295891e-4f;
+constexpr f32 COS_C1 = 4.166664568298827e-2f;
+constexpr f32 COS_C2 = -1.388731625493765e-3f;
+constexpr f32 COS_C3 = 2.443315711809948e-5f;
+// atan on [-tan(pi / 8), tan(pi / 8)] (Cephes atanf)
+constexpr f32 TAN_PI_8 = 0.414213562373095f;
+constexpr f32 ATAN_C1 = -3.33329491539e-1f;
+constexpr f32 ATAN_C2 = 1.99777106478e-1f;
+constexpr f32 ATAN_C3 = -1.38776856032e-1f;
+constexpr f32 ATAN_C4 = 8.05374449538e-2f;
+constexpr f32 QUARTER_PI = 0.785398163397448f;
+// 2^f - 1 on [-1 / 2, 1 / 2] divided by f (Cephes exp2f)
+constexpr f32 EXP2_C1 = 6.931472028550421e-1f;
+constexpr f32 EXP2_C2 = 2.402264791363012e-1f;
+constexpr f32 EXP2_C3 = 5.550332471162809e-2f;
+constexpr f32 EXP2_C4 = 9.618437357674640e-3f;
+constexpr f32 EXP2_C5 = 1.339887440266574e-3f;
+constexpr f32 EXP2_C6 = 1.535336188319500e-4f;
+constexpr f32 EXP2_MIN = -150.0f;
+constexpr f32 EXP2_MAX = 128.0f;
+// ln(1 + f) on [sqrt(1 / 2) - 1, sqrt(2) - 1] (Cephes logf), and log2(e) - 1
+constexpr f32 LOG_C1 = 3.3333331174e-1f;
+constexpr f32 LOG_C2 = -2.4999993993e-1f;
+constexpr f32 LOG_C3 = 2.0000714765e-1f;
+constexpr f32 LOG_C4 = -1.6668057665e-1f;
+constexpr f32 LOG_C5 = 1.4249322787e-1f;
+constexpr f32 LOG_C6 = -1.2420140846e-1f;
+constexpr f32 LOG_C7 = 1.1676998740e-1f;
+constexpr f32 LOG_C8 = -1.1514610310e-1f;
+constexpr f32 LOG_C9 = 7.0376836292e-2f;
+constexpr f32 LOG2_E_MINUS_ONE = 0.44269504088896340736f;
+constexpr f32 SQRT_2 = 1.41421356237309505f;
+constexpr u32 SIGN_BIT = 0x80000000u;
+constexpr u32 MANTISSA_BITS = 23;
+constexpr u32 MANTISSA_MASK = (1u << MANTISSA_BITS) - 1;
+constexpr s32 EXPONENT_BIAS = 127;
+
+inline u32 ToBits(f32 f)
+{
+    u32 bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+inline f32 FromBits(u32 bits)
+{
+    f32 f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Rounds to the nearest integer, halfway cases away from zero. |f| < 2^31.
+inline s32 RoundToInt(f32 f)
+{
+    return static_cast<s32>(f + FromBits((ToBits(f) & SIGN_BIT) | ToBits(0.5f)));
+}
+
+/*
+ * 1 / sqrt(x) for positive normal x: the estimate instruction refined by Newton-Raphson, one step from
+ * the 12-bit x86 estimate, 4 ulp, two from the 8-bit ARM one, 2 ulp. 0 gives NaN, not FLOAT_MAX.
+ */
+inline f32 ReciprocalSqrt(f32 x)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    const f32 y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+    return y * (1.5f - 0.5f * x * y * y);
+#elif defined(__aarch64__)
+    f32 y = vrsqrtes_f32(x);
+    y = y * vrsqrtss_f32(x * y, y);
+    return y * vrsqrtss_f32(x * y, y);
+#else
+    return 1.0f / sqrtf(x);
+#endif
+}
+
+// The square root instruction, correctly rounded; negative x gives NaN, not FLOAT_MAX.
+inline f32 Sqrt(f32 x)
+{
+    return sqrtf(x);
+}
+
+// Correctly rounded; 0 gives infinity, not FLOAT_MAX.
+inline f32 Reciprocal(f32 x)
+{
+    return 1.0f / x;
+}
+
+/*
+ * sin and cos of x in radians for |x| <= 8192: x reduced by the nearest multiple q of pi / 2 to
+ * [-pi / 4, pi / 4] and polynomials of the remainder, picked and signed by q. SinCos gives both for the
+ * cost of one. Within 1e-7 absolute, and 2 ulp where the result is 0.01 or more in magnitude.
+ */
+inline void SinCos(f32 x, f32& sine, f32& cosine)
+{
+    const s32 quadrant = RoundToInt(x * TWO_OVER_PI);
+    const f32 q = static_cast<f32>(quadrant);
+    const f32 r = ((x - q * PIO2_HIGH) - q * PIO2_MIDDLE) - q * PIO2_LOW;
+    const f32 z = r * r;
+    const f32 s = ((SIN_C3 * z + SIN_C2) * z + SIN_C1) * z * r + r;
+    const f32 c = ((COS_C3 * z + COS_C2) * z + COS_C1) * z * z - 0.5f * z + 1.0f;
+    const u32 swap = static_cast<u32>(quadrant) & 1;
+    const u32 sineSign = (static_cast<u32>(quadrant) & 2) << 30;
+    const u32 cosineSign = (static_cast<u32>(quadrant + 1) & 2) << 30;
+    sine = FromBits(ToBits(swap != 0 ? c : s) ^ sineSign);
+    cosine = FromBits(ToBits(swap != 0 ? s : c) ^ cosineSign);
+}
+
+inline f32 Sin(f32 x)
+{
+    f32 sine;
+    f32 cosine;
+    SinCos(x, sine, cosine);
+    return sine;
+}
+
+inline f32 Cos(f32 x)
+{
+    f32 sine;
+    f32 cosine;
+    SinCos(x, sine, cosine);
+    return cosine;
+}
+
+/*
+ * atan2(y, x) for finite x and y, the angle of (x, y) in [-pi, pi]: atan of min(|x|, |y|) / max(|x|, |y|)
+ * then moved to the octant of (x, y). Within 3 ulp, 4 for the ARMv7 arrays, which divide through the
+ * reciprocal estimate. atan2(0, 0) is 0, and pi when x is -0, like libm.
+ */
+inline f32 Atan2(f32 y, f32 x)
+{
+    const f32 ax = fabsf(x);
+    const f32 ay = fabsf(y);
+    const f32 larger = ax > ay ? ax : ay;
+    const f32 smaller = ax > ay ? ay : ax;
+    const f32 ratio = larger > 0.0f ? smaller / larger : 0.0f;
+    const bool far = ratio > TAN_PI_8;
+    const f32 u = far ? (ratio - 1.0f) / (ratio + 1.0f) : ratio;
+    const f32 z = u * u;
+    f32 angle = (((ATAN_C4 * z + ATAN_C3) * z + ATAN_C2) * z + ATAN_C1) * z * u + u;
+    angle = far ? angle + QUARTER_PI : angle;
+    angle = ay > ax ? HALF_PI - angle : angle;
+    angle = (ToBits(x) & SIGN_BIT) != 0 ? PI - angle : angle;
+    return FromBits(ToBits(angle) | (ToBits(y) & SIGN_BIT));
+}
+
+/*
+ * 2^x for finite x: a polynomial of x - round(x) scaled by 2^round(x), built from exponent bits in two
+ * halves so that denormal results underflow gradually. Within 1 ulp of normal results, x >= 128 gives
+ * infinity.
+ */
+inline f32 Exp2(f32 x)
+{
+    x = x < EXP2_MIN ? EXP2_MIN : x;
+    x = x > EXP2_MAX ? EXP2_MAX : x;
+    const s32 n = RoundToInt(x);
+    const f32 f = x - static_cast<f32>(n);
+    const f32 p = (((((EXP2_C6 * f + EXP2_C5) * f + EXP2_C4) * f + EXP2_C3) * f + EXP2_C2) * f + EXP2_C1) * f + 1.0f;
+    const s32 half = n / 2;
+    return p * FromBits(static_cast<u32>(half + EXPONENT_BIAS) << MANTISSA_BITS) *
+        FromBits(static_cast<u32>(n - half + EXPONENT_BIAS) << MANTISSA_BITS);
+}
+
+/*
+ * log2(x) for positive normal x: the exponent plus a polynomial of the mantissa scaled to
+ * [sqrt(1 / 2), sqrt(2)). Within 1 ulp. 0, denormals, negatives, infinity and NaN are out of the domain.
+ */
+inline f32 Log2(f32 x)
+{
+    const u32 bits = ToBits(x);
+    f32 m = FromBits((bits & MANTISSA_MASK) | ToBits(1.0f));
+    f32 e = static_cast<f32>(static_cast<s32>(bits >> MANTISSA_BITS) - EXPONENT_BIAS);
+    const bool high = m > SQRT_2;
+    m = high ? m * 0.5f : m;
+    e = high ? e + 1.0f : e;
+    const f32 f = m - 1.0f;
+    const f32 z = f * f;
+    const f32 p = (((((((LOG_C9 * f + LOG_C8) * f + LOG_C7) * f + LOG_C6) * f + LOG_C5) * f + LOG_C4) * f + LOG_C3) *
+        f + LOG_C2) * f + LOG_C1;
+    const f32 y = f * z * p - 0.5f * z;
+    return (((y * LOG2_E_MINUS_ONE + f * LOG2_E_MINUS_ONE) + y) + f) + e;
+}
+
+/*
+ * The functions over arrays of count floats.
+ */
+void ReciprocalSqrt(const f32* x, f32* out, u32 count);
+
+// sine or cosine may be nullptr
+void SinCos(const f32* x, f32* sine, f32* cosine, u32 count);
+
+void Atan2(const f32* y, const f32* x, f32* out, u32 count);
+
+void Exp2(const f32* x, f32* out, u32 count);
+
+void Log2(const f32* x, f32* out, u32 count);
+}  // namespace Fast
+}  // namespace Math
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Batched Matrix4 operations with SIMD kernels.
+ */
+
+#ifndef MATRIX_BATCH_H
+#define MATRIX_BATCH_H
+
+#include "Math/Matrix4.h"
+
+namespace CGKit {
+
+/**
+ * @brief Instruction sets the math kernels are built for.
+ */
+enum MathIsa {
+    MATH_ISA_SCALAR,
+    MATH_ISA_SSE4,
+    MATH_ISA_AVX2,
+    MATH_ISA_NEON,
+    MATH_ISA_MAX
+};
+
+struct BoundingBox;
+struct PlaneEquation;
+
+/*
+ * Planes of a view frustum in the order GetFrustumPlanes writes them.
+ */
+enum FrustumPlane {
+    FRUSTUM_PLANE_LEFT,
+    FRUSTUM_PLANE_RIGHT,
+    FRUSTUM_PLANE_BOTTOM,
+    FRUSTUM_PLANE_TOP,
+    FRUSTUM_PLANE_NEAR,
+    FRUSTUM_PLANE_FAR,
+    FRUSTUM_PLANE_MAX
+};
+
+/*
+ * Vector3 arrays stored as one array per component (SoA), the layout the SIMD kernels read fastest.
+ */
+struct Vector3SoA {
+    f32* x;
+    f32* y;
+    f32* z;
+};
+
+struct ConstVector3SoA {
+    const f32* x;
+    const f32* y;
+    const f32* z;
+
+    ConstVector3SoA(const f32* nx, const f32* ny, const f32* nz) : x(nx), y(ny), z(nz) {}
+
+    ConstVector3SoA(const Vector3SoA& other) : x(other.x), y(other.y), z(other.z) {}
+};
+
+struct QuaternionSoA {
+    f32* x;
+    f32* y;
+    f32* z;
+    f32* w;
+};
+
+struct ConstQuaternionSoA {
+    const f32* x;
+    const f32* y;
+    const f32* z;
+    const f32* w;
+
+    ConstQuaternionSoA(const f32* nx, const f32* ny, const f32* nz, const f32* nw) : x(nx), y(ny), z(nz), w(nw) {}
+
+    ConstQuaternionSoA(const QuaternionSoA& other) : x(other.x), y(other.y), z(other.z), w(other.w) {}
+};
+
+/*
+ * Matrix4 operations over arrays, for the per-object and per-camera work of a frame. Matrices follow
+ * Matrix4: row major, row vectors, v' = v * M with the translation in the 4th row. The SSE4, AVX2 and
+ * NEON kernels compute the same expressions as the scalar ones, the best one the CPU supports is picked
+ * on first use. The scalar kernels are the reference: the others may differ from them in the last bits,
+ * AVX2 fuses multiply-adds, but never in the operation done.
+ * Outputs may be the same array as an input, other overlaps are not allowed. For SoA this holds per
+ * component array.
+ */
+class MatrixBatch {
+public:
+    /* out[i] = a[i] * b[i]. */
+    static void Multiply(const Matrix4* a, const Matrix4* b, Matrix4* out, u32 count);
+
+    /* out[i] = a[i] * b. */
+    static void Multiply(const Matrix4* a, const Matrix4& b, Matrix4* out, u32 count);
+
+    static void Transpose(const Matrix4* in, Matrix4* out, u32 count);
+
+    /* General inverse. A singular matrix, determinant 0, gives the zero matrix. */
+    static void Inverse(const Matrix4* in, Matrix4* out, u32 count);
+
+    /*
+     * Inverse of affine matrices, 4th column (0, 0, 0, 1), which includes every matrix MakeTransform
+     * makes and their products: the inverse of the 3x3 part and the translation moved through it. A
+     * singular 3x3 part gives the zero matrix. Debug builds assert the matrices are affine.
+     */
+    static void InverseAffine(const Matrix4* in, Matrix4* out, u32 count);
+
+    /*
+     * Inverse of matrices that only rotate and translate, such as the world transform of a camera whose
+     * inverse is its view matrix: the transpose of the 3x3 part. Debug builds assert the matrices are
+     * affine with an orthonormal 3x3 part.
+     */
+    static void InverseRigid(const Matrix4* in, Matrix4* out, u32 count);
+
+    /*
+     * Inverse of MakeTransform(position, scale, orientation), from the components for callers that keep
+     * them, without building, decomposing or inverting the matrix. Scale components must not be 0.
+     */
+    static void InverseTransform(const Vector3* position, const Vector3* scale, const Quaternion* orientation,
+        Matrix4* out, u32 count);
+
+    /*
+     * Matrices for TransformDirections on normals: the inverse transpose of the 3x3 part of affine
+     * matrices, with no translation. A singular 3x3 part gives the zero matrix. The results keep the
+     * scale of the inverse, normalize the transformed normals.
+     */
+    static void NormalMatrix(const Matrix4* in, Matrix4* out, u32 count);
+
+    /* out[i] = in[i] * matrix. */
+    static void Transform(const Matrix4& matrix, const Vector4* in, Vector4* out, u32 count);
+
+    /* out[i] = in[i] * matrices[i]. */
+    static void Transform(const Matrix4* matrices, const Vector4* in, Vector4* out, u32 count);
+
+    /*
+     * Matrix4::Transform(Vector3&) for each point: (x, y, z, 1) * matrix without the divide by w, so
+     * rotation, scale and translation.
+     */
+    static void TransformPoints(const Matrix4& matrix, const Vector3* in, Vector3* out, u32 count);
+
+    /* out[i] = in[i] transformed as a point by matrices[i]. */
+    static void TransformPoints(const Matrix4* matrices, const Vector3* in, Vector3* out, u32 count);
+
+    static void TransformPoints(const Matrix4& matrix, const ConstVector3SoA& in, const Vector3SoA& out, u32 count);
+
+    /* (x, y, z, 0) * matrix: rotation and scale only, for directions and offsets. */
+    static void TransformDirections(const Matrix4& matrix, const Vector3* in, Vector3* out, u32 count);
+
+    static void TransformDirections(const Matrix4* matrices, const Vector3* in, Vector3* out, u32 count);
+
+    static void TransformDirections(const Matrix4& matrix, const ConstVector3SoA& in, const Vector3SoA& out,
+        u32 count);
+
+    /*
+     * Bounds of the boxes transformed by matrix, tight around their eight transformed corners, for world
+     * space bounds of renderables. Matrices must be affine, the 4th column is ignored, and the boxes must
+     * not be empty, which debug builds assert.
+     */
+    static void TransformBoxes(const Matrix4& matrix, const BoundingBox* in, BoundingBox* out, u32 count);
+
+    /* out[i] = in[i] transformed by matrices[i]. */
+    static void TransformBoxes(const Matrix4* matrices, const BoundingBox* in, BoundingBox* out, u32 count);
+
+    /*
+     * BoundingBox::AddInternalPoint for each point, bounds of vertices or of transformed points. Start from
+     * BoundingBox::Empty() for the bounds of the points alone.
+     */
+    static void AddInternalPoints(const Vector3* points, u32 count, BoundingBox& box);
+
+    /* BoundingBox::AddInternalBox for each box, the boxes must not be empty, which debug builds assert. */
+    static void AddInternalBoxes(const BoundingBox* boxes, u32 count, BoundingBox& box);
+
+    /*
+     * The planes of the frustum of viewProjection, the view matrix times the projection matrix of a
+     * camera, so that points v * viewProjection are in clip space. Normals are unit length and point
+     * inside: points p with Dot(normal, p) + distance >= 0 are on the inner side. zeroToOneDepth selects
+     * a clip space depth of 0 to w, as in Vulkan, over -w to w, as in OpenGL ES.
+     */
+    static void GetFrustumPlanes(const Matrix4& viewProjection, bool zeroToOneDepth,
+        PlaneEquation planes[FRUSTUM_PLANE_MAX]);
+
+    /*
+     * Frustum culling of count boxes given as center and extent, the half size, arrays. Box i is visible,
+     * bit i % 32 of visible[i / 32] set, unless it lies wholly on the outer side of a plane; boxes near
+     * the frustum corners that no plane separates stay visible. Writes (count + 31) / 32 words, the bits
+     * past count are 0. SIMD kernels may decide boxes that touch a plane differently from scalar, within
+     * rounding.
+     */
+    static void CullBoxes(const PlaneEquation planes[FRUSTUM_PLANE_MAX], const ConstVector3SoA& centers,
+        const ConstVector3SoA& extents, u32* visible, u32 count);
+
+    /*
+     * Matrix4::MakeTransform for each element: scale, then rotate by the unit quaternion orientation,
+     * then translate to position.
+     */
+    static void MakeTransform(const Vector3* position, const Vector3* scale, const Quaternion* orientation,
+        Matrix4* out, u32 count);
+
+    /*
+     * MakeTransform from SoA components, such as the sampled poses of the joints of a skeleton.
+     */
+    static void MakeTransform(const ConstVector3SoA& position, const ConstVector3SoA& scale,
+        const ConstQuaternionSoA& orientation, Matrix4* out, u32 count);
+
+    /*
+     * Animation sampling. Store the keys of a clip SoA per key: for each key time one array per
+     * component with an element per joint. FindKeyframe gives the key pair around the sample time once
+     * for all joints, and keys key and key + 1 are then the a and b arrays of the interpolations, with
+     * no gathers. The quaternions must be unit length and are interpolated through the shorter arc.
+     */
+
+    /*
+     * Index of the last key at or before time in the count ascending key times, and the factor between
+     * it and the next key. Times before the first or after the last key clamp to them, factor 0 or 1.
+     */
+    static u32 FindKeyframe(const f32* times, u32 count, f32 time, f32& factor);
+
+    /*
+     * out[i] = a[i] + (b[i] - a[i]) * t over floats, for positions and scales: with the components of
+     * all joints in one run, one call interpolates them all. Plain code the compiler vectorizes.
+     */
+    static void Lerp(const f32* a, const f32* b, f32 t, f32* out, u32 count);
+
+    /* out[i] = normalize(a[i] * (1 - t) + b[i] * t): cheap, the angle does not move at a constant rate. */
+    static void Nlerp(const ConstQuaternionSoA& a, const ConstQuaternionSoA& b, f32 t, const QuaternionSoA& out,
+        u32 count);
+
+    /* With a factor per element. */
+    static void Nlerp(const ConstQuaternionSoA& a, const ConstQuaternionSoA& b, const f32* t,
+        const QuaternionSoA& out, u32 count);
+
+    /*
+     * Spherical interpolation at a constant angular rate. The weights come from a polynomial instead of
+     * sin and acos, within 2e-5 of them.
+     */
+    static void Slerp(const ConstQuaternionSoA& a, const ConstQuaternionSoA& b, f32 t, const QuaternionSoA& out,
+        u32 count);
+
+    static void Slerp(const ConstQuaternionSoA& a, const ConstQuaternionSoA& b, const f32* t,
+        const QuaternionSoA& out, u32 count);
+
+    /*
+     * Returns the instruction set in use.
+     */
+    static MathIsa GetIsa();
+
+    /*
+     * Switches to the kernels of isa, fails if the CPU or the build does not support it. Meant for
+     * benchmarks and checks against the scalar reference, it must not race with running kernels.
+     */
+    static bool SetIsa(MathIsa isa);
+
+    static const c8* GetIsaName(MathIsa isa);
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Kernels behind MatrixBatch and Math::Fast, one table per instruction set.
+ */
+
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+#include "Core/Types.h"
+
+namespace CGKit {
+
+constexpr u32 MATRIX_ROWS = 4;
+constexpr u32 MATRIX_FLOATS = MATRIX_ROWS * MATRIX_ROWS;
+constexpr u32 VECTOR3_FLOATS = 3;
+constexpr u32 VECTOR4_FLOATS = 4;
+constexpr u32 BOX_FLOATS = 2 * VECTOR3_FLOATS;
+constexpr u32 PLANE_FLOATS = 4;
+// boxes per word of a visibility mask
+constexpr u32 MASK_BITS = 32;
+
+/*
+ * Slerp without trigonometry (Eberly, A Fast and Accurate Algorithm for Computing SLERP): the weights
+ * sin(t * angle) / sin(angle) are a polynomial in t and the cosine of the angle, evaluated as
+ * t * (1 + b0 * (1 + b1 * (... (1 + b7)))) with bi = (SLERP_U[i] * t * t - SLERP_V[i]) * (cos - 1).
+ * The last terms absorb the truncated rest of the series.
+ */
+constexpr u32 SLERP_TERMS = 8;
+constexpr f32 SLERP_MU = 1.85298109240830f;
+constexpr f32 SLERP_U[SLERP_TERMS] = {1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+    1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), SLERP_MU / (8 * 17)};
+constexpr f32 SLERP_V[SLERP_TERMS] = {1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15,
+    SLERP_MU * 8 / 17};
+
+/*
+ * Kernels work on the floats of count packed elements: 16 per matrix, row major, 4 per Vector4 and
+ * Quaternion, 3 per Vector3, 6 per BoundingBox. multiply advances b by bStride floats per matrix and the transforms advance
+ * matrix by matrixStride, 0 uses the same matrix for every element. The Vector3 transforms extend each
+ * vector with w, 1 for points and 0 for directions. Each kernel reads a whole element before it writes
+ * its output, so out may be an input.
+ */
+struct MatrixKernels {
+    void (*multiply)(const f32* a, const f32* b, u32 bStride, f32* out, u32 count);
+    void (*transpose)(const f32* in, f32* out, u32 count);
+    void (*inverse)(const f32* in, f32* out, u32 count);
+    // the affine kernels ignore the 4th column and treat it as (0, 0, 0, 1)
+    void (*inverseAffine)(const f32* in, f32* out, u32 count);
+    void (*inverseRigid)(const f32* in, f32* out, u32 count);
+    void (*normalMatrix)(const f32* in, f32* out, u32 count);
+    void (*transform)(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count);
+    void (*transformVector3)(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count, f32 w);
+    // one array per component
+    void (*transformVector3SoA)(const f32* matrix, const f32* const in[VECTOR3_FLOATS],
+        f32* const out[VECTOR3_FLOATS], u32 count, f32 w);
+    // bounds of the transformed boxes, the 4th column is ignored like in the affine kernels
+    void (*transformBox)(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count);
+    // grows box, minimum then maximum, to the count Vector3 points
+    void (*bounds)(const f32* points, u32 count, f32* box);
+    // boxes holds the center x, y, z and extent x, y, z arrays, planes the normal and distance of each plane
+    void (*cullBoxes)(const f32* planes, u32 planeCount, const f32* const boxes[BOX_FLOATS], u32* visible, u32 count);
+    void (*makeTransform)(const f32* position, const f32* scale, const f32* orientation, f32* out, u32 count);
+    void (*makeTransformSoA)(const f32* const position[VECTOR3_FLOATS], const f32* const scale[VECTOR3_FLOATS],
+        const f32* const orientation[VECTOR4_FLOATS], f32* out, u32 count);
+    // quaternions in one array per component, t advances by tStride, 0 uses the same factor for all
+    void (*nlerp)(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t,
+        u32 tStride, f32* const out[VECTOR4_FLOATS], u32 count);
+    void (*slerp)(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t,
+        u32 tStride, f32* const out[VECTOR4_FLOATS], u32 count);
+};
+
+/*
+ * The Math::Fast array functions over count floats, the SIMD kernels compute the scalar functions lane
+ * by lane. Inputs may be outputs, sinCos skips a null output.
+ */
+struct FastMathKernels {
+    void (*reciprocalSqrt)(const f32* x, f32* out, u32 count);
+    void (*sinCos)(const f32* x, f32* sine, f32* cosine, u32 count);
+    void (*atan2)(const f32* y, const f32* x, f32* out, u32 count);
+    void (*exp2)(const f32* x, f32* out, u32 count);
+    void (*log2)(const f32* x, f32* out, u32 count);
+};
+
+namespace MatrixScalar {
+void Multiply(const f32* a, const f32* b, u32 bStride, f32* out, u32 count);
+void Transpose(const f32* in, f32* out, u32 count);
+void Inverse(const f32* in, f32* out, u32 count);
+void InverseAffine(const f32* in, f32* out, u32 count);
+void InverseRigid(const f32* in, f32* out, u32 count);
+void NormalMatrix(const f32* in, f32* out, u32 count);
+void InverseTransform(const f32* position, const f32* scale, const f32* orientation, f32* out, u32 count);
+void Transform(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count);
+void TransformVector3(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count, f32 w);
+void TransformVector3SoA(const f32* matrix, const f32* const in[VECTOR3_FLOATS], f32* const out[VECTOR3_FLOATS],
+    u32 count, f32 w);
+void TransformBox(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count);
+void Bounds(const f32* points, u32 count, f32* box);
+void CullBoxes(const f32* planes, u32 planeCount, const f32* const boxes[BOX_FLOATS], u32* visible, u32 count);
+void MakeTransform(const f32* position, const f32* scale, const f32* orientation, f32* out, u32 count);
+void MakeTransformSoA(const f32* const position[VECTOR3_FLOATS], const f32* const scale[VECTOR3_FLOATS],
+    const f32* const orientation[VECTOR4_FLOATS], f32* out, u32 count);
+void Nlerp(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t, u32 tStride,
+    f32* const out[VECTOR4_FLOATS], u32 count);
+void Slerp(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t, u32 tStride,
+    f32* const out[VECTOR4_FLOATS], u32 count);
+}
+
+namespace FastMathScalar {
+void ReciprocalSqrt(const f32* x, f32* out, u32 count);
+void SinCos(const f32* x, f32* sine, f32* cosine, u32 count);
+void Atan2(const f32* y, const f32* x, f32* out, u32 count);
+void Exp2(const f32* x, f32* out, u32 count);
+void Log2(const f32* x, f32* out, u32 count);
+}
+
+/*
+ * Fill kernels with the kernels of an instruction set, keeping the entries it has no kernel for.
+ * They return false if the build or the CPU lacks the instruction set.
+ */
+bool GetSSE4MatrixKernels(MatrixKernels& kernels);
+bool GetAVX2MatrixKernels(MatrixKernels& kernels);
+bool GetNEONMatrixKernels(MatrixKernels& kernels);
+bool GetSSE4FastMathKernels(FastMathKernels& kernels);
+bool GetAVX2FastMathKernels(FastMathKernels& kernels);
+bool GetNEONFastMathKernels(FastMathKernels& kernels);
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Trivially copyable mirrors of the CGKit math types.
+ */
+
+#ifndef POD_MATH_H
+#define POD_MATH_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include "Math/Color.h"
+#include "Math/Matrix4.h"
+#include "Math/Plane.h"
+#include "Math/Vector2.h"
+
+namespace CGKit {
+
+/*
+ * The CGKit math types declare their destructors and assignment operators out of line in libcgkit, so
+ * arrays of them are copied, relocated and destroyed one element and one library call at a time. The
+ * types here have the same layout and no user-defined copy, move or destructor: they are trivially
+ * copyable and constexpr constructible, vectors of them grow with memcpy and need no destruction, and
+ * they may live in unions. Use them for bulk data and convert at the SDK boundary.
+ */
+struct Float2 {
+    f32 x;
+    f32 y;
+
+    constexpr Float2() : x(0.0f), y(0.0f) {}
+
+    constexpr Float2(f32 nx, f32 ny) : x(nx), y(ny) {}
+
+    explicit Float2(const Vector2& v) : x(v.x), y(v.y) {}
+
+    Vector2 ToVector2() const
+    {
+        return Vector2(x, y);
+    }
+};
+
+struct Float3 {
+    f32 x;
+    f32 y;
+    f32 z;
+
+    constexpr Float3() : x(0.0f), y(0.0f), z(0.0f) {}
+
+    constexpr Float3(f32 nx, f32 ny, f32 nz) : x(nx), y(ny), z(nz) {}
+
+    explicit Float3(const Vector3& v) : x(v.x), y(v.y), z(v.z) {}
+
+    Vector3 ToVector3() const
+    {
+        return Vector3(x, y, z);
+    }
+};
+
+// Also the layout of Quaternion, x y z w.
+struct Float4 {
+    f32 x;
+    f32 y;
+    f32 z;
+    f32 w;
+
+    constexpr Float4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+
+    constexpr Float4(f32 nx, f32 ny, f32 nz, f32 nw) : x(nx), y(ny), z(nz), w(nw) {}
+
+    explicit Float4(const Vector4& v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+
+    explicit Float4(const Quaternion& q) : x(q.x), y(q.y), z(q.z), w(q.w) {}
+
+    Vector4 ToVector4() const
+    {
+        return Vector4(x, y, z, w);
+    }
+
+    Quaternion ToQuaternion() const
+    {
+        return Quaternion(x, y, z, w);
+    }
+};
+
+// Row major like Matrix4.
+struct Float4x4 {
+    f32 m[MATRIX4_ROW_SIZE * MATRIX4_COLUMN_SIZE];
+
+    constexpr Float4x4() : m {} {}
+
+    constexpr Float4x4(f32 m00, f32 m01, f32 m02, f32 m03, f32 m10, f32 m11, f32 m12, f32 m13,
+        f32 m20, f32 m21, f32 m22, f32 m23, f32 m30, f32 m31, f32 m32, f32 m33)
+        : m {m00, m01, m02, m03, m10, m11, m12, m13, m20, m21, m22, m23, m30, m31, m32, m33}
+    {}
+
+    explicit Float4x4(const Matrix4& matrix)
+    {
+        memcpy(m, matrix.m, sizeof(m));
+    }
+
+    Matrix4 ToMatrix4() const
+    {
+        Matrix4 matrix;
+        memcpy(matrix.m, m, sizeof(m));
+        return matrix;
+    }
+};
+
+// The u32 of Color, red in the low byte.
+struct Rgba8 {
+    u32 color;
+
+    constexpr Rgba8() : color(0) {}
+
+    constexpr Rgba8(u32 red, u32 green, u32 blue, u32 alpha)
+        : color((red & 0xff) | ((green & 0xff) << 8) | ((blue & 0xff) << 16) | ((alpha & 0xff) << 24))
+    {}
+
+    explicit Rgba8(const Color& c) : color(c.color) {}
+
+    Color ToColor() const
+    {
+        Color c;
+        c.color = color;
+        return c;
+    }
+};
+
+// Plane: the normal and the distance from the origin.
+struct PlaneEquation {
+    Float3 normal;
+    f32 distance;
+
+    constexpr PlaneEquation() : normal(), distance(0.0f) {}
+
+    constexpr PlaneEquation(const Float3& n, f32 d) : normal(n), distance(d) {}
+
+    explicit PlaneEquation(const Plane& plane) : normal(plane.m_normal), distance(plane.m_distance) {}
+
+    Plane ToPlane() const
+    {
+        Plane plane;
+        plane.Set(normal.ToVector3(), distance);
+        return plane;
+    }
+};
+
+constexpr Float2 FLOAT2_ZERO(0.0f, 0.0f);
+constexpr Float2 FLOAT2_ONE(1.0f, 1.0f);
+constexpr Float3 FLOAT3_ZERO(0.0f, 0.0f, 0.0f);
+constexpr Float3 FLOAT3_ONE(1.0f, 1.0f, 1.0f);
+constexpr Float4 FLOAT4_ZERO(0.0f, 0.0f, 0.0f, 0.0f);
+constexpr Float4 FLOAT4_ONE(1.0f, 1.0f, 1.0f, 1.0f);
+constexpr Float4 QUATERNION_IDENTITY(0.0f, 0.0f, 0.0f, 1.0f);
+constexpr Float4x4 FLOAT4X4_ZERO;
+constexpr Float4x4 FLOAT4X4_IDENTITY(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+    0.0f, 0.0f, 0.0f, 1.0f);
+
+constexpr Float3 operator+(const Float3& a, const Float3& b)
+{
+    return Float3(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+constexpr Float3 operator-(const Float3& a, const Float3& b)
+{
+    return Float3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+constexpr Float3 operator*(const Float3& a, f32 s)
+{
+    return Float3(a.x * s, a.y * s, a.z * s);
+}
+
+constexpr f32 Dot(const Float3& a, const Float3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+constexpr Float3 Cross(const Float3& a, const Float3& b)
+{
+    return Float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+constexpr Float3 Min(const Float3& a, const Float3& b)
+{
+    return Float3(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z);
+}
+
+constexpr Float3 Max(const Float3& a, const Float3& b)
+{
+    return Float3(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z);
+}
+
+#define POD_MATH_CHECK(pod, sdk)                                                                        \
+    static_assert(std::is_trivially_copyable<pod>::value && std::is_standard_layout<pod>::value,       \
+        #pod " must stay trivially copyable");                                                          \
+    static_assert(std::is_trivially_destructible<pod>::value, #pod " must stay trivially destructible"); \
+    static_assert(sizeof(pod) == sizeof(sdk), #pod " must have the layout of " #sdk)
+POD_MATH_CHECK(Float2, Vector2);
+POD_MATH_CHECK(Float3, Vector3);
+POD_MATH_CHECK(Float4, Vector4);
+POD_MATH_CHECK(Float4, Quaternion);
+POD_MATH_CHECK(Float4x4, Matrix4);
+POD_MATH_CHECK(Rgba8, Color);
+POD_MATH_CHECK(PlaneEquation, Plane);
+#undef POD_MATH_CHECK
+
+static_assert(offsetof(Float3, z) == offsetof(Vector3, z), "Float3 must have the layout of Vector3");
+static_assert(offsetof(Float4, w) == offsetof(Quaternion, w), "Float4 must have the layout of Quaternion");
+static_assert(offsetof(PlaneEquation, distance) == offsetof(Plane, m_distance),
+    "PlaneEquation must have the layout of Plane");
+static_assert(FLOAT4X4_IDENTITY.m[15] == 1.0f && FLOAT4X4_ZERO.m[15] == 0.0f, "constants must be constexpr");
+
+}  // namespace CGKit
+
+#endif
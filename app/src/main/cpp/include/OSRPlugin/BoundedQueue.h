@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Fixed-capacity blocking queue used to connect the OSR pipeline stages.
+ */
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include "Core/Types.h"
+
+namespace CGKit {
+
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(u32 capacity) : m_capacity(capacity > 0 ? capacity : 1) {}
+
+    ~BoundedQueue() {}
+
+    CG_DELETE_COPY_AND_MOVE_CONSTRUCTOR(BoundedQueue)
+
+    /*
+     * Blocks while the queue is full. Returns false if the queue was closed before the item was pushed.
+     */
+    bool Push(const T& item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed) {
+            return false;
+        }
+        m_items.push_back(item);
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /*
+     * Blocks while the queue is empty. Returns false once the queue is closed and drained.
+     */
+    bool Pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty()) {
+            return false;
+        }
+        item = m_items.front();
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    /*
+     * Wakes up all waiters. Items already queued can still be popped.
+     */
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    u32 Capacity() const
+    {
+        return m_capacity;
+    }
+
+private:
+    const u32 m_capacity;
+    bool m_closed = false;
+    std::deque<T> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+};
+
+}  // namespace CGKit
+
+#endif
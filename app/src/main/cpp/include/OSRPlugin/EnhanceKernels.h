@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Row kernels behind OSRCpuPlugin and ImageQuality, one table per instruction set.
+ */
+
+#ifndef ENHANCE_KERNELS_H
+#define ENHANCE_KERNELS_H
+
+#include "Core/Types.h"
+
+namespace CGKit {
+
+// taps of the 1-4-6-4-1 binomial blur the unsharp mask subtracts, in each direction
+constexpr u32 BLUR_TAPS = 5;
+constexpr u32 BLUR_RADIUS = 2;
+// sharpening amount is 6-bit fixed point and at most 2.0, so (pixel - blur) * amount fits 16 bits
+constexpr s32 SHARPEN_SHIFT = 6;
+constexpr s32 SHARPEN_MAX_AMOUNT = 2 << SHARPEN_SHIFT;
+// Lanczos-3 upscaling: six taps per direction, 14-bit weights, the horizontal pass keeps 6 fraction bits
+constexpr u32 LANCZOS_TAPS = 6;
+constexpr s32 LANCZOS_WEIGHT_SHIFT = 14;
+constexpr s32 LANCZOS_FRACTION_SHIFT = 6;
+// SSIM statistics are gathered over windows of 8x8 luma samples
+constexpr u32 SSIM_WINDOW = 8;
+
+/**
+ * @brief Sums over one SSIM window of two images a and b.
+ */
+struct SsimSums {
+    u32 a;
+    u32 b;
+    u32 aa;
+    u32 bb;
+    u32 ab;
+};
+
+/*
+ * Kernels work on the bytes of one row of 8-bit samples, so count is width * channels.
+ * blurColumn sums the five rows around an output row with the binomial weights.
+ * sharpenRow blurs those column sums horizontally and applies src + (src - blur) * amount. columns must
+ * hold BLUR_RADIUS * channels padding samples on both sides.
+ * resampleColumn is the vertical Lanczos pass, it weights six rows of the horizontal pass and rounds to
+ * 8 bits.
+ * squaredError sums the squared differences of two rows, ssimWindow gathers the SsimSums of the window
+ * at a and b, two planes with the same stride.
+ * Everything is integer arithmetic, so all instruction sets produce identical bytes.
+ */
+struct EnhanceKernels {
+    void (*blurColumn)(const u8* const rows[BLUR_TAPS], u16* columns, u32 count);
+    void (*sharpenRow)(const u8* src, const u16* columns, u8* dst, u32 count, u32 channels, s32 amount);
+    void (*resampleColumn)(const s16* const rows[LANCZOS_TAPS], const s16* weights, u8* dst, u32 count);
+    u64 (*squaredError)(const u8* a, const u8* b, u32 count);
+    void (*ssimWindow)(const u8* a, const u8* b, u32 stride, SsimSums& sums);
+};
+
+namespace EnhanceScalar {
+void BlurColumn(const u8* const rows[BLUR_TAPS], u16* columns, u32 count);
+void SharpenRow(const u8* src, const u16* columns, u8* dst, u32 count, u32 channels, s32 amount);
+void ResampleColumn(const s16* const rows[LANCZOS_TAPS], const s16* weights, u8* dst, u32 count);
+u64 SquaredError(const u8* a, const u8* b, u32 count);
+void SsimWindow(const u8* a, const u8* b, u32 stride, SsimSums& sums);
+}
+
+/*
+ * Returns the kernels of the instruction set PixelConverter uses, so that PixelConverter::SetIsa
+ * switches these kernels as well.
+ */
+const EnhanceKernels& GetEnhanceKernels();
+
+/*
+ * Fill kernels with the kernels of an instruction set, they return false if the build or the CPU lacks
+ * the instruction set.
+ */
+bool GetSSE4EnhanceKernels(EnhanceKernels& kernels);
+bool GetAVX2EnhanceKernels(EnhanceKernels& kernels);
+bool GetNEONEnhanceKernels(EnhanceKernels& kernels);
+
+}  // namespace CGKit
+
+#endif
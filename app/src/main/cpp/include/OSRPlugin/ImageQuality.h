@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Full reference image quality metrics for plugin outputs.
+ */
+
+#ifndef IMAGE_QUALITY_H
+#define IMAGE_QUALITY_H
+
+#include "OSRPlugin/OSRPluginCommon.h"
+
+namespace CGKit {
+
+/*
+ * Compares an image against a reference of the same size, both in any format PixelConverter supports.
+ * The sums run on the EnhanceKernels of the PixelConverter instruction set and are exact integers, so
+ * every instruction set reports the same values.
+ */
+class ImageQuality {
+public:
+    /*
+     * Peak signal to noise ratio in dB over the R, G and B bytes, alpha is ignored. Identical images give
+     * infinity.
+     */
+    static bool PSNR(const BufferDescriptor& image, const BufferDescriptor& reference, f64& psnr);
+
+    /*
+     * Mean structural similarity of the BT.601 luma, over SSIM_WINDOW x SSIM_WINDOW windows placed every
+     * half window. Images smaller than one window fail.
+     */
+    static bool SSIM(const BufferDescriptor& image, const BufferDescriptor& reference, f64& ssim);
+};
+
+}  // namespace CGKit
+
+#endif
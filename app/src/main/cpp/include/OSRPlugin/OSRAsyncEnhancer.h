@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Asynchronous image enhancing on top of an OSRSession.
+ */
+
+#ifndef OSR_ASYNC_ENHANCER_H
+#define OSR_ASYNC_ENHANCER_H
+
+#include <future>
+#include <thread>
+#include "OSRPlugin/OSRSession.h"
+
+namespace CGKit {
+
+/**
+ * @brief Describes how an asynchronous request finished.
+ */
+enum OSRRequestStatus {
+    OSR_REQUEST_DONE,
+    OSR_REQUEST_FAILED,
+    OSR_REQUEST_CANCELLED,
+    OSR_REQUEST_TIMED_OUT
+};
+
+/*
+ * Called once a request has finished: on the worker thread, or on the cancelling thread for a request
+ * cancelled before it started. The buffers are the ones passed to EnhanceAsync, so the callback is the
+ * place to consume and release them.
+ */
+using OSRCallback = std::function<void(OSRRequestStatus status, BufferDescriptor& inBuffer,
+    BufferDescriptor& outBuffer)>;
+
+/**
+ * @brief Handle of a submitted request.
+ */
+struct OSRAsyncRequest {
+    /** 0 if the request was rejected */
+    u64 id = 0;
+    /** becomes ready with the final status */
+    std::shared_future<OSRRequestStatus> result;
+};
+
+/*
+ * Queues enhance requests and completes them on a worker thread so that the caller never blocks on the
+ * plugin. Requests run one at a time in submission order since the plugin serves one call at a time;
+ * any number of them can be queued. A deadline is turned into the plugin timeout of the request,
+ * requests whose deadline expired while queued are not sent to the plugin at all.
+ */
+class OSRAsyncEnhancer {
+public:
+    explicit OSRAsyncEnhancer(OSRSession& session);
+    ~OSRAsyncEnhancer();
+
+    CG_DELETE_COPY_AND_MOVE_CONSTRUCTOR(OSRAsyncEnhancer)
+
+    /*
+     * Queues inBuffer for enhancing into outBuffer. Both buffers must stay valid until the request
+     * completes. deadlineMs counts from now.
+     */
+    OSRAsyncRequest EnhanceAsync(const BufferDescriptor& inBuffer, const BufferDescriptor& outBuffer,
+        OSRCallback callback = nullptr, u32 deadlineMs = OSRSession::DEFAULT_TIME_OUT_MS);
+
+    /*
+     * Cancels a request. A queued request completes right away, a running one completes as cancelled
+     * once the plugin returns. Returns false if the request already completed.
+     */
+    bool Cancel(u64 id);
+
+    /*
+     * Cancels every queued and running request.
+     */
+    void CancelAll();
+
+    /*
+     * Returns the number of queued and running requests.
+     */
+    u32 GetInFlightCount();
+
+private:
+    struct Request {
+        u64 id;
+        BufferDescriptor inBuffer;
+        BufferDescriptor outBuffer;
+        OSRCallback callback;
+        std::chrono::steady_clock::time_point deadline;
+        std::promise<OSRRequestStatus> promise;
+        bool cancelled;
+    };
+
+    void WorkerLoop();
+    void Complete(Request& request, OSRRequestStatus status);
+
+private:
+    OSRSession& m_session;
+    std::deque<std::shared_ptr<Request>> m_queue;
+    std::shared_ptr<Request> m_running;
+    u64 m_nextId = 1;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::thread m_worker;
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Recycling allocator for plugin image buffers.
+ */
+
+#ifndef OSR_BUFFER_POOL_H
+#define OSR_BUFFER_POOL_H
+
+#include "OSRPlugin/OSRPluginCommon.h"
+
+namespace CGKit {
+
+/**
+ * @brief Describes how a buffer pool allocates and how much it keeps.
+ */
+struct OSRBufferPoolConfig {
+    /** back blocks of 2MB and more with transparent huge pages */
+    bool hugePages = false;
+    /** bytes of released blocks kept for reuse, larger releases go back to the system */
+    u64 maxCachedBytes = 256ull * 1024 * 1024;
+};
+
+/**
+ * @brief Describes the traffic and footprint of a buffer pool.
+ */
+struct OSRBufferPoolStats {
+    /** acquires served from a cached block */
+    u64 hits = 0;
+    /** acquires that had to allocate */
+    u64 misses = 0;
+    /** bytes of all blocks owned by the pool, handed out or cached */
+    u64 residentBytes = 0;
+    /** bytes of blocks currently handed out */
+    u64 inUseBytes = 0;
+
+    f64 HitRate() const
+    {
+        return (hits + misses) > 0 ? static_cast<f64>(hits) / (hits + misses) : 0.0;
+    }
+};
+
+/*
+ * Hands out 64-byte aligned pixel buffers from size classes and keeps released blocks for the next
+ * frame, so that a batch of same-sized images allocates once per buffer in flight. Size classes are a
+ * quarter of a power of two apart, which bounds the slack of a block to 25%. Every block starts with
+ * a small header recording its class and whether it is handed out. Release finds the block in an address
+ * sorted registry of the blocks the pool owns before reading its header, so it never touches memory the
+ * pool does not own and rejects a buffer released twice. The registry only changes when a block is
+ * allocated or freed, a hit allocates nothing.
+ * Acquire and Release are thread safe.
+ */
+class OSRBufferPool {
+public:
+    static constexpr u32 ALIGNMENT = 64;
+
+    explicit OSRBufferPool(const OSRBufferPoolConfig& config = OSRBufferPoolConfig());
+    ~OSRBufferPool();
+
+    CG_DELETE_COPY_AND_MOVE_CONSTRUCTOR(OSRBufferPool)
+
+    /*
+     * Fills buffer with a block of len bytes at least. The pixels are not cleared.
+     */
+    bool Acquire(BufferDescriptor& buffer, u32 len);
+
+    /*
+     * Returns the block of buffer to the pool. Returns false if buffer.addr was not acquired from it or was
+     * already released.
+     */
+    bool Release(BufferDescriptor& buffer);
+
+    /*
+     * Frees every cached block.
+     */
+    void Trim();
+
+    OSRBufferPoolStats GetStats();
+
+private:
+    struct Block;
+
+    static u32 GetSizeClass(u64 len, u64& classBytes);
+    Block* Allocate(u32 sizeClass, u64 classBytes);
+    void Free(Block* block);
+
+private:
+    OSRBufferPoolConfig m_config;
+    std::vector<std::vector<Block*>> m_freeLists;
+    // every block owned by the pool, handed out or cached, sorted by address
+    std::vector<Block*> m_blocks;
+    u64 m_cachedBytes = 0;
+    OSRBufferPoolStats m_stats;
+    std::mutex m_mutex;
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: CPU implementation of the OfflineSupRes image enhancing, used when the NPU plugin is not
+ * available.
+ */
+
+#ifndef OSR_CPU_PLUGIN_H
+#define OSR_CPU_PLUGIN_H
+
+#include <atomic>
+#include "OSRPlugin/OSRPluginCommon.h"
+#include "OSRPlugin/EnhanceKernels.h"
+#include "OSRPlugin/OSRThreadPool.h"
+#include "PluginManager/IPlugin.h"
+
+namespace CGKit {
+
+/**
+ * @brief Interpolation used for super sampling.
+ */
+enum OSRUpscaleMode {
+    /** separable Lanczos-3, any output size at least as large as the input */
+    OSR_UPSCALE_LANCZOS3,
+    /** interpolates along the weaker gradient so that edges stay sharp, 2x only, other sizes use Lanczos */
+    OSR_UPSCALE_EDGE_DIRECTED,
+    OSR_UPSCALE_MODE_MAX
+};
+
+/*
+ * Answers the image enhancing and super sampling opcodes of OfflineSupRes on the CPU. SYNC_IMAGE_ENHANCING applies an
+ * unsharp mask of the given sharpness, the difference to a 5x5 binomial blur, followed by an ACES
+ * filmic tone curve when tone mapping is requested. The image is cut into bands of rows that the
+ * workers process in parallel with the SSE4/AVX2/NEON kernels PixelConverter selected, and the result
+ * is bit exact across instruction sets and worker counts.
+ * QUERY_SUPER_SAMPLING reports the input scaled by scale and SYNC_SUPER_SAMPLING upscales into the
+ * output buffer with the upscale mode. Both report estimatedCostTime from the measured cost of earlier
+ * images, so callers can compare it with the NPU plugin and pick the cheaper engine.
+ * Works on R8, R8G8B8 and R8G8B8A8 UNORM images, alpha is passed through when enhancing. SET_ASSETS_DIR
+ * is accepted and ignored, there is no model to load.
+ */
+class OSRCpuPlugin : public IPlugin {
+public:
+    // workers 0 uses one worker per core, scale is the super sampling factor QUERY_SUPER_SAMPLING reports.
+    explicit OSRCpuPlugin(u32 workers = 0, u32 scale = 2);
+    ~OSRCpuPlugin() override;
+
+    const String& GetPluginInfo() const override;
+
+    bool Execute(const Param& paramIn, Param& paramOut) override;
+
+    /*
+     * Enhances inBuffer into outBuffer of the same size and format.
+     */
+    bool Enhance(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer, f32 sharpness, bool toneMapping);
+
+    /*
+     * Upscales inBuffer into outBuffer of the same format, which must not be smaller in either dimension.
+     */
+    bool Upscale(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer);
+
+    void SetUpscaleMode(OSRUpscaleMode mode)
+    {
+        m_upscaleMode = mode;
+    }
+
+    OSRUpscaleMode GetUpscaleMode() const
+    {
+        return m_upscaleMode;
+    }
+
+    static bool IsSupported(PixelFormat format);
+
+private:
+    bool Initialize() override;
+    void Uninitialize() override;
+    bool Query(const Param& paramIn, const Param& paramOut, u32 scale);
+    bool EnhanceImage(const Param& paramIn, const Param& paramOut);
+    bool UpscaleImage(const Param& paramIn, const Param& paramOut);
+    void EnhanceRows(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer, u32 y0, u32 y1,
+        const EnhanceKernels& kernels, s32 amount, bool toneMapping, std::vector<u16>& columns) const;
+    void UpscaleLanczos(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer);
+    void UpscaleEdgeDirected(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer);
+
+private:
+    u32 m_scale;
+    std::atomic<OSRUpscaleMode> m_upscaleMode;
+    OSRThreadPool m_pool;
+    // measured cost of the last images per output megapixel, reported as estimatedCostTime
+    std::atomic<f32> m_msPerMegaPixel;
+    std::atomic<f32> m_upscaleMsPerMegaPixel[OSR_UPSCALE_MODE_MAX];
+    const String m_info = "OSR CPU plugin";
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Bounded three-stage read -> enhance -> write pipeline for batch super-resolution.
+ */
+
+#ifndef OSR_PIPELINE_H
+#define OSR_PIPELINE_H
+
+#include "OSRPlugin/OSRPluginCommon.h"
+#include "OSRPlugin/BoundedQueue.h"
+
+namespace CGKit {
+
+/**
+ * @brief Describes how the pipeline is sized.
+ */
+struct OSRPipelineConfig {
+    /** max frames waiting between two adjacent stages */
+    u32 queueDepth = 4;
+};
+
+/**
+ * @brief Describes the work done by one pipeline stage.
+ */
+struct OSRStageStats {
+    /** frames the stage completed successfully */
+    u32 frames = 0;
+    /** frames the stage dropped */
+    u32 failures = 0;
+    /** pixels handled by successful frames */
+    u64 pixels = 0;
+    /** time spent inside the stage function(ms) */
+    f64 busyMs = 0.0;
+
+    f64 FramesPerSecond() const
+    {
+        return busyMs > 0.0 ? frames * 1000.0 / busyMs : 0.0;
+    }
+
+    f64 MegaPixelsPerSecond() const
+    {
+        return busyMs > 0.0 ? pixels / (busyMs * 1000.0) : 0.0;
+    }
+};
+
+/**
+ * @brief Describes a whole pipeline run.
+ */
+struct OSRPipelineStats {
+    OSRStageStats read;
+    OSRStageStats enhance;
+    OSRStageStats write;
+    /** elapsed time from the first read to the last write(ms) */
+    f64 wallMs = 0.0;
+};
+
+/**
+ * @brief One image travelling through the pipeline.
+ */
+struct OSRFrame {
+    String inPath;
+    String outPath;
+    BufferDescriptor inBuffer {nullptr, 0, 0, 0, PIXEL_FORMAT_MAX};
+    BufferDescriptor outBuffer {nullptr, 0, 0, 0, PIXEL_FORMAT_MAX};
+    /** outBuffer already maps outPath, so writing it only means releasing it */
+    bool outMapped = false;
+};
+
+/*
+ * Runs the read, enhance and write stages of a frame list concurrently. The read and write stages get a
+ * thread each, the enhance stage runs on the calling thread so that plugin calls stay on one thread.
+ * Stage functions own the buffers of their frame: a failing stage must release what it allocated, a
+ * frame is only handed to the next stage when its stage function returns true.
+ */
+class OSRPipeline {
+public:
+    using Stage = std::function<bool(OSRFrame& frame)>;
+
+    explicit OSRPipeline(const OSRPipelineConfig& config);
+    ~OSRPipeline();
+
+    /*
+     * Pushes every frame through the three stages. Returns true if all frames were written.
+     */
+    bool Run(std::vector<OSRFrame>& frames, const Stage& read, const Stage& enhance, const Stage& write,
+        OSRPipelineStats* stats);
+
+    /*
+     * Logs per-stage throughput of a pipeline run.
+     */
+    static void LogStats(const OSRPipelineStats& stats);
+
+private:
+    OSRPipelineConfig m_config;
+};
+
+}  // namespace CGKit
+
+#endif
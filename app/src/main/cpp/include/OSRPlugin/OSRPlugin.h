@@ -9,20 +9,14 @@
 #define OSRPLUGIN_H
 
 #include "OSRPlugin/OSRPluginCommon.h"
+#include "OSRPlugin/OSRPipeline.h"
+#include "OSRPlugin/OSRSession.h"
+#include "OSRPlugin/OSRAsyncEnhancer.h"
+#include "OSRPlugin/OSRBufferPool.h"
+#include "OSRPlugin/OSRTiledEnhancer.h"
 #include "MainApplication/MainApplication.h"
 
 namespace CGKit {
-// Describes pixel format.
-enum OSROperationCode {
-    QUERY_SUPER_SAMPLING = 0,
-    QUERY_IMAGE_ENHANCING = 1,
-    SYNC_SUPER_SAMPLING = 2,
-    SYNC_IMAGE_ENHANCING = 3,
-    ASYNC_SUPER_SAMPLING = 4,
-    ASYNC_IMAGE_ENHANCING = 5,
-    SET_ASSETS_DIR = 6
-};
-
 static inline u64 GetCurrentTimeMilliSecond()
 {
     std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -31,29 +25,61 @@ static inline u64 GetCurrentTimeMilliSecond()
 }
 
 #ifdef CG_ANDROID_PLATFORM
+// Receives an enhanced in-memory frame, outBuffer is only valid during the call.
+using OSRFrameCallback = std::function<void(bool success, const BufferDescriptor& outBuffer)>;
+
 class OSRPlugin {
 public:
     OSRPlugin();
+    // Drives the given plugin instead of loading OfflineSupRes through the plugin manager.
+    explicit OSRPlugin(IPlugin* standIn);
     ~OSRPlugin();
     void ExecuteOSR(const String localDir);
+    // Same as ExecuteOSR, but enhancing and writing the result to outputName happen on the OSR worker thread.
+    bool ExecuteOSRAsync(const String& localDir, const String& outputName = "output_ie_async.ppm");
+    // Enhances a frame in memory on the OSR worker thread and hands the result to callback, no file is
+    // involved. A frame in another format than packed RGB is converted before this returns, a packed RGB
+    // frame is read in place and must stay valid until callback has run.
+    bool ExecuteOSRFrame(const String& localDir, const BufferDescriptor& frame, OSRFrameCallback callback);
+    // Whether an ExecuteOSRAsync or ExecuteOSRFrame request is still queued or running.
+    bool IsEnhancing();
+    // Writes frame to localDir/name as PNM, for ExecuteOSRFrame callbacks that deliver the result as a file.
+    static bool SaveFrame(const BufferDescriptor& frame, const String& localDir, const String& name);
+    // Wraps the last snapshot of app, RGBA8 pixels of the screen size, without copying it.
+    static BufferDescriptor WrapSnapshot(const BaseApplication& app);
+    bool ExecuteOSRBatch(const String& localDir, const std::vector<String>& inputs, const String& outputDir,
+        const OSRPipelineConfig& config, OSRPipelineStats* stats = nullptr);
+    bool ExecuteOSRDirectory(const String& localDir, const String& inputDir, const String& outputDir,
+        const OSRPipelineConfig& config, OSRPipelineStats* stats = nullptr);
+    // Images larger than MAX_WIDTH x MAX_HEIGHT are enhanced in tiles of this config.
+    void SetTileConfig(const OSRTileConfig& config);
+    OSRBufferPoolStats GetBufferPoolStats();
+    // The .ppm files in dir, sorted by name.
+    static std::vector<String> ListPPMFiles(const String& dir);
 
 private:
-    u8* ReadPPM(const String& path, u32& width, u32& height);
-    s32 Format2Channel(PixelFormat format);
-    bool WritePPM(const String& path, const u8* pixels, u32 width, u32 height);
+    // Accepts every format PixelConverter supports.
     bool CreateBuffer(BufferDescriptor& buffer, u32 w, u32 h, PixelFormat format);
+    // Creates converted, a copy of buffer in format.
+    bool ConvertBuffer(const BufferDescriptor& buffer, PixelFormat format, BufferDescriptor& converted);
+    bool CreateEnhancer();
     bool ReadBuffer(BufferDescriptor& buffer, const String& path);
     bool WriteBuffer(const BufferDescriptor& buffer, const String& path);
     void DeleteBuffer(BufferDescriptor& buffer);
-    bool SetAssetsDir(const String& localDir);
-    bool QueryImage(BufferDescriptor& inBuffer, PluginConfig* pluginConfig);
-    bool ImageEnhancingSync(BufferDescriptor& inBuffer, BufferDescriptor& outBuffer);
-    bool PluginInit();
-    void PluginDeInit();
+    bool EnhanceFrame(OSRFrame& frame);
+    bool NeedsTiling(const BufferDescriptor& buffer) const;
+    bool EnhanceTiled(OSRFrame& frame);
+    static String JoinPath(const String& dir, const String& name);
+    static String OutputPath(const String& outputDir, const String& inPath);
 
 private:
-    IPlugin* plugin = nullptr;
-    const String pluginName = "OfflineSupRes";
+    // Output buffers are recycled across frames, declared first so that it outlives their users.
+    OSRBufferPool bufferPool;
+    // Kept open across calls so that the plugin and its model are loaded once.
+    OSRSession session;
+    // Created on first async call, destroyed before the session it drives.
+    OSRAsyncEnhancer* enhancer = nullptr;
+    OSRTileConfig tileConfig;
 };
 #endif
 
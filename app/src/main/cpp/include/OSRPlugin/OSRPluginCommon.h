@@ -12,6 +12,19 @@
 extern "C" {
 #endif
 namespace CGKit {
+/**
+ * @brief Describes plugin operation code.
+ */
+enum OSROperationCode {
+    QUERY_SUPER_SAMPLING = 0,
+    QUERY_IMAGE_ENHANCING = 1,
+    SYNC_SUPER_SAMPLING = 2,
+    SYNC_IMAGE_ENHANCING = 3,
+    ASYNC_SUPER_SAMPLING = 4,
+    ASYNC_IMAGE_ENHANCING = 5,
+    SET_ASSETS_DIR = 6
+};
+
 /**
  * @brief Describes buffer for plugin inoutput.
  */
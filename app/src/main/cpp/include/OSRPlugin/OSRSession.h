@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Long-lived connection to the OfflineSupRes plugin.
+ */
+
+#ifndef OSR_SESSION_H
+#define OSR_SESSION_H
+
+#include "OSRPlugin/OSRPluginCommon.h"
+#include "OSRPlugin/OSRCpuPlugin.h"
+#include "OSRPlugin/PluginCallFrame.h"
+#include "PluginManager/PluginManager.h"
+
+namespace CGKit {
+
+/*
+ * Loads the plugin and pins its assets dir once, then serves any number of query and enhance calls.
+ * Query results only depend on the opcode, input size and format, so they are cached and repeated
+ * frames of the same size skip the plugin round trip. Plugin calls are serialised, so a session
+ * can be shared between the render thread and OSR worker threads, and each kind of call reuses one
+ * PluginCallFrame instead of building its Param arrays per call. Re-opening the same dir and cached
+ * queries only take a short state lock, so the render thread does not wait out a running enhance call.
+ * When OfflineSupRes cannot be loaded or is not activated, the session falls back to OSRCpuPlugin.
+ */
+class OSRSession {
+public:
+    OSRSession();
+    // Drives the given plugin instead of loading OfflineSupRes through the plugin manager.
+    explicit OSRSession(IPlugin* standIn);
+    ~OSRSession();
+
+    CG_DELETE_COPY_AND_MOVE_CONSTRUCTOR(OSRSession)
+
+    /*
+     * Loads the plugin on first use and points it at localDir. Re-opening with the same dir is free,
+     * a different dir only re-issues SET_ASSETS_DIR.
+     */
+    bool Open(const String& localDir);
+
+    /*
+     * Unloads the plugin and drops the query cache.
+     */
+    void Close();
+
+    bool IsOpen() const
+    {
+        return plugin != nullptr;
+    }
+
+    // True while the session runs on OSRCpuPlugin instead of OfflineSupRes.
+    bool IsCpuFallback() const
+    {
+        return plugin == &cpuPlugin;
+    }
+
+    // Disabling the fallback makes Open fail without OfflineSupRes, as before the CPU plugin existed.
+    void SetCpuFallback(bool enabled)
+    {
+        cpuFallback = enabled;
+    }
+
+    bool QueryImage(const BufferDescriptor& inBuffer, PluginConfig& pluginConfig);
+
+    /*
+     * Fills pluginConfig with the output size and cost of upscaling inBuffer.
+     */
+    bool QuerySuperSampling(const BufferDescriptor& inBuffer, PluginConfig& pluginConfig);
+
+    /*
+     * Blocks until the plugin has enhanced inBuffer into outBuffer or timeOut(ms) has expired.
+     */
+    bool ImageEnhancingSync(BufferDescriptor& inBuffer, BufferDescriptor& outBuffer,
+        u32 timeOut = DEFAULT_TIME_OUT_MS);
+
+    /*
+     * Blocks until the plugin has upscaled inBuffer into outBuffer or timeOut(ms) has expired.
+     */
+    bool SuperSamplingSync(BufferDescriptor& inBuffer, BufferDescriptor& outBuffer,
+        u32 timeOut = DEFAULT_TIME_OUT_MS);
+
+    static constexpr u32 DEFAULT_TIME_OUT_MS = 10000;
+
+    u32 GetQueryCacheHits() const
+    {
+        return queryCacheHits;
+    }
+
+    u32 GetQueryCacheMisses() const
+    {
+        return queryCacheMisses;
+    }
+
+private:
+    struct QueryKey {
+        s32 opCode;
+        s32 width;
+        s32 height;
+        s32 format;
+
+        bool operator<(const QueryKey& other) const
+        {
+            if (opCode != other.opCode) {
+                return opCode < other.opCode;
+            }
+            if (width != other.width) {
+                return width < other.width;
+            }
+            if (height != other.height) {
+                return height < other.height;
+            }
+            return format < other.format;
+        }
+    };
+
+    void CloseLocked();
+    // Forgets the cached queries and their counters, they belong to the model of the old assets dir.
+    void ClearQueryCacheLocked();
+    bool Query(OSROperationCode opCode, const BufferDescriptor& inBuffer, PluginConfig& pluginConfig);
+    // Takes stateMutex, fails when the session is closed or key is not cached.
+    bool FindCachedQuery(const QueryKey& key, PluginConfig& pluginConfig);
+    bool PluginInit();
+    bool FallBackToCpu();
+    void PluginDeInit();
+    bool SetAssetsDir(const String& localDir);
+
+private:
+    IPlugin* plugin = nullptr;
+    IPlugin* standInPlugin = nullptr;
+    OSRCpuPlugin cpuPlugin;
+    bool cpuFallback = true;
+    const String pluginName = "OfflineSupRes";
+    String assetsDir;
+    std::map<QueryKey, PluginConfig> queryCache;
+    u32 queryCacheHits = 0;
+    u32 queryCacheMisses = 0;
+    // opcode, dir
+    PluginCallFrame<2> assetsFrame;
+    // opcode, width, height, format
+    PluginCallFrame<4> queryFrame;
+    // opcode, inBuffer, sharpness, toneMapping, timeOut
+    PluginCallFrame<5> enhanceFrame;
+    // opcode, inBuffer, timeOut
+    PluginCallFrame<3> superSamplingFrame;
+    // Held across every plugin call, taken before stateMutex.
+    std::mutex callMutex;
+    // Guards the query cache and its counters. plugin and assetsDir are written with both mutexes held,
+    // so either one is enough to read them.
+    std::mutex stateMutex;
+};
+
+}  // namespace CGKit
+
+#endif
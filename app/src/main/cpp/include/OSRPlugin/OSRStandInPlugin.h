@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Local stand-in for the OfflineSupRes plugin, used to run and benchmark the OSR code
+ * paths on devices without the NPU plugin.
+ */
+
+#ifndef OSR_STAND_IN_PLUGIN_H
+#define OSR_STAND_IN_PLUGIN_H
+
+#include "OSRPlugin/OSRPluginCommon.h"
+#include "PluginManager/IPlugin.h"
+
+namespace CGKit {
+
+/*
+ * Answers the OSR opcodes the same way the real plugin does. SET_ASSETS_DIR reads ie_data.bin like the
+ * real plugin loads its model, image enhancing copies the input to the output and super sampling does
+ * a nearest-neighbour upscale. Every sync call is stretched to costMs so that pipelines can be
+ * benchmarked against a realistic plugin latency.
+ */
+class OSRStandInPlugin : public IPlugin {
+public:
+    explicit OSRStandInPlugin(f32 costMs = 0.0f, u32 scale = 2);
+    ~OSRStandInPlugin() override;
+
+    const String& GetPluginInfo() const override;
+
+    bool Execute(const Param& paramIn, Param& paramOut) override;
+
+private:
+    bool Initialize() override;
+    void Uninitialize() override;
+    bool LoadModel(const Param& paramIn);
+    bool Query(const Param& paramIn, const Param& paramOut, u32 scale);
+    bool Enhance(const Param& paramIn, const Param& paramOut);
+    bool SuperSample(const Param& paramIn, const Param& paramOut);
+    void Stall(u64 startUs) const;
+
+private:
+    f32 m_costMs;
+    u32 m_scale;
+    std::vector<u8> m_model;
+    const String m_info = "OSR stand-in plugin";
+};
+
+}  // namespace CGKit
+
+#endif
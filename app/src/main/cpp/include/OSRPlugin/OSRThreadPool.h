@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Fixed set of worker threads for data parallel loops.
+ */
+
+#ifndef OSR_THREAD_POOL_H
+#define OSR_THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Core/Types.h"
+
+namespace CGKit {
+
+/*
+ * Runs the iterations of a loop on workers - 1 pool threads plus the calling thread. The threads are
+ * started by the first loop and then wait for the next one, so per frame loops do not pay for thread
+ * creation. Loops from different threads are run one after the other.
+ */
+class OSRThreadPool {
+public:
+    // workers 0 uses one worker per core.
+    explicit OSRThreadPool(u32 workers = 0);
+    ~OSRThreadPool();
+
+    CG_DELETE_COPY_AND_MOVE_CONSTRUCTOR(OSRThreadPool)
+
+    u32 GetWorkerCount() const
+    {
+        return m_workers;
+    }
+
+    /*
+     * Calls task(index, worker) for every index in [0, count) and returns once all calls are done.
+     * worker is below GetWorkerCount() and unique among the calls running at the same time, so tasks can
+     * use it to pick their scratch memory.
+     */
+    void ParallelFor(u32 count, const std::function<void(u32 index, u32 worker)>& task);
+
+private:
+    void Start();
+    void WorkerLoop(u32 worker);
+    void RunTasks(u32 worker);
+
+private:
+    u32 m_workers;
+    std::vector<std::thread> m_threads;
+    // serialises ParallelFor calls
+    std::mutex m_loopMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+    const std::function<void(u32, u32)>* m_task = nullptr;
+    u32 m_count = 0;
+    u32 m_next = 0;
+    u32 m_running = 0;
+    u64 m_generation = 0;
+    bool m_stop = false;
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Tiled image enhancing for images larger than one plugin call can take.
+ */
+
+#ifndef OSR_TILED_ENHANCER_H
+#define OSR_TILED_ENHANCER_H
+
+#include "OSRPlugin/OSRSession.h"
+#include "OSRPlugin/OSRThreadPool.h"
+
+namespace CGKit {
+
+/**
+ * @brief Describes how an image is cut into tiles.
+ */
+struct OSRTileConfig {
+    /** max input tile size, each tile is one plugin call */
+    u32 tileWidth = 1024;
+    u32 tileHeight = 1024;
+    /** input pixels shared by two neighbouring tiles, at most a quarter of the tile size */
+    u32 overlap = 32;
+    /** threads blending an enhanced tile into the output, the plugin calls run one at a time */
+    u32 workers = 2;
+};
+
+/*
+ * Cuts an image into overlapping tiles, enhances them with one plugin call each and cross-fades the
+ * overlaps into the output, so that the seams of neighbouring tiles do not show. The output is scaled
+ * by the factor the plugin reports for a tile. Tiles are enhanced one at a time in row order, the
+ * session serialises plugin calls; only blending the rows of an enhanced tile into the output runs on
+ * the workers of a thread pool. Vertical seams are summed in f32, horizontal seams fade into the blend
+ * the tile row above left in the output. Besides the input and output buffers, which may be file
+ * mappings, memory use is one input tile, one output tile and the blend sums of one overlap as high as
+ * an output tile, whatever the image size.
+ */
+class OSRTiledEnhancer {
+public:
+    OSRTiledEnhancer(OSRSession& session, const OSRTileConfig& config);
+    ~OSRTiledEnhancer();
+
+    CG_DELETE_COPY_AND_MOVE_CONSTRUCTOR(OSRTiledEnhancer)
+
+    /*
+     * Fills pluginConfig with the output size of the whole image.
+     */
+    bool QueryImage(const BufferDescriptor& inBuffer, PluginConfig& pluginConfig);
+
+    /*
+     * Enhances inBuffer into outBuffer, which must have the size and format returned by QueryImage.
+     */
+    bool Enhance(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer);
+
+    /*
+     * Returns the tile memory Enhance allocates for an image of the given size.
+     */
+    u64 GetTileBytes(const BufferDescriptor& inBuffer);
+
+    u32 GetTileCount() const
+    {
+        return m_tileCount;
+    }
+
+private:
+    // Placement of the tiles along one axis, in input pixels.
+    struct Axis {
+        u32 tileSize;
+        std::vector<u32> starts;
+    };
+
+    struct Layout {
+        Axis x;
+        Axis y;
+        u32 scaleX;
+        u32 scaleY;
+        PluginConfig tileConfig;
+        u32 channels;
+        u32 bytesPerSample;
+    };
+
+    bool Plan(const BufferDescriptor& inBuffer, Layout& layout);
+    static Axis PlanAxis(u32 size, u32 tileSize, u32 overlap);
+
+private:
+    OSRSession& m_session;
+    OSRTileConfig m_config;
+    OSRThreadPool m_pool;
+    u32 m_tileCount = 0;
+};
+
+}  // namespace CGKit
+
+#endif
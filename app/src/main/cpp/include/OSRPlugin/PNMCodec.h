@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Memory-mapped PNM(P5/P6) reader and writer for plugin buffers.
+ */
+
+#ifndef PNM_CODEC_H
+#define PNM_CODEC_H
+
+#include "OSRPlugin/OSRPluginCommon.h"
+
+namespace CGKit {
+
+/**
+ * @brief Describes the header of a binary PNM file.
+ */
+struct PNMHeader {
+    /** 1 for P5(graymap), 3 for P6(pixmap) */
+    u32 channels;
+    u32 width;
+    u32 height;
+    /** 1..65535, samples above 255 take two big-endian bytes */
+    u32 maxVal;
+    /** offset of the first sample in the file */
+    size_t dataOffset;
+    /** size of the sample data */
+    size_t dataSize;
+};
+
+/*
+ * Reads map the file privately and point BufferDescriptor.addr straight at its samples, so no pixel is
+ * copied for 8-bit files of maxval 255. 16-bit samples are stored big-endian, they are byte-swapped in place and only
+ * the touched pages get copied by the kernel. Writes size the file with ftruncate and fill a shared
+ * mapping of it.
+ * Buffers returned by Read and Create stay mapped until Release is called on them.
+ */
+class PNMCodec {
+public:
+    /*
+     * Parses a P5/P6 header, '#' comments are allowed between any two header fields.
+     */
+    static bool ParseHeader(const u8* data, size_t size, PNMHeader& header);
+
+    /*
+     * Maps a PNM file into buffer. The pixel format is R8, R16, R8G8B8 or R16G16B16 depending on the
+     * header. Samples of any other maxval than 255 or 65535, such as 10 or 12-bit files, are scaled
+     * to the full range of the format in place, which copies every page of the mapping.
+     */
+    static bool Read(const String& path, BufferDescriptor& buffer);
+
+    /*
+     * Writes buffer as P5 or P6 depending on its pixel format.
+     */
+    static bool Write(const String& path, const BufferDescriptor& buffer);
+
+    /*
+     * Creates a PNM file of the given size and maps its zeroed samples into buffer, so that an image
+     * larger than memory can be produced in place. The samples reach the file once buffer is released.
+     */
+    static bool Create(const String& path, u32 width, u32 height, PixelFormat format, BufferDescriptor& buffer);
+
+    /*
+     * Unmaps a buffer returned by Read or Create. Returns false if buffer.addr is not a mapping of this
+     * codec.
+     */
+    static bool Release(BufferDescriptor& buffer);
+
+    /*
+     * Returns the channel count and sample size of the pixel formats PNM can hold, false otherwise.
+     */
+    static bool GetSampleLayout(PixelFormat format, u32& channels, u32& bytesPerSample);
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Pixel format conversion for plugin buffers.
+ */
+
+#ifndef PIXEL_CONVERTER_H
+#define PIXEL_CONVERTER_H
+
+#include "OSRPlugin/OSRPluginCommon.h"
+
+namespace CGKit {
+
+/**
+ * @brief Instruction sets the conversion kernels are built for.
+ */
+enum PixelIsa {
+    PIXEL_ISA_SCALAR,
+    PIXEL_ISA_SSE4,
+    PIXEL_ISA_AVX2,
+    PIXEL_ISA_NEON,
+    PIXEL_ISA_MAX
+};
+
+/**
+ * @brief Chroma order of a semi-planar YUV 4:2:0 image.
+ */
+enum YUVLayout {
+    /** interleaved U, V after the luma plane */
+    YUV_LAYOUT_NV12,
+    /** interleaved V, U after the luma plane, the Android camera default */
+    YUV_LAYOUT_NV21
+};
+
+/*
+ * Converts tightly packed images between the colour formats of RenderCommon.h and the packed RGB the
+ * plugin works on. Conversions go through R8G8B8_UNORM, so any supported format converts to any other.
+ * RGBA8, BGRA8 and RGBA16F have SSE4/AVX2/NEON kernels, the best one the CPU supports is picked on
+ * first use. NV12/NV21 use full-range BT.601 and the same 6-bit fixed point on every instruction set,
+ * so all kernels produce identical bytes.
+ */
+class PixelConverter {
+public:
+    /*
+     * Returns the size of one pixel, 0 if format cannot be converted.
+     */
+    static u32 GetBytesPerPixel(PixelFormat format);
+
+    static bool IsSupported(PixelFormat format)
+    {
+        return GetBytesPerPixel(format) != 0;
+    }
+
+    /*
+     * Converts src into dst, both must have the same size and dst.addr must hold dst.format pixels.
+     */
+    static bool Convert(const BufferDescriptor& src, BufferDescriptor& dst);
+
+    /*
+     * Converts a semi-planar YUV 4:2:0 image into dst, which must be an R8G8B8_UNORM buffer of the same
+     * size. uvPlane holds ceil(height / 2) rows of ceil(width / 2) chroma pairs.
+     */
+    static bool YUVToRGB(const u8* yPlane, const u8* uvPlane, YUVLayout layout, BufferDescriptor& dst);
+
+    /*
+     * Converts an R8G8B8_UNORM image into a semi-planar YUV 4:2:0 image, chroma is averaged over 2x2.
+     */
+    static bool RGBToYUV(const BufferDescriptor& src, YUVLayout layout, u8* yPlane, u8* uvPlane);
+
+    /*
+     * Returns the instruction set in use.
+     */
+    static PixelIsa GetIsa();
+
+    /*
+     * Switches to the kernels of isa, fails if the CPU or the build does not support it. Meant for
+     * benchmarks, it must not race with running conversions.
+     */
+    static bool SetIsa(PixelIsa isa);
+
+    static const c8* GetIsaName(PixelIsa isa);
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Row kernels behind PixelConverter, one table per instruction set.
+ */
+
+#ifndef PIXEL_KERNELS_H
+#define PIXEL_KERNELS_H
+
+#include "Core/Types.h"
+
+namespace CGKit {
+
+/*
+ * Every kernel converts count pixels of one row. yuvToRgb converts one luma row with the chroma row it
+ * shares with its neighbour row. rgbToYuv converts a pair of RGB rows into their luma rows and the chroma
+ * row they share, averaged over 2x2 blocks; the last row of an odd height comes as a pair of itself.
+ */
+struct PixelKernels {
+    void (*rgbaToRgb)(const u8* src, u8* dst, u32 count);
+    void (*bgraToRgb)(const u8* src, u8* dst, u32 count);
+    void (*rgbToRgba)(const u8* src, u8* dst, u32 count);
+    void (*rgbToBgra)(const u8* src, u8* dst, u32 count);
+    void (*rgba16fToRgb)(const u16* src, u8* dst, u32 count);
+    void (*rgbToRgba16f)(const u8* src, u16* dst, u32 count);
+    void (*yuvToRgb)(const u8* y, const u8* uv, u8* dst, u32 count, bool nv21);
+    void (*rgbToYuv)(const u8* top, const u8* bottom, u8* yTop, u8* yBottom, u8* uv, u32 count, bool nv21);
+};
+
+// 6-bit fixed point full-range BT.601 coefficients shared by all YUV kernels
+constexpr s32 YUV_SHIFT = 6;
+constexpr s32 YUV_R_V = 90;
+constexpr s32 YUV_G_U = 22;
+constexpr s32 YUV_G_V = 46;
+constexpr s32 YUV_B_U = 113;
+
+// 8-bit fixed point full-range BT.601 coefficients of the other direction, magnitudes of the terms
+constexpr s32 RGB_SHIFT = 8;
+constexpr s32 RGB_Y_R = 77;
+constexpr s32 RGB_Y_G = 150;
+constexpr s32 RGB_Y_B = 29;
+constexpr s32 RGB_U_R = 43;
+constexpr s32 RGB_U_G = 85;
+constexpr s32 RGB_U_B = 128;
+constexpr s32 RGB_V_R = 128;
+constexpr s32 RGB_V_G = 107;
+constexpr s32 RGB_V_B = 21;
+
+namespace PixelScalar {
+void RgbaToRgb(const u8* src, u8* dst, u32 count);
+void BgraToRgb(const u8* src, u8* dst, u32 count);
+void RgbToRgba(const u8* src, u8* dst, u32 count);
+void RgbToBgra(const u8* src, u8* dst, u32 count);
+void Rgba16fToRgb(const u16* src, u8* dst, u32 count);
+void RgbToRgba16f(const u8* src, u16* dst, u32 count);
+void YuvToRgb(const u8* y, const u8* uv, u8* dst, u32 count, bool nv21);
+void RgbToYuv(const u8* top, const u8* bottom, u8* yTop, u8* yBottom, u8* uv, u32 count, bool nv21);
+u16 FloatToHalf(f32 value);
+f32 HalfToFloat(u16 value);
+}
+
+/*
+ * Fill kernels with the kernels of an instruction set, keeping the entries it has no kernel for.
+ * They return false if the build or the CPU lacks the instruction set.
+ */
+bool GetSSE4Kernels(PixelKernels& kernels);
+bool GetAVX2Kernels(PixelKernels& kernels);
+bool GetNEONKernels(PixelKernels& kernels);
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Preallocated argument lists for IPlugin::Execute.
+ */
+
+#ifndef PLUGIN_CALL_FRAME_H
+#define PLUGIN_CALL_FRAME_H
+
+#include "PluginManager/IPlugin.h"
+
+namespace CGKit {
+
+/*
+ * The paramIn and paramOut arrays of one kind of plugin call, IN_ARITY and OUT_ARITY slots long.
+ * Building a Param array per call allocates every time Param::Set(idx, ...) grows it and copies each
+ * element Param on the way. A frame builds both arrays once, and Set/SetOut then overwrite the value
+ * of a slot in place, so calls with bool, s32, f32, f64 and pointer arguments do not touch the heap.
+ * In() and Out() are ordinary Params, so plugins see no difference. A frame is not thread safe, keep one
+ * per caller or serialise the calls.
+ */
+template <u32 IN_ARITY, u32 OUT_ARITY = 1>
+class PluginCallFrame {
+public:
+    PluginCallFrame()
+    {
+        paramIn.Set<Param::Array>(Param::Array(IN_ARITY));
+        paramOut.Set<Param::Array>(Param::Array(OUT_ARITY));
+    }
+
+    template <typename T>
+    void Set(u32 idx, T val)
+    {
+        paramIn.Get<Param::Array>()[idx].Set<T>(val);
+    }
+
+    template <typename T>
+    void SetOut(u32 idx, T val)
+    {
+        paramOut.Get<Param::Array>()[idx].Set<T>(val);
+    }
+
+    const Param& In() const
+    {
+        return paramIn;
+    }
+
+    const Param& Out() const
+    {
+        return paramOut;
+    }
+
+    /*
+     * Copies the slots of a Param array built the usual way into the frame. Only the scalar and pointer
+     * slots that fit the arity are taken over, so this never allocates either. Returns false if in is
+     * not an array of at most IN_ARITY such slots.
+     */
+    bool Load(const Param& in)
+    {
+        if (!in.IsArray() || in.ArrayLen() > IN_ARITY) {
+            return false;
+        }
+        Param::Array& slots = paramIn.Get<Param::Array>();
+        for (u32 i = 0; i < in.ArrayLen(); i++) {
+            const Param& slot = in.Get(i);
+            if (slot.IsString() || slot.IsArray() || slot.IsObject()) {
+                return false;
+            }
+            slots[i].type = slot.type;
+            slots[i].value = slot.value;
+        }
+        for (u32 i = static_cast<u32>(in.ArrayLen()); i < IN_ARITY; i++) {
+            slots[i].type = PARAMETER_TYPE_MAX;
+        }
+        return true;
+    }
+
+    bool Execute(IPlugin& plugin)
+    {
+        return plugin.Execute(paramIn, paramOut);
+    }
+
+private:
+    Param paramIn;
+    Param paramOut;
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Param with variant storage, for large parameter trees such as loaded materials.
+ */
+
+#ifndef COMPACT_PARAM_H
+#define COMPACT_PARAM_H
+
+#include <new>
+#include "Utils/Param.h"
+#include "Param/ParamKey.h"
+
+namespace CGKit {
+
+class ParamObject;
+
+/*
+ * Same interface as Param, but only the active type takes space. Param carries a Matrix4 sized Value
+ * union, a String, an Array and an Object whatever its type, CompactParam keeps one of them in a union:
+ * - bool, s32, f32, f64, vectors, quaternions, colors and pointers are stored inline.
+ * - String and Array are stored inline too, short strings then stay in the String's own small buffer
+ *   and an Array costs its three pointers until elements are added.
+ * - Matrix4 and Object are rarely used and large, they live out of line behind a pointer.
+ * Get<T>() of String, Array, Object and Matrix4 on a param of another type returns an empty value, the
+ * non-const overload first turns the param into an empty value of that type. Param is the SDK type and
+ * cannot change its layout, so plugins still exchange Param and CompactParam converts from and to it.
+ * Objects are ParamObjects, Keys() therefore lists members in insertion order where Param sorts them.
+ */
+class CompactParam {
+public:
+    typedef std::vector<CompactParam> Array;
+    typedef ParamObject Object;
+
+    CompactParam() : type(PARAMETER_TYPE_MAX), pointerValue(nullptr) {}
+    CompactParam(const CompactParam& other);
+    CompactParam(CompactParam&& other) noexcept;
+    CompactParam& operator=(const CompactParam& other);
+    CompactParam& operator=(CompactParam&& other) noexcept;
+    ~CompactParam();
+
+    /* Converts an SDK Param tree. */
+    explicit CompactParam(const Param& param);
+
+    /* Writes this tree into param, replacing its content. */
+    void ToParam(Param& param) const;
+
+    /*
+     * Builds a tree from json in one pass, reserving every array and object up front. Integers become
+     * s32, other numbers f32, null an untyped param.
+     */
+    static CompactParam FromJson(const nlohmann::json& json);
+
+    void Clear();
+
+    template<typename T>
+    const T& Get() const;
+
+    template<typename T>
+    T& Get();
+
+    const void* Get() const
+    {
+        return pointerValue;
+    }
+
+    template<typename T>
+    void Set(T val);
+
+    /* Sets element idx, growing the array like std::vector does instead of copying it per call. */
+    void Set(u32 idx, const CompactParam& param);
+    void Set(u32 idx, CompactParam&& param);
+
+    void Set(const String& name, const CompactParam& param);
+    void Set(const String& name, CompactParam&& param);
+
+    /*
+     * Reserves room for count elements of an array or count members of an object, a param of another
+     * type becomes an empty array first.
+     */
+    void Reserve(u32 count);
+
+    /* Appends param to the array, a param of another type becomes an array first. */
+    CompactParam& PushBack(const CompactParam& param);
+    CompactParam& PushBack(CompactParam&& param);
+
+    /* Like PushBack, but constructs the element from args in place. args must not refer into this tree. */
+    template<typename... Args>
+    CompactParam& Emplace(Args&&... args)
+    {
+        MakeArray();
+        arrayValue.emplace_back(std::forward<Args>(args)...);
+        return arrayValue.back();
+    }
+
+    explicit CompactParam(bool val) : type(PARAMETER_TYPE_BOOLEAN), booleanValue(val) {}
+    explicit CompactParam(s32 val) : type(PARAMETER_TYPE_INT), intValue(val) {}
+    explicit CompactParam(f32 val) : type(PARAMETER_TYPE_FLOAT), floatValue(val) {}
+    explicit CompactParam(f64 val) : type(PARAMETER_TYPE_DOUBLE), doubleValue(val) {}
+    explicit CompactParam(void* val) : type(PARAMETER_TYPE_POINTER), pointerValue(val) {}
+    explicit CompactParam(const Vector2& val);
+    explicit CompactParam(const Vector3& val);
+    explicit CompactParam(const Vector4& val);
+    explicit CompactParam(const Matrix4& val);
+    explicit CompactParam(const Quaternion& val);
+    explicit CompactParam(const Color& val);
+    explicit CompactParam(const String& val);
+    explicit CompactParam(const Array& val);
+    explicit CompactParam(const Object& val);
+
+    char ParameterType() const
+    {
+        return static_cast<char>(type);
+    }
+
+    bool IsBool() const
+    {
+        return type == PARAMETER_TYPE_BOOLEAN;
+    }
+
+    bool IsInt() const
+    {
+        return type == PARAMETER_TYPE_INT;
+    }
+
+    bool IsFloat() const
+    {
+        return type == PARAMETER_TYPE_FLOAT;
+    }
+
+    bool IsDouble() const
+    {
+        return type == PARAMETER_TYPE_DOUBLE;
+    }
+
+    bool IsVector2() const
+    {
+        return type == PARAMETER_TYPE_VECTOR2;
+    }
+
+    bool IsVector3() const
+    {
+        return type == PARAMETER_TYPE_VECTOR3;
+    }
+
+    bool IsVector4() const
+    {
+        return type == PARAMETER_TYPE_VECTOR4;
+    }
+
+    bool IsMatrix() const
+    {
+        return type == PARAMETER_TYPE_MATRIX;
+    }
+
+    bool IsQuaternion() const
+    {
+        return type == PARAMETER_TYPE_QUATERNION;
+    }
+
+    bool IsColor() const
+    {
+        return type == PARAMETER_TYPE_COLOR;
+    }
+
+    bool IsPointer() const
+    {
+        return type == PARAMETER_TYPE_POINTER;
+    }
+
+    bool IsString() const
+    {
+        return type == PARAMETER_TYPE_STRING;
+    }
+
+    bool IsArray() const
+    {
+        return type == PARAMETER_TYPE_ARRAY;
+    }
+
+    bool IsObject() const
+    {
+        return type == PARAMETER_TYPE_OBJECT;
+    }
+
+    const CompactParam& Get(u32 idx) const;
+
+    const CompactParam& Get(const String& key) const;
+
+    size_t ArrayLen() const
+    {
+        return IsArray() ? arrayValue.size() : 0;
+    }
+
+    bool Has(const String& key) const;
+
+    std::vector<String> Keys() const;
+
+    /* Element or member count, without building Keys(). */
+    s32 Size() const;
+
+private:
+    /* Destroys the active member and leaves the param without type. */
+    void Reset();
+    /* Turns the param into an empty array unless it already is an array. */
+    void MakeArray();
+    static void BuildFromJson(const nlohmann::json& json, CompactParam& param);
+    void CopyFrom(const CompactParam& other);
+    void MoveFrom(CompactParam& other);
+
+    static const CompactParam& Null();
+
+private:
+    s32 type;
+    union {
+        bool booleanValue;
+        s32 intValue;
+        f32 floatValue;
+        f64 doubleValue;
+        Vector2 vector2Value;
+        Vector3 vector3Value;
+        Vector4 vector4Value;
+        Quaternion quaternionValue;
+        Color colorValue;
+        void* pointerValue;
+        Matrix4* matrixValue;
+        String stringValue;
+        Array arrayValue;
+        Object* objectValue;
+    };
+};
+
+#define COMPACT_PARAM_SET(ctype, var, paramType)     \
+    template<>                                       \
+    inline void CompactParam::Set<ctype>(ctype val)  \
+    {                                                \
+        Reset();                                     \
+        new (&var) ctype(val);                       \
+        type = paramType;                            \
+    }
+COMPACT_PARAM_SET(bool, booleanValue, PARAMETER_TYPE_BOOLEAN)
+COMPACT_PARAM_SET(s32, intValue, PARAMETER_TYPE_INT)
+COMPACT_PARAM_SET(f32, floatValue, PARAMETER_TYPE_FLOAT)
+COMPACT_PARAM_SET(f64, doubleValue, PARAMETER_TYPE_DOUBLE)
+COMPACT_PARAM_SET(Vector2, vector2Value, PARAMETER_TYPE_VECTOR2)
+COMPACT_PARAM_SET(Vector3, vector3Value, PARAMETER_TYPE_VECTOR3)
+COMPACT_PARAM_SET(Vector4, vector4Value, PARAMETER_TYPE_VECTOR4)
+COMPACT_PARAM_SET(Quaternion, quaternionValue, PARAMETER_TYPE_QUATERNION)
+COMPACT_PARAM_SET(Color, colorValue, PARAMETER_TYPE_COLOR)
+COMPACT_PARAM_SET(void*, pointerValue, PARAMETER_TYPE_POINTER)
+#undef COMPACT_PARAM_SET
+
+/* Like the accessors in CompactParam.cpp: const access to another type reads a default, non-const access resets. */
+#define COMPACT_PARAM_GET(ctype, var, paramType)         \
+    template<>                                           \
+    inline const ctype& CompactParam::Get<ctype>() const \
+    {                                                    \
+        static const ctype nullValue = ctype();          \
+        return type == paramType ? var : nullValue;      \
+    }                                                    \
+    template<>                                           \
+    inline ctype& CompactParam::Get<ctype>()             \
+    {                                                    \
+        if (type != paramType) {                         \
+            Set<ctype>(ctype());                         \
+        }                                                \
+        return var;                                      \
+    }
+COMPACT_PARAM_GET(bool, booleanValue, PARAMETER_TYPE_BOOLEAN)
+COMPACT_PARAM_GET(s32, intValue, PARAMETER_TYPE_INT)
+COMPACT_PARAM_GET(f32, floatValue, PARAMETER_TYPE_FLOAT)
+COMPACT_PARAM_GET(f64, doubleValue, PARAMETER_TYPE_DOUBLE)
+COMPACT_PARAM_GET(Vector2, vector2Value, PARAMETER_TYPE_VECTOR2)
+COMPACT_PARAM_GET(Vector3, vector3Value, PARAMETER_TYPE_VECTOR3)
+COMPACT_PARAM_GET(Vector4, vector4Value, PARAMETER_TYPE_VECTOR4)
+COMPACT_PARAM_GET(Quaternion, quaternionValue, PARAMETER_TYPE_QUATERNION)
+COMPACT_PARAM_GET(Color, colorValue, PARAMETER_TYPE_COLOR)
+#undef COMPACT_PARAM_GET
+
+/* Types that do not fit a scalar slot, their accessors live in CompactParam.cpp. */
+template<> const Matrix4& CompactParam::Get<Matrix4>() const;
+template<> Matrix4& CompactParam::Get<Matrix4>();
+template<> void CompactParam::Set<Matrix4>(Matrix4 val);
+template<> const String& CompactParam::Get<String>() const;
+template<> String& CompactParam::Get<String>();
+template<> void CompactParam::Set<String>(String val);
+template<> const CompactParam::Array& CompactParam::Get<CompactParam::Array>() const;
+template<> CompactParam::Array& CompactParam::Get<CompactParam::Array>();
+template<> void CompactParam::Set<CompactParam::Array>(CompactParam::Array val);
+template<> const CompactParam::Object& CompactParam::Get<CompactParam::Object>() const;
+template<> CompactParam::Object& CompactParam::Get<CompactParam::Object>();
+template<> void CompactParam::Set<CompactParam::Object>(CompactParam::Object val);
+
+/*
+ * The members of a CompactParam object, in insertion order. Members hold an interned ParamKey instead of
+ * their own copy of the key, and lookups go through a flat open addressing table of member indices with
+ * linear probing, kept at most half full. Small objects, the common case, skip the table and compare the
+ * key hashes of their few members directly. Unlike std::map, adding a member may move the others, so
+ * references returned by Find and operator[] are only valid until the next insertion.
+ */
+class ParamObject {
+public:
+    struct Member {
+        const ParamKey* key;
+        CompactParam value;
+
+        const String& Name() const
+        {
+            return *key->name;
+        }
+    };
+    typedef std::vector<Member>::iterator Iterator;
+    typedef std::vector<Member>::const_iterator ConstIterator;
+
+    size_t Size() const
+    {
+        return members.size();
+    }
+
+    bool Empty() const
+    {
+        return members.empty();
+    }
+
+    void Reserve(size_t count);
+
+    void Clear();
+
+    /* The value of key, nullptr if the object has no such member. */
+    CompactParam* Find(const String& key);
+    const CompactParam* Find(const String& key) const;
+
+    /* The value of key, added as an untyped param if the object has no such member. */
+    CompactParam& operator[](const String& key);
+
+    Iterator begin()
+    {
+        return members.begin();
+    }
+
+    Iterator end()
+    {
+        return members.end();
+    }
+
+    ConstIterator begin() const
+    {
+        return members.begin();
+    }
+
+    ConstIterator end() const
+    {
+        return members.end();
+    }
+
+private:
+    static constexpr u32 NOT_FOUND = 0xFFFFFFFFu;
+    static constexpr size_t LINEAR_SCAN_MAX = 8;
+
+    u32 Lookup(const String& key, u32 hash) const;
+    void Rehash(size_t count);
+    void Index(u32 member);
+
+private:
+    std::vector<Member> members;
+    // member index + 1 per slot, 0 when free, empty while the object is small enough to scan
+    std::vector<u32> slots;
+};
+
+}  // namespace CGKit
+
+#endif
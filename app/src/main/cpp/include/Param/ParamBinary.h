@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Binary encoding of parameter trees, read in place from memory-mapped files.
+ */
+
+#ifndef PARAM_BINARY_H
+#define PARAM_BINARY_H
+
+#include "Param/CompactParam.h"
+
+namespace CGKit {
+
+/*
+ * Layout, native little-endian, every node 4-byte aligned:
+ * - header: magic, version, blob size, root node offset, string table offset, all u32.
+ * - node: u32 parameter type, then its payload. bool, s32 and Color take 4 bytes, f32 and the vector,
+ *   quaternion and matrix types their f32 components, f64 8 bytes. A string is a u32 index into the
+ *   string table. An array is a u32 count and the u32 offsets of its elements, an object a u32 count and
+ *   {key string index, value offset} pairs sorted by key. Children always follow their parent.
+ * - string table: u32 count, {offset, length} per string, then the NUL terminated characters. Keys and
+ *   string values are stored once however often they occur.
+ * Pointers mean nothing outside the process that wrote them, they are encoded as untyped params.
+ */
+class ParamBinary {
+public:
+    static constexpr u32 MAGIC = 0x42504743;  // "CGPB"
+    static constexpr u32 VERSION = 1;
+
+    static void Encode(const Param& param, std::vector<u8>& blob);
+    static void Encode(const CompactParam& param, std::vector<u8>& blob);
+
+    static bool Save(const String& path, const Param& param);
+    static bool Save(const String& path, const CompactParam& param);
+};
+
+/*
+ * A node of an encoded tree, read straight from the blob. Getting an element or member only walks the
+ * offsets down to it, nothing is decoded or copied until a value is asked for. Every read is checked
+ * against the blob size, a malformed or missing node reads as an untyped param. A view does not own
+ * the blob, it is valid as long as the ParamFile it came from stays open.
+ */
+class ParamView {
+public:
+    ParamView() = default;
+    ParamView(const u8* data, u32 size, u32 node) : data(data), size(size), node(node) {}
+
+    s32 Type() const;
+
+    bool IsValid() const
+    {
+        return Type() != PARAMETER_TYPE_MAX;
+    }
+
+    bool IsArray() const
+    {
+        return Type() == PARAMETER_TYPE_ARRAY;
+    }
+
+    bool IsObject() const
+    {
+        return Type() == PARAMETER_TYPE_OBJECT;
+    }
+
+    bool IsString() const
+    {
+        return Type() == PARAMETER_TYPE_STRING;
+    }
+
+    /* The value if the node has type T, T() otherwise. */
+    template<typename T>
+    T Get() const;
+
+    /* The characters of a string node, in place and NUL terminated, nullptr for other nodes. */
+    const c8* CString(u32* length = nullptr) const;
+
+    u32 ArrayLen() const;
+
+    ParamView Get(u32 idx) const;
+
+    /* Binary search of the sorted members. */
+    ParamView Get(const c8* key) const;
+
+    ParamView Get(const String& key) const
+    {
+        return Get(key.c_str());
+    }
+
+    bool Has(const c8* key) const
+    {
+        return Get(key).IsValid();
+    }
+
+    /* Element or member count. */
+    s32 Size() const;
+
+    /* Key and value of member idx, in key order. */
+    const c8* KeyAt(u32 idx) const;
+    ParamView ValueAt(u32 idx) const;
+
+    /* Decodes the whole subtree. */
+    void ToParam(Param& param) const;
+    void ToCompactParam(CompactParam& param) const;
+
+private:
+    bool Read(u32 offset, void* value, u32 length) const;
+    u32 Read32(u32 offset) const;
+    u32 Count() const;
+    ParamView Child(u32 offset) const;
+    const c8* StringAt(u32 idx, u32* length) const;
+
+private:
+    const u8* data = nullptr;
+    u32 size = 0;
+    u32 node = 0;
+};
+
+template<> bool ParamView::Get<bool>() const;
+template<> s32 ParamView::Get<s32>() const;
+template<> f32 ParamView::Get<f32>() const;
+template<> f64 ParamView::Get<f64>() const;
+template<> Vector2 ParamView::Get<Vector2>() const;
+template<> Vector3 ParamView::Get<Vector3>() const;
+template<> Vector4 ParamView::Get<Vector4>() const;
+template<> Matrix4 ParamView::Get<Matrix4>() const;
+template<> Quaternion ParamView::Get<Quaternion>() const;
+template<> Color ParamView::Get<Color>() const;
+template<> String ParamView::Get<String>() const;
+
+/*
+ * An encoded tree, either a file mapped read only or a blob in memory that the caller keeps alive.
+ * Open only checks the header, nodes are checked when they are read, so opening costs the same
+ * whatever the size of the tree.
+ */
+class ParamFile {
+public:
+    ParamFile() = default;
+    ~ParamFile();
+
+    CG_DELETE_COPY_AND_MOVE_CONSTRUCTOR(ParamFile)
+
+    bool Open(const String& path);
+    bool Open(const void* blob, size_t length);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return data != nullptr;
+    }
+
+    ParamView Root() const;
+
+private:
+    bool CheckHeader(const u8* blob, size_t length);
+
+private:
+    void* mapping = nullptr;
+    size_t mappingLength = 0;
+    const u8* data = nullptr;
+    u32 size = 0;
+    u32 root = 0;
+};
+
+}  // namespace CGKit
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Process wide interned keys of parameter objects.
+ */
+
+#ifndef PARAM_KEY_H
+#define PARAM_KEY_H
+
+#include "Core/Types.h"
+
+namespace CGKit {
+
+/*
+ * One distinct object key. Each key string is stored once for the whole process however many objects
+ * use it, objects keep a pointer to it together with its hash. Keys are never released, they come from
+ * the small vocabulary of material and uniform names the app keeps using for its whole life.
+ */
+struct ParamKey {
+    const String* name;
+    u32 hash;
+
+    static u32 Hash(const String& key);
+
+    /* Returns the ParamKey of key, adding it on first use. Thread safe. */
+    static const ParamKey* Intern(const String& key);
+};
+
+}  // namespace CGKit
+
+#endif
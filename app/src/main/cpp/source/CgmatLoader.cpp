@@ -0,0 +1,1088 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Streaming .cgmat parser and its binary material cache.
+ */
+
+#define CGKIT_LOG
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "nlohmann/json.hpp"
+#include "Log/Log.h"
+#include "Material/CgmatLoader.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+constexpr u64 FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr u64 FNV_PRIME = 1099511628211ull;
+
+template<typename T>
+struct EnumName {
+    const c8* name;
+    T value;
+};
+
+const EnumName<SamplerFilter> SAMPLER_FILTERS[] = {
+    {"SAMPLER_FILTER_NEAREST", SAMPLER_FILTER_NEAREST},
+    {"SAMPLER_FILTER_BILINEAR", SAMPLER_FILTER_BILINEAR},
+    {"SAMPLER_FILTER_TRILINEAR", SAMPLER_FILTER_TRILINEAR},
+};
+
+const EnumName<SamplerMipmapMode> SAMPLER_MIPMAP_MODES[] = {
+    {"SAMPLER_MIPMAP_NEAREST", SAMPLER_MIPMAP_NEAREST},
+    {"SAMPLER_MIPMAP_BILINEAR", SAMPLER_MIPMAP_BILINEAR},
+};
+
+const EnumName<SamplerAddress> SAMPLER_ADDRESSES[] = {
+    {"SAMPLER_ADDRESS_WRAP", SAMPLER_ADDRESS_WRAP},
+    {"SAMPLER_ADDRESS_MIRROR", SAMPLER_ADDRESS_MIRROR},
+    {"SAMPLER_ADDRESS_CLAMP", SAMPLER_ADDRESS_CLAMP},
+    {"SAMPLER_ADDRESS_BORDER", SAMPLER_ADDRESS_BORDER},
+    {"SAMPLER_ADDRESS_MIRROR_ONCE", SAMPLER_ADDRESS_MIRROR_ONCE},
+};
+
+const EnumName<CompareOperation> COMPARE_OPERATIONS[] = {
+    {"COMPARISON_OPERATION_NEVER", COMPARISON_OPERATION_NEVER},
+    {"COMPARISON_OPERATION_LESS", COMPARISON_OPERATION_LESS},
+    {"COMPARISON_OPERATION_EQUAL", COMPARISON_OPERATION_EQUAL},
+    {"COMPARISON_OPERATION_LESS_OR_EQUAL", COMPARISON_OPERATION_LESS_OR_EQUAL},
+    {"COMPARISON_OPERATION_GREATER", COMPARISON_OPERATION_GREATER},
+    {"COMPARISON_OPERATION_NOT_EQUAL", COMPARISON_OPERATION_NOT_EQUAL},
+    {"COMPARISON_OPERATION_GREATER_OR_EQUAL", COMPARISON_OPERATION_GREATER_OR_EQUAL},
+    {"COMPARISON_OPERATION_ALWAYS", COMPARISON_OPERATION_ALWAYS},
+};
+
+const EnumName<FillMode> FILL_MODES[] = {
+    {"FILL_MODE_FILL", FILL_MODE_FILL},
+    {"FILL_MODE_LINE", FILL_MODE_LINE},
+    {"FILL_MODE_POINT", FILL_MODE_POINT},
+};
+
+const EnumName<CullMode> CULL_MODES[] = {
+    {"CULL_MODE_NONE", CULL_MODE_NONE},
+    {"CULL_MODE_FRONT", CULL_MODE_FRONT},
+    {"CULL_MODE_BACK", CULL_MODE_BACK},
+    {"CULL_MODE_FRONT_AND_BACK", CULL_MODE_FRONT_AND_BACK},
+};
+
+const EnumName<FrontFace> FRONT_FACES[] = {
+    {"FRONT_FACE_COUNTER_CLOCKWISE", FRONT_FACE_COUNTER_CLOCKWISE},
+    {"FRONT_FACE_CLOCKWISE", FRONT_FACE_CLOCKWISE},
+};
+
+const EnumName<StencilOperation> STENCIL_OPERATIONS[] = {
+    {"STENCIL_OPERATION_KEEP", STENCIL_OPERATION_KEEP},
+    {"STENCIL_OPERATION_ZERO", STENCIL_OPERATION_ZERO},
+    {"STENCIL_OPERATION_REPLACE", STENCIL_OPERATION_REPLACE},
+    {"STENCIL_OPERATION_INCREMENT_AND_CLAMP", STENCIL_OPERATION_INCREMENT_AND_CLAMP},
+    {"STENCIL_OPERATION_DECREMENT_AND_CLAMP", STENCIL_OPERATION_DECREMENT_AND_CLAMP},
+    {"STENCIL_OPERATION_INVERT", STENCIL_OPERATION_INVERT},
+    {"STENCIL_OPERATION_INCREMENT_AND_WRAP", STENCIL_OPERATION_INCREMENT_AND_WRAP},
+    {"STENCIL_OPERATION_DECREMENT_AND_WRAP", STENCIL_OPERATION_DECREMENT_AND_WRAP},
+};
+
+const EnumName<BlendFactor> BLEND_FACTORS[] = {
+    {"BLEND_ZERO", BLEND_ZERO},
+    {"BLEND_ONE", BLEND_ONE},
+    {"BLEND_SRC_COLOR", BLEND_SRC_COLOR},
+    {"BLEND_ONE_MINUS_SRC_COLOR", BLEND_ONE_MINUS_SRC_COLOR},
+    {"BLEND_DST_COLOR", BLEND_DST_COLOR},
+    {"BLEND_ONE_MINUS_DST_COLOR", BLEND_ONE_MINUS_DST_COLOR},
+    {"BLEND_SRC_ALPHA", BLEND_SRC_ALPHA},
+    {"BLEND_ONE_MINUS_SRC_ALPHA", BLEND_ONE_MINUS_SRC_ALPHA},
+    {"BLEND_DST_ALPHA", BLEND_DST_ALPHA},
+    {"BLEND_ONE_MINUS_DST_ALPHA", BLEND_ONE_MINUS_DST_ALPHA},
+    {"BLEND_CONSTANT_COLOR", BLEND_CONSTANT_COLOR},
+    {"BLEND_ONE_MINUS_CONSTANT_COLOR", BLEND_ONE_MINUS_CONSTANT_COLOR},
+    {"BLEND_CONSTANT_ALPHA", BLEND_CONSTANT_ALPHA},
+    {"BLEND_ONE_MINUS_CONSTANT_ALPHA", BLEND_ONE_MINUS_CONSTANT_ALPHA},
+};
+
+const EnumName<BlendOperation> BLEND_OPERATIONS[] = {
+    {"BLEND_OPERATION_ADD", BLEND_OPERATION_ADD},
+    {"BLEND_OPERATION_SUBTRACT", BLEND_OPERATION_SUBTRACT},
+    {"BLEND_OPERATION_REV_SUBTRACT", BLEND_OPERATION_REV_SUBTRACT},
+    {"BLEND_OPERATION_MIN", BLEND_OPERATION_MIN},
+    {"BLEND_OPERATION_MAX", BLEND_OPERATION_MAX},
+};
+
+const EnumName<LogicOp> LOGIC_OPS[] = {
+    {"LOGIC_OP_CLEAR", LOGIC_OP_CLEAR},
+    {"LOGIC_OP_AND", LOGIC_OP_AND},
+    {"LOGIC_OP_AND_REVERSE", LOGIC_OP_AND_REVERSE},
+    {"LOGIC_OP_COPY", LOGIC_OP_COPY},
+};
+
+const EnumName<ShaderStageType> SHADER_STAGES[] = {
+    {"SHADER_STAGE_TYPE_VERTEX", SHADER_STAGE_TYPE_VERTEX},
+    {"SHADER_STAGE_TYPE_TESSELLATION_CONTROL", SHADER_STAGE_TYPE_TESSELLATION_CONTROL},
+    {"SHADER_STAGE_TYPE_TESSELLATION_EVALUATION", SHADER_STAGE_TYPE_TESSELLATION_EVALUATION},
+    {"SHADER_STAGE_TYPE_GEOMETRY", SHADER_STAGE_TYPE_GEOMETRY},
+    {"SHADER_STAGE_TYPE_FRAGMENT", SHADER_STAGE_TYPE_FRAGMENT},
+    {"SHADER_STAGE_TYPE_COMPUTE", SHADER_STAGE_TYPE_COMPUTE},
+};
+
+// A scalar json value as handed over by the SAX callbacks.
+struct Scalar {
+    enum Kind {
+        NUMBER,
+        BOOLEAN,
+        STRING,
+        NONE
+    };
+    Kind kind;
+    f64 number;
+    bool flag;
+    String* text;
+};
+
+bool Assign(const Scalar& value, f32& field)
+{
+    field = static_cast<f32>(value.number);
+    return value.kind == Scalar::NUMBER;
+}
+
+bool Assign(const Scalar& value, s32& field)
+{
+    field = static_cast<s32>(value.number);
+    return value.kind == Scalar::NUMBER;
+}
+
+bool Assign(const Scalar& value, u32& field)
+{
+    field = static_cast<u32>(value.number);
+    return value.kind == Scalar::NUMBER && value.number >= 0;
+}
+
+bool Assign(const Scalar& value, bool& field)
+{
+    field = value.flag;
+    return value.kind == Scalar::BOOLEAN;
+}
+
+bool Assign(const Scalar& value, String& field)
+{
+    if (value.kind != Scalar::STRING) {
+        return false;
+    }
+    field = std::move(*value.text);
+    return true;
+}
+
+template<typename T, size_t N>
+bool Assign(const Scalar& value, const EnumName<T> (&names)[N], T& field)
+{
+    if (value.kind != Scalar::STRING) {
+        return false;
+    }
+    for (const EnumName<T>& name : names) {
+        if (*value.text == name.name) {
+            field = name.value;
+            return true;
+        }
+    }
+    LOGERROR("Unknown material value %s", value.text->c_str());
+    return false;
+}
+
+/*
+ * SAX handler for nlohmann::json::sax_parse. scopes holds one entry per open object or array, the
+ * entry says which part of the material it fills; currentKey is the last key read in the innermost object.
+ */
+class CgmatHandler {
+public:
+    explicit CgmatHandler(MaterialDesc& material) : material(material)
+    {
+        scopes.reserve(MAX_DEPTH);
+    }
+
+    bool null()
+    {
+        return Value(Scalar {Scalar::NONE, 0.0, false, nullptr});
+    }
+
+    bool boolean(bool val)
+    {
+        return Value(Scalar {Scalar::BOOLEAN, 0.0, val, nullptr});
+    }
+
+    bool number_integer(s64 val)
+    {
+        return Value(Scalar {Scalar::NUMBER, static_cast<f64>(val), false, nullptr});
+    }
+
+    bool number_unsigned(u64 val)
+    {
+        return Value(Scalar {Scalar::NUMBER, static_cast<f64>(val), false, nullptr});
+    }
+
+    bool number_float(f64 val, const String&)
+    {
+        return Value(Scalar {Scalar::NUMBER, val, false, nullptr});
+    }
+
+    bool string(String& val)
+    {
+        return Value(Scalar {Scalar::STRING, 0.0, false, &val});
+    }
+
+    bool key(String& val)
+    {
+        currentKey.swap(val);
+        return true;
+    }
+
+    bool start_object(size_t)
+    {
+        return Open(false);
+    }
+
+    bool end_object()
+    {
+        // a pass is complete, its states go to the table and only their ids stay in the material
+        bool ok = (scopes.back() != PASS) || RenderStateTable::Intern(passState, Pass().states);
+        scopes.pop_back();
+        return ok;
+    }
+
+    bool start_array(size_t)
+    {
+        return Open(true);
+    }
+
+    bool end_array()
+    {
+        scopes.pop_back();
+        return true;
+    }
+
+    bool parse_error(size_t position, const String& token, const nlohmann::detail::exception&)
+    {
+        LOGERROR("Material json error at %zu near '%s'", position, token.c_str());
+        return false;
+    }
+
+private:
+    enum Scope {
+        ROOT,
+        PROPERTIES,
+        SAMPLERS,
+        SAMPLER,
+        TEXTURES,
+        TEXTURE,
+        CONSTANTS,
+        CONSTANT,
+        CONSTANT_VALUES,
+        CONSTANT_VALUE,
+        CONSTANT_COMPONENTS,
+        TECHNIQUES,
+        TECHNIQUE,
+        PASSES,
+        PASS,
+        RASTERIZATION,
+        DEPTH_STENCIL,
+        STENCIL_FRONT,
+        STENCIL_BACK,
+        COLOR_BLEND,
+        BLEND_ATTACHMENTS,
+        BLEND_ATTACHMENT,
+        RESOURCE,
+        SHADERS,
+        SHADER,
+        // a subtree the loader does not read
+        SKIP
+    };
+
+    static constexpr size_t MAX_DEPTH = 16;
+
+    struct Child {
+        Scope parent;
+        const c8* key;
+        bool array;
+        Scope scope;
+    };
+
+    // Objects and arrays found under a key. Elements of SAMPLERS and the other arrays are handled in Open.
+    static constexpr Child CHILDREN[] = {
+        {ROOT, "properties", false, PROPERTIES},
+        {ROOT, "techniques", true, TECHNIQUES},
+        {PROPERTIES, "sampler", true, SAMPLERS},
+        {PROPERTIES, "texture", true, TEXTURES},
+        {PROPERTIES, "constant", true, CONSTANTS},
+        {CONSTANT, "value", true, CONSTANT_VALUES},
+        {CONSTANT_VALUE, "value", true, CONSTANT_COMPONENTS},
+        {TECHNIQUE, "passes", true, PASSES},
+        {PASS, "rasterizationState", false, RASTERIZATION},
+        {PASS, "depthStencilState", false, DEPTH_STENCIL},
+        {PASS, "colorBlendState", false, COLOR_BLEND},
+        {PASS, "resource", false, RESOURCE},
+        {DEPTH_STENCIL, "front", false, STENCIL_FRONT},
+        {DEPTH_STENCIL, "back", false, STENCIL_BACK},
+        {COLOR_BLEND, "blendAttachmentState", true, BLEND_ATTACHMENTS},
+        {RESOURCE, "shader", true, SHADERS},
+    };
+
+    bool Open(bool array)
+    {
+        if (scopes.size() >= MAX_DEPTH) {
+            LOGERROR("Material nested deeper than %zu", MAX_DEPTH);
+            return false;
+        }
+        if (scopes.empty()) {
+            scopes.push_back(array ? SKIP : ROOT);
+            return !array;
+        }
+        Scope parent = scopes.back();
+        Scope scope = SKIP;
+        switch (parent) {
+            case SAMPLERS:
+                scope = Element(array, SAMPLER, material.samplers);
+                break;
+            case TEXTURES:
+                scope = Element(array, TEXTURE, material.textures);
+                break;
+            case CONSTANTS:
+                scope = Element(array, CONSTANT, material.constants);
+                break;
+            case CONSTANT_VALUES:
+                scope = Element(array, CONSTANT_VALUE, material.constants.back().values);
+                break;
+            case TECHNIQUES:
+                scope = Element(array, TECHNIQUE, material.techniques);
+                break;
+            case PASSES:
+                scope = Element(array, PASS, material.techniques.back().passes);
+                break;
+            case BLEND_ATTACHMENTS:
+                scope = Element(array, BLEND_ATTACHMENT, passState.colorBlendState.attachments);
+                break;
+            case SHADERS:
+                scope = Element(array, SHADER, Pass().shaders);
+                break;
+            case SKIP:
+            case CONSTANT_COMPONENTS:
+                break;
+            default:
+                for (const Child& child : CHILDREN) {
+                    if (child.parent == parent && currentKey == child.key) {
+                        if (child.array != array) {
+                            LOGERROR("Material key %s has the wrong kind", currentKey.c_str());
+                            return false;
+                        }
+                        scope = child.scope;
+                        break;
+                    }
+                }
+                break;
+        }
+        if (scope == PASS) {
+            passState = PipelineCreateInfo();
+        } else if (scope == CONSTANT_COMPONENTS) {
+            material.constants.back().values.back().value.clear();
+        } else if (scope == BLEND_ATTACHMENTS) {
+            // the array replaces the default attachment of ColorBlendState
+            passState.colorBlendState.attachments.clear();
+        }
+        scopes.push_back(scope);
+        return true;
+    }
+
+    // Starts a new element of an array of objects, arrays nested in such an array are skipped.
+    template<typename T>
+    static Scope Element(bool array, Scope scope, vector<T>& items)
+    {
+        if (array) {
+            return SKIP;
+        }
+        items.emplace_back();
+        return scope;
+    }
+
+    MaterialPass& Pass()
+    {
+        return material.techniques.back().passes.back();
+    }
+
+    bool Value(const Scalar& value)
+    {
+        if (scopes.empty()) {
+            return false;
+        }
+        switch (scopes.back()) {
+            case ROOT:
+                return (currentKey == "version") ? Assign(value, material.version) : true;
+            case SAMPLER:
+                return SamplerField(value, material.samplers.back());
+            case TEXTURE:
+                return TextureField(value, material.textures.back());
+            case CONSTANT:
+                return NamedField(value, material.constants.back());
+            case CONSTANT_VALUE:
+                return NamedField(value, material.constants.back().values.back());
+            case CONSTANT_COMPONENTS: {
+                f32 component = 0.0f;
+                bool ok = Assign(value, component);
+                material.constants.back().values.back().value.push_back(component);
+                return ok;
+            }
+            case TECHNIQUE:
+                return NamedField(value, material.techniques.back());
+            case PASS:
+                return PassField(value, Pass());
+            case RASTERIZATION:
+                return RasterizationField(value, Pass());
+            case DEPTH_STENCIL:
+                return DepthStencilField(value, passState);
+            case STENCIL_FRONT:
+                return StencilField(value, passState.depthStencilState.front);
+            case STENCIL_BACK:
+                return StencilField(value, passState.depthStencilState.back);
+            case COLOR_BLEND:
+                return ColorBlendField(value, passState.colorBlendState);
+            case BLEND_ATTACHMENT:
+                return BlendAttachmentField(value, passState.colorBlendState.attachments.back());
+            case SHADER:
+                return ShaderField(value, Pass().shaders.back());
+            case SKIP:
+            case PROPERTIES:
+            case RESOURCE:
+                return true;
+            default:
+                LOGERROR("Unexpected material value in array");
+                return false;
+        }
+    }
+
+    bool SamplerField(const Scalar& value, MaterialSampler& sampler)
+    {
+        if (currentKey == "filterMin") {
+            return Assign(value, SAMPLER_FILTERS, sampler.createInfo.filterMin);
+        } else if (currentKey == "filterMag") {
+            return Assign(value, SAMPLER_FILTERS, sampler.createInfo.filterMag);
+        } else if (currentKey == "filterMipmap") {
+            return Assign(value, SAMPLER_MIPMAP_MODES, sampler.createInfo.filterMipmap);
+        } else if (currentKey == "addressModeU") {
+            return Assign(value, SAMPLER_ADDRESSES, sampler.createInfo.addressMode);
+        } else if (currentKey == "addressModeV") {
+            return Assign(value, SAMPLER_ADDRESSES, sampler.addressModeV);
+        } else if (currentKey == "addressModeW") {
+            return Assign(value, SAMPLER_ADDRESSES, sampler.addressModeW);
+        } else if (currentKey == "comparisonFunc") {
+            return Assign(value, COMPARE_OPERATIONS, sampler.createInfo.comparisonFunc);
+        } else if (currentKey == "anisotropyEnabled") {
+            return Assign(value, sampler.createInfo.anisotropyEnabled);
+        } else if (currentKey == "comparisonEnabled") {
+            return Assign(value, sampler.createInfo.comparisonEnabled);
+        } else if (currentKey == "mipLODBias") {
+            return Assign(value, sampler.mipLODBias);
+        } else if (currentKey == "maxAnisotropy") {
+            return Assign(value, sampler.maxAnisotropy);
+        } else if (currentKey == "minLOD") {
+            return Assign(value, sampler.minLOD);
+        } else if (currentKey == "maxLOD") {
+            return Assign(value, sampler.maxLOD);
+        } else if (currentKey == "borderColor") {
+            return Assign(value, sampler.borderColor);
+        }
+        return true;
+    }
+
+    bool TextureField(const Scalar& value, MaterialTexture& texture)
+    {
+        if (currentKey == "uri") {
+            return Assign(value, texture.uri);
+        } else if (currentKey == "name") {
+            return Assign(value, texture.name);
+        } else if (currentKey == "samplerIndex") {
+            return Assign(value, texture.samplerIndex);
+        }
+        return true;
+    }
+
+    // name and type of constants, constant values and techniques
+    template<typename T>
+    bool NamedField(const Scalar& value, T& named)
+    {
+        if (currentKey == "name") {
+            return Assign(value, named.name);
+        } else if (currentKey == "type") {
+            return Assign(value, named.type);
+        }
+        return true;
+    }
+
+    bool PassField(const Scalar& value, MaterialPass& pass)
+    {
+        return (currentKey == "name") ? Assign(value, pass.name) : true;
+    }
+
+    bool RasterizationField(const Scalar& value, MaterialPass& pass)
+    {
+        RasterizationState& state = passState.rasterizationState;
+        if (currentKey == "cullMode") {
+            return Assign(value, CULL_MODES, state.cullmode);
+        } else if (currentKey == "fillMode") {
+            return Assign(value, FILL_MODES, state.polygonMode);
+        } else if (currentKey == "frontFace") {
+            return Assign(value, FRONT_FACES, state.frontFace);
+        } else if (currentKey == "lineWidth") {
+            return Assign(value, state.lineWidth);
+        } else if (currentKey == "scissorEnable") {
+            return Assign(value, pass.scissorEnable);
+        } else if (currentKey == "pointSize") {
+            return Assign(value, pass.pointSize);
+        }
+        return true;
+    }
+
+    bool DepthStencilField(const Scalar& value, PipelineCreateInfo& pipeline)
+    {
+        DepthStencilState& state = pipeline.depthStencilState;
+        if (currentKey == "depthFunc") {
+            return Assign(value, COMPARE_OPERATIONS, state.depthFunc);
+        } else if (currentKey == "depthTestEnable") {
+            return Assign(value, state.depthTestEnable);
+        } else if (currentKey == "depthWriteEnable") {
+            return Assign(value, state.depthWriteEnable);
+        } else if (currentKey == "stencilTestEnable") {
+            return Assign(value, state.stencilTestEnable);
+        } else if (currentKey == "depthClampEnable") {
+            return Assign(value, pipeline.rasterizationState.depthClampEnable);
+        }
+        return true;
+    }
+
+    bool StencilField(const Scalar& value, DepthStencilOp& op)
+    {
+        if (currentKey == "stencilFail") {
+            return Assign(value, STENCIL_OPERATIONS, op.stencilFail);
+        } else if (currentKey == "stencilDepthFail") {
+            return Assign(value, STENCIL_OPERATIONS, op.stencilDepthFail);
+        } else if (currentKey == "stencilPass") {
+            return Assign(value, STENCIL_OPERATIONS, op.stencilPass);
+        } else if (currentKey == "stencilFunc") {
+            return Assign(value, COMPARE_OPERATIONS, op.stencilFunc);
+        } else if (currentKey == "stencilCompareMask") {
+            return Assign(value, op.stencilCompareMask);
+        } else if (currentKey == "stencilReference") {
+            return Assign(value, op.stencilReference);
+        } else if (currentKey == "stencilReadMask") {
+            return Assign(value, op.stencilReadMask);
+        } else if (currentKey == "stencilWriteMask") {
+            return Assign(value, op.stencilWriteMask);
+        }
+        return true;
+    }
+
+    bool ColorBlendField(const Scalar& value, ColorBlendState& state)
+    {
+        if (currentKey == "logicOpEnable") {
+            return Assign(value, state.logicOpEnable);
+        } else if (currentKey == "logicOp") {
+            return Assign(value, LOGIC_OPS, state.logicOp);
+        }
+        return true;
+    }
+
+    bool BlendAttachmentField(const Scalar& value, BlendAttachmentState& state)
+    {
+        if (currentKey == "blendingEnable") {
+            return Assign(value, state.blendingEnable);
+        } else if (currentKey == "srcColorBlend") {
+            return Assign(value, BLEND_FACTORS, state.srcColorBlend);
+        } else if (currentKey == "dstColorBlend") {
+            return Assign(value, BLEND_FACTORS, state.dstColorBlend);
+        } else if (currentKey == "colorBlendOp") {
+            return Assign(value, BLEND_OPERATIONS, state.colorBlendOp);
+        } else if (currentKey == "srcAlphaBlend") {
+            return Assign(value, BLEND_FACTORS, state.srcAlphaBlend);
+        } else if (currentKey == "dstAlphaBlend") {
+            return Assign(value, BLEND_FACTORS, state.dstAlphaBlend);
+        } else if (currentKey == "alphaBlendOp") {
+            return Assign(value, BLEND_OPERATIONS, state.alphaBlendOp);
+        } else if (currentKey == "renderTargetWriteMask") {
+            return Assign(value, state.colorMask);
+        } else if (currentKey == "blendFactor") {
+            return Assign(value, state.blendFactor);
+        }
+        return true;
+    }
+
+    bool ShaderField(const Scalar& value, MaterialShader& shader)
+    {
+        if (currentKey == "uri") {
+            return Assign(value, shader.uri);
+        } else if (currentKey == "type") {
+            return Assign(value, SHADER_STAGES, shader.type);
+        }
+        return true;
+    }
+
+private:
+    MaterialDesc& material;
+    vector<Scope> scopes;
+    String currentKey;
+    // the render states of the pass being read, interned when the pass ends
+    PipelineCreateInfo passState;
+};
+
+constexpr CgmatHandler::Child CgmatHandler::CHILDREN[];
+
+/*
+ * A cached enum is only taken if it is one the parser can produce, so a damaged cache never puts a value
+ * outside its enum into a material.
+ */
+template<typename T, size_t N>
+bool ToEnum(u32 raw, const EnumName<T> (&names)[N], T& value)
+{
+    for (const EnumName<T>& name : names) {
+        if (static_cast<u32>(name.value) == raw) {
+            value = name.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ToEnum(u32 raw, SamplerFilter& value)
+{
+    return ToEnum(raw, SAMPLER_FILTERS, value);
+}
+
+bool ToEnum(u32 raw, SamplerMipmapMode& value)
+{
+    return ToEnum(raw, SAMPLER_MIPMAP_MODES, value);
+}
+
+bool ToEnum(u32 raw, SamplerAddress& value)
+{
+    return ToEnum(raw, SAMPLER_ADDRESSES, value);
+}
+
+bool ToEnum(u32 raw, CompareOperation& value)
+{
+    return ToEnum(raw, COMPARE_OPERATIONS, value);
+}
+
+bool ToEnum(u32 raw, FillMode& value)
+{
+    return ToEnum(raw, FILL_MODES, value);
+}
+
+bool ToEnum(u32 raw, CullMode& value)
+{
+    return ToEnum(raw, CULL_MODES, value);
+}
+
+bool ToEnum(u32 raw, FrontFace& value)
+{
+    return ToEnum(raw, FRONT_FACES, value);
+}
+
+bool ToEnum(u32 raw, StencilOperation& value)
+{
+    return ToEnum(raw, STENCIL_OPERATIONS, value);
+}
+
+bool ToEnum(u32 raw, BlendFactor& value)
+{
+    return ToEnum(raw, BLEND_FACTORS, value);
+}
+
+bool ToEnum(u32 raw, BlendOperation& value)
+{
+    return ToEnum(raw, BLEND_OPERATIONS, value);
+}
+
+bool ToEnum(u32 raw, LogicOp& value)
+{
+    return ToEnum(raw, LOGIC_OPS, value);
+}
+
+bool ToEnum(u32 raw, ShaderStageType& value)
+{
+    // a shader without a type keeps the default
+    if (raw == static_cast<u32>(SHADER_STAGE_NONE)) {
+        value = SHADER_STAGE_NONE;
+        return true;
+    }
+    return ToEnum(raw, SHADER_STAGES, value);
+}
+
+/*
+ * The cache streams. Both walk MaterialDesc through the same Visit functions below, the writer appends
+ * each field, the reader fills it back, so the two sides cannot drift apart.
+ */
+class CacheWriter {
+public:
+    explicit CacheWriter(vector<u8>& blob) : blob(blob) {}
+
+    template<typename T>
+    typename enable_if<is_arithmetic<T>::value, bool>::type Value(const T& value)
+    {
+        size_t offset = blob.size();
+        blob.resize(offset + sizeof(T));
+        memcpy(blob.data() + offset, &value, sizeof(T));
+        return true;
+    }
+
+    template<typename T>
+    typename enable_if<is_enum<T>::value, bool>::type Value(const T& value)
+    {
+        return Value(static_cast<u32>(value));
+    }
+
+    bool Value(const bool& value)
+    {
+        return Value(static_cast<u8>(value ? 1 : 0));
+    }
+
+    bool Value(const String& value)
+    {
+        Value(static_cast<u32>(value.size()));
+        blob.insert(blob.end(), value.begin(), value.end());
+        return true;
+    }
+
+    template<typename T>
+    bool Array(vector<T>& items);
+
+private:
+    vector<u8>& blob;
+};
+
+class CacheReader {
+public:
+    CacheReader(const u8* data, size_t size) : data(data), size(size) {}
+
+    template<typename T>
+    typename enable_if<is_arithmetic<T>::value, bool>::type Value(T& value)
+    {
+        if (size - offset < sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    template<typename T>
+    typename enable_if<is_enum<T>::value, bool>::type Value(T& value)
+    {
+        u32 raw = 0;
+        return Value(raw) && ToEnum(raw, value);
+    }
+
+    bool Value(bool& value)
+    {
+        u8 raw = 0;
+        if (!Value(raw)) {
+            return false;
+        }
+        value = (raw != 0);
+        return true;
+    }
+
+    bool Value(String& value)
+    {
+        u32 length = 0;
+        if (!Value(length) || size - offset < length) {
+            return false;
+        }
+        value.assign(reinterpret_cast<const c8*>(data + offset), length);
+        offset += length;
+        return true;
+    }
+
+    template<typename T>
+    bool Array(vector<T>& items);
+
+    bool AtEnd() const
+    {
+        return offset == size;
+    }
+
+private:
+    const u8* data;
+    size_t size;
+    size_t offset = 0;
+};
+
+template<typename S>
+bool Visit(S& stream, f32& value)
+{
+    return stream.Value(value);
+}
+
+template<typename S>
+bool Visit(S& stream, MaterialSampler& sampler)
+{
+    SamplerCreateInfo& info = sampler.createInfo;
+    return stream.Value(info.filterMin) && stream.Value(info.filterMag) && stream.Value(info.filterMipmap) &&
+        stream.Value(info.addressMode) && stream.Value(info.comparisonFunc) && stream.Value(info.anisotropyEnabled) &&
+        stream.Value(info.comparisonEnabled) && stream.Value(sampler.addressModeV) &&
+        stream.Value(sampler.addressModeW) && stream.Value(sampler.mipLODBias) && stream.Value(sampler.maxAnisotropy) &&
+        stream.Value(sampler.minLOD) && stream.Value(sampler.maxLOD) && stream.Value(sampler.borderColor);
+}
+
+template<typename S>
+bool Visit(S& stream, MaterialTexture& texture)
+{
+    return stream.Value(texture.uri) && stream.Value(texture.name) && stream.Value(texture.samplerIndex);
+}
+
+template<typename S>
+bool Visit(S& stream, MaterialConstantValue& value)
+{
+    return stream.Value(value.name) && stream.Value(value.type) && stream.Array(value.value);
+}
+
+template<typename S>
+bool Visit(S& stream, MaterialConstant& constant)
+{
+    return stream.Value(constant.name) && stream.Value(constant.type) && stream.Array(constant.values);
+}
+
+template<typename S>
+bool Visit(S& stream, MaterialShader& shader)
+{
+    return stream.Value(shader.uri) && stream.Value(shader.type);
+}
+
+template<typename S>
+bool Visit(S& stream, DepthStencilOp& op)
+{
+    return stream.Value(op.stencilFail) && stream.Value(op.stencilDepthFail) && stream.Value(op.stencilPass) &&
+        stream.Value(op.stencilFunc) && stream.Value(op.stencilCompareMask) && stream.Value(op.stencilReference) &&
+        stream.Value(op.stencilReadMask) && stream.Value(op.stencilWriteMask);
+}
+
+template<typename S>
+bool Visit(S& stream, BlendAttachmentState& state)
+{
+    return stream.Value(state.blendingEnable) && stream.Value(state.srcColorBlend) &&
+        stream.Value(state.dstColorBlend) && stream.Value(state.colorBlendOp) && stream.Value(state.srcAlphaBlend) &&
+        stream.Value(state.dstAlphaBlend) && stream.Value(state.alphaBlendOp) && stream.Value(state.colorMask) &&
+        stream.Value(state.blendFactor);
+}
+
+template<typename S>
+bool Visit(S& stream, RasterizationState& state)
+{
+    return stream.Value(state.depthClampEnable) && stream.Value(state.rasterizerDiscardEnable) &&
+        stream.Value(state.polygonMode) && stream.Value(state.cullmode) && stream.Value(state.frontFace) &&
+        stream.Value(state.depthBiasEnable) && stream.Value(state.depthBiasConstantFactor) &&
+        stream.Value(state.depthBiasClamp) && stream.Value(state.depthBiasSlopeFactor) && stream.Value(state.lineWidth);
+}
+
+template<typename S>
+bool Visit(S& stream, DepthStencilState& state)
+{
+    return stream.Value(state.depthTestEnable) && stream.Value(state.depthWriteEnable) &&
+        stream.Value(state.depthFunc) && stream.Value(state.depthBoundsTestEnable) &&
+        stream.Value(state.stencilTestEnable) && Visit(stream, state.front) && Visit(stream, state.back);
+}
+
+template<typename S>
+bool Visit(S& stream, ColorBlendState& state)
+{
+    return stream.Value(state.logicOpEnable) && stream.Value(state.logicOp) && stream.Array(state.attachments) &&
+        stream.Array(state.blendConstants);
+}
+
+// State ids mean nothing in another process, the cache holds the states and the reader interns them again.
+bool Visit(CacheWriter& stream, RenderStateIds& ids)
+{
+    RasterizationState rasterization = RenderStateTable::Rasterization(ids.rasterization);
+    DepthStencilState depthStencil = RenderStateTable::DepthStencil(ids.depthStencil);
+    ColorBlendState colorBlend = RenderStateTable::ColorBlend(ids.colorBlend);
+    return Visit(stream, rasterization) && Visit(stream, depthStencil) && Visit(stream, colorBlend);
+}
+
+bool Visit(CacheReader& stream, RenderStateIds& ids)
+{
+    PipelineCreateInfo pipeline;
+    return Visit(stream, pipeline.rasterizationState) && Visit(stream, pipeline.depthStencilState) &&
+        Visit(stream, pipeline.colorBlendState) && RenderStateTable::Intern(pipeline, ids);
+}
+
+template<typename S>
+bool Visit(S& stream, MaterialPass& pass)
+{
+    return stream.Value(pass.name) && Visit(stream, pass.states) && stream.Value(pass.scissorEnable) &&
+        stream.Value(pass.pointSize) && stream.Array(pass.shaders);
+}
+
+template<typename S>
+bool Visit(S& stream, MaterialTechnique& technique)
+{
+    return stream.Value(technique.name) && stream.Value(technique.type) && stream.Array(technique.passes);
+}
+
+template<typename S>
+bool Visit(S& stream, MaterialDesc& material)
+{
+    return stream.Value(material.version) && stream.Array(material.samplers) && stream.Array(material.textures) &&
+        stream.Array(material.constants) && stream.Array(material.techniques);
+}
+
+template<typename T>
+bool CacheWriter::Array(vector<T>& items)
+{
+    Value(static_cast<u32>(items.size()));
+    for (T& item : items) {
+        Visit(*this, item);
+    }
+    return true;
+}
+
+template<typename T>
+bool CacheReader::Array(vector<T>& items)
+{
+    u32 count = 0;
+    // every element takes at least one byte, a larger count is corrupt
+    if (!Value(count) || count > size - offset) {
+        return false;
+    }
+    items.resize(count);
+    for (T& item : items) {
+        if (!Visit(*this, item)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReadFile(const String& path, vector<u8>& data)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < 0) {
+        close(fd);
+        return false;
+    }
+    data.resize(static_cast<size_t>(fileStat.st_size));
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = read(fd, data.data() + done, data.size() - done);
+        if (n <= 0) {
+            close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    close(fd);
+    return true;
+}
+
+// Writes next to path and renames, so a reader never sees half a cache.
+bool WriteFileAtomic(const String& path, const vector<u8>& data)
+{
+    String temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) {
+            close(fd);
+            unlink(temporary.c_str());
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    if (close(fd) != 0 || rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+}
+
+constexpr u32 CgmatLoader::CACHE_MAGIC;
+constexpr u32 CgmatLoader::CACHE_VERSION;
+
+bool CgmatLoader::Parse(const c8* text, size_t length, MaterialDesc& material)
+{
+    material = MaterialDesc();
+    CgmatHandler handler(material);
+    return text != nullptr && nlohmann::json::sax_parse(text, text + length, &handler);
+}
+
+u64 CgmatLoader::ContentHash(const u8* data, size_t size)
+{
+    u64 hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+void CgmatLoader::Encode(const MaterialDesc& material, u64 contentHash, vector<u8>& blob)
+{
+    blob.clear();
+    CacheWriter writer(blob);
+    writer.Value(CACHE_MAGIC);
+    writer.Value(CACHE_VERSION);
+    writer.Value(contentHash);
+    // the writer only reads the fields, Visit is shared with the reader
+    Visit(writer, const_cast<MaterialDesc&>(material));
+}
+
+bool CgmatLoader::Decode(const u8* blob, size_t size, u64 contentHash, MaterialDesc& material)
+{
+    CacheReader reader(blob, size);
+    u32 magic = 0;
+    u32 version = 0;
+    u64 hash = 0;
+    if (blob == nullptr || !reader.Value(magic) || !reader.Value(version) || !reader.Value(hash) ||
+        magic != CACHE_MAGIC || version != CACHE_VERSION || hash != contentHash) {
+        return false;
+    }
+    material = MaterialDesc();
+    return Visit(reader, material) && reader.AtEnd();
+}
+
+bool CgmatLoader::Load(const String& path, const String& cacheDir, MaterialDesc& material)
+{
+    vector<u8> text;
+    if (!ReadFile(path, text)) {
+        LOGERROR("Cannot read material %s", path.c_str());
+        return false;
+    }
+    u64 hash = ContentHash(text.data(), text.size());
+    String cachePath;
+    if (!cacheDir.empty()) {
+        c8 name[32];
+        snprintf(name, sizeof(name), "/%016llx.cgmc", static_cast<unsigned long long>(hash));
+        cachePath = cacheDir + name;
+        vector<u8> cache;
+        if (ReadFile(cachePath, cache) && Decode(cache.data(), cache.size(), hash, material)) {
+            return true;
+        }
+    }
+
+    if (!Parse(reinterpret_cast<const c8*>(text.data()), text.size(), material)) {
+        LOGERROR("Cannot parse material %s", path.c_str());
+        return false;
+    }
+    if (!cachePath.empty()) {
+        vector<u8> cache;
+        Encode(material, hash, cache);
+        if (WriteFileAtomic(cachePath, cache)) {
+            LOGINFO("Compiled material %s into %s", path.c_str(), cachePath.c_str());
+        } else {
+            LOGERROR("Cannot write material cache %s", cachePath.c_str());
+        }
+    }
+    return true;
+}
@@ -0,0 +1,657 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Param with variant storage, for large parameter trees such as loaded materials.
+ */
+
+#include "Param/CompactParam.h"
+
+using namespace std;
+using namespace CGKit;
+
+CompactParam::CompactParam(const CompactParam& other) : type(PARAMETER_TYPE_MAX), pointerValue(nullptr)
+{
+    CopyFrom(other);
+}
+
+CompactParam::CompactParam(CompactParam&& other) noexcept : type(PARAMETER_TYPE_MAX), pointerValue(nullptr)
+{
+    MoveFrom(other);
+}
+
+CompactParam& CompactParam::operator=(const CompactParam& other)
+{
+    if (this != &other) {
+        // other may live inside this tree, so copy it before the old value goes away
+        CompactParam copy(other);
+        Reset();
+        MoveFrom(copy);
+    }
+    return *this;
+}
+
+CompactParam& CompactParam::operator=(CompactParam&& other) noexcept
+{
+    if (this != &other) {
+        CompactParam moved(std::move(other));
+        Reset();
+        MoveFrom(moved);
+    }
+    return *this;
+}
+
+CompactParam::~CompactParam()
+{
+    Reset();
+}
+
+CompactParam::CompactParam(const Vector2& val) : type(PARAMETER_TYPE_VECTOR2), vector2Value(val) {}
+
+CompactParam::CompactParam(const Vector3& val) : type(PARAMETER_TYPE_VECTOR3), vector3Value(val) {}
+
+CompactParam::CompactParam(const Vector4& val) : type(PARAMETER_TYPE_VECTOR4), vector4Value(val) {}
+
+CompactParam::CompactParam(const Matrix4& val) : type(PARAMETER_TYPE_MATRIX), matrixValue(new Matrix4(val)) {}
+
+CompactParam::CompactParam(const Quaternion& val) : type(PARAMETER_TYPE_QUATERNION), quaternionValue(val) {}
+
+CompactParam::CompactParam(const Color& val) : type(PARAMETER_TYPE_COLOR), colorValue(val) {}
+
+CompactParam::CompactParam(const String& val) : type(PARAMETER_TYPE_STRING), stringValue(val) {}
+
+CompactParam::CompactParam(const Array& val) : type(PARAMETER_TYPE_ARRAY), arrayValue(val) {}
+
+CompactParam::CompactParam(const Object& val) : type(PARAMETER_TYPE_OBJECT), objectValue(new Object(val)) {}
+
+CompactParam::CompactParam(const Param& param) : type(PARAMETER_TYPE_MAX), pointerValue(nullptr)
+{
+    switch (param.type) {
+        case PARAMETER_TYPE_BOOLEAN:
+            Set<bool>(param.value.booleanValue);
+            break;
+        case PARAMETER_TYPE_INT:
+            Set<s32>(param.value.intValue);
+            break;
+        case PARAMETER_TYPE_FLOAT:
+            Set<f32>(param.value.floatValue);
+            break;
+        case PARAMETER_TYPE_DOUBLE:
+            Set<f64>(param.value.doubleValue);
+            break;
+        case PARAMETER_TYPE_VECTOR2:
+            Set<Vector2>(param.value.vector2Value);
+            break;
+        case PARAMETER_TYPE_VECTOR3:
+            Set<Vector3>(param.value.vector3Value);
+            break;
+        case PARAMETER_TYPE_VECTOR4:
+            Set<Vector4>(param.value.vector4Value);
+            break;
+        case PARAMETER_TYPE_MATRIX:
+            Set<Matrix4>(param.value.matrixValue);
+            break;
+        case PARAMETER_TYPE_QUATERNION:
+            Set<Quaternion>(param.value.quaternionValue);
+            break;
+        case PARAMETER_TYPE_COLOR:
+            Set<Color>(param.value.colorValue);
+            break;
+        case PARAMETER_TYPE_POINTER:
+            Set<void*>(param.value.pointerValue);
+            break;
+        case PARAMETER_TYPE_STRING:
+            new (&stringValue) String(param.stringValue);
+            type = PARAMETER_TYPE_STRING;
+            break;
+        case PARAMETER_TYPE_ARRAY:
+            new (&arrayValue) Array();
+            type = PARAMETER_TYPE_ARRAY;
+            arrayValue.reserve(param.arrayValue.size());
+            for (const Param& element : param.arrayValue) {
+                arrayValue.emplace_back(element);
+            }
+            break;
+        case PARAMETER_TYPE_OBJECT:
+            objectValue = new Object();
+            type = PARAMETER_TYPE_OBJECT;
+            objectValue->Reserve(param.objectValue.size());
+            for (const auto& member : param.objectValue) {
+                (*objectValue)[member.first] = CompactParam(member.second);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void CompactParam::ToParam(Param& param) const
+{
+    param.Clear();
+    param.type = type;
+    switch (type) {
+        case PARAMETER_TYPE_BOOLEAN:
+            param.value.booleanValue = booleanValue;
+            break;
+        case PARAMETER_TYPE_INT:
+            param.value.intValue = intValue;
+            break;
+        case PARAMETER_TYPE_FLOAT:
+            param.value.floatValue = floatValue;
+            break;
+        case PARAMETER_TYPE_DOUBLE:
+            param.value.doubleValue = doubleValue;
+            break;
+        case PARAMETER_TYPE_VECTOR2:
+            param.value.vector2Value = vector2Value;
+            break;
+        case PARAMETER_TYPE_VECTOR3:
+            param.value.vector3Value = vector3Value;
+            break;
+        case PARAMETER_TYPE_VECTOR4:
+            param.value.vector4Value = vector4Value;
+            break;
+        case PARAMETER_TYPE_MATRIX:
+            param.value.matrixValue = *matrixValue;
+            break;
+        case PARAMETER_TYPE_QUATERNION:
+            param.value.quaternionValue = quaternionValue;
+            break;
+        case PARAMETER_TYPE_COLOR:
+            param.value.colorValue = colorValue;
+            break;
+        case PARAMETER_TYPE_POINTER:
+            param.value.pointerValue = pointerValue;
+            break;
+        case PARAMETER_TYPE_STRING:
+            param.stringValue = stringValue;
+            break;
+        case PARAMETER_TYPE_ARRAY:
+            // build the elements in place, Param::Set(idx, ...) would copy the array per element
+            param.arrayValue.resize(arrayValue.size());
+            for (size_t i = 0; i < arrayValue.size(); i++) {
+                arrayValue[i].ToParam(param.arrayValue[i]);
+            }
+            break;
+        case PARAMETER_TYPE_OBJECT:
+            for (const ParamObject::Member& member : *objectValue) {
+                member.value.ToParam(param.objectValue[member.Name()]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+CompactParam CompactParam::FromJson(const nlohmann::json& json)
+{
+    CompactParam param;
+    BuildFromJson(json, param);
+    return param;
+}
+
+void CompactParam::BuildFromJson(const nlohmann::json& json, CompactParam& param)
+{
+    switch (json.type()) {
+        case nlohmann::json::value_t::object:
+            param.Set<Object>(Object());
+            param.objectValue->Reserve(json.size());
+            for (auto it = json.begin(); it != json.end(); ++it) {
+                // build the member where it is stored, the reserve keeps it from moving meanwhile
+                BuildFromJson(it.value(), (*param.objectValue)[it.key()]);
+            }
+            break;
+        case nlohmann::json::value_t::array:
+            param.Set<Array>(Array());
+            param.arrayValue.reserve(json.size());
+            for (const nlohmann::json& element : json) {
+                BuildFromJson(element, param.Emplace());
+            }
+            break;
+        case nlohmann::json::value_t::string:
+            param.Set<String>(json.get_ref<const String&>());
+            break;
+        case nlohmann::json::value_t::boolean:
+            param.Set<bool>(json.get<bool>());
+            break;
+        case nlohmann::json::value_t::number_integer:
+        case nlohmann::json::value_t::number_unsigned:
+            param.Set<s32>(json.get<s32>());
+            break;
+        case nlohmann::json::value_t::number_float:
+            param.Set<f32>(json.get<f32>());
+            break;
+        default:
+            param.Reset();
+            break;
+    }
+}
+
+void CompactParam::Clear()
+{
+    Reset();
+}
+
+void CompactParam::MakeArray()
+{
+    if (!IsArray()) {
+        Reset();
+        new (&arrayValue) Array();
+        type = PARAMETER_TYPE_ARRAY;
+    }
+}
+
+void CompactParam::Reset()
+{
+    switch (type) {
+        case PARAMETER_TYPE_VECTOR2:
+            vector2Value.~Vector2();
+            break;
+        case PARAMETER_TYPE_VECTOR3:
+            vector3Value.~Vector3();
+            break;
+        case PARAMETER_TYPE_VECTOR4:
+            vector4Value.~Vector4();
+            break;
+        case PARAMETER_TYPE_QUATERNION:
+            quaternionValue.~Quaternion();
+            break;
+        case PARAMETER_TYPE_COLOR:
+            colorValue.~Color();
+            break;
+        case PARAMETER_TYPE_MATRIX:
+            delete matrixValue;
+            break;
+        case PARAMETER_TYPE_STRING:
+            stringValue.~String();
+            break;
+        case PARAMETER_TYPE_ARRAY:
+            arrayValue.~Array();
+            break;
+        case PARAMETER_TYPE_OBJECT:
+            delete objectValue;
+            break;
+        default:
+            break;
+    }
+    type = PARAMETER_TYPE_MAX;
+    pointerValue = nullptr;
+}
+
+void CompactParam::CopyFrom(const CompactParam& other)
+{
+    switch (other.type) {
+        case PARAMETER_TYPE_VECTOR2:
+            new (&vector2Value) Vector2(other.vector2Value);
+            break;
+        case PARAMETER_TYPE_VECTOR3:
+            new (&vector3Value) Vector3(other.vector3Value);
+            break;
+        case PARAMETER_TYPE_VECTOR4:
+            new (&vector4Value) Vector4(other.vector4Value);
+            break;
+        case PARAMETER_TYPE_QUATERNION:
+            new (&quaternionValue) Quaternion(other.quaternionValue);
+            break;
+        case PARAMETER_TYPE_COLOR:
+            new (&colorValue) Color(other.colorValue);
+            break;
+        case PARAMETER_TYPE_MATRIX:
+            matrixValue = new Matrix4(*other.matrixValue);
+            break;
+        case PARAMETER_TYPE_STRING:
+            new (&stringValue) String(other.stringValue);
+            break;
+        case PARAMETER_TYPE_ARRAY:
+            new (&arrayValue) Array(other.arrayValue);
+            break;
+        case PARAMETER_TYPE_OBJECT:
+            objectValue = new Object(*other.objectValue);
+            break;
+        case PARAMETER_TYPE_BOOLEAN:
+            booleanValue = other.booleanValue;
+            break;
+        case PARAMETER_TYPE_INT:
+            intValue = other.intValue;
+            break;
+        case PARAMETER_TYPE_FLOAT:
+            floatValue = other.floatValue;
+            break;
+        case PARAMETER_TYPE_DOUBLE:
+            doubleValue = other.doubleValue;
+            break;
+        case PARAMETER_TYPE_POINTER:
+            pointerValue = other.pointerValue;
+            break;
+        default:
+            break;
+    }
+    type = other.type;
+}
+
+void CompactParam::MoveFrom(CompactParam& other)
+{
+    switch (other.type) {
+        case PARAMETER_TYPE_STRING:
+            new (&stringValue) String(std::move(other.stringValue));
+            break;
+        case PARAMETER_TYPE_ARRAY:
+            new (&arrayValue) Array(std::move(other.arrayValue));
+            break;
+        case PARAMETER_TYPE_MATRIX:
+        case PARAMETER_TYPE_OBJECT:
+            // steal the out of line value
+            pointerValue = other.pointerValue;
+            type = other.type;
+            other.type = PARAMETER_TYPE_MAX;
+            other.pointerValue = nullptr;
+            return;
+        default:
+            CopyFrom(other);
+            return;
+    }
+    type = other.type;
+    other.Reset();
+}
+
+const CompactParam& CompactParam::Null()
+{
+    static const CompactParam nullValue;
+    return nullValue;
+}
+
+void CompactParam::Set(u32 idx, const CompactParam& param)
+{
+    // param may live inside this param, copy it before the storage changes
+    Set(idx, CompactParam(param));
+}
+
+void CompactParam::Set(u32 idx, CompactParam&& param)
+{
+    if (!IsArray()) {
+        CompactParam value(std::move(param));
+        Reset();
+        new (&arrayValue) Array();
+        type = PARAMETER_TYPE_ARRAY;
+        arrayValue.resize(static_cast<size_t>(idx) + 1);
+        arrayValue[idx] = std::move(value);
+        return;
+    }
+    if (arrayValue.size() <= idx) {
+        CompactParam value(std::move(param));
+        arrayValue.resize(static_cast<size_t>(idx) + 1);
+        arrayValue[idx] = std::move(value);
+        return;
+    }
+    arrayValue[idx] = std::move(param);
+}
+
+void CompactParam::Set(const String& name, const CompactParam& param)
+{
+    Set(name, CompactParam(param));
+}
+
+void CompactParam::Set(const String& name, CompactParam&& param)
+{
+    // a new member may move the others, param among them
+    CompactParam value(std::move(param));
+    if (!IsObject()) {
+        Reset();
+        objectValue = new Object();
+        type = PARAMETER_TYPE_OBJECT;
+    }
+    (*objectValue)[name] = std::move(value);
+}
+
+void CompactParam::Reserve(u32 count)
+{
+    if (IsObject()) {
+        objectValue->Reserve(count);
+        return;
+    }
+    MakeArray();
+    arrayValue.reserve(count);
+}
+
+CompactParam& CompactParam::PushBack(const CompactParam& param)
+{
+    return PushBack(CompactParam(param));
+}
+
+CompactParam& CompactParam::PushBack(CompactParam&& param)
+{
+    CompactParam value(std::move(param));
+    MakeArray();
+    arrayValue.push_back(std::move(value));
+    return arrayValue.back();
+}
+
+const CompactParam& CompactParam::Get(u32 idx) const
+{
+    ASSERT(IsArray());
+    return (IsArray() && idx < arrayValue.size()) ? arrayValue[idx] : Null();
+}
+
+const CompactParam& CompactParam::Get(const String& key) const
+{
+    ASSERT(IsObject());
+    if (!IsObject()) {
+        return Null();
+    }
+    const CompactParam* value = objectValue->Find(key);
+    return (value != nullptr) ? *value : Null();
+}
+
+bool CompactParam::Has(const String& key) const
+{
+    return IsObject() && objectValue->Find(key) != nullptr;
+}
+
+vector<String> CompactParam::Keys() const
+{
+    vector<String> keys;
+    if (!IsObject()) {
+        return keys;
+    }
+    keys.reserve(objectValue->Size());
+    for (const ParamObject::Member& member : *objectValue) {
+        keys.push_back(member.Name());
+    }
+    return keys;
+}
+
+s32 CompactParam::Size() const
+{
+    if (IsArray()) {
+        return static_cast<s32>(arrayValue.size());
+    }
+    return IsObject() ? static_cast<s32>(objectValue->Size()) : 0;
+}
+
+namespace CGKit {
+template<>
+const Matrix4& CompactParam::Get<Matrix4>() const
+{
+    static const Matrix4 nullValue;
+    return IsMatrix() ? *matrixValue : nullValue;
+}
+
+template<>
+Matrix4& CompactParam::Get<Matrix4>()
+{
+    if (!IsMatrix()) {
+        Set<Matrix4>(Matrix4());
+    }
+    return *matrixValue;
+}
+
+template<>
+void CompactParam::Set<Matrix4>(Matrix4 val)
+{
+    if (IsMatrix()) {
+        *matrixValue = val;
+        return;
+    }
+    Matrix4* matrix = new Matrix4(val);
+    Reset();
+    matrixValue = matrix;
+    type = PARAMETER_TYPE_MATRIX;
+}
+
+template<>
+const String& CompactParam::Get<String>() const
+{
+    static const String nullValue;
+    return IsString() ? stringValue : nullValue;
+}
+
+template<>
+String& CompactParam::Get<String>()
+{
+    if (!IsString()) {
+        Set<String>(String());
+    }
+    return stringValue;
+}
+
+template<>
+void CompactParam::Set<String>(String val)
+{
+    Reset();
+    new (&stringValue) String(std::move(val));
+    type = PARAMETER_TYPE_STRING;
+}
+
+template<>
+const CompactParam::Array& CompactParam::Get<CompactParam::Array>() const
+{
+    static const Array nullValue;
+    return IsArray() ? arrayValue : nullValue;
+}
+
+template<>
+CompactParam::Array& CompactParam::Get<CompactParam::Array>()
+{
+    if (!IsArray()) {
+        Set<Array>(Array());
+    }
+    return arrayValue;
+}
+
+template<>
+void CompactParam::Set<CompactParam::Array>(CompactParam::Array val)
+{
+    // val may be a copy of this param's own elements, it is moved in only after the reset
+    Reset();
+    new (&arrayValue) Array(std::move(val));
+    type = PARAMETER_TYPE_ARRAY;
+}
+
+template<>
+const CompactParam::Object& CompactParam::Get<CompactParam::Object>() const
+{
+    static const Object nullValue;
+    return IsObject() ? *objectValue : nullValue;
+}
+
+template<>
+CompactParam::Object& CompactParam::Get<CompactParam::Object>()
+{
+    if (!IsObject()) {
+        Set<Object>(Object());
+    }
+    return *objectValue;
+}
+
+template<>
+void CompactParam::Set<CompactParam::Object>(CompactParam::Object val)
+{
+    Object* object = new Object(std::move(val));
+    Reset();
+    objectValue = object;
+    type = PARAMETER_TYPE_OBJECT;
+}
+}  // namespace CGKit
+
+void ParamObject::Reserve(size_t count)
+{
+    members.reserve(count);
+    if (count > LINEAR_SCAN_MAX && slots.size() < count * 2) {
+        Rehash(count);
+    }
+}
+
+void ParamObject::Clear()
+{
+    members.clear();
+    slots.clear();
+}
+
+CompactParam* ParamObject::Find(const String& key)
+{
+    u32 member = Lookup(key, ParamKey::Hash(key));
+    return (member != NOT_FOUND) ? &members[member].value : nullptr;
+}
+
+const CompactParam* ParamObject::Find(const String& key) const
+{
+    u32 member = Lookup(key, ParamKey::Hash(key));
+    return (member != NOT_FOUND) ? &members[member].value : nullptr;
+}
+
+CompactParam& ParamObject::operator[](const String& key)
+{
+    u32 member = Lookup(key, ParamKey::Hash(key));
+    if (member != NOT_FOUND) {
+        return members[member].value;
+    }
+    member = static_cast<u32>(members.size());
+    members.push_back(Member {ParamKey::Intern(key), CompactParam()});
+    if (!slots.empty() && slots.size() >= members.size() * 2) {
+        Index(member);
+    } else if (members.size() > LINEAR_SCAN_MAX) {
+        Rehash(members.capacity());
+    }
+    return members.back().value;
+}
+
+u32 ParamObject::Lookup(const String& key, u32 hash) const
+{
+    if (slots.empty()) {
+        for (size_t i = 0; i < members.size(); i++) {
+            if (members[i].key->hash == hash && members[i].Name() == key) {
+                return static_cast<u32>(i);
+            }
+        }
+        return NOT_FOUND;
+    }
+    const size_t mask = slots.size() - 1;
+    for (size_t slot = hash & mask; slots[slot] != 0; slot = (slot + 1) & mask) {
+        const Member& member = members[slots[slot] - 1];
+        if (member.key->hash == hash && member.Name() == key) {
+            return slots[slot] - 1;
+        }
+    }
+    return NOT_FOUND;
+}
+
+void ParamObject::Rehash(size_t count)
+{
+    // smallest power of two that keeps count members at most half the table
+    size_t size = LINEAR_SCAN_MAX * 2;
+    while (size < count * 2) {
+        size *= 2;
+    }
+    slots.assign(size, 0);
+    for (size_t i = 0; i < members.size(); i++) {
+        Index(static_cast<u32>(i));
+    }
+}
+
+void ParamObject::Index(u32 member)
+{
+    const size_t mask = slots.size() - 1;
+    size_t slot = members[member].key->hash & mask;
+    while (slots[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = member + 1;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: NEON kernels of OSRCpuPlugin and ImageQuality.
+ */
+
+#include "OSRPlugin/EnhanceKernels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+using namespace CGKit;
+
+namespace {
+constexpr u32 BLOCK = 16;
+constexpr u32 HALF = 8;
+constexpr s32 BLUR_SHIFT = 8;
+
+// Binomial weights 1-4-6-4-1 of five 16-bit vectors.
+uint16x8_t Weight(uint16x8_t a, uint16x8_t b, uint16x8_t c, uint16x8_t d, uint16x8_t e)
+{
+    uint16x8_t sum = vaddq_u16(vaddq_u16(a, e), vshlq_n_u16(vaddq_u16(b, d), 2));
+    return vmlaq_n_u16(sum, c, 6);
+}
+
+void BlurColumnNEON(const u8* const rows[BLUR_TAPS], u16* columns, u32 count)
+{
+    u32 i = 0;
+    for (; i + HALF <= count; i += HALF) {
+        uint16x8_t sum = Weight(vmovl_u8(vld1_u8(rows[0] + i)), vmovl_u8(vld1_u8(rows[1] + i)),
+            vmovl_u8(vld1_u8(rows[2] + i)), vmovl_u8(vld1_u8(rows[3] + i)), vmovl_u8(vld1_u8(rows[4] + i)));
+        vst1q_u16(columns + i, sum);
+    }
+    const u8* const tail[BLUR_TAPS] = {rows[0] + i, rows[1] + i, rows[2] + i, rows[3] + i, rows[4] + i};
+    EnhanceScalar::BlurColumn(tail, columns + i, count - i);
+}
+
+// Eight samples: blur the column sums horizontally and push src away from the blur by amount.
+uint8x8_t Sharpen(const u8* src, const u16* p, s32 c1, s32 c2, s16 amount)
+{
+    // sums stay below 65536 and the rounding shifts work on the full precision, so this matches scalar
+    uint16x8_t sum = Weight(vld1q_u16(p - c2), vld1q_u16(p - c1), vld1q_u16(p), vld1q_u16(p + c1), vld1q_u16(p + c2));
+    int16x8_t blur = vreinterpretq_s16_u16(vrshrq_n_u16(sum, BLUR_SHIFT));
+    int16x8_t value = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src)));
+    int16x8_t delta = vrshrq_n_s16(vmulq_n_s16(vsubq_s16(value, blur), amount), SHARPEN_SHIFT);
+    return vqmovun_s16(vaddq_s16(value, delta));
+}
+
+void SharpenRowNEON(const u8* src, const u16* columns, u8* dst, u32 count, u32 channels, s32 amount)
+{
+    const s32 c1 = static_cast<s32>(channels);
+    const s32 c2 = static_cast<s32>(channels * BLUR_RADIUS);
+    const s16 factor = static_cast<s16>(amount);
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK) {
+        uint8x8_t lo = Sharpen(src + i, columns + i, c1, c2, factor);
+        uint8x8_t hi = Sharpen(src + i + HALF, columns + i + HALF, c1, c2, factor);
+        vst1q_u8(dst + i, vcombine_u8(lo, hi));
+    }
+    EnhanceScalar::SharpenRow(src + i, columns + i, dst + i, count - i, channels, amount);
+}
+
+// Eight samples of the vertical Lanczos pass, saturated to 8 bits.
+uint8x8_t Resample(const s16* const rows[LANCZOS_TAPS], const s16* weights, u32 i)
+{
+    const s32 shift = LANCZOS_WEIGHT_SHIFT + LANCZOS_FRACTION_SHIFT;
+    int32x4_t lo = vdupq_n_s32(0);
+    int32x4_t hi = vdupq_n_s32(0);
+    for (u32 k = 0; k < LANCZOS_TAPS; k++) {
+        int16x8_t row = vld1q_s16(rows[k] + i);
+        lo = vmlal_n_s16(lo, vget_low_s16(row), weights[k]);
+        hi = vmlal_n_s16(hi, vget_high_s16(row), weights[k]);
+    }
+    int16x8_t narrow = vcombine_s16(vqmovn_s32(vrshrq_n_s32(lo, shift)), vqmovn_s32(vrshrq_n_s32(hi, shift)));
+    return vqmovun_s16(narrow);
+}
+
+void ResampleColumnNEON(const s16* const rows[LANCZOS_TAPS], const s16* weights, u8* dst, u32 count)
+{
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK) {
+        vst1q_u8(dst + i, vcombine_u8(Resample(rows, weights, i), Resample(rows, weights, i + HALF)));
+    }
+    const s16* const tail[LANCZOS_TAPS] = {rows[0] + i, rows[1] + i, rows[2] + i, rows[3] + i, rows[4] + i,
+        rows[5] + i};
+    EnhanceScalar::ResampleColumn(tail, weights, dst + i, count - i);
+}
+
+// A 32-bit lane gains at most four squares of 255 per block, flushing every 4096 blocks keeps it exact.
+constexpr u32 ERROR_FLUSH_BLOCKS = 4096;
+
+u64 SumLanes(uint32x4_t lanes)
+{
+    uint64x2_t wide = vpaddlq_u32(lanes);
+    return vgetq_lane_u64(wide, 0) + vgetq_lane_u64(wide, 1);
+}
+
+u64 SquaredErrorNEON(const u8* a, const u8* b, u32 count)
+{
+    u64 sum = 0;
+    u32 i = 0;
+    while (i + BLOCK <= count) {
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (u32 blocks = 0; blocks < ERROR_FLUSH_BLOCKS && i + BLOCK <= count; blocks++, i += BLOCK) {
+            // |a - b| fits 8 bits and its square 16 bits, so the widening stays unsigned
+            uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+            acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(diff), vget_low_u8(diff)));
+            acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(diff), vget_high_u8(diff)));
+        }
+        sum += SumLanes(acc);
+    }
+    return sum + EnhanceScalar::SquaredError(a + i, b + i, count - i);
+}
+
+void SsimWindowNEON(const u8* a, const u8* b, u32 stride, SsimSums& sums)
+{
+    uint16x8_t sumA = vdupq_n_u16(0);
+    uint16x8_t sumB = sumA;
+    uint32x4_t aa = vdupq_n_u32(0);
+    uint32x4_t bb = aa;
+    uint32x4_t ab = aa;
+    for (u32 y = 0; y < SSIM_WINDOW; y++, a += stride, b += stride) {
+        uint8x8_t va = vld1_u8(a);
+        uint8x8_t vb = vld1_u8(b);
+        sumA = vaddw_u8(sumA, va);
+        sumB = vaddw_u8(sumB, vb);
+        aa = vpadalq_u16(aa, vmull_u8(va, va));
+        bb = vpadalq_u16(bb, vmull_u8(vb, vb));
+        ab = vpadalq_u16(ab, vmull_u8(va, vb));
+    }
+    sums.a = static_cast<u32>(SumLanes(vpaddlq_u16(sumA)));
+    sums.b = static_cast<u32>(SumLanes(vpaddlq_u16(sumB)));
+    sums.aa = static_cast<u32>(SumLanes(aa));
+    sums.bb = static_cast<u32>(SumLanes(bb));
+    sums.ab = static_cast<u32>(SumLanes(ab));
+}
+}
+
+namespace CGKit {
+bool GetNEONEnhanceKernels(EnhanceKernels& kernels)
+{
+    kernels.blurColumn = BlurColumnNEON;
+    kernels.sharpenRow = SharpenRowNEON;
+    kernels.resampleColumn = ResampleColumnNEON;
+    kernels.squaredError = SquaredErrorNEON;
+    kernels.ssimWindow = SsimWindowNEON;
+    return true;
+}
+}  // namespace CGKit
+#else
+namespace CGKit {
+bool GetNEONEnhanceKernels(EnhanceKernels&)
+{
+    return false;
+}
+}  // namespace CGKit
+#endif
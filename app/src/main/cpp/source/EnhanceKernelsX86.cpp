@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: SSE4.1 and AVX2 kernels of OSRCpuPlugin and ImageQuality.
+ */
+
+#include "OSRPlugin/EnhanceKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+using namespace CGKit;
+
+#define SSE4_TARGET __attribute__((target("sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+namespace {
+constexpr u32 BLOCK = 16;
+constexpr s32 BLUR_SHIFT = 8;
+
+// Binomial weights 1-4-6-4-1 of five 16-bit vectors, in shifts and adds.
+SSE4_TARGET __m128i WeightSSE4(__m128i a, __m128i b, __m128i c, __m128i d, __m128i e)
+{
+    __m128i sum = _mm_add_epi16(_mm_add_epi16(a, e), _mm_slli_epi16(_mm_add_epi16(b, d), 2));
+    return _mm_add_epi16(sum, _mm_add_epi16(_mm_slli_epi16(c, 2), _mm_slli_epi16(c, 1)));
+}
+
+AVX2_TARGET __m256i WeightAVX2(__m256i a, __m256i b, __m256i c, __m256i d, __m256i e)
+{
+    __m256i sum = _mm256_add_epi16(_mm256_add_epi16(a, e), _mm256_slli_epi16(_mm256_add_epi16(b, d), 2));
+    return _mm256_add_epi16(sum, _mm256_add_epi16(_mm256_slli_epi16(c, 2), _mm256_slli_epi16(c, 1)));
+}
+
+SSE4_TARGET __m128i LoadWideSSE4(const u8* src)
+{
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+}
+
+SSE4_TARGET __m128i LoadColumnsSSE4(const u16* columns)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns));
+}
+
+SSE4_TARGET void BlurColumnSSE4(const u8* const rows[BLUR_TAPS], u16* columns, u32 count)
+{
+    const u32 half = 8;
+    u32 i = 0;
+    for (; i + half <= count; i += half) {
+        __m128i sum = WeightSSE4(LoadWideSSE4(rows[0] + i), LoadWideSSE4(rows[1] + i), LoadWideSSE4(rows[2] + i),
+            LoadWideSSE4(rows[3] + i), LoadWideSSE4(rows[4] + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(columns + i), sum);
+    }
+    const u8* const tail[BLUR_TAPS] = {rows[0] + i, rows[1] + i, rows[2] + i, rows[3] + i, rows[4] + i};
+    EnhanceScalar::BlurColumn(tail, columns + i, count - i);
+}
+
+// Eight samples: blur the column sums horizontally and push src away from the blur by amount.
+SSE4_TARGET __m128i SharpenSSE4(const u8* src, const u16* p, s32 c1, s32 c2, __m128i amount)
+{
+    const __m128i blurRound = _mm_set1_epi16(1 << (BLUR_SHIFT - 1));
+    const __m128i sharpenRound = _mm_set1_epi16(1 << (SHARPEN_SHIFT - 1));
+    // sums stay below 65536, so the wrapping adds are exact
+    __m128i sum = WeightSSE4(LoadColumnsSSE4(p - c2), LoadColumnsSSE4(p - c1), LoadColumnsSSE4(p),
+        LoadColumnsSSE4(p + c1), LoadColumnsSSE4(p + c2));
+    __m128i blur = _mm_srli_epi16(_mm_add_epi16(sum, blurRound), BLUR_SHIFT);
+    __m128i value = LoadWideSSE4(src);
+    __m128i delta = _mm_mullo_epi16(_mm_sub_epi16(value, blur), amount);
+    delta = _mm_srai_epi16(_mm_add_epi16(delta, sharpenRound), SHARPEN_SHIFT);
+    return _mm_add_epi16(value, delta);
+}
+
+SSE4_TARGET void SharpenRowSSE4(const u8* src, const u16* columns, u8* dst, u32 count, u32 channels, s32 amount)
+{
+    const u32 half = 8;
+    const s32 c1 = static_cast<s32>(channels);
+    const s32 c2 = static_cast<s32>(channels * BLUR_RADIUS);
+    const __m128i factor = _mm_set1_epi16(static_cast<s16>(amount));
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK) {
+        __m128i lo = SharpenSSE4(src + i, columns + i, c1, c2, factor);
+        __m128i hi = SharpenSSE4(src + i + half, columns + i + half, c1, c2, factor);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    EnhanceScalar::SharpenRow(src + i, columns + i, dst + i, count - i, channels, amount);
+}
+
+// Weights a pair of rows with madd, each 32-bit lane gets row0 * w0 + row1 * w1.
+SSE4_TARGET void WeightPairSSE4(const s16* row0, const s16* row1, s16 w0, s16 w1, __m128i& lo, __m128i& hi)
+{
+    const __m128i weights = _mm_set1_epi32(static_cast<s32>(static_cast<u16>(w0)) | (static_cast<s32>(w1) << 16));
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+    lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights));
+    hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights));
+}
+
+// Eight samples of the vertical Lanczos pass, saturated to 16 bits.
+SSE4_TARGET __m128i ResampleSSE4(const s16* const rows[LANCZOS_TAPS], const s16* weights, u32 i)
+{
+    const s32 shift = LANCZOS_WEIGHT_SHIFT + LANCZOS_FRACTION_SHIFT;
+    __m128i lo = _mm_set1_epi32(1 << (shift - 1));
+    __m128i hi = lo;
+    for (u32 k = 0; k < LANCZOS_TAPS; k += 2) {
+        WeightPairSSE4(rows[k] + i, rows[k + 1] + i, weights[k], weights[k + 1], lo, hi);
+    }
+    return _mm_packs_epi32(_mm_srai_epi32(lo, shift), _mm_srai_epi32(hi, shift));
+}
+
+SSE4_TARGET void ResampleColumnSSE4(const s16* const rows[LANCZOS_TAPS], const s16* weights, u8* dst, u32 count)
+{
+    const u32 half = 8;
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK) {
+        __m128i packed = _mm_packus_epi16(ResampleSSE4(rows, weights, i), ResampleSSE4(rows, weights, i + half));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+    const s16* const tail[LANCZOS_TAPS] = {rows[0] + i, rows[1] + i, rows[2] + i, rows[3] + i, rows[4] + i,
+        rows[5] + i};
+    EnhanceScalar::ResampleColumn(tail, weights, dst + i, count - i);
+}
+
+AVX2_TARGET __m256i LoadWideAVX2(const u8* src)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+}
+
+AVX2_TARGET __m256i LoadColumnsAVX2(const u16* columns)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns));
+}
+
+AVX2_TARGET void BlurColumnAVX2(const u8* const rows[BLUR_TAPS], u16* columns, u32 count)
+{
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK) {
+        __m256i sum = WeightAVX2(LoadWideAVX2(rows[0] + i), LoadWideAVX2(rows[1] + i), LoadWideAVX2(rows[2] + i),
+            LoadWideAVX2(rows[3] + i), LoadWideAVX2(rows[4] + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(columns + i), sum);
+    }
+    const u8* const tail[BLUR_TAPS] = {rows[0] + i, rows[1] + i, rows[2] + i, rows[3] + i, rows[4] + i};
+    EnhanceScalar::BlurColumn(tail, columns + i, count - i);
+}
+
+AVX2_TARGET __m256i SharpenAVX2(const u8* src, const u16* p, s32 c1, s32 c2, __m256i amount)
+{
+    const __m256i blurRound = _mm256_set1_epi16(1 << (BLUR_SHIFT - 1));
+    const __m256i sharpenRound = _mm256_set1_epi16(1 << (SHARPEN_SHIFT - 1));
+    __m256i sum = WeightAVX2(LoadColumnsAVX2(p - c2), LoadColumnsAVX2(p - c1), LoadColumnsAVX2(p),
+        LoadColumnsAVX2(p + c1), LoadColumnsAVX2(p + c2));
+    __m256i blur = _mm256_srli_epi16(_mm256_add_epi16(sum, blurRound), BLUR_SHIFT);
+    __m256i value = LoadWideAVX2(src);
+    __m256i delta = _mm256_mullo_epi16(_mm256_sub_epi16(value, blur), amount);
+    delta = _mm256_srai_epi16(_mm256_add_epi16(delta, sharpenRound), SHARPEN_SHIFT);
+    return _mm256_add_epi16(value, delta);
+}
+
+AVX2_TARGET void SharpenRowAVX2(const u8* src, const u16* columns, u8* dst, u32 count, u32 channels, s32 amount)
+{
+    const u32 block = 32;
+    const s32 c1 = static_cast<s32>(channels);
+    const s32 c2 = static_cast<s32>(channels * BLUR_RADIUS);
+    const __m256i factor = _mm256_set1_epi16(static_cast<s16>(amount));
+    u32 i = 0;
+    for (; i + block <= count; i += block) {
+        __m256i lo = SharpenAVX2(src + i, columns + i, c1, c2, factor);
+        __m256i hi = SharpenAVX2(src + i + BLOCK, columns + i + BLOCK, c1, c2, factor);
+        // packus interleaves the 128-bit lanes, put the quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    SharpenRowSSE4(src + i, columns + i, dst + i, count - i, channels, amount);
+}
+
+AVX2_TARGET void WeightPairAVX2(const s16* row0, const s16* row1, s16 w0, s16 w1, __m256i& lo, __m256i& hi)
+{
+    const __m256i weights = _mm256_set1_epi32(static_cast<s32>(static_cast<u16>(w0)) | (static_cast<s32>(w1) << 16));
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1));
+    lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weights));
+    hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weights));
+}
+
+// Sixteen samples, unpack and packs both work per 128-bit lane, so the sample order is kept.
+AVX2_TARGET __m256i ResampleAVX2(const s16* const rows[LANCZOS_TAPS], const s16* weights, u32 i)
+{
+    const s32 shift = LANCZOS_WEIGHT_SHIFT + LANCZOS_FRACTION_SHIFT;
+    __m256i lo = _mm256_set1_epi32(1 << (shift - 1));
+    __m256i hi = lo;
+    for (u32 k = 0; k < LANCZOS_TAPS; k += 2) {
+        WeightPairAVX2(rows[k] + i, rows[k + 1] + i, weights[k], weights[k + 1], lo, hi);
+    }
+    return _mm256_packs_epi32(_mm256_srai_epi32(lo, shift), _mm256_srai_epi32(hi, shift));
+}
+
+AVX2_TARGET void ResampleColumnAVX2(const s16* const rows[LANCZOS_TAPS], const s16* weights, u8* dst, u32 count)
+{
+    const u32 block = 32;
+    u32 i = 0;
+    for (; i + block <= count; i += block) {
+        __m256i packed = _mm256_packus_epi16(ResampleAVX2(rows, weights, i), ResampleAVX2(rows, weights, i + BLOCK));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    const s16* const tail[LANCZOS_TAPS] = {rows[0] + i, rows[1] + i, rows[2] + i, rows[3] + i, rows[4] + i,
+        rows[5] + i};
+    ResampleColumnSSE4(tail, weights, dst + i, count - i);
+}
+
+// A 32-bit lane gains at most four squares of 255 per block, flushing every 4096 blocks keeps it below 2^31.
+constexpr u32 ERROR_FLUSH_BLOCKS = 4096;
+
+SSE4_TARGET u64 SumLanesSSE4(__m128i lanes)
+{
+    alignas(16) u64 wide[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(wide),
+        _mm_add_epi64(_mm_cvtepu32_epi64(lanes), _mm_cvtepu32_epi64(_mm_srli_si128(lanes, 8))));
+    return wide[0] + wide[1];
+}
+
+// Squares of eight differences, summed in pairs into four 32-bit lanes.
+SSE4_TARGET __m128i SquareDiffSSE4(const u8* a, const u8* b)
+{
+    __m128i diff = _mm_sub_epi16(LoadWideSSE4(a), LoadWideSSE4(b));
+    return _mm_madd_epi16(diff, diff);
+}
+
+SSE4_TARGET u64 SquaredErrorSSE4(const u8* a, const u8* b, u32 count)
+{
+    const u32 half = 8;
+    u64 sum = 0;
+    u32 i = 0;
+    while (i + BLOCK <= count) {
+        __m128i acc = _mm_setzero_si128();
+        for (u32 blocks = 0; blocks < ERROR_FLUSH_BLOCKS && i + BLOCK <= count; blocks++, i += BLOCK) {
+            __m128i squares = _mm_add_epi32(SquareDiffSSE4(a + i, b + i), SquareDiffSSE4(a + i + half, b + i + half));
+            acc = _mm_add_epi32(acc, squares);
+        }
+        sum += SumLanesSSE4(acc);
+    }
+    return sum + EnhanceScalar::SquaredError(a + i, b + i, count - i);
+}
+
+/*
+ * Adds up the SSIM window products, the 16-bit sums hold at most 8 * 255 per lane and every madd lane at
+ * most 16 * 255^2, so nothing overflows.
+ */
+SSE4_TARGET void SsimAccumulateSSE4(__m128i va, __m128i vb, __m128i* acc)
+{
+    acc[0] = _mm_add_epi16(acc[0], va);
+    acc[1] = _mm_add_epi16(acc[1], vb);
+    acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(va, va));
+    acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(vb, vb));
+    acc[4] = _mm_add_epi32(acc[4], _mm_madd_epi16(va, vb));
+}
+
+SSE4_TARGET u32 SumLanes32SSE4(__m128i lanes)
+{
+    lanes = _mm_add_epi32(lanes, _mm_srli_si128(lanes, 8));
+    lanes = _mm_add_epi32(lanes, _mm_srli_si128(lanes, 4));
+    return static_cast<u32>(_mm_cvtsi128_si32(lanes));
+}
+
+SSE4_TARGET void SsimSumsSSE4(const __m128i* acc, SsimSums& sums)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    sums.a = SumLanes32SSE4(_mm_madd_epi16(acc[0], ones));
+    sums.b = SumLanes32SSE4(_mm_madd_epi16(acc[1], ones));
+    sums.aa = SumLanes32SSE4(acc[2]);
+    sums.bb = SumLanes32SSE4(acc[3]);
+    sums.ab = SumLanes32SSE4(acc[4]);
+}
+
+SSE4_TARGET void SsimWindowSSE4(const u8* a, const u8* b, u32 stride, SsimSums& sums)
+{
+    __m128i acc[5] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(),
+        _mm_setzero_si128()};
+    for (u32 y = 0; y < SSIM_WINDOW; y++, a += stride, b += stride) {
+        SsimAccumulateSSE4(LoadWideSSE4(a), LoadWideSSE4(b), acc);
+    }
+    SsimSumsSSE4(acc, sums);
+}
+
+AVX2_TARGET __m256i SquareDiffAVX2(const u8* a, const u8* b)
+{
+    __m256i diff = _mm256_sub_epi16(LoadWideAVX2(a), LoadWideAVX2(b));
+    return _mm256_madd_epi16(diff, diff);
+}
+
+AVX2_TARGET u64 SquaredErrorAVX2(const u8* a, const u8* b, u32 count)
+{
+    const u32 block = 32;
+    u64 sum = 0;
+    u32 i = 0;
+    while (i + block <= count) {
+        __m256i acc = _mm256_setzero_si256();
+        for (u32 blocks = 0; blocks < ERROR_FLUSH_BLOCKS && i + block <= count; blocks++, i += block) {
+            __m256i squares =
+                _mm256_add_epi32(SquareDiffAVX2(a + i, b + i), SquareDiffAVX2(a + i + BLOCK, b + i + BLOCK));
+            acc = _mm256_add_epi32(acc, squares);
+        }
+        sum += SumLanesSSE4(_mm256_castsi256_si128(acc)) + SumLanesSSE4(_mm256_extracti128_si256(acc, 1));
+    }
+    return sum + SquaredErrorSSE4(a + i, b + i, count - i);
+}
+}
+
+namespace CGKit {
+bool GetSSE4EnhanceKernels(EnhanceKernels& kernels)
+{
+    if (!__builtin_cpu_supports("sse4.1")) {
+        return false;
+    }
+    kernels.blurColumn = BlurColumnSSE4;
+    kernels.sharpenRow = SharpenRowSSE4;
+    kernels.resampleColumn = ResampleColumnSSE4;
+    kernels.squaredError = SquaredErrorSSE4;
+    kernels.ssimWindow = SsimWindowSSE4;
+    return true;
+}
+
+bool GetAVX2EnhanceKernels(EnhanceKernels& kernels)
+{
+    if (!__builtin_cpu_supports("avx2")) {
+        return false;
+    }
+    kernels.blurColumn = BlurColumnAVX2;
+    kernels.sharpenRow = SharpenRowAVX2;
+    kernels.resampleColumn = ResampleColumnAVX2;
+    kernels.squaredError = SquaredErrorAVX2;
+    // a window row is only eight samples, pairing rows for AVX2 measured slower than SSE4
+    kernels.ssimWindow = SsimWindowSSE4;
+    return true;
+}
+}  // namespace CGKit
+#else
+namespace CGKit {
+bool GetSSE4EnhanceKernels(EnhanceKernels&)
+{
+    return false;
+}
+
+bool GetAVX2EnhanceKernels(EnhanceKernels&)
+{
+    return false;
+}
+}  // namespace CGKit
+#endif
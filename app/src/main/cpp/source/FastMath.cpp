@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Math::Fast over arrays, on the instruction set MatrixBatch uses.
+ */
+
+#include "MathKernels/FastMath.h"
+#include "MathKernels/MatrixBatch.h"
+#include "MathKernels/MatrixKernels.h"
+
+using namespace CGKit;
+
+namespace {
+struct FastMathDispatch {
+    FastMathKernels kernels[MATH_ISA_MAX];
+
+    FastMathDispatch()
+    {
+        for (u32 isa = 0; isa < MATH_ISA_MAX; isa++) {
+            kernels[isa] = {FastMathScalar::ReciprocalSqrt, FastMathScalar::SinCos, FastMathScalar::Atan2,
+                FastMathScalar::Exp2, FastMathScalar::Log2};
+        }
+        GetSSE4FastMathKernels(kernels[MATH_ISA_SSE4]);
+        GetAVX2FastMathKernels(kernels[MATH_ISA_AVX2]);
+        GetNEONFastMathKernels(kernels[MATH_ISA_NEON]);
+    }
+};
+
+// The kernels of the instruction set MatrixBatch picked, so MatrixBatch::SetIsa switches both.
+const FastMathKernels& GetKernels()
+{
+    static FastMathDispatch dispatch;
+    return dispatch.kernels[MatrixBatch::GetIsa()];
+}
+}
+
+namespace CGKit {
+namespace FastMathScalar {
+void ReciprocalSqrt(const f32* x, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++) {
+        out[n] = Math::Fast::ReciprocalSqrt(x[n]);
+    }
+}
+
+void SinCos(const f32* x, f32* sine, f32* cosine, u32 count)
+{
+    for (u32 n = 0; n < count; n++) {
+        f32 s;
+        f32 c;
+        Math::Fast::SinCos(x[n], s, c);
+        if (sine != nullptr) {
+            sine[n] = s;
+        }
+        if (cosine != nullptr) {
+            cosine[n] = c;
+        }
+    }
+}
+
+void Atan2(const f32* y, const f32* x, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++) {
+        out[n] = Math::Fast::Atan2(y[n], x[n]);
+    }
+}
+
+void Exp2(const f32* x, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++) {
+        out[n] = Math::Fast::Exp2(x[n]);
+    }
+}
+
+void Log2(const f32* x, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++) {
+        out[n] = Math::Fast::Log2(x[n]);
+    }
+}
+}  // namespace FastMathScalar
+
+namespace Math {
+namespace Fast {
+void ReciprocalSqrt(const f32* x, f32* out, u32 count)
+{
+    GetKernels().reciprocalSqrt(x, out, count);
+}
+
+void SinCos(const f32* x, f32* sine, f32* cosine, u32 count)
+{
+    GetKernels().sinCos(x, sine, cosine, count);
+}
+
+void Atan2(const f32* y, const f32* x, f32* out, u32 count)
+{
+    GetKernels().atan2(y, x, out, count);
+}
+
+void Exp2(const f32* x, f32* out, u32 count)
+{
+    GetKernels().exp2(x, out, count);
+}
+
+void Log2(const f32* x, f32* out, u32 count)
+{
+    GetKernels().log2(x, out, count);
+}
+}  // namespace Fast
+}  // namespace Math
+}  // namespace CGKit
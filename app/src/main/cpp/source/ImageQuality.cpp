@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Full reference image quality metrics for plugin outputs.
+ */
+
+#define CGKIT_LOG
+#include "OSRPlugin/ImageQuality.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "Log/Log.h"
+#include "OSRPlugin/EnhanceKernels.h"
+#include "OSRPlugin/PixelConverter.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+constexpr u32 RGB_CHANNELS = 3;
+constexpr u32 SSIM_STEP = SSIM_WINDOW / 2;
+constexpr f64 PEAK = 255.0;
+// stabilising constants of Wang et al., (0.01 * peak)^2 and (0.03 * peak)^2
+constexpr f64 SSIM_C1 = (0.01 * PEAK) * (0.01 * PEAK);
+constexpr f64 SSIM_C2 = (0.03 * PEAK) * (0.03 * PEAK);
+
+bool SameSize(const BufferDescriptor& image, const BufferDescriptor& reference)
+{
+    if (image.addr == nullptr || reference.addr == nullptr || image.width <= 0 || image.height <= 0 ||
+        image.width != reference.width || image.height != reference.height) {
+        LOGERROR("Image quality needs two non-empty images of the same size.");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Returns the pixels of buffer in format, converting into storage only when buffer has another format.
+ */
+const u8* PixelsAs(const BufferDescriptor& buffer, PixelFormat format, vector<u8>& storage)
+{
+    if (buffer.format == format) {
+        return static_cast<const u8*>(buffer.addr);
+    }
+    const u32 bpp = PixelConverter::GetBytesPerPixel(format);
+    storage.resize(static_cast<size_t>(buffer.width) * buffer.height * bpp);
+    BufferDescriptor converted = {storage.data(), static_cast<int>(storage.size()), buffer.width, buffer.height,
+        format};
+    if (!PixelConverter::Convert(buffer, converted)) {
+        LOGERROR("Image quality cannot read pixel format %d.", static_cast<int>(buffer.format));
+        return nullptr;
+    }
+    return storage.data();
+}
+}
+
+namespace CGKit {
+namespace EnhanceScalar {
+u64 SquaredError(const u8* a, const u8* b, u32 count)
+{
+    u64 sum = 0;
+    for (u32 i = 0; i < count; i++) {
+        s32 diff = static_cast<s32>(a[i]) - static_cast<s32>(b[i]);
+        sum += static_cast<u64>(diff * diff);
+    }
+    return sum;
+}
+
+void SsimWindow(const u8* a, const u8* b, u32 stride, SsimSums& sums)
+{
+    sums = {0, 0, 0, 0, 0};
+    for (u32 y = 0; y < SSIM_WINDOW; y++, a += stride, b += stride) {
+        for (u32 x = 0; x < SSIM_WINDOW; x++) {
+            u32 va = a[x];
+            u32 vb = b[x];
+            sums.a += va;
+            sums.b += vb;
+            sums.aa += va * va;
+            sums.bb += vb * vb;
+            sums.ab += va * vb;
+        }
+    }
+}
+}  // namespace EnhanceScalar
+}  // namespace CGKit
+
+bool ImageQuality::PSNR(const BufferDescriptor& image, const BufferDescriptor& reference, f64& psnr)
+{
+    if (!SameSize(image, reference)) {
+        return false;
+    }
+    vector<u8> imageStorage;
+    vector<u8> referenceStorage;
+    const u8* a = PixelsAs(image, PIXEL_FORMAT_R8G8B8_UNORM, imageStorage);
+    const u8* b = PixelsAs(reference, PIXEL_FORMAT_R8G8B8_UNORM, referenceStorage);
+    if (a == nullptr || b == nullptr) {
+        return false;
+    }
+    const EnhanceKernels& kernels = GetEnhanceKernels();
+    const u32 rowBytes = static_cast<u32>(image.width) * RGB_CHANNELS;
+    u64 error = 0;
+    for (s32 y = 0; y < image.height; y++, a += rowBytes, b += rowBytes) {
+        error += kernels.squaredError(a, b, rowBytes);
+    }
+    if (error == 0) {
+        psnr = numeric_limits<f64>::infinity();
+        return true;
+    }
+    const f64 mse = static_cast<f64>(error) / (static_cast<f64>(rowBytes) * image.height);
+    psnr = 10.0 * log10(PEAK * PEAK / mse);
+    return true;
+}
+
+bool ImageQuality::SSIM(const BufferDescriptor& image, const BufferDescriptor& reference, f64& ssim)
+{
+    if (!SameSize(image, reference)) {
+        return false;
+    }
+    const u32 width = static_cast<u32>(image.width);
+    const u32 height = static_cast<u32>(image.height);
+    if (width < SSIM_WINDOW || height < SSIM_WINDOW) {
+        LOGERROR("SSIM needs images of at least %u x %u pixels.", SSIM_WINDOW, SSIM_WINDOW);
+        return false;
+    }
+    vector<u8> imageStorage;
+    vector<u8> referenceStorage;
+    const u8* a = PixelsAs(image, PIXEL_FORMAT_R8_UNORM, imageStorage);
+    const u8* b = PixelsAs(reference, PIXEL_FORMAT_R8_UNORM, referenceStorage);
+    if (a == nullptr || b == nullptr) {
+        return false;
+    }
+    const EnhanceKernels& kernels = GetEnhanceKernels();
+    const f64 n = SSIM_WINDOW * SSIM_WINDOW;
+    f64 total = 0.0;
+    u64 windows = 0;
+    SsimSums sums;
+    for (u32 y = 0; y + SSIM_WINDOW <= height; y += SSIM_STEP) {
+        for (u32 x = 0; x + SSIM_WINDOW <= width; x += SSIM_STEP) {
+            size_t offset = static_cast<size_t>(y) * width + x;
+            kernels.ssimWindow(a + offset, b + offset, width, sums);
+            // sample statistics of the window, variances and covariance with the n - 1 correction
+            f64 meanA = sums.a / n;
+            f64 meanB = sums.b / n;
+            f64 varA = (sums.aa - sums.a * meanA) / (n - 1);
+            f64 varB = (sums.bb - sums.b * meanB) / (n - 1);
+            f64 cov = (sums.ab - sums.a * meanB) / (n - 1);
+            total += ((2 * meanA * meanB + SSIM_C1) * (2 * cov + SSIM_C2)) /
+                ((meanA * meanA + meanB * meanB + SSIM_C1) * (varA + varB + SSIM_C2));
+            windows++;
+        }
+    }
+    ssim = total / windows;
+    return true;
+}
@@ -8,6 +8,7 @@
 
 #include <AIFaceMod.h>
 #include "MainApplication/MainApplication.h"
+#include "MathKernels/FastMath.h"
 #include "OSRPlugin/OSRPlugin.h"
 
 using namespace CGKit;
@@ -47,6 +48,9 @@ void MainApplication::Initialize(const void* winHandle, u32 width, u32 height)
 void MainApplication::Uninitialize()
 {
     // Destroy all your allocations and then call the destruction method of CG Kit to uninitialize the system.
+#ifdef CG_ANDROID_PLATFORM
+    CG_SAFE_DELETE(m_osrPlugin);
+#endif
     BaseApplication::Uninitialize();
 }
 
@@ -99,7 +103,10 @@ void MainApplication::Update(float deltaTime)
 {
     // deltaTime indicates the interval between consecutive frames, in seconds.
     m_deltaTime = deltaTime;
-    m_deltaAccumulate += deltaTime;
+    // Both light motions below repeat every 20 pi seconds. Wrapping there keeps them continuous and keeps the
+    // phases inside the |x| <= 8192 domain of Math::Fast however long the app runs.
+    const f32 lightPeriod = 10.0f * Math::TWO_PI;
+    m_deltaAccumulate = fmodf(m_deltaAccumulate + deltaTime, lightPeriod);
 
     // Set the rotation and scale for each frame. The m_objectRotation and m_objectScale variables are dynamically changed in gesture events.
     if (m_modelObject != nullptr) {
@@ -112,9 +119,12 @@ void MainApplication::Update(float deltaTime)
     const f32 moveRatioY = 0.5f;
     const f32 pointLightCircle = 50.f;
     if (m_pointLightObject != nullptr) {
-        m_pointLightObject->SetPosition(Vector3(sin(m_deltaAccumulate * moveRatioX) * pointLightCircle,
-                                                sin(m_deltaAccumulate * moveRatioY) * pointLightCircle + pointLightCircle,
-                                                cos(m_deltaAccumulate * moveRatioX) * pointLightCircle));
+        f32 sineX;
+        f32 cosineX;
+        Math::Fast::SinCos(m_deltaAccumulate * moveRatioX, sineX, cosineX);
+        m_pointLightObject->SetPosition(Vector3(sineX * pointLightCircle,
+                                                Math::Fast::Sin(m_deltaAccumulate * moveRatioY) * pointLightCircle + pointLightCircle,
+                                                cosineX * pointLightCircle));
     }
 
     // Call the default update logic of CG Kit.
@@ -174,7 +184,7 @@ void MainApplication::ProcessInputEvent(const InputEvent* inputEvent)
         m_touchBegin = true;
 #ifdef CG_ANDROID_PLATFORM
         // Two taps happening within the double-tap interval constitute a double-tap action.
-        if (!m_osrPluginExecuted && tapDetected && (GetCurrentTimeMilliSecond() - lastTime < DOUBLE_TAP_INTERVAL_MS)) {
+        if (tapDetected && (GetCurrentTimeMilliSecond() - lastTime < DOUBLE_TAP_INTERVAL_MS)) {
             ExecuteOSRPlugin();
         }
 #endif
@@ -212,10 +222,8 @@ void MainApplication::ProcessInputEvent(const InputEvent* inputEvent)
     } else if (touchEvent->GetAction() == TOUCH_ACTION_UP) {  // Touch action: release
         LOGINFO("Action up.");
         m_touchBegin = false;
-        if (!m_osrPluginExecuted) {
-            tapDetected = true;
-            lastTime = GetCurrentTimeMilliSecond();
-        }
+        tapDetected = true;
+        lastTime = GetCurrentTimeMilliSecond();
     } else if (touchEvent->GetAction() == TOUCH_ACTION_CANCEL) {  // Cancel the touch action.
         LOGINFO("Action cancel.");
         m_touchBegin = false;
@@ -367,9 +375,41 @@ void MainApplication::ExecuteOSRPlugin()
 {
     // Save super-resolution data in the sandbox directory, for example, /storage/emulated/0/Android/data/com.xxx.xxx/files.
     const String localDir = GetProgramDirectory();
-    OSRPlugin plugin;
-    plugin.ExecuteOSR(localDir);
-    m_osrPluginExecuted = true;
+    // The plugin stays loaded until Uninitialize so that later runs skip loading the model.
+    if (m_osrPlugin == nullptr) {
+        m_osrPlugin = CG_NEW_DEFAULT(OSRPlugin);
+        if (m_osrPlugin == nullptr) {
+            LOG_ALLOC_ERROR("Failed to create OSR plugin.");
+            return;
+        }
+    }
+    // Every double-tap enhances again through the loaded plugin, taps during a run are dropped.
+    if (m_osrPlugin->IsEnhancing()) {
+        LOGINFO("OSR is still enhancing the previous frame.");
+        return;
+    }
+    // Enhancing runs on the OSR worker thread, the render loop keeps going meanwhile. Either way the
+    // result lands in output_ie_sync.ppm, where it has always been picked up from.
+    const String outputName = "output_ie_sync.ppm";
+    BufferDescriptor snapshot = OSRPlugin::WrapSnapshot(*this);
+    if (snapshot.addr == nullptr) {
+        if (!m_osrPlugin->ExecuteOSRAsync(localDir, outputName)) {
+            LOGERROR("Enhancing input.ppm failed to start");
+        }
+        return;
+    }
+    // The last rendered frame goes to the plugin straight from memory, skipping input.ppm.
+    bool started = m_osrPlugin->ExecuteOSRFrame(localDir, snapshot,
+        [localDir, outputName](bool success, const BufferDescriptor& outBuffer) {
+            if (!success) {
+                LOGERROR("Enhancing the snapshot failed");
+                return;
+            }
+            OSRPlugin::SaveFrame(outBuffer, localDir, outputName);
+        });
+    if (!started) {
+        LOGERROR("Enhancing the snapshot failed to start");
+    }
 }
 #endif
 
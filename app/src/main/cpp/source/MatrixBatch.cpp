@@ -0,0 +1,793 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Batched Matrix4 operations with SIMD kernels.
+ */
+
+#include "MathKernels/MatrixBatch.h"
+#include <cmath>
+#include <cstring>
+#include "Core/Macro.h"
+#include "MathKernels/BoundingBox.h"
+#include "MathKernels/MatrixKernels.h"
+
+using namespace std;
+using namespace CGKit;
+
+static_assert(sizeof(Matrix4) == MATRIX_FLOATS * sizeof(f32), "Matrix4 must be 16 packed floats");
+static_assert(sizeof(Vector4) == VECTOR4_FLOATS * sizeof(f32), "Vector4 must be 4 packed floats");
+static_assert(sizeof(Vector3) == VECTOR3_FLOATS * sizeof(f32), "Vector3 must be 3 packed floats");
+static_assert(sizeof(Quaternion) == VECTOR4_FLOATS * sizeof(f32), "Quaternion must be 4 packed floats");
+static_assert(sizeof(BoundingBox) == BOX_FLOATS * sizeof(f32), "BoundingBox must be 6 packed floats");
+static_assert(sizeof(PlaneEquation) == PLANE_FLOATS * sizeof(f32), "PlaneEquation must be 4 packed floats");
+
+namespace {
+struct Dispatch {
+    MatrixKernels kernels;
+    MathIsa isa;
+
+    Dispatch()
+    {
+        Select(MATH_ISA_MAX);
+    }
+
+    // MATH_ISA_MAX picks the best available instruction set.
+    bool Select(MathIsa wanted)
+    {
+        MatrixKernels selected = {MatrixScalar::Multiply, MatrixScalar::Transpose, MatrixScalar::Inverse,
+            MatrixScalar::InverseAffine, MatrixScalar::InverseRigid, MatrixScalar::NormalMatrix,
+            MatrixScalar::Transform, MatrixScalar::TransformVector3, MatrixScalar::TransformVector3SoA,
+            MatrixScalar::TransformBox, MatrixScalar::Bounds, MatrixScalar::CullBoxes, MatrixScalar::MakeTransform,
+            MatrixScalar::MakeTransformSoA, MatrixScalar::Nlerp, MatrixScalar::Slerp};
+        MathIsa selectedIsa = MATH_ISA_SCALAR;
+        bool found = (wanted == MATH_ISA_SCALAR);
+        if (wanted == MATH_ISA_MAX) {
+            MatrixKernels candidate = selected;
+            if (GetAVX2MatrixKernels(candidate)) {
+                selectedIsa = MATH_ISA_AVX2;
+            } else if (GetSSE4MatrixKernels(candidate)) {
+                selectedIsa = MATH_ISA_SSE4;
+            } else if (GetNEONMatrixKernels(candidate)) {
+                selectedIsa = MATH_ISA_NEON;
+            }
+            selected = candidate;
+            found = true;
+        } else if (wanted == MATH_ISA_SSE4) {
+            found = GetSSE4MatrixKernels(selected);
+        } else if (wanted == MATH_ISA_AVX2) {
+            found = GetAVX2MatrixKernels(selected);
+        } else if (wanted == MATH_ISA_NEON) {
+            found = GetNEONMatrixKernels(selected);
+        }
+        if (!found) {
+            return false;
+        }
+        kernels = selected;
+        isa = (wanted == MATH_ISA_MAX) ? selectedIsa : wanted;
+        return true;
+    }
+};
+
+Dispatch& GetDispatch()
+{
+    static Dispatch dispatch;
+    return dispatch;
+}
+
+const f32* Floats(const Matrix4* matrices)
+{
+    return reinterpret_cast<const f32*>(matrices);
+}
+
+f32* Floats(Matrix4* matrices)
+{
+    return reinterpret_cast<f32*>(matrices);
+}
+
+#ifndef NDEBUG
+// Exact: MakeTransform writes exact 0 and 1 there and products of such matrices keep them.
+bool IsAffine(const Matrix4& matrix)
+{
+    return matrix.M[0][3] == 0.0f && matrix.M[1][3] == 0.0f && matrix.M[2][3] == 0.0f && matrix.M[3][3] == 1.0f;
+}
+
+bool IsOrthonormal(const Matrix4& matrix)
+{
+    const f32 tolerance = 1e-3f;
+    for (u32 i = 0; i < VECTOR3_FLOATS; i++) {
+        for (u32 j = 0; j < VECTOR3_FLOATS; j++) {
+            f32 dot = matrix.M[i][0] * matrix.M[j][0] + matrix.M[i][1] * matrix.M[j][1] + matrix.M[i][2] * matrix.M[j][2];
+            if (fabs(dot - ((i == j) ? 1.0f : 0.0f)) > tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+#endif
+
+const f32* Floats(const Vector3* vectors)
+{
+    return reinterpret_cast<const f32*>(vectors);
+}
+
+f32* Floats(Vector3* vectors)
+{
+    return reinterpret_cast<f32*>(vectors);
+}
+
+const f32* Floats(const BoundingBox* boxes)
+{
+    return reinterpret_cast<const f32*>(boxes);
+}
+
+f32* Floats(BoundingBox* boxes)
+{
+    return reinterpret_cast<f32*>(boxes);
+}
+
+// Writes the 3x3 part rows, the translation moved through them as the 4th row, and the 4th column (0, 0, 0, 1).
+void StoreAffine(const f32 rows[VECTOR3_FLOATS][VECTOR3_FLOATS], const f32* translation, f32* out)
+{
+    f32 result[MATRIX_FLOATS] = {};
+    for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            result[row * MATRIX_ROWS + col] = rows[row][col];
+        }
+    }
+    for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+        result[12 + col] = -(translation[0] * rows[0][col] + translation[1] * rows[1][col] +
+            translation[2] * rows[2][col]);
+    }
+    result[15] = 1.0f;
+    memcpy(out, result, sizeof(result));
+}
+
+/*
+ * The columns of the inverse of a 3x3 matrix are the cross products of its rows, a1 x a2, a2 x a0 and
+ * a0 x a1, divided by the determinant a0 . (a1 x a2). Returns false if the determinant is 0.
+ */
+bool Inverse3(const f32* in, f32 inverse[VECTOR3_FLOATS][VECTOR3_FLOATS])
+{
+    const f32* a0 = in;
+    const f32* a1 = in + MATRIX_ROWS;
+    const f32* a2 = in + 2 * MATRIX_ROWS;
+    const f32 cross[VECTOR3_FLOATS][VECTOR3_FLOATS] = {
+        {a1[1] * a2[2] - a1[2] * a2[1], a1[2] * a2[0] - a1[0] * a2[2], a1[0] * a2[1] - a1[1] * a2[0]},
+        {a2[1] * a0[2] - a2[2] * a0[1], a2[2] * a0[0] - a2[0] * a0[2], a2[0] * a0[1] - a2[1] * a0[0]},
+        {a0[1] * a1[2] - a0[2] * a1[1], a0[2] * a1[0] - a0[0] * a1[2], a0[0] * a1[1] - a0[1] * a1[0]},
+    };
+    const f32 det = a0[0] * cross[0][0] + a0[1] * cross[0][1] + a0[2] * cross[0][2];
+    if (det == 0.0f) {
+        return false;
+    }
+    const f32 r = 1.0f / det;
+    for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            inverse[row][col] = cross[col][row] * r;
+        }
+    }
+    return true;
+}
+
+// One MakeTransform matrix, see there.
+void StoreTransform(const f32* position, const f32* scale, const f32* orientation, f32* out)
+{
+    const f32 x = orientation[0];
+    const f32 y = orientation[1];
+    const f32 z = orientation[2];
+    const f32 w = orientation[3];
+    const f32 xx = x * x, yy = y * y, zz = z * z;
+    const f32 xy = x * y, xz = x * z, yz = y * z;
+    const f32 wx = w * x, wy = w * y, wz = w * z;
+    const f32 sx = scale[0], sy = scale[1], sz = scale[2];
+    const f32 result[MATRIX_FLOATS] = {
+        (1.0f - 2.0f * (yy + zz)) * sx, 2.0f * (xy + wz) * sx, 2.0f * (xz - wy) * sx, 0.0f,
+        2.0f * (xy - wz) * sy, (1.0f - 2.0f * (xx + zz)) * sy, 2.0f * (yz + wx) * sy, 0.0f,
+        2.0f * (xz + wy) * sz, 2.0f * (yz - wx) * sz, (1.0f - 2.0f * (xx + yy)) * sz, 0.0f,
+        position[0], position[1], position[2], 1.0f,
+    };
+    memcpy(out, result, sizeof(result));
+}
+}
+
+namespace CGKit {
+namespace MatrixScalar {
+void Multiply(const f32* a, const f32* b, u32 bStride, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, a += MATRIX_FLOATS, b += bStride, out += MATRIX_FLOATS) {
+        f32 result[MATRIX_FLOATS];
+        for (u32 row = 0; row < MATRIX_ROWS; row++) {
+            const f32* left = a + row * MATRIX_ROWS;
+            for (u32 col = 0; col < MATRIX_ROWS; col++) {
+                result[row * MATRIX_ROWS + col] = left[0] * b[col] + left[1] * b[4 + col] +
+                    left[2] * b[8 + col] + left[3] * b[12 + col];
+            }
+        }
+        memcpy(out, result, sizeof(result));
+    }
+}
+
+void Transpose(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        f32 result[MATRIX_FLOATS];
+        for (u32 row = 0; row < MATRIX_ROWS; row++) {
+            for (u32 col = 0; col < MATRIX_ROWS; col++) {
+                result[col * MATRIX_ROWS + row] = in[row * MATRIX_ROWS + col];
+            }
+        }
+        memcpy(out, result, sizeof(result));
+    }
+}
+
+// Cofactors from the 2x2 determinants of the top two rows (s) and the bottom two rows (c).
+void Inverse(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        const f32 a00 = in[0], a01 = in[1], a02 = in[2], a03 = in[3];
+        const f32 a10 = in[4], a11 = in[5], a12 = in[6], a13 = in[7];
+        const f32 a20 = in[8], a21 = in[9], a22 = in[10], a23 = in[11];
+        const f32 a30 = in[12], a31 = in[13], a32 = in[14], a33 = in[15];
+        const f32 s0 = a00 * a11 - a10 * a01;
+        const f32 s1 = a00 * a12 - a10 * a02;
+        const f32 s2 = a00 * a13 - a10 * a03;
+        const f32 s3 = a01 * a12 - a11 * a02;
+        const f32 s4 = a01 * a13 - a11 * a03;
+        const f32 s5 = a02 * a13 - a12 * a03;
+        const f32 c0 = a20 * a31 - a30 * a21;
+        const f32 c1 = a20 * a32 - a30 * a22;
+        const f32 c2 = a20 * a33 - a30 * a23;
+        const f32 c3 = a21 * a32 - a31 * a22;
+        const f32 c4 = a21 * a33 - a31 * a23;
+        const f32 c5 = a22 * a33 - a32 * a23;
+        const f32 det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        if (det == 0.0f) {
+            memset(out, 0, MATRIX_FLOATS * sizeof(f32));
+            continue;
+        }
+        const f32 r = 1.0f / det;
+        const f32 result[MATRIX_FLOATS] = {
+            (a11 * c5 - a12 * c4 + a13 * c3) * r, (-a01 * c5 + a02 * c4 - a03 * c3) * r,
+            (a31 * s5 - a32 * s4 + a33 * s3) * r, (-a21 * s5 + a22 * s4 - a23 * s3) * r,
+            (-a10 * c5 + a12 * c2 - a13 * c1) * r, (a00 * c5 - a02 * c2 + a03 * c1) * r,
+            (-a30 * s5 + a32 * s2 - a33 * s1) * r, (a20 * s5 - a22 * s2 + a23 * s1) * r,
+            (a10 * c4 - a11 * c2 + a13 * c0) * r, (-a00 * c4 + a01 * c2 - a03 * c0) * r,
+            (a30 * s4 - a31 * s2 + a33 * s0) * r, (-a20 * s4 + a21 * s2 - a23 * s0) * r,
+            (-a10 * c3 + a11 * c1 - a12 * c0) * r, (a00 * c3 - a01 * c1 + a02 * c0) * r,
+            (-a30 * s3 + a31 * s1 - a32 * s0) * r, (a20 * s3 - a21 * s1 + a22 * s0) * r,
+        };
+        memcpy(out, result, sizeof(result));
+    }
+}
+
+void InverseAffine(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        f32 rows[VECTOR3_FLOATS][VECTOR3_FLOATS];
+        if (!Inverse3(in, rows)) {
+            memset(out, 0, MATRIX_FLOATS * sizeof(f32));
+            continue;
+        }
+        StoreAffine(rows, in + 12, out);
+    }
+}
+
+void InverseRigid(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        f32 rows[VECTOR3_FLOATS][VECTOR3_FLOATS];
+        for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+            for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+                rows[row][col] = in[col * MATRIX_ROWS + row];
+            }
+        }
+        StoreAffine(rows, in + 12, out);
+    }
+}
+
+void NormalMatrix(const f32* in, f32* out, u32 count)
+{
+    const f32 noTranslation[VECTOR3_FLOATS] = {};
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        f32 inverse[VECTOR3_FLOATS][VECTOR3_FLOATS];
+        if (!Inverse3(in, inverse)) {
+            memset(out, 0, MATRIX_FLOATS * sizeof(f32));
+            continue;
+        }
+        f32 rows[VECTOR3_FLOATS][VECTOR3_FLOATS];
+        for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+            for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+                rows[row][col] = inverse[col][row];
+            }
+        }
+        StoreAffine(rows, noTranslation, out);
+    }
+}
+
+// MakeTransform is v * S * R + p, so the inverse is (v - p) * transpose(R) * inverse(S).
+void InverseTransform(const f32* position, const f32* scale, const f32* orientation, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, position += VECTOR3_FLOATS, scale += VECTOR3_FLOATS,
+        orientation += VECTOR4_FLOATS, out += MATRIX_FLOATS) {
+        const f32 x = orientation[0];
+        const f32 y = orientation[1];
+        const f32 z = orientation[2];
+        const f32 w = orientation[3];
+        const f32 xx = x * x, yy = y * y, zz = z * z;
+        const f32 xy = x * y, xz = x * z, yz = y * z;
+        const f32 wx = w * x, wy = w * y, wz = w * z;
+        const f32 ix = 1.0f / scale[0], iy = 1.0f / scale[1], iz = 1.0f / scale[2];
+        // the rows of the rotation as columns, each scaled by 1 / scale
+        const f32 rows[VECTOR3_FLOATS][VECTOR3_FLOATS] = {
+            {(1.0f - 2.0f * (yy + zz)) * ix, 2.0f * (xy - wz) * iy, 2.0f * (xz + wy) * iz},
+            {2.0f * (xy + wz) * ix, (1.0f - 2.0f * (xx + zz)) * iy, 2.0f * (yz - wx) * iz},
+            {2.0f * (xz - wy) * ix, 2.0f * (yz + wx) * iy, (1.0f - 2.0f * (xx + yy)) * iz},
+        };
+        StoreAffine(rows, position, out);
+    }
+}
+
+void Transform(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += VECTOR4_FLOATS, out += VECTOR4_FLOATS) {
+        f32 result[VECTOR4_FLOATS];
+        for (u32 col = 0; col < VECTOR4_FLOATS; col++) {
+            result[col] = in[0] * matrix[col] + in[1] * matrix[4 + col] + in[2] * matrix[8 + col] +
+                in[3] * matrix[12 + col];
+        }
+        memcpy(out, result, sizeof(result));
+    }
+}
+
+void TransformVector3(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count, f32 w)
+{
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += VECTOR3_FLOATS, out += VECTOR3_FLOATS) {
+        f32 result[VECTOR3_FLOATS];
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            result[col] = in[0] * matrix[col] + in[1] * matrix[4 + col] + in[2] * matrix[8 + col] +
+                w * matrix[12 + col];
+        }
+        memcpy(out, result, sizeof(result));
+    }
+}
+
+void TransformVector3SoA(const f32* matrix, const f32* const in[VECTOR3_FLOATS], f32* const out[VECTOR3_FLOATS],
+    u32 count, f32 w)
+{
+    for (u32 n = 0; n < count; n++) {
+        const f32 x = in[0][n];
+        const f32 y = in[1][n];
+        const f32 z = in[2][n];
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            out[col][n] = x * matrix[col] + y * matrix[4 + col] + z * matrix[8 + col] + w * matrix[12 + col];
+        }
+    }
+}
+
+/*
+ * Arvo's method on the center and half size: the center moves as a point, the half size through the
+ * absolute values of the 3x3 part, which bounds the eight transformed corners exactly.
+ */
+void TransformBox(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += BOX_FLOATS, out += BOX_FLOATS) {
+        f32 center[VECTOR3_FLOATS];
+        f32 extent[VECTOR3_FLOATS];
+        for (u32 i = 0; i < VECTOR3_FLOATS; i++) {
+            center[i] = (in[i] + in[VECTOR3_FLOATS + i]) * 0.5f;
+            extent[i] = (in[VECTOR3_FLOATS + i] - in[i]) * 0.5f;
+        }
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            const f32 c = center[0] * matrix[col] + center[1] * matrix[4 + col] + center[2] * matrix[8 + col] +
+                matrix[12 + col];
+            const f32 e = extent[0] * fabsf(matrix[col]) + extent[1] * fabsf(matrix[4 + col]) +
+                extent[2] * fabsf(matrix[8 + col]);
+            out[col] = c - e;
+            out[VECTOR3_FLOATS + col] = c + e;
+        }
+    }
+}
+
+/*
+ * The compares of Min and Max in PodMath.h, the point replaces the bound unless the bound is beyond it. The
+ * bounds stay in locals, box could alias points for all the compiler knows.
+ */
+void Bounds(const f32* points, u32 count, f32* box)
+{
+    f32 minX = box[0];
+    f32 minY = box[1];
+    f32 minZ = box[2];
+    f32 maxX = box[3];
+    f32 maxY = box[4];
+    f32 maxZ = box[5];
+    for (u32 n = 0; n < count; n++, points += VECTOR3_FLOATS) {
+        const f32 x = points[0];
+        const f32 y = points[1];
+        const f32 z = points[2];
+        minX = minX < x ? minX : x;
+        minY = minY < y ? minY : y;
+        minZ = minZ < z ? minZ : z;
+        maxX = maxX > x ? maxX : x;
+        maxY = maxY > y ? maxY : y;
+        maxZ = maxZ > z ? maxZ : z;
+    }
+    const f32 bounds[BOX_FLOATS] = {minX, minY, minZ, maxX, maxY, maxZ};
+    memcpy(box, bounds, sizeof(bounds));
+}
+
+/*
+ * A box is outside a plane when its center is farther behind it than its extent reaches along the
+ * normal. The results of 32 boxes are packed into each word.
+ */
+void CullBoxes(const f32* planes, u32 planeCount, const f32* const boxes[BOX_FLOATS], u32* visible, u32 count)
+{
+    for (u32 first = 0; first < count; first += MASK_BITS) {
+        const u32 end = (count - first < MASK_BITS) ? count : first + MASK_BITS;
+        u32 bits = 0;
+        for (u32 n = first; n < end; n++) {
+            bool inside = true;
+            for (u32 p = 0; p < planeCount; p++) {
+                const f32* plane = planes + p * PLANE_FLOATS;
+                const f32 distance = boxes[0][n] * plane[0] + boxes[1][n] * plane[1] + boxes[2][n] * plane[2] +
+                    plane[3];
+                const f32 radius = boxes[3][n] * fabsf(plane[0]) + boxes[4][n] * fabsf(plane[1]) +
+                    boxes[5][n] * fabsf(plane[2]);
+                inside = inside && (distance + radius >= 0.0f);
+            }
+            bits |= static_cast<u32>(inside) << (n - first);
+        }
+        visible[first / MASK_BITS] = bits;
+    }
+}
+
+/*
+ * The rotation rows are those of the column-vector rotation matrix of the quaternion transposed, so
+ * v * M turns v the way the quaternion does.
+ */
+void MakeTransform(const f32* position, const f32* scale, const f32* orientation, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, position += VECTOR3_FLOATS, scale += VECTOR3_FLOATS,
+        orientation += VECTOR4_FLOATS, out += MATRIX_FLOATS) {
+        StoreTransform(position, scale, orientation, out);
+    }
+}
+
+void MakeTransformSoA(const f32* const position[VECTOR3_FLOATS], const f32* const scale[VECTOR3_FLOATS],
+    const f32* const orientation[VECTOR4_FLOATS], f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, out += MATRIX_FLOATS) {
+        const f32 p[VECTOR3_FLOATS] = {position[0][n], position[1][n], position[2][n]};
+        const f32 s[VECTOR3_FLOATS] = {scale[0][n], scale[1][n], scale[2][n]};
+        const f32 q[VECTOR4_FLOATS] = {orientation[0][n], orientation[1][n], orientation[2][n], orientation[3][n]};
+        StoreTransform(p, s, q, out);
+    }
+}
+
+// Through the shorter arc: b is negated when the quaternions are more than 90 degrees apart in 4D.
+void Nlerp(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t, u32 tStride,
+    f32* const out[VECTOR4_FLOATS], u32 count)
+{
+    for (u32 n = 0; n < count; n++, t += tStride) {
+        const f32 cosine = a[0][n] * b[0][n] + a[1][n] * b[1][n] + a[2][n] * b[2][n] + a[3][n] * b[3][n];
+        const f32 weightA = 1.0f - *t;
+        const f32 weightB = (cosine < 0.0f) ? -*t : *t;
+        f32 result[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            result[i] = a[i][n] * weightA + b[i][n] * weightB;
+        }
+        const f32 scale = 1.0f / sqrtf(result[0] * result[0] + result[1] * result[1] + result[2] * result[2] +
+            result[3] * result[3]);
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            out[i][n] = result[i] * scale;
+        }
+    }
+}
+
+// The weights of SLERP_U and SLERP_V, within 2e-5 of sin(t * angle) / sin(angle) for unit quaternions.
+void Slerp(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t, u32 tStride,
+    f32* const out[VECTOR4_FLOATS], u32 count)
+{
+    for (u32 n = 0; n < count; n++, t += tStride) {
+        const f32 cosine = a[0][n] * b[0][n] + a[1][n] * b[1][n] + a[2][n] * b[2][n] + a[3][n] * b[3][n];
+        const f32 cosineMinusOne = fabsf(cosine) - 1.0f;
+        const f32 tb = *t;
+        const f32 ta = 1.0f - tb;
+        f32 weightA = 1.0f;
+        f32 weightB = 1.0f;
+        for (u32 i = SLERP_TERMS; i > 0; i--) {
+            weightA = 1.0f + (SLERP_U[i - 1] * (ta * ta) - SLERP_V[i - 1]) * cosineMinusOne * weightA;
+            weightB = 1.0f + (SLERP_U[i - 1] * (tb * tb) - SLERP_V[i - 1]) * cosineMinusOne * weightB;
+        }
+        weightA *= ta;
+        weightB *= (cosine < 0.0f) ? -tb : tb;
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            out[i][n] = a[i][n] * weightA + b[i][n] * weightB;
+        }
+    }
+}
+}  // namespace MatrixScalar
+}  // namespace CGKit
+
+void MatrixBatch::Multiply(const Matrix4* a, const Matrix4* b, Matrix4* out, u32 count)
+{
+    GetDispatch().kernels.multiply(Floats(a), Floats(b), MATRIX_FLOATS, Floats(out), count);
+}
+
+void MatrixBatch::Multiply(const Matrix4* a, const Matrix4& b, Matrix4* out, u32 count)
+{
+    // b is copied, out may be the same matrix
+    f32 right[MATRIX_FLOATS];
+    memcpy(right, b.m, sizeof(right));
+    GetDispatch().kernels.multiply(Floats(a), right, 0, Floats(out), count);
+}
+
+void MatrixBatch::Transpose(const Matrix4* in, Matrix4* out, u32 count)
+{
+    GetDispatch().kernels.transpose(Floats(in), Floats(out), count);
+}
+
+void MatrixBatch::Inverse(const Matrix4* in, Matrix4* out, u32 count)
+{
+    GetDispatch().kernels.inverse(Floats(in), Floats(out), count);
+}
+
+void MatrixBatch::InverseAffine(const Matrix4* in, Matrix4* out, u32 count)
+{
+#ifndef NDEBUG
+    for (u32 n = 0; n < count; n++) {
+        ASSERT_MSG(IsAffine(in[n]), "InverseAffine needs affine matrices");
+    }
+#endif
+    GetDispatch().kernels.inverseAffine(Floats(in), Floats(out), count);
+}
+
+void MatrixBatch::InverseRigid(const Matrix4* in, Matrix4* out, u32 count)
+{
+#ifndef NDEBUG
+    for (u32 n = 0; n < count; n++) {
+        ASSERT_MSG(IsAffine(in[n]) && IsOrthonormal(in[n]), "InverseRigid needs rotation and translation only");
+    }
+#endif
+    GetDispatch().kernels.inverseRigid(Floats(in), Floats(out), count);
+}
+
+void MatrixBatch::InverseTransform(const Vector3* position, const Vector3* scale, const Quaternion* orientation,
+    Matrix4* out, u32 count)
+{
+    MatrixScalar::InverseTransform(Floats(position), Floats(scale), reinterpret_cast<const f32*>(orientation),
+        Floats(out), count);
+}
+
+void MatrixBatch::NormalMatrix(const Matrix4* in, Matrix4* out, u32 count)
+{
+#ifndef NDEBUG
+    for (u32 n = 0; n < count; n++) {
+        ASSERT_MSG(IsAffine(in[n]), "NormalMatrix needs affine matrices");
+    }
+#endif
+    GetDispatch().kernels.normalMatrix(Floats(in), Floats(out), count);
+}
+
+void MatrixBatch::Transform(const Matrix4& matrix, const Vector4* in, Vector4* out, u32 count)
+{
+    GetDispatch().kernels.transform(matrix.m, 0, reinterpret_cast<const f32*>(in), reinterpret_cast<f32*>(out),
+        count);
+}
+
+void MatrixBatch::Transform(const Matrix4* matrices, const Vector4* in, Vector4* out, u32 count)
+{
+    GetDispatch().kernels.transform(Floats(matrices), MATRIX_FLOATS, reinterpret_cast<const f32*>(in),
+        reinterpret_cast<f32*>(out), count);
+}
+
+void MatrixBatch::TransformPoints(const Matrix4& matrix, const Vector3* in, Vector3* out, u32 count)
+{
+    GetDispatch().kernels.transformVector3(matrix.m, 0, Floats(in), Floats(out), count, 1.0f);
+}
+
+void MatrixBatch::TransformPoints(const Matrix4* matrices, const Vector3* in, Vector3* out, u32 count)
+{
+    GetDispatch().kernels.transformVector3(Floats(matrices), MATRIX_FLOATS, Floats(in), Floats(out), count, 1.0f);
+}
+
+void MatrixBatch::TransformPoints(const Matrix4& matrix, const ConstVector3SoA& in, const Vector3SoA& out,
+    u32 count)
+{
+    const f32* const inArrays[VECTOR3_FLOATS] = {in.x, in.y, in.z};
+    f32* const outArrays[VECTOR3_FLOATS] = {out.x, out.y, out.z};
+    GetDispatch().kernels.transformVector3SoA(matrix.m, inArrays, outArrays, count, 1.0f);
+}
+
+void MatrixBatch::TransformDirections(const Matrix4& matrix, const Vector3* in, Vector3* out, u32 count)
+{
+    GetDispatch().kernels.transformVector3(matrix.m, 0, Floats(in), Floats(out), count, 0.0f);
+}
+
+void MatrixBatch::TransformDirections(const Matrix4* matrices, const Vector3* in, Vector3* out, u32 count)
+{
+    GetDispatch().kernels.transformVector3(Floats(matrices), MATRIX_FLOATS, Floats(in), Floats(out), count, 0.0f);
+}
+
+void MatrixBatch::TransformDirections(const Matrix4& matrix, const ConstVector3SoA& in, const Vector3SoA& out,
+    u32 count)
+{
+    const f32* const inArrays[VECTOR3_FLOATS] = {in.x, in.y, in.z};
+    f32* const outArrays[VECTOR3_FLOATS] = {out.x, out.y, out.z};
+    GetDispatch().kernels.transformVector3SoA(matrix.m, inArrays, outArrays, count, 0.0f);
+}
+
+void MatrixBatch::TransformBoxes(const Matrix4& matrix, const BoundingBox* in, BoundingBox* out, u32 count)
+{
+#ifndef NDEBUG
+    for (u32 n = 0; n < count; n++) {
+        ASSERT_MSG(!in[n].IsEmpty(), "TransformBoxes needs boxes that are not empty");
+    }
+#endif
+    GetDispatch().kernels.transformBox(matrix.m, 0, Floats(in), Floats(out), count);
+}
+
+void MatrixBatch::TransformBoxes(const Matrix4* matrices, const BoundingBox* in, BoundingBox* out, u32 count)
+{
+#ifndef NDEBUG
+    for (u32 n = 0; n < count; n++) {
+        ASSERT_MSG(!in[n].IsEmpty(), "TransformBoxes needs boxes that are not empty");
+    }
+#endif
+    GetDispatch().kernels.transformBox(Floats(matrices), MATRIX_FLOATS, Floats(in), Floats(out), count);
+}
+
+void MatrixBatch::AddInternalPoints(const Vector3* points, u32 count, BoundingBox& box)
+{
+    GetDispatch().kernels.bounds(Floats(points), count, Floats(&box));
+}
+
+// The corners of the boxes as points: the minimum and maximum of a box that is not empty are its bounds.
+void MatrixBatch::AddInternalBoxes(const BoundingBox* boxes, u32 count, BoundingBox& box)
+{
+#ifndef NDEBUG
+    for (u32 n = 0; n < count; n++) {
+        ASSERT_MSG(!boxes[n].IsEmpty(), "AddInternalBoxes needs boxes that are not empty");
+    }
+#endif
+    GetDispatch().kernels.bounds(Floats(boxes), 2 * count, Floats(&box));
+}
+
+/*
+ * Clip space x, y and z are v * column j, inside when -w <= x <= w and so on, so each plane is the
+ * 4th column plus or minus another (Gribb and Hartmann).
+ */
+void MatrixBatch::GetFrustumPlanes(const Matrix4& viewProjection, bool zeroToOneDepth,
+    PlaneEquation planes[FRUSTUM_PLANE_MAX])
+{
+    const f32 (*m)[MATRIX_ROWS] = viewProjection.M;
+    const f32 signs[FRUSTUM_PLANE_MAX] = {1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f};
+    for (u32 plane = 0; plane < FRUSTUM_PLANE_MAX; plane++) {
+        const u32 col = plane / 2;
+        // near of 0 to w depth is z >= 0 alone
+        const f32 w = (plane == FRUSTUM_PLANE_NEAR && zeroToOneDepth) ? 0.0f : 1.0f;
+        f32 equation[PLANE_FLOATS];
+        for (u32 row = 0; row < MATRIX_ROWS; row++) {
+            equation[row] = w * m[row][MATRIX_ROWS - 1] + signs[plane] * m[row][col];
+        }
+        const f32 length = sqrtf(equation[0] * equation[0] + equation[1] * equation[1] + equation[2] * equation[2]);
+        const f32 scale = (length > 0.0f) ? 1.0f / length : 0.0f;
+        planes[plane] = PlaneEquation(Float3(equation[0] * scale, equation[1] * scale, equation[2] * scale),
+            equation[3] * scale);
+    }
+}
+
+void MatrixBatch::CullBoxes(const PlaneEquation planes[FRUSTUM_PLANE_MAX], const ConstVector3SoA& centers,
+    const ConstVector3SoA& extents, u32* visible, u32 count)
+{
+    const f32* const boxes[BOX_FLOATS] = {centers.x, centers.y, centers.z, extents.x, extents.y, extents.z};
+    GetDispatch().kernels.cullBoxes(reinterpret_cast<const f32*>(planes), FRUSTUM_PLANE_MAX, boxes, visible, count);
+}
+
+void MatrixBatch::MakeTransform(const Vector3* position, const Vector3* scale, const Quaternion* orientation,
+    Matrix4* out, u32 count)
+{
+    GetDispatch().kernels.makeTransform(reinterpret_cast<const f32*>(position), reinterpret_cast<const f32*>(scale),
+        reinterpret_cast<const f32*>(orientation), Floats(out), count);
+}
+
+void MatrixBatch::MakeTransform(const ConstVector3SoA& position, const ConstVector3SoA& scale,
+    const ConstQuaternionSoA& orientation, Matrix4* out, u32 count)
+{
+    const f32* const positions[VECTOR3_FLOATS] = {position.x, position.y, position.z};
+    const f32* const scales[VECTOR3_FLOATS] = {scale.x, scale.y, scale.z};
+    const f32* const orientations[VECTOR4_FLOATS] = {orientation.x, orientation.y, orientation.z, orientation.w};
+    GetDispatch().kernels.makeTransformSoA(positions, scales, orientations, Floats(out), count);
+}
+
+// Branchless binary search: the halving steps depend only on count.
+u32 MatrixBatch::FindKeyframe(const f32* times, u32 count, f32 time, f32& factor)
+{
+    if (count < 2 || !(time > times[0])) {
+        factor = 0.0f;
+        return 0;
+    }
+    if (time >= times[count - 1]) {
+        factor = 1.0f;
+        return count - 2;
+    }
+    // times[key] < time < times[count - 1]
+    u32 key = 0;
+    u32 size = count - 1;
+    while (size > 1) {
+        const u32 half = size / 2;
+        key = (times[key + half] <= time) ? key + half : key;
+        size -= half;
+    }
+    const f32 span = times[key + 1] - times[key];
+    factor = (span > 0.0f) ? (time - times[key]) / span : 0.0f;
+    return key;
+}
+
+void MatrixBatch::Lerp(const f32* a, const f32* b, f32 t, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++) {
+        out[n] = a[n] + (b[n] - a[n]) * t;
+    }
+}
+
+void MatrixBatch::Nlerp(const ConstQuaternionSoA& a, const ConstQuaternionSoA& b, f32 t, const QuaternionSoA& out,
+    u32 count)
+{
+    const f32* const inA[VECTOR4_FLOATS] = {a.x, a.y, a.z, a.w};
+    const f32* const inB[VECTOR4_FLOATS] = {b.x, b.y, b.z, b.w};
+    f32* const result[VECTOR4_FLOATS] = {out.x, out.y, out.z, out.w};
+    GetDispatch().kernels.nlerp(inA, inB, &t, 0, result, count);
+}
+
+void MatrixBatch::Nlerp(const ConstQuaternionSoA& a, const ConstQuaternionSoA& b, const f32* t,
+    const QuaternionSoA& out, u32 count)
+{
+    const f32* const inA[VECTOR4_FLOATS] = {a.x, a.y, a.z, a.w};
+    const f32* const inB[VECTOR4_FLOATS] = {b.x, b.y, b.z, b.w};
+    f32* const result[VECTOR4_FLOATS] = {out.x, out.y, out.z, out.w};
+    GetDispatch().kernels.nlerp(inA, inB, t, 1, result, count);
+}
+
+void MatrixBatch::Slerp(const ConstQuaternionSoA& a, const ConstQuaternionSoA& b, f32 t, const QuaternionSoA& out,
+    u32 count)
+{
+    const f32* const inA[VECTOR4_FLOATS] = {a.x, a.y, a.z, a.w};
+    const f32* const inB[VECTOR4_FLOATS] = {b.x, b.y, b.z, b.w};
+    f32* const result[VECTOR4_FLOATS] = {out.x, out.y, out.z, out.w};
+    GetDispatch().kernels.slerp(inA, inB, &t, 0, result, count);
+}
+
+void MatrixBatch::Slerp(const ConstQuaternionSoA& a, const ConstQuaternionSoA& b, const f32* t,
+    const QuaternionSoA& out, u32 count)
+{
+    const f32* const inA[VECTOR4_FLOATS] = {a.x, a.y, a.z, a.w};
+    const f32* const inB[VECTOR4_FLOATS] = {b.x, b.y, b.z, b.w};
+    f32* const result[VECTOR4_FLOATS] = {out.x, out.y, out.z, out.w};
+    GetDispatch().kernels.slerp(inA, inB, t, 1, result, count);
+}
+
+MathIsa MatrixBatch::GetIsa()
+{
+    return GetDispatch().isa;
+}
+
+bool MatrixBatch::SetIsa(MathIsa isa)
+{
+    return isa < MATH_ISA_MAX && GetDispatch().Select(isa);
+}
+
+const c8* MatrixBatch::GetIsaName(MathIsa isa)
+{
+    switch (isa) {
+        case MATH_ISA_SCALAR:
+            return "scalar";
+        case MATH_ISA_SSE4:
+            return "sse4";
+        case MATH_ISA_AVX2:
+            return "avx2";
+        case MATH_ISA_NEON:
+            return "neon";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,849 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: NEON kernels of MatrixBatch and Math::Fast.
+ */
+
+#include "MathKernels/MatrixKernels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#include "MathKernels/FastMath.h"
+
+using namespace CGKit;
+
+namespace {
+// elements per SoA step of MakeTransform
+constexpr u32 QUAD = 4;
+
+// row * b, b given by its rows, in the order of the scalar kernel. vmlaq rounds the product, it is not fused.
+inline float32x4_t RowTimes(float32x4_t row, const float32x4_t b[MATRIX_ROWS])
+{
+    const float32x2_t low = vget_low_f32(row);
+    const float32x2_t high = vget_high_f32(row);
+    float32x4_t result = vmulq_lane_f32(b[0], low, 0);
+    result = vmlaq_lane_f32(result, b[1], low, 1);
+    result = vmlaq_lane_f32(result, b[2], high, 0);
+    return vmlaq_lane_f32(result, b[3], high, 1);
+}
+
+inline void LoadRows(const f32* m, float32x4_t rows[MATRIX_ROWS])
+{
+    for (u32 row = 0; row < MATRIX_ROWS; row++) {
+        rows[row] = vld1q_f32(m + row * MATRIX_ROWS);
+    }
+}
+
+void MultiplyNEON(const f32* a, const f32* b, u32 bStride, f32* out, u32 count)
+{
+    if (count == 0) {
+        return;
+    }
+    float32x4_t right[MATRIX_ROWS];
+    LoadRows(b, right);
+    for (u32 n = 0; n < count; n++, a += MATRIX_FLOATS, b += bStride, out += MATRIX_FLOATS) {
+        if (bStride != 0 && n != 0) {
+            LoadRows(b, right);
+        }
+        float32x4_t rows[MATRIX_ROWS];
+        for (u32 row = 0; row < MATRIX_ROWS; row++) {
+            rows[row] = RowTimes(vld1q_f32(a + row * MATRIX_ROWS), right);
+        }
+        for (u32 row = 0; row < MATRIX_ROWS; row++) {
+            vst1q_f32(out + row * MATRIX_ROWS, rows[row]);
+        }
+    }
+}
+
+void TransposeNEON(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        // the de-interleaving load gives the columns
+        const float32x4x4_t columns = vld4q_f32(in);
+        for (u32 col = 0; col < MATRIX_ROWS; col++) {
+            vst1q_f32(out + col * MATRIX_ROWS, columns.val[col]);
+        }
+    }
+}
+
+// Lane moves the compiler folds into one permute where the instruction set has it.
+template<s32 X, s32 Y, s32 Z, s32 W>
+inline float32x4_t Swizzle(float32x4_t v)
+{
+    float32x4_t result = vdupq_n_f32(vgetq_lane_f32(v, X));
+    result = vsetq_lane_f32(vgetq_lane_f32(v, Y), result, 1);
+    result = vsetq_lane_f32(vgetq_lane_f32(v, Z), result, 2);
+    return vsetq_lane_f32(vgetq_lane_f32(v, W), result, 3);
+}
+
+// 2x2 blocks are held row major in one register: (m00, m01, m10, m11). Returns a * b.
+inline float32x4_t Mat2Mul(float32x4_t a, float32x4_t b)
+{
+    return vaddq_f32(vmulq_f32(a, Swizzle<0, 3, 0, 3>(b)), vmulq_f32(vrev64q_f32(a), Swizzle<2, 1, 2, 1>(b)));
+}
+
+// adj(a) * b
+inline float32x4_t Mat2AdjMul(float32x4_t a, float32x4_t b)
+{
+    return vsubq_f32(vmulq_f32(Swizzle<3, 3, 0, 0>(a), b), vmulq_f32(Swizzle<1, 1, 2, 2>(a), vextq_f32(b, b, 2)));
+}
+
+// a * adj(b)
+inline float32x4_t Mat2MulAdj(float32x4_t a, float32x4_t b)
+{
+    return vsubq_f32(vmulq_f32(a, Swizzle<3, 0, 3, 0>(b)), vmulq_f32(vrev64q_f32(a), Swizzle<2, 1, 2, 1>(b)));
+}
+
+inline f32 Sum(float32x4_t v)
+{
+    const float32x2_t pair = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
+}
+
+// The block inverse of InverseSSE4, see there.
+void InverseNEON(const f32* in, f32* out, u32 count)
+{
+    const f32 sign[QUAD] = {1.0f, -1.0f, -1.0f, 1.0f};
+    const float32x4_t adjugateSign = vld1q_f32(sign);
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        const float32x4_t r0 = vld1q_f32(in);
+        const float32x4_t r1 = vld1q_f32(in + 4);
+        const float32x4_t r2 = vld1q_f32(in + 8);
+        const float32x4_t r3 = vld1q_f32(in + 12);
+        const float32x4_t a = vcombine_f32(vget_low_f32(r0), vget_low_f32(r1));
+        const float32x4_t b = vcombine_f32(vget_high_f32(r0), vget_high_f32(r1));
+        const float32x4_t c = vcombine_f32(vget_low_f32(r2), vget_low_f32(r3));
+        const float32x4_t d = vcombine_f32(vget_high_f32(r2), vget_high_f32(r3));
+
+        // (|A|, |B|, |C|, |D|)
+        const float32x4x2_t top = vuzpq_f32(r0, r2);
+        const float32x4x2_t bottom = vuzpq_f32(r1, r3);
+        const float32x4_t dets = vsubq_f32(vmulq_f32(top.val[0], bottom.val[1]), vmulq_f32(top.val[1], bottom.val[0]));
+        const f32 detA = vgetq_lane_f32(dets, 0);
+        const f32 detB = vgetq_lane_f32(dets, 1);
+        const f32 detC = vgetq_lane_f32(dets, 2);
+        const f32 detD = vgetq_lane_f32(dets, 3);
+
+        const float32x4_t dc = Mat2AdjMul(d, c);
+        const float32x4_t ab = Mat2AdjMul(a, b);
+        float32x4_t x = vsubq_f32(vmulq_n_f32(a, detD), Mat2Mul(b, dc));
+        float32x4_t w = vsubq_f32(vmulq_n_f32(d, detA), Mat2Mul(c, ab));
+        float32x4_t y = vsubq_f32(vmulq_n_f32(c, detB), Mat2MulAdj(d, ab));
+        float32x4_t z = vsubq_f32(vmulq_n_f32(b, detC), Mat2MulAdj(a, dc));
+
+        const f32 trace = Sum(vmulq_f32(ab, Swizzle<0, 2, 1, 3>(dc)));
+        const f32 det = (detA * detD + detB * detC) - trace;
+        if (det == 0.0f) {
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+            for (u32 row = 0; row < MATRIX_ROWS; row++) {
+                vst1q_f32(out + row * MATRIX_ROWS, zero);
+            }
+            continue;
+        }
+        const float32x4_t scale = vmulq_n_f32(adjugateSign, 1.0f / det);
+        x = vmulq_f32(x, scale);
+        y = vmulq_f32(y, scale);
+        z = vmulq_f32(z, scale);
+        w = vmulq_f32(w, scale);
+        // adjugate of each block and its place in the result: (x3, x1, y3, y1) and (x2, x0, y2, y0)
+        const float32x4x2_t upper = vuzpq_f32(x, y);
+        const float32x4x2_t lower = vuzpq_f32(z, w);
+        vst1q_f32(out, vrev64q_f32(upper.val[1]));
+        vst1q_f32(out + 4, vrev64q_f32(upper.val[0]));
+        vst1q_f32(out + 8, vrev64q_f32(lower.val[1]));
+        vst1q_f32(out + 12, vrev64q_f32(lower.val[0]));
+    }
+}
+
+inline void Transpose4(float32x4_t r[QUAD])
+{
+    const float32x4x2_t t01 = vtrnq_f32(r[0], r[1]);
+    const float32x4x2_t t23 = vtrnq_f32(r[2], r[3]);
+    r[0] = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r[1] = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r[2] = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r[3] = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+inline float32x4_t Cross(float32x4_t a, float32x4_t b)
+{
+    return vsubq_f32(vmulq_f32(Swizzle<1, 2, 0, 3>(a), Swizzle<2, 0, 1, 3>(b)),
+        vmulq_f32(Swizzle<2, 0, 1, 3>(a), Swizzle<1, 2, 0, 3>(b)));
+}
+
+inline void StoreZero(f32* out)
+{
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    for (u32 row = 0; row < MATRIX_ROWS; row++) {
+        vst1q_f32(out + row * MATRIX_ROWS, zero);
+    }
+}
+
+// Stores the rows of a 3x3 part, w 0, and the translation moved through them as the 4th row, w 1.
+inline void StoreAffineNEON(float32x4_t r0, float32x4_t r1, float32x4_t r2, float32x4_t translation, f32* out)
+{
+    const float32x2_t low = vget_low_f32(translation);
+    float32x4_t moved = vmlaq_lane_f32(vmulq_lane_f32(r0, low, 0), r1, low, 1);
+    moved = vnegq_f32(vmlaq_lane_f32(moved, r2, vget_high_f32(translation), 0));
+    vst1q_f32(out, r0);
+    vst1q_f32(out + 4, r1);
+    vst1q_f32(out + 8, r2);
+    vst1q_f32(out + 12, vsetq_lane_f32(1.0f, moved, 3));
+}
+
+// The 3x3 inverse of MatrixScalar: the columns are the cross products of the rows over the determinant.
+void InverseAffineNEON(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        const float32x4_t r0 = vsetq_lane_f32(0.0f, vld1q_f32(in), 3);
+        const float32x4_t r1 = vld1q_f32(in + 4);
+        const float32x4_t r2 = vld1q_f32(in + 8);
+        float32x4_t c[QUAD] = {Cross(r1, r2), Cross(r2, r0), Cross(r0, r1), vdupq_n_f32(0.0f)};
+        const f32 det = Sum(vmulq_f32(r0, c[0]));
+        if (det == 0.0f) {
+            StoreZero(out);
+            continue;
+        }
+        Transpose4(c);
+        const f32 scale = 1.0f / det;
+        StoreAffineNEON(vmulq_n_f32(c[0], scale), vmulq_n_f32(c[1], scale), vmulq_n_f32(c[2], scale),
+            vld1q_f32(in + 12), out);
+    }
+}
+
+void InverseRigidNEON(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        float32x4_t r[QUAD] = {vld1q_f32(in), vld1q_f32(in + 4), vld1q_f32(in + 8), vdupq_n_f32(0.0f)};
+        Transpose4(r);
+        StoreAffineNEON(r[0], r[1], r[2], vld1q_f32(in + 12), out);
+    }
+}
+
+// The transpose of the 3x3 inverse has the cross products as its rows.
+void NormalMatrixNEON(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        const float32x4_t r0 = vsetq_lane_f32(0.0f, vld1q_f32(in), 3);
+        const float32x4_t r1 = vld1q_f32(in + 4);
+        const float32x4_t r2 = vld1q_f32(in + 8);
+        const float32x4_t c0 = Cross(r1, r2);
+        const f32 det = Sum(vmulq_f32(r0, c0));
+        if (det == 0.0f) {
+            StoreZero(out);
+            continue;
+        }
+        const f32 scale = 1.0f / det;
+        StoreAffineNEON(vmulq_n_f32(c0, scale), vmulq_n_f32(Cross(r2, r0), scale),
+            vmulq_n_f32(Cross(r0, r1), scale), vdupq_n_f32(0.0f), out);
+    }
+}
+
+void TransformNEON(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count)
+{
+    if (count == 0) {
+        return;
+    }
+    float32x4_t rows[MATRIX_ROWS];
+    LoadRows(matrix, rows);
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += VECTOR4_FLOATS, out += VECTOR4_FLOATS) {
+        if (matrixStride != 0 && n != 0) {
+            LoadRows(matrix, rows);
+        }
+        vst1q_f32(out, RowTimes(vld1q_f32(in), rows));
+    }
+}
+
+// The 3x3 part of a matrix and w times its 4th row, for SoA Vector3 transforms.
+struct Matrix3 {
+    f32 m[VECTOR3_FLOATS][VECTOR3_FLOATS];
+    f32 w[VECTOR3_FLOATS];
+
+    Matrix3(const f32* matrix, f32 vectorW)
+    {
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+                m[row][col] = matrix[row * MATRIX_ROWS + col];
+            }
+            w[col] = vectorW * matrix[(MATRIX_ROWS - 1) * MATRIX_ROWS + col];
+        }
+    }
+};
+
+// Component col of four transformed vectors, in the order of the scalar kernel.
+inline float32x4_t Column3(const Matrix3& matrix, u32 col, float32x4_t x, float32x4_t y, float32x4_t z)
+{
+    float32x4_t result = vmlaq_n_f32(vmulq_n_f32(x, matrix.m[0][col]), y, matrix.m[1][col]);
+    result = vmlaq_n_f32(result, z, matrix.m[2][col]);
+    return vaddq_f32(result, vdupq_n_f32(matrix.w[col]));
+}
+
+/*
+ * Shared matrix: four vectors at a time, the de-interleaving load and store do the SoA conversion. A
+ * matrix per vector: one vector at a time, stored as 8 + 4 bytes so the next vector, which out may
+ * alias, is not overwritten before it is read.
+ */
+void TransformVector3NEON(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count, f32 w)
+{
+    if (matrixStride == 0) {
+        const Matrix3 m(matrix, w);
+        u32 n = 0;
+        for (; n + QUAD <= count; n += QUAD, in += QUAD * VECTOR3_FLOATS, out += QUAD * VECTOR3_FLOATS) {
+            const float32x4x3_t v = vld3q_f32(in);
+            float32x4x3_t result;
+            for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+                result.val[col] = Column3(m, col, v.val[0], v.val[1], v.val[2]);
+            }
+            vst3q_f32(out, result);
+        }
+        MatrixScalar::TransformVector3(matrix, 0, in, out, count - n, w);
+        return;
+    }
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += VECTOR3_FLOATS, out += VECTOR3_FLOATS) {
+        float32x4_t rows[MATRIX_ROWS];
+        LoadRows(matrix, rows);
+        float32x4_t result = vmlaq_n_f32(vmulq_n_f32(rows[0], in[0]), rows[1], in[1]);
+        result = vmlaq_n_f32(result, rows[2], in[2]);
+        result = vmlaq_n_f32(result, rows[3], w);
+        vst1_f32(out, vget_low_f32(result));
+        vst1_lane_f32(out + 2, vget_high_f32(result), 0);
+    }
+}
+
+void TransformVector3SoANEON(const f32* matrix, const f32* const in[VECTOR3_FLOATS], f32* const out[VECTOR3_FLOATS],
+    u32 count, f32 w)
+{
+    const Matrix3 m(matrix, w);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const float32x4_t x = vld1q_f32(in[0] + n);
+        const float32x4_t y = vld1q_f32(in[1] + n);
+        const float32x4_t z = vld1q_f32(in[2] + n);
+        float32x4_t result[VECTOR3_FLOATS];
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            result[col] = Column3(m, col, x, y, z);
+        }
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            vst1q_f32(out[col] + n, result[col]);
+        }
+    }
+    const f32* const tailIn[VECTOR3_FLOATS] = {in[0] + n, in[1] + n, in[2] + n};
+    f32* const tailOut[VECTOR3_FLOATS] = {out[0] + n, out[1] + n, out[2] + n};
+    MatrixScalar::TransformVector3SoA(matrix, tailIn, tailOut, count - n, w);
+}
+
+// The rows of the 3x3 part, their absolute values and the translation, for TransformBoxNEON.
+struct BoxMatrix {
+    float32x4_t rows[VECTOR3_FLOATS];
+    float32x4_t absRows[VECTOR3_FLOATS];
+    float32x4_t translation;
+
+    void Load(const f32* matrix)
+    {
+        for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+            rows[row] = vld1q_f32(matrix + row * MATRIX_ROWS);
+            absRows[row] = vabsq_f32(rows[row]);
+        }
+        translation = vld1q_f32(matrix + (MATRIX_ROWS - 1) * MATRIX_ROWS);
+    }
+};
+
+inline void StoreVector3(float32x4_t v, f32* out)
+{
+    vst1_f32(out, vget_low_f32(v));
+    vst1_lane_f32(out + 2, vget_high_f32(v), 0);
+}
+
+// One box at a time like TransformBoxSSE4.
+void TransformBoxNEON(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count)
+{
+    if (count == 0) {
+        return;
+    }
+    BoxMatrix box;
+    box.Load(matrix);
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += BOX_FLOATS, out += BOX_FLOATS) {
+        if (matrixStride != 0 && n != 0) {
+            box.Load(matrix);
+        }
+        const float32x4_t minimum = vld1q_f32(in);
+        const float32x4_t upper = vld1q_f32(in + 2);
+        const float32x4_t maximum = vextq_f32(upper, upper, 1);
+        const float32x4_t center = vmulq_n_f32(vaddq_f32(minimum, maximum), 0.5f);
+        const float32x4_t extent = vmulq_n_f32(vsubq_f32(maximum, minimum), 0.5f);
+        float32x4_t c = vmlaq_lane_f32(vmulq_lane_f32(box.rows[0], vget_low_f32(center), 0), box.rows[1],
+            vget_low_f32(center), 1);
+        c = vaddq_f32(vmlaq_lane_f32(c, box.rows[2], vget_high_f32(center), 0), box.translation);
+        float32x4_t e = vmlaq_lane_f32(vmulq_lane_f32(box.absRows[0], vget_low_f32(extent), 0), box.absRows[1],
+            vget_low_f32(extent), 1);
+        e = vmlaq_lane_f32(e, box.absRows[2], vget_high_f32(extent), 0);
+        StoreVector3(vsubq_f32(c, e), out);
+        StoreVector3(vaddq_f32(c, e), out + VECTOR3_FLOATS);
+    }
+}
+
+// Three vectors of four points at a time like BoundsSSE4.
+void BoundsNEON(const f32* points, u32 count, f32* box)
+{
+    if (count < QUAD) {
+        MatrixScalar::Bounds(points, count, box);
+        return;
+    }
+    float32x4_t minimum[VECTOR3_FLOATS];
+    float32x4_t maximum[VECTOR3_FLOATS];
+    for (u32 v = 0; v < VECTOR3_FLOATS; v++) {
+        minimum[v] = vld1q_f32(points + v * QUAD);
+        maximum[v] = minimum[v];
+    }
+    u32 n = QUAD;
+    for (points += QUAD * VECTOR3_FLOATS; n + QUAD <= count; n += QUAD, points += QUAD * VECTOR3_FLOATS) {
+        for (u32 v = 0; v < VECTOR3_FLOATS; v++) {
+            const float32x4_t p = vld1q_f32(points + v * QUAD);
+            minimum[v] = vminq_f32(minimum[v], p);
+            maximum[v] = vmaxq_f32(maximum[v], p);
+        }
+    }
+    f32 lanes[2 * QUAD * VECTOR3_FLOATS];
+    for (u32 v = 0; v < VECTOR3_FLOATS; v++) {
+        vst1q_f32(lanes + v * QUAD, minimum[v]);
+        vst1q_f32(lanes + (VECTOR3_FLOATS + v) * QUAD, maximum[v]);
+    }
+    MatrixScalar::Bounds(lanes, 2 * QUAD, box);
+    MatrixScalar::Bounds(points, count - n, box);
+}
+
+// The normal, distance and absolute normal of a plane, each in all lanes.
+struct SplatPlane {
+    float32x4_t normal[VECTOR3_FLOATS];
+    float32x4_t distance;
+    float32x4_t absNormal[VECTOR3_FLOATS];
+
+    void Load(const f32* plane)
+    {
+        for (u32 i = 0; i < VECTOR3_FLOATS; i++) {
+            normal[i] = vdupq_n_f32(plane[i]);
+            absNormal[i] = vabsq_f32(normal[i]);
+        }
+        distance = vdupq_n_f32(plane[VECTOR3_FLOATS]);
+    }
+};
+
+// Whether four boxes from n on reach the inner side of the plane, the test of MatrixScalar::CullBoxes.
+inline uint32x4_t InsideNEON(const SplatPlane& plane, const f32* const boxes[BOX_FLOATS], u32 n)
+{
+    float32x4_t distance = vmlaq_f32(vmulq_f32(vld1q_f32(boxes[0] + n), plane.normal[0]), vld1q_f32(boxes[1] + n),
+        plane.normal[1]);
+    distance = vaddq_f32(vmlaq_f32(distance, vld1q_f32(boxes[2] + n), plane.normal[2]), plane.distance);
+    float32x4_t radius = vmlaq_f32(vmulq_f32(vld1q_f32(boxes[3] + n), plane.absNormal[0]), vld1q_f32(boxes[4] + n),
+        plane.absNormal[1]);
+    radius = vmlaq_f32(radius, vld1q_f32(boxes[5] + n), plane.absNormal[2]);
+    return vcgeq_f32(vaddq_f32(distance, radius), vdupq_n_f32(0.0f));
+}
+
+// Lane i of a comparison mask to bit i, without the AArch64 only across-vector add.
+inline u32 MaskBits(uint32x4_t mask)
+{
+    static const u32 weights[QUAD] = {1, 2, 4, 8};
+    const uint32x4_t bits = vandq_u32(mask, vld1q_u32(weights));
+    const uint32x2_t pairs = vorr_u32(vget_low_u32(bits), vget_high_u32(bits));
+    return vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+}
+
+// A mask word at a time like CullBoxesSSE4.
+void CullBoxesNEON(const f32* planes, u32 planeCount, const f32* const boxes[BOX_FLOATS], u32* visible, u32 count)
+{
+    const u32 steps = MASK_BITS / QUAD;
+    u32 n = 0;
+    for (; n + MASK_BITS <= count; n += MASK_BITS) {
+        uint32x4_t inside[steps];
+        for (u32 step = 0; step < steps; step++) {
+            inside[step] = vdupq_n_u32(0xffffffffu);
+        }
+        for (u32 p = 0; p < planeCount; p++) {
+            SplatPlane plane;
+            plane.Load(planes + p * PLANE_FLOATS);
+            for (u32 step = 0; step < steps; step++) {
+                inside[step] = vandq_u32(inside[step], InsideNEON(plane, boxes, n + step * QUAD));
+            }
+        }
+        u32 bits = 0;
+        for (u32 step = 0; step < steps; step++) {
+            bits |= MaskBits(inside[step]) << (step * QUAD);
+        }
+        visible[n / MASK_BITS] = bits;
+    }
+    const f32* const tail[BOX_FLOATS] = {boxes[0] + n, boxes[1] + n, boxes[2] + n, boxes[3] + n, boxes[4] + n,
+        boxes[5] + n};
+    MatrixScalar::CullBoxes(planes, planeCount, tail, visible + n / MASK_BITS, count - n);
+}
+
+// Four MakeTransform matrices from SoA components like StoreTransformsSSE4.
+inline void StoreTransformsNEON(const float32x4_t p[VECTOR3_FLOATS], const float32x4_t s[VECTOR3_FLOATS],
+    const float32x4_t q[VECTOR4_FLOATS], f32* out)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t two = vdupq_n_f32(2.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t x = q[0];
+    const float32x4_t y = q[1];
+    const float32x4_t z = q[2];
+    const float32x4_t w = q[3];
+    const float32x4_t xx = vmulq_f32(x, x);
+    const float32x4_t yy = vmulq_f32(y, y);
+    const float32x4_t zz = vmulq_f32(z, z);
+    const float32x4_t xy = vmulq_f32(x, y);
+    const float32x4_t xz = vmulq_f32(x, z);
+    const float32x4_t yz = vmulq_f32(y, z);
+    const float32x4_t wx = vmulq_f32(w, x);
+    const float32x4_t wy = vmulq_f32(w, y);
+    const float32x4_t wz = vmulq_f32(w, z);
+
+    float32x4_t rows[MATRIX_ROWS][MATRIX_ROWS] = {
+        {vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(yy, zz))), s[0]),
+            vmulq_f32(vmulq_f32(two, vaddq_f32(xy, wz)), s[0]), vmulq_f32(vmulq_f32(two, vsubq_f32(xz, wy)), s[0]),
+            zero},
+        {vmulq_f32(vmulq_f32(two, vsubq_f32(xy, wz)), s[1]),
+            vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(xx, zz))), s[1]),
+            vmulq_f32(vmulq_f32(two, vaddq_f32(yz, wx)), s[1]), zero},
+        {vmulq_f32(vmulq_f32(two, vaddq_f32(xz, wy)), s[2]), vmulq_f32(vmulq_f32(two, vsubq_f32(yz, wx)), s[2]),
+            vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(xx, yy))), s[2]), zero},
+        {p[0], p[1], p[2], one},
+    };
+    for (u32 row = 0; row < MATRIX_ROWS; row++) {
+        Transpose4(rows[row]);
+        for (u32 m = 0; m < QUAD; m++) {
+            vst1q_f32(out + m * MATRIX_FLOATS + row * MATRIX_ROWS, rows[row][m]);
+        }
+    }
+}
+
+// Four matrices at a time, the de-interleaving loads do the gathers.
+void MakeTransformNEON(const f32* position, const f32* scale, const f32* orientation, f32* out, u32 count)
+{
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD, position += QUAD * VECTOR3_FLOATS, scale += QUAD * VECTOR3_FLOATS,
+        orientation += QUAD * VECTOR4_FLOATS, out += QUAD * MATRIX_FLOATS) {
+        const float32x4x4_t q = vld4q_f32(orientation);
+        const float32x4x3_t s = vld3q_f32(scale);
+        const float32x4x3_t p = vld3q_f32(position);
+        StoreTransformsNEON(p.val, s.val, q.val, out);
+    }
+    MatrixScalar::MakeTransform(position, scale, orientation, out, count - n);
+}
+
+void MakeTransformSoANEON(const f32* const position[VECTOR3_FLOATS], const f32* const scale[VECTOR3_FLOATS],
+    const f32* const orientation[VECTOR4_FLOATS], f32* out, u32 count)
+{
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD, out += QUAD * MATRIX_FLOATS) {
+        float32x4_t p[VECTOR3_FLOATS];
+        float32x4_t s[VECTOR3_FLOATS];
+        float32x4_t q[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR3_FLOATS; i++) {
+            p[i] = vld1q_f32(position[i] + n);
+            s[i] = vld1q_f32(scale[i] + n);
+        }
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            q[i] = vld1q_f32(orientation[i] + n);
+        }
+        StoreTransformsNEON(p, s, q, out);
+    }
+    const f32* const tailPosition[VECTOR3_FLOATS] = {position[0] + n, position[1] + n, position[2] + n};
+    const f32* const tailScale[VECTOR3_FLOATS] = {scale[0] + n, scale[1] + n, scale[2] + n};
+    const f32* const tailOrientation[VECTOR4_FLOATS] = {orientation[0] + n, orientation[1] + n, orientation[2] + n,
+        orientation[3] + n};
+    MatrixScalar::MakeTransformSoA(tailPosition, tailScale, tailOrientation, out, count - n);
+}
+
+inline float32x4_t Dot4(const float32x4_t a[VECTOR4_FLOATS], const float32x4_t b[VECTOR4_FLOATS])
+{
+    float32x4_t dot = vmlaq_f32(vmulq_f32(a[0], b[0]), a[1], b[1]);
+    dot = vmlaq_f32(dot, a[2], b[2]);
+    return vmlaq_f32(dot, a[3], b[3]);
+}
+
+// 1 / sqrt(v). ARMv7 has no vector square root or divide: the estimate and two Newton steps.
+inline float32x4_t InverseSqrt(float32x4_t v)
+{
+#if defined(__aarch64__)
+    return vdivq_f32(vdupq_n_f32(1.0f), vsqrtq_f32(v));
+#else
+    float32x4_t estimate = vrsqrteq_f32(v);
+    estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(v, estimate), estimate));
+    return vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(v, estimate), estimate));
+#endif
+}
+
+void NlerpNEON(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t, u32 tStride,
+    f32* const out[VECTOR4_FLOATS], u32 count)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        float32x4_t qa[VECTOR4_FLOATS];
+        float32x4_t qb[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            qa[i] = vld1q_f32(a[i] + n);
+            qb[i] = vld1q_f32(b[i] + n);
+        }
+        const float32x4_t tb = (tStride == 0) ? vdupq_n_f32(*t) : vld1q_f32(t + n);
+        const float32x4_t weightA = vsubq_f32(one, tb);
+        const float32x4_t weightB = vbslq_f32(vcltq_f32(Dot4(qa, qb), zero), vnegq_f32(tb), tb);
+        float32x4_t result[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            result[i] = vmlaq_f32(vmulq_f32(qa[i], weightA), qb[i], weightB);
+        }
+        const float32x4_t scale = InverseSqrt(Dot4(result, result));
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            vst1q_f32(out[i] + n, vmulq_f32(result[i], scale));
+        }
+    }
+    const f32* const tailA[VECTOR4_FLOATS] = {a[0] + n, a[1] + n, a[2] + n, a[3] + n};
+    const f32* const tailB[VECTOR4_FLOATS] = {b[0] + n, b[1] + n, b[2] + n, b[3] + n};
+    f32* const tailOut[VECTOR4_FLOATS] = {out[0] + n, out[1] + n, out[2] + n, out[3] + n};
+    MatrixScalar::Nlerp(tailA, tailB, t + n * tStride, tStride, tailOut, count - n);
+}
+
+// The slerp weight polynomial of MatrixScalar::Slerp for four factors.
+inline float32x4_t SlerpWeightNEON(float32x4_t t, float32x4_t cosineMinusOne)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t squared = vmulq_f32(t, t);
+    float32x4_t weight = one;
+    for (u32 i = SLERP_TERMS; i > 0; i--) {
+        const float32x4_t term = vsubq_f32(vmulq_n_f32(squared, SLERP_U[i - 1]), vdupq_n_f32(SLERP_V[i - 1]));
+        weight = vmlaq_f32(one, vmulq_f32(term, cosineMinusOne), weight);
+    }
+    return vmulq_f32(weight, t);
+}
+
+void SlerpNEON(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t, u32 tStride,
+    f32* const out[VECTOR4_FLOATS], u32 count)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        float32x4_t qa[VECTOR4_FLOATS];
+        float32x4_t qb[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            qa[i] = vld1q_f32(a[i] + n);
+            qb[i] = vld1q_f32(b[i] + n);
+        }
+        const float32x4_t tb = (tStride == 0) ? vdupq_n_f32(*t) : vld1q_f32(t + n);
+        const float32x4_t cosine = Dot4(qa, qb);
+        const float32x4_t cosineMinusOne = vsubq_f32(vabsq_f32(cosine), one);
+        const float32x4_t weightA = SlerpWeightNEON(vsubq_f32(one, tb), cosineMinusOne);
+        const float32x4_t weight = SlerpWeightNEON(tb, cosineMinusOne);
+        const float32x4_t weightB = vbslq_f32(vcltq_f32(cosine, zero), vnegq_f32(weight), weight);
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            vst1q_f32(out[i] + n, vmlaq_f32(vmulq_f32(qa[i], weightA), qb[i], weightB));
+        }
+    }
+    const f32* const tailA[VECTOR4_FLOATS] = {a[0] + n, a[1] + n, a[2] + n, a[3] + n};
+    const f32* const tailB[VECTOR4_FLOATS] = {b[0] + n, b[1] + n, b[2] + n, b[3] + n};
+    f32* const tailOut[VECTOR4_FLOATS] = {out[0] + n, out[1] + n, out[2] + n, out[3] + n};
+    MatrixScalar::Slerp(tailA, tailB, t + n * tStride, tStride, tailOut, count - n);
+}
+
+// Math::Fast four lanes at a time, the scalar expressions in the scalar order.
+inline int32x4_t RoundToIntNEON(float32x4_t f)
+{
+    const uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(f), vdupq_n_u32(Math::Fast::SIGN_BIT));
+    const float32x4_t half = vreinterpretq_f32_u32(vorrq_u32(sign, vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+    return vcvtq_s32_f32(vaddq_f32(f, half));
+}
+
+inline float32x4_t Polynomial(float32x4_t x, const f32* coefficients, u32 count)
+{
+    float32x4_t result = vdupq_n_f32(coefficients[0]);
+    for (u32 i = 1; i < count; i++) {
+        result = vmlaq_f32(vdupq_n_f32(coefficients[i]), result, x);
+    }
+    return result;
+}
+
+// a / b. ARMv7 has no vector divide: the reciprocal estimate and two Newton steps.
+inline float32x4_t Divide(float32x4_t a, float32x4_t b)
+{
+#if defined(__aarch64__)
+    return vdivq_f32(a, b);
+#else
+    float32x4_t estimate = vrecpeq_f32(b);
+    estimate = vmulq_f32(estimate, vrecpsq_f32(b, estimate));
+    return vmulq_f32(a, vmulq_f32(estimate, vrecpsq_f32(b, estimate)));
+#endif
+}
+
+void ReciprocalSqrtNEON(const f32* x, f32* out, u32 count)
+{
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const float32x4_t v = vld1q_f32(x + n);
+        float32x4_t y = vrsqrteq_f32(v);
+        y = vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(v, y), y));
+        vst1q_f32(out + n, vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(v, y), y)));
+    }
+    FastMathScalar::ReciprocalSqrt(x + n, out + n, count - n);
+}
+
+void SinCosNEON(const f32* x, f32* sine, f32* cosine, u32 count)
+{
+    const f32 sinCoefficients[] = {Math::Fast::SIN_C3, Math::Fast::SIN_C2, Math::Fast::SIN_C1};
+    const f32 cosCoefficients[] = {Math::Fast::COS_C3, Math::Fast::COS_C2, Math::Fast::COS_C1};
+    const uint32x4_t one = vdupq_n_u32(1);
+    const uint32x4_t two = vdupq_n_u32(2);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const float32x4_t v = vld1q_f32(x + n);
+        const int32x4_t quadrant = RoundToIntNEON(vmulq_n_f32(v, Math::Fast::TWO_OVER_PI));
+        const float32x4_t q = vcvtq_f32_s32(quadrant);
+        float32x4_t r = vmlsq_n_f32(v, q, Math::Fast::PIO2_HIGH);
+        r = vmlsq_n_f32(r, q, Math::Fast::PIO2_MIDDLE);
+        r = vmlsq_n_f32(r, q, Math::Fast::PIO2_LOW);
+        const float32x4_t z = vmulq_f32(r, r);
+        const float32x4_t s = vmlaq_f32(r, vmulq_f32(Polynomial(z, sinCoefficients, 3), z), r);
+        float32x4_t c = vmulq_f32(vmulq_f32(Polynomial(z, cosCoefficients, 3), z), z);
+        c = vaddq_f32(vmlsq_n_f32(c, z, 0.5f), vdupq_n_f32(1.0f));
+        const uint32x4_t bits = vreinterpretq_u32_s32(quadrant);
+        const uint32x4_t swap = vceqq_u32(vandq_u32(bits, one), one);
+        if (sine != nullptr) {
+            const uint32x4_t sign = vshlq_n_u32(vandq_u32(bits, two), 30);
+            vst1q_f32(sine + n, vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, c, s)), sign)));
+        }
+        if (cosine != nullptr) {
+            const uint32x4_t sign = vshlq_n_u32(vandq_u32(vaddq_u32(bits, one), two), 30);
+            vst1q_f32(cosine + n, vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, s, c)), sign)));
+        }
+    }
+    FastMathScalar::SinCos(x + n, sine == nullptr ? nullptr : sine + n, cosine == nullptr ? nullptr : cosine + n,
+        count - n);
+}
+
+void Atan2NEON(const f32* y, const f32* x, f32* out, u32 count)
+{
+    const f32 coefficients[] = {Math::Fast::ATAN_C4, Math::Fast::ATAN_C3, Math::Fast::ATAN_C2, Math::Fast::ATAN_C1};
+    const uint32x4_t signBit = vdupq_n_u32(Math::Fast::SIGN_BIT);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const float32x4_t vy = vld1q_f32(y + n);
+        const float32x4_t vx = vld1q_f32(x + n);
+        const float32x4_t ax = vabsq_f32(vx);
+        const float32x4_t ay = vabsq_f32(vy);
+        const uint32x4_t xLarger = vcgtq_f32(ax, ay);
+        const float32x4_t larger = vbslq_f32(xLarger, ax, ay);
+        const float32x4_t smaller = vbslq_f32(xLarger, ay, ax);
+        const float32x4_t ratio = vbslq_f32(vcgtq_f32(larger, zero), Divide(smaller, larger), zero);
+        const uint32x4_t far = vcgtq_f32(ratio, vdupq_n_f32(Math::Fast::TAN_PI_8));
+        const float32x4_t u = vbslq_f32(far, Divide(vsubq_f32(ratio, one), vaddq_f32(ratio, one)), ratio);
+        const float32x4_t z = vmulq_f32(u, u);
+        float32x4_t angle = vmlaq_f32(u, vmulq_f32(Polynomial(z, coefficients, 4), z), u);
+        angle = vbslq_f32(far, vaddq_f32(angle, vdupq_n_f32(Math::Fast::QUARTER_PI)), angle);
+        angle = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(Math::HALF_PI), angle), angle);
+        const uint32x4_t xNegative = vtstq_u32(vreinterpretq_u32_f32(vx), signBit);
+        angle = vbslq_f32(xNegative, vsubq_f32(vdupq_n_f32(Math::PI), angle), angle);
+        const uint32x4_t ySign = vandq_u32(vreinterpretq_u32_f32(vy), signBit);
+        vst1q_f32(out + n, vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(angle), ySign)));
+    }
+    FastMathScalar::Atan2(y + n, x + n, out + n, count - n);
+}
+
+// 2^n from the exponent bits, n within the normal exponents.
+inline float32x4_t PowerOfTwoNEON(int32x4_t n)
+{
+    return vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(Math::Fast::EXPONENT_BIAS)),
+        Math::Fast::MANTISSA_BITS));
+}
+
+void Exp2NEON(const f32* x, f32* out, u32 count)
+{
+    const f32 coefficients[] = {Math::Fast::EXP2_C6, Math::Fast::EXP2_C5, Math::Fast::EXP2_C4, Math::Fast::EXP2_C3,
+        Math::Fast::EXP2_C2, Math::Fast::EXP2_C1};
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        float32x4_t v = vmaxq_f32(vld1q_f32(x + n), vdupq_n_f32(Math::Fast::EXP2_MIN));
+        v = vminq_f32(v, vdupq_n_f32(Math::Fast::EXP2_MAX));
+        const int32x4_t power = RoundToIntNEON(v);
+        const float32x4_t f = vsubq_f32(v, vcvtq_f32_s32(power));
+        const float32x4_t p = vmlaq_f32(vdupq_n_f32(1.0f), Polynomial(f, coefficients, 6), f);
+        // power / 2 rounded toward zero, like the scalar division
+        const uint32x4_t bits = vreinterpretq_u32_s32(power);
+        const int32x4_t half = vshrq_n_s32(vreinterpretq_s32_u32(vsraq_n_u32(bits, bits, 31)), 1);
+        vst1q_f32(out + n, vmulq_f32(vmulq_f32(p, PowerOfTwoNEON(half)), PowerOfTwoNEON(vsubq_s32(power, half))));
+    }
+    FastMathScalar::Exp2(x + n, out + n, count - n);
+}
+
+void Log2NEON(const f32* x, f32* out, u32 count)
+{
+    const f32 coefficients[] = {Math::Fast::LOG_C9, Math::Fast::LOG_C8, Math::Fast::LOG_C7, Math::Fast::LOG_C6,
+        Math::Fast::LOG_C5, Math::Fast::LOG_C4, Math::Fast::LOG_C3, Math::Fast::LOG_C2, Math::Fast::LOG_C1};
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const uint32x4_t bits = vreinterpretq_u32_f32(vld1q_f32(x + n));
+        float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(Math::Fast::MANTISSA_MASK)),
+            vreinterpretq_u32_f32(one)));
+        float32x4_t e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, Math::Fast::MANTISSA_BITS)),
+            vdupq_n_s32(Math::Fast::EXPONENT_BIAS)));
+        const uint32x4_t high = vcgtq_f32(m, vdupq_n_f32(Math::Fast::SQRT_2));
+        m = vbslq_f32(high, vmulq_n_f32(m, 0.5f), m);
+        e = vbslq_f32(high, vaddq_f32(e, one), e);
+        const float32x4_t f = vsubq_f32(m, one);
+        const float32x4_t z = vmulq_f32(f, f);
+        const float32x4_t y = vmlsq_n_f32(vmulq_f32(vmulq_f32(f, z), Polynomial(f, coefficients, 9)), z, 0.5f);
+        float32x4_t result = vmlaq_n_f32(vmulq_n_f32(y, Math::Fast::LOG2_E_MINUS_ONE), f, Math::Fast::LOG2_E_MINUS_ONE);
+        result = vaddq_f32(vaddq_f32(vaddq_f32(result, y), f), e);
+        vst1q_f32(out + n, result);
+    }
+    FastMathScalar::Log2(x + n, out + n, count - n);
+}
+}
+
+namespace CGKit {
+bool GetNEONMatrixKernels(MatrixKernels& kernels)
+{
+    kernels.multiply = MultiplyNEON;
+    kernels.transpose = TransposeNEON;
+    kernels.inverse = InverseNEON;
+    kernels.inverseAffine = InverseAffineNEON;
+    kernels.inverseRigid = InverseRigidNEON;
+    kernels.normalMatrix = NormalMatrixNEON;
+    kernels.transform = TransformNEON;
+    kernels.transformVector3 = TransformVector3NEON;
+    kernels.transformVector3SoA = TransformVector3SoANEON;
+    kernels.transformBox = TransformBoxNEON;
+    kernels.bounds = BoundsNEON;
+    kernels.cullBoxes = CullBoxesNEON;
+    kernels.makeTransform = MakeTransformNEON;
+    kernels.makeTransformSoA = MakeTransformSoANEON;
+    kernels.nlerp = NlerpNEON;
+    kernels.slerp = SlerpNEON;
+    return true;
+}
+
+bool GetNEONFastMathKernels(FastMathKernels& kernels)
+{
+    kernels.reciprocalSqrt = ReciprocalSqrtNEON;
+    kernels.sinCos = SinCosNEON;
+    kernels.atan2 = Atan2NEON;
+    kernels.exp2 = Exp2NEON;
+    kernels.log2 = Log2NEON;
+    return true;
+}
+}  // namespace CGKit
+#else
+namespace CGKit {
+bool GetNEONMatrixKernels(MatrixKernels&)
+{
+    return false;
+}
+
+bool GetNEONFastMathKernels(FastMathKernels&)
+{
+    return false;
+}
+}  // namespace CGKit
+#endif
@@ -0,0 +1,1261 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: SSE4.1 and AVX2 kernels of MatrixBatch and Math::Fast.
+ */
+
+#include "MathKernels/MatrixKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cmath>
+#include <immintrin.h>
+#include "MathKernels/FastMath.h"
+
+using namespace CGKit;
+
+// Kernels are compiled per function for their instruction set, dispatch only calls them on CPUs that
+// support it, so the rest of the library keeps the baseline flags.
+#define SSE4_TARGET __attribute__((target("sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+
+namespace {
+// elements per SoA step of MakeTransform
+constexpr u32 QUAD = 4;
+
+template<s32 LANE>
+SSE4_TARGET inline __m128 Splat(__m128 v)
+{
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(LANE, LANE, LANE, LANE));
+}
+
+// row * b, b given by its rows, in the order of the scalar kernel
+SSE4_TARGET inline __m128 RowTimes(__m128 row, const __m128 b[MATRIX_ROWS])
+{
+    __m128 result = _mm_mul_ps(Splat<0>(row), b[0]);
+    result = _mm_add_ps(result, _mm_mul_ps(Splat<1>(row), b[1]));
+    result = _mm_add_ps(result, _mm_mul_ps(Splat<2>(row), b[2]));
+    return _mm_add_ps(result, _mm_mul_ps(Splat<3>(row), b[3]));
+}
+
+SSE4_TARGET inline void LoadRows(const f32* m, __m128 rows[MATRIX_ROWS])
+{
+    for (u32 row = 0; row < MATRIX_ROWS; row++) {
+        rows[row] = _mm_loadu_ps(m + row * MATRIX_ROWS);
+    }
+}
+
+SSE4_TARGET void MultiplySSE4(const f32* a, const f32* b, u32 bStride, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, a += MATRIX_FLOATS, b += bStride, out += MATRIX_FLOATS) {
+        __m128 right[MATRIX_ROWS];
+        LoadRows(b, right);
+        __m128 rows[MATRIX_ROWS];
+        for (u32 row = 0; row < MATRIX_ROWS; row++) {
+            rows[row] = RowTimes(_mm_loadu_ps(a + row * MATRIX_ROWS), right);
+        }
+        for (u32 row = 0; row < MATRIX_ROWS; row++) {
+            _mm_storeu_ps(out + row * MATRIX_ROWS, rows[row]);
+        }
+    }
+}
+
+SSE4_TARGET void TransposeSSE4(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        __m128 r0 = _mm_loadu_ps(in);
+        __m128 r1 = _mm_loadu_ps(in + 4);
+        __m128 r2 = _mm_loadu_ps(in + 8);
+        __m128 r3 = _mm_loadu_ps(in + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out, r0);
+        _mm_storeu_ps(out + 4, r1);
+        _mm_storeu_ps(out + 8, r2);
+        _mm_storeu_ps(out + 12, r3);
+    }
+}
+
+// (a[X], a[Y], b[Z], b[W])
+template<s32 X, s32 Y, s32 Z, s32 W>
+SSE4_TARGET inline __m128 Shuffle(__m128 a, __m128 b)
+{
+    return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X));
+}
+
+template<s32 X, s32 Y, s32 Z, s32 W>
+SSE4_TARGET inline __m128 Swizzle(__m128 v)
+{
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(W, Z, Y, X));
+}
+
+// 2x2 blocks are held row major in one register: (m00, m01, m10, m11). Returns a * b.
+SSE4_TARGET inline __m128 Mat2Mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, Swizzle<0, 3, 0, 3>(b)), _mm_mul_ps(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+}
+
+// adj(a) * b
+SSE4_TARGET inline __m128 Mat2AdjMul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(Swizzle<3, 3, 0, 0>(a), b), _mm_mul_ps(Swizzle<1, 1, 2, 2>(a), Swizzle<2, 3, 0, 1>(b)));
+}
+
+// a * adj(b)
+SSE4_TARGET inline __m128 Mat2MulAdj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, Swizzle<3, 0, 3, 0>(b)), _mm_mul_ps(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+}
+
+/*
+ * Block inverse: with M = [A B; C D] in 2x2 blocks, the blocks of the adjugate are built from 2x2
+ * products and adjugates, |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C).
+ */
+SSE4_TARGET void InverseSSE4(const f32* in, f32* out, u32 count)
+{
+    const __m128 adjugateSign = _mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f);
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        const __m128 r0 = _mm_loadu_ps(in);
+        const __m128 r1 = _mm_loadu_ps(in + 4);
+        const __m128 r2 = _mm_loadu_ps(in + 8);
+        const __m128 r3 = _mm_loadu_ps(in + 12);
+        const __m128 a = _mm_movelh_ps(r0, r1);
+        const __m128 b = _mm_movehl_ps(r1, r0);
+        const __m128 c = _mm_movelh_ps(r2, r3);
+        const __m128 d = _mm_movehl_ps(r3, r2);
+
+        // (|A|, |B|, |C|, |D|)
+        const __m128 dets = _mm_sub_ps(_mm_mul_ps(Shuffle<0, 2, 0, 2>(r0, r2), Shuffle<1, 3, 1, 3>(r1, r3)),
+            _mm_mul_ps(Shuffle<1, 3, 1, 3>(r0, r2), Shuffle<0, 2, 0, 2>(r1, r3)));
+        const __m128 detA = Splat<0>(dets);
+        const __m128 detB = Splat<1>(dets);
+        const __m128 detC = Splat<2>(dets);
+        const __m128 detD = Splat<3>(dets);
+
+        const __m128 dc = Mat2AdjMul(d, c);
+        const __m128 ab = Mat2AdjMul(a, b);
+        __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), Mat2Mul(b, dc));
+        __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), Mat2Mul(c, ab));
+        __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), Mat2MulAdj(d, ab));
+        __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), Mat2MulAdj(a, dc));
+
+        __m128 trace = _mm_mul_ps(ab, Swizzle<0, 2, 1, 3>(dc));
+        trace = _mm_hadd_ps(trace, trace);
+        trace = _mm_hadd_ps(trace, trace);
+        const f32 det = _mm_cvtss_f32(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace));
+        if (det == 0.0f) {
+            const __m128 zero = _mm_setzero_ps();
+            _mm_storeu_ps(out, zero);
+            _mm_storeu_ps(out + 4, zero);
+            _mm_storeu_ps(out + 8, zero);
+            _mm_storeu_ps(out + 12, zero);
+            continue;
+        }
+        const __m128 scale = _mm_mul_ps(adjugateSign, _mm_set1_ps(1.0f / det));
+        x = _mm_mul_ps(x, scale);
+        y = _mm_mul_ps(y, scale);
+        z = _mm_mul_ps(z, scale);
+        w = _mm_mul_ps(w, scale);
+        // adjugate of each block and its place in the result in one shuffle
+        _mm_storeu_ps(out, Shuffle<3, 1, 3, 1>(x, y));
+        _mm_storeu_ps(out + 4, Shuffle<2, 0, 2, 0>(x, y));
+        _mm_storeu_ps(out + 8, Shuffle<3, 1, 3, 1>(z, w));
+        _mm_storeu_ps(out + 12, Shuffle<2, 0, 2, 0>(z, w));
+    }
+}
+
+SSE4_TARGET inline __m128 Cross(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(Swizzle<1, 2, 0, 3>(a), Swizzle<2, 0, 1, 3>(b)),
+        _mm_mul_ps(Swizzle<2, 0, 1, 3>(a), Swizzle<1, 2, 0, 3>(b)));
+}
+
+SSE4_TARGET inline void StoreZero(f32* out)
+{
+    const __m128 zero = _mm_setzero_ps();
+    for (u32 row = 0; row < MATRIX_ROWS; row++) {
+        _mm_storeu_ps(out + row * MATRIX_ROWS, zero);
+    }
+}
+
+// Stores the rows of a 3x3 part, w 0, and the translation moved through them as the 4th row, w 1.
+SSE4_TARGET inline void StoreAffineSSE4(__m128 r0, __m128 r1, __m128 r2, __m128 translation, f32* out)
+{
+    __m128 moved = _mm_add_ps(_mm_mul_ps(Splat<0>(translation), r0), _mm_mul_ps(Splat<1>(translation), r1));
+    moved = _mm_add_ps(moved, _mm_mul_ps(Splat<2>(translation), r2));
+    moved = _mm_xor_ps(moved, _mm_set1_ps(-0.0f));
+    _mm_storeu_ps(out, r0);
+    _mm_storeu_ps(out + 4, r1);
+    _mm_storeu_ps(out + 8, r2);
+    _mm_storeu_ps(out + 12, _mm_blend_ps(moved, _mm_set1_ps(1.0f), 0x8));
+}
+
+// The 3x3 inverse of MatrixScalar: the columns are the cross products of the rows over the determinant.
+SSE4_TARGET void InverseAffineSSE4(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        const __m128 r0 = _mm_loadu_ps(in);
+        const __m128 r1 = _mm_loadu_ps(in + 4);
+        const __m128 r2 = _mm_loadu_ps(in + 8);
+        const __m128 translation = _mm_loadu_ps(in + 12);
+        __m128 c0 = Cross(r1, r2);
+        __m128 c1 = Cross(r2, r0);
+        __m128 c2 = Cross(r0, r1);
+        const f32 det = _mm_cvtss_f32(_mm_dp_ps(r0, c0, 0x71));
+        if (det == 0.0f) {
+            StoreZero(out);
+            continue;
+        }
+        __m128 c3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        const __m128 scale = _mm_set1_ps(1.0f / det);
+        StoreAffineSSE4(_mm_mul_ps(c0, scale), _mm_mul_ps(c1, scale), _mm_mul_ps(c2, scale), translation, out);
+    }
+}
+
+SSE4_TARGET void InverseRigidSSE4(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        __m128 r0 = _mm_loadu_ps(in);
+        __m128 r1 = _mm_loadu_ps(in + 4);
+        __m128 r2 = _mm_loadu_ps(in + 8);
+        __m128 r3 = _mm_setzero_ps();
+        const __m128 translation = _mm_loadu_ps(in + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        StoreAffineSSE4(r0, r1, r2, translation, out);
+    }
+}
+
+// The transpose of the 3x3 inverse has the cross products as its rows.
+SSE4_TARGET void NormalMatrixSSE4(const f32* in, f32* out, u32 count)
+{
+    for (u32 n = 0; n < count; n++, in += MATRIX_FLOATS, out += MATRIX_FLOATS) {
+        const __m128 r0 = _mm_loadu_ps(in);
+        const __m128 r1 = _mm_loadu_ps(in + 4);
+        const __m128 r2 = _mm_loadu_ps(in + 8);
+        const __m128 c0 = Cross(r1, r2);
+        const f32 det = _mm_cvtss_f32(_mm_dp_ps(r0, c0, 0x71));
+        if (det == 0.0f) {
+            StoreZero(out);
+            continue;
+        }
+        const __m128 scale = _mm_set1_ps(1.0f / det);
+        StoreAffineSSE4(_mm_mul_ps(c0, scale), _mm_mul_ps(Cross(r2, r0), scale), _mm_mul_ps(Cross(r0, r1), scale),
+            _mm_setzero_ps(), out);
+    }
+}
+
+SSE4_TARGET void TransformSSE4(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count)
+{
+    if (count == 0) {
+        return;
+    }
+    __m128 rows[MATRIX_ROWS];
+    LoadRows(matrix, rows);
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += VECTOR4_FLOATS, out += VECTOR4_FLOATS) {
+        if (matrixStride != 0 && n != 0) {
+            LoadRows(matrix, rows);
+        }
+        _mm_storeu_ps(out, RowTimes(_mm_loadu_ps(in), rows));
+    }
+}
+
+// The 3x3 part of a matrix and w times its 4th row, each entry in all lanes, for SoA Vector3 transforms.
+struct SplatMatrix3 {
+    __m128 m[VECTOR3_FLOATS][VECTOR3_FLOATS];
+    __m128 w[VECTOR3_FLOATS];
+};
+
+SSE4_TARGET inline void Splat3(const f32* matrix, f32 w, SplatMatrix3& splat)
+{
+    for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+        for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+            splat.m[row][col] = _mm_set1_ps(matrix[row * MATRIX_ROWS + col]);
+        }
+        splat.w[col] = _mm_set1_ps(w * matrix[(MATRIX_ROWS - 1) * MATRIX_ROWS + col]);
+    }
+}
+
+// Component col of four transformed vectors, in the order of the scalar kernel.
+SSE4_TARGET inline __m128 Column3(const SplatMatrix3& splat, u32 col, __m128 x, __m128 y, __m128 z)
+{
+    __m128 result = _mm_add_ps(_mm_mul_ps(x, splat.m[0][col]), _mm_mul_ps(y, splat.m[1][col]));
+    result = _mm_add_ps(result, _mm_mul_ps(z, splat.m[2][col]));
+    return _mm_add_ps(result, splat.w[col]);
+}
+
+// Four packed Vector3 (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) to x, y and z of the four, and back.
+SSE4_TARGET inline void Deinterleave3(const f32* in, __m128& x, __m128& y, __m128& z)
+{
+    const __m128 a = _mm_loadu_ps(in);
+    const __m128 b = _mm_loadu_ps(in + 4);
+    const __m128 c = _mm_loadu_ps(in + 8);
+    const __m128 x0x1x2y2 = Shuffle<0, 3, 2, 3>(a, b);
+    const __m128 x2y2z2x3 = Shuffle<2, 3, 0, 1>(b, c);
+    const __m128 y0z0y1z1 = Shuffle<1, 2, 0, 1>(a, b);
+    const __m128 y2y1y3z3 = Shuffle<3, 0, 2, 3>(b, c);
+    x = Shuffle<0, 1, 0, 3>(x0x1x2y2, x2y2z2x3);
+    y = Shuffle<0, 2, 0, 2>(y0z0y1z1, y2y1y3z3);
+    z = Shuffle<1, 3, 0, 3>(y0z0y1z1, c);
+}
+
+SSE4_TARGET inline void Interleave3(__m128 x, __m128 y, __m128 z, f32* out)
+{
+    const __m128 xyLow = _mm_unpacklo_ps(x, y);
+    const __m128 xyHigh = _mm_unpackhi_ps(x, y);
+    const __m128 yzLow = _mm_unpacklo_ps(y, z);
+    _mm_storeu_ps(out, Shuffle<0, 1, 0, 2>(xyLow, Shuffle<0, 0, 1, 1>(z, x)));
+    _mm_storeu_ps(out + 4, Shuffle<2, 3, 0, 1>(yzLow, xyHigh));
+    _mm_storeu_ps(out + 8, Swizzle<0, 2, 3, 1>(Shuffle<2, 3, 2, 3>(z, xyHigh)));
+}
+
+/*
+ * Shared matrix: four vectors at a time through SoA. A matrix per vector: one vector at a time, stored
+ * as 8 + 4 bytes so the next vector, which out may alias, is not overwritten before it is read.
+ */
+SSE4_TARGET void TransformVector3SSE4(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count, f32 w)
+{
+    if (matrixStride == 0) {
+        SplatMatrix3 splat;
+        Splat3(matrix, w, splat);
+        u32 n = 0;
+        for (; n + QUAD <= count; n += QUAD, in += QUAD * VECTOR3_FLOATS, out += QUAD * VECTOR3_FLOATS) {
+            __m128 x;
+            __m128 y;
+            __m128 z;
+            Deinterleave3(in, x, y, z);
+            Interleave3(Column3(splat, 0, x, y, z), Column3(splat, 1, x, y, z), Column3(splat, 2, x, y, z), out);
+        }
+        MatrixScalar::TransformVector3(matrix, 0, in, out, count - n, w);
+        return;
+    }
+    const __m128 vectorW = _mm_set1_ps(w);
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += VECTOR3_FLOATS, out += VECTOR3_FLOATS) {
+        __m128 rows[MATRIX_ROWS];
+        LoadRows(matrix, rows);
+        __m128 result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(in[0]), rows[0]), _mm_mul_ps(_mm_set1_ps(in[1]), rows[1]));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(in[2]), rows[2]));
+        result = _mm_add_ps(result, _mm_mul_ps(vectorW, rows[3]));
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), result);
+        _mm_store_ss(out + 2, _mm_movehl_ps(result, result));
+    }
+}
+
+SSE4_TARGET void TransformVector3SoASSE4(const f32* matrix, const f32* const in[VECTOR3_FLOATS],
+    f32* const out[VECTOR3_FLOATS], u32 count, f32 w)
+{
+    SplatMatrix3 splat;
+    Splat3(matrix, w, splat);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const __m128 x = _mm_loadu_ps(in[0] + n);
+        const __m128 y = _mm_loadu_ps(in[1] + n);
+        const __m128 z = _mm_loadu_ps(in[2] + n);
+        const __m128 rx = Column3(splat, 0, x, y, z);
+        const __m128 ry = Column3(splat, 1, x, y, z);
+        const __m128 rz = Column3(splat, 2, x, y, z);
+        _mm_storeu_ps(out[0] + n, rx);
+        _mm_storeu_ps(out[1] + n, ry);
+        _mm_storeu_ps(out[2] + n, rz);
+    }
+    const f32* const tailIn[VECTOR3_FLOATS] = {in[0] + n, in[1] + n, in[2] + n};
+    f32* const tailOut[VECTOR3_FLOATS] = {out[0] + n, out[1] + n, out[2] + n};
+    MatrixScalar::TransformVector3SoA(matrix, tailIn, tailOut, count - n, w);
+}
+
+// The rows of the 3x3 part, their absolute values and the translation, for TransformBoxSSE4.
+struct BoxMatrix {
+    __m128 rows[VECTOR3_FLOATS];
+    __m128 absRows[VECTOR3_FLOATS];
+    __m128 translation;
+};
+
+SSE4_TARGET inline void LoadBoxMatrix(const f32* matrix, BoxMatrix& box)
+{
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+        box.rows[row] = _mm_loadu_ps(matrix + row * MATRIX_ROWS);
+        box.absRows[row] = _mm_andnot_ps(signBit, box.rows[row]);
+    }
+    box.translation = _mm_loadu_ps(matrix + (MATRIX_ROWS - 1) * MATRIX_ROWS);
+}
+
+SSE4_TARGET inline void StoreVector3(__m128 v, f32* out)
+{
+    _mm_storel_pi(reinterpret_cast<__m64*>(out), v);
+    _mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+}
+
+// One box at a time. Both loads stay inside the box: (minimum, maximum x) and (minimum z, maximum).
+SSE4_TARGET void TransformBoxSSE4(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count)
+{
+    if (count == 0) {
+        return;
+    }
+    const __m128 half = _mm_set1_ps(0.5f);
+    BoxMatrix box;
+    LoadBoxMatrix(matrix, box);
+    for (u32 n = 0; n < count; n++, matrix += matrixStride, in += BOX_FLOATS, out += BOX_FLOATS) {
+        if (matrixStride != 0 && n != 0) {
+            LoadBoxMatrix(matrix, box);
+        }
+        const __m128 minimum = _mm_loadu_ps(in);
+        const __m128 maximum = Swizzle<1, 2, 3, 3>(_mm_loadu_ps(in + 2));
+        const __m128 center = _mm_mul_ps(_mm_add_ps(minimum, maximum), half);
+        const __m128 extent = _mm_mul_ps(_mm_sub_ps(maximum, minimum), half);
+        __m128 c = _mm_add_ps(_mm_mul_ps(Splat<0>(center), box.rows[0]), _mm_mul_ps(Splat<1>(center), box.rows[1]));
+        c = _mm_add_ps(_mm_add_ps(c, _mm_mul_ps(Splat<2>(center), box.rows[2])), box.translation);
+        __m128 e = _mm_add_ps(_mm_mul_ps(Splat<0>(extent), box.absRows[0]),
+            _mm_mul_ps(Splat<1>(extent), box.absRows[1]));
+        e = _mm_add_ps(e, _mm_mul_ps(Splat<2>(extent), box.absRows[2]));
+        StoreVector3(_mm_sub_ps(c, e), out);
+        StoreVector3(_mm_add_ps(c, e), out + VECTOR3_FLOATS);
+    }
+}
+
+/*
+ * Four points are three vectors whose lanes run x, y, z, x, ...: each vector keeps its own minimum and
+ * maximum, which end up as four points each for the scalar kernel to fold into box with the rest.
+ */
+SSE4_TARGET void BoundsSSE4(const f32* points, u32 count, f32* box)
+{
+    if (count < QUAD) {
+        MatrixScalar::Bounds(points, count, box);
+        return;
+    }
+    __m128 minimum[VECTOR3_FLOATS];
+    __m128 maximum[VECTOR3_FLOATS];
+    for (u32 v = 0; v < VECTOR3_FLOATS; v++) {
+        minimum[v] = _mm_loadu_ps(points + v * QUAD);
+        maximum[v] = minimum[v];
+    }
+    u32 n = QUAD;
+    for (points += QUAD * VECTOR3_FLOATS; n + QUAD <= count; n += QUAD, points += QUAD * VECTOR3_FLOATS) {
+        for (u32 v = 0; v < VECTOR3_FLOATS; v++) {
+            const __m128 p = _mm_loadu_ps(points + v * QUAD);
+            minimum[v] = _mm_min_ps(minimum[v], p);
+            maximum[v] = _mm_max_ps(maximum[v], p);
+        }
+    }
+    f32 lanes[2 * QUAD * VECTOR3_FLOATS];
+    for (u32 v = 0; v < VECTOR3_FLOATS; v++) {
+        _mm_storeu_ps(lanes + v * QUAD, minimum[v]);
+        _mm_storeu_ps(lanes + (VECTOR3_FLOATS + v) * QUAD, maximum[v]);
+    }
+    MatrixScalar::Bounds(lanes, 2 * QUAD, box);
+    MatrixScalar::Bounds(points, count - n, box);
+}
+
+// The normal, distance and absolute normal of a plane, each in all lanes.
+struct SplatPlane {
+    __m128 normal[VECTOR3_FLOATS];
+    __m128 distance;
+    __m128 absNormal[VECTOR3_FLOATS];
+};
+
+SSE4_TARGET inline void LoadPlane(const f32* plane, SplatPlane& splat)
+{
+    for (u32 i = 0; i < VECTOR3_FLOATS; i++) {
+        splat.normal[i] = _mm_set1_ps(plane[i]);
+        splat.absNormal[i] = _mm_set1_ps(fabsf(plane[i]));
+    }
+    splat.distance = _mm_set1_ps(plane[VECTOR3_FLOATS]);
+}
+
+// Whether four boxes from n on reach the inner side of the plane, the test of MatrixScalar::CullBoxes.
+SSE4_TARGET inline __m128 InsideSSE4(const SplatPlane& plane, const f32* const boxes[BOX_FLOATS], u32 n)
+{
+    __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(boxes[0] + n), plane.normal[0]),
+        _mm_mul_ps(_mm_loadu_ps(boxes[1] + n), plane.normal[1]));
+    distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(boxes[2] + n), plane.normal[2])), plane.distance);
+    __m128 radius = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(boxes[3] + n), plane.absNormal[0]),
+        _mm_mul_ps(_mm_loadu_ps(boxes[4] + n), plane.absNormal[1]));
+    radius = _mm_add_ps(radius, _mm_mul_ps(_mm_loadu_ps(boxes[5] + n), plane.absNormal[2]));
+    return _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps());
+}
+
+/*
+ * A mask word at a time, planes in the outer loop so each is splat once per word, boxes are read from
+ * memory again for each plane.
+ */
+SSE4_TARGET void CullBoxesSSE4(const f32* planes, u32 planeCount, const f32* const boxes[BOX_FLOATS], u32* visible,
+    u32 count)
+{
+    const u32 steps = MASK_BITS / QUAD;
+    u32 n = 0;
+    for (; n + MASK_BITS <= count; n += MASK_BITS) {
+        __m128 inside[steps];
+        for (u32 step = 0; step < steps; step++) {
+            inside[step] = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        }
+        for (u32 p = 0; p < planeCount; p++) {
+            SplatPlane plane;
+            LoadPlane(planes + p * PLANE_FLOATS, plane);
+            for (u32 step = 0; step < steps; step++) {
+                inside[step] = _mm_and_ps(inside[step], InsideSSE4(plane, boxes, n + step * QUAD));
+            }
+        }
+        u32 bits = 0;
+        for (u32 step = 0; step < steps; step++) {
+            bits |= static_cast<u32>(_mm_movemask_ps(inside[step])) << (step * QUAD);
+        }
+        visible[n / MASK_BITS] = bits;
+    }
+    const f32* const tail[BOX_FLOATS] = {boxes[0] + n, boxes[1] + n, boxes[2] + n, boxes[3] + n, boxes[4] + n,
+        boxes[5] + n};
+    MatrixScalar::CullBoxes(planes, planeCount, tail, visible + n / MASK_BITS, count - n);
+}
+
+// Gathers one component of four Vector3.
+SSE4_TARGET inline __m128 LoadComponent(const f32* v, u32 component)
+{
+    return _mm_setr_ps(v[component], v[VECTOR3_FLOATS + component], v[2 * VECTOR3_FLOATS + component],
+        v[3 * VECTOR3_FLOATS + component]);
+}
+
+// Four MakeTransform matrices from SoA components: each matrix entry is computed for the four at once
+// and the rows are transposed back.
+SSE4_TARGET inline void StoreTransformsSSE4(const __m128 p[VECTOR3_FLOATS], const __m128 s[VECTOR3_FLOATS],
+    const __m128 q[VECTOR4_FLOATS], f32* out)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 x = q[0];
+    const __m128 y = q[1];
+    const __m128 z = q[2];
+    const __m128 w = q[3];
+    const __m128 xx = _mm_mul_ps(x, x);
+    const __m128 yy = _mm_mul_ps(y, y);
+    const __m128 zz = _mm_mul_ps(z, z);
+    const __m128 xy = _mm_mul_ps(x, y);
+    const __m128 xz = _mm_mul_ps(x, z);
+    const __m128 yz = _mm_mul_ps(y, z);
+    const __m128 wx = _mm_mul_ps(w, x);
+    const __m128 wy = _mm_mul_ps(w, y);
+    const __m128 wz = _mm_mul_ps(w, z);
+
+    __m128 rows[MATRIX_ROWS][MATRIX_ROWS] = {
+        {_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), s[0]),
+            _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), s[0]), _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), s[0]),
+            zero},
+        {_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), s[1]),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), s[1]),
+            _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), s[1]), zero},
+        {_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), s[2]), _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), s[2]),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), s[2]), zero},
+        {p[0], p[1], p[2], one},
+    };
+    for (u32 row = 0; row < MATRIX_ROWS; row++) {
+        __m128* r = rows[row];
+        _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+        for (u32 m = 0; m < QUAD; m++) {
+            _mm_storeu_ps(out + m * MATRIX_FLOATS + row * MATRIX_ROWS, r[m]);
+        }
+    }
+}
+
+// Four matrices at a time, the quaternions are transposed into x, y, z and w of all four.
+SSE4_TARGET void MakeTransformSSE4(const f32* position, const f32* scale, const f32* orientation, f32* out, u32 count)
+{
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD, position += QUAD * VECTOR3_FLOATS, scale += QUAD * VECTOR3_FLOATS,
+        orientation += QUAD * VECTOR4_FLOATS, out += QUAD * MATRIX_FLOATS) {
+        __m128 q[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            q[i] = _mm_loadu_ps(orientation + i * VECTOR4_FLOATS);
+        }
+        _MM_TRANSPOSE4_PS(q[0], q[1], q[2], q[3]);
+        const __m128 s[VECTOR3_FLOATS] = {LoadComponent(scale, 0), LoadComponent(scale, 1), LoadComponent(scale, 2)};
+        const __m128 p[VECTOR3_FLOATS] = {LoadComponent(position, 0), LoadComponent(position, 1),
+            LoadComponent(position, 2)};
+        StoreTransformsSSE4(p, s, q, out);
+    }
+    MatrixScalar::MakeTransform(position, scale, orientation, out, count - n);
+}
+
+SSE4_TARGET void MakeTransformSoASSE4(const f32* const position[VECTOR3_FLOATS], const f32* const scale[VECTOR3_FLOATS],
+    const f32* const orientation[VECTOR4_FLOATS], f32* out, u32 count)
+{
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD, out += QUAD * MATRIX_FLOATS) {
+        __m128 p[VECTOR3_FLOATS];
+        __m128 s[VECTOR3_FLOATS];
+        __m128 q[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR3_FLOATS; i++) {
+            p[i] = _mm_loadu_ps(position[i] + n);
+            s[i] = _mm_loadu_ps(scale[i] + n);
+        }
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            q[i] = _mm_loadu_ps(orientation[i] + n);
+        }
+        StoreTransformsSSE4(p, s, q, out);
+    }
+    const f32* const tailPosition[VECTOR3_FLOATS] = {position[0] + n, position[1] + n, position[2] + n};
+    const f32* const tailScale[VECTOR3_FLOATS] = {scale[0] + n, scale[1] + n, scale[2] + n};
+    const f32* const tailOrientation[VECTOR4_FLOATS] = {orientation[0] + n, orientation[1] + n, orientation[2] + n,
+        orientation[3] + n};
+    MatrixScalar::MakeTransformSoA(tailPosition, tailScale, tailOrientation, out, count - n);
+}
+
+// Loads four elements of each component of a and b.
+SSE4_TARGET inline void LoadPair(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], u32 n,
+    __m128 qa[VECTOR4_FLOATS], __m128 qb[VECTOR4_FLOATS])
+{
+    for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+        qa[i] = _mm_loadu_ps(a[i] + n);
+        qb[i] = _mm_loadu_ps(b[i] + n);
+    }
+}
+
+SSE4_TARGET inline __m128 Dot4(const __m128 a[VECTOR4_FLOATS], const __m128 b[VECTOR4_FLOATS])
+{
+    __m128 dot = _mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1]));
+    dot = _mm_add_ps(dot, _mm_mul_ps(a[2], b[2]));
+    return _mm_add_ps(dot, _mm_mul_ps(a[3], b[3]));
+}
+
+SSE4_TARGET void NlerpSSE4(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t,
+    u32 tStride, f32* const out[VECTOR4_FLOATS], u32 count)
+{
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        __m128 qa[VECTOR4_FLOATS];
+        __m128 qb[VECTOR4_FLOATS];
+        LoadPair(a, b, n, qa, qb);
+        const __m128 tb = (tStride == 0) ? _mm_set1_ps(*t) : _mm_loadu_ps(t + n);
+        const __m128 weightA = _mm_sub_ps(one, tb);
+        // negate t where the cosine is negative
+        const __m128 weightB = _mm_xor_ps(tb, _mm_and_ps(_mm_cmplt_ps(Dot4(qa, qb), _mm_setzero_ps()), signBit));
+        __m128 result[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            result[i] = _mm_add_ps(_mm_mul_ps(qa[i], weightA), _mm_mul_ps(qb[i], weightB));
+        }
+        const __m128 scale = _mm_div_ps(one, _mm_sqrt_ps(Dot4(result, result)));
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            _mm_storeu_ps(out[i] + n, _mm_mul_ps(result[i], scale));
+        }
+    }
+    const f32* const tailA[VECTOR4_FLOATS] = {a[0] + n, a[1] + n, a[2] + n, a[3] + n};
+    const f32* const tailB[VECTOR4_FLOATS] = {b[0] + n, b[1] + n, b[2] + n, b[3] + n};
+    f32* const tailOut[VECTOR4_FLOATS] = {out[0] + n, out[1] + n, out[2] + n, out[3] + n};
+    MatrixScalar::Nlerp(tailA, tailB, t + n * tStride, tStride, tailOut, count - n);
+}
+
+// The slerp weight polynomial of MatrixScalar::Slerp for four factors.
+SSE4_TARGET inline __m128 SlerpWeightSSE4(__m128 t, __m128 cosineMinusOne)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 squared = _mm_mul_ps(t, t);
+    __m128 weight = one;
+    for (u32 i = SLERP_TERMS; i > 0; i--) {
+        const __m128 term = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(SLERP_U[i - 1]), squared), _mm_set1_ps(SLERP_V[i - 1]));
+        weight = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(term, cosineMinusOne), weight));
+    }
+    return _mm_mul_ps(weight, t);
+}
+
+SSE4_TARGET void SlerpSSE4(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t,
+    u32 tStride, f32* const out[VECTOR4_FLOATS], u32 count)
+{
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        __m128 qa[VECTOR4_FLOATS];
+        __m128 qb[VECTOR4_FLOATS];
+        LoadPair(a, b, n, qa, qb);
+        const __m128 tb = (tStride == 0) ? _mm_set1_ps(*t) : _mm_loadu_ps(t + n);
+        const __m128 cosine = Dot4(qa, qb);
+        const __m128 cosineMinusOne = _mm_sub_ps(_mm_andnot_ps(signBit, cosine), one);
+        const __m128 weightA = SlerpWeightSSE4(_mm_sub_ps(one, tb), cosineMinusOne);
+        const __m128 negative = _mm_and_ps(_mm_cmplt_ps(cosine, _mm_setzero_ps()), signBit);
+        const __m128 weightB = _mm_xor_ps(SlerpWeightSSE4(tb, cosineMinusOne), negative);
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            _mm_storeu_ps(out[i] + n, _mm_add_ps(_mm_mul_ps(qa[i], weightA), _mm_mul_ps(qb[i], weightB)));
+        }
+    }
+    const f32* const tailA[VECTOR4_FLOATS] = {a[0] + n, a[1] + n, a[2] + n, a[3] + n};
+    const f32* const tailB[VECTOR4_FLOATS] = {b[0] + n, b[1] + n, b[2] + n, b[3] + n};
+    f32* const tailOut[VECTOR4_FLOATS] = {out[0] + n, out[1] + n, out[2] + n, out[3] + n};
+    MatrixScalar::Slerp(tailA, tailB, t + n * tStride, tStride, tailOut, count - n);
+}
+
+// Math::Fast four lanes at a time, the scalar expressions in the scalar order.
+SSE4_TARGET inline __m128i RoundToIntSSE4(__m128 f)
+{
+    const __m128 half = _mm_or_ps(_mm_and_ps(f, _mm_set1_ps(-0.0f)), _mm_set1_ps(0.5f));
+    return _mm_cvttps_epi32(_mm_add_ps(f, half));
+}
+
+SSE4_TARGET inline __m128 Polynomial(__m128 x, const f32* coefficients, u32 count)
+{
+    __m128 result = _mm_set1_ps(coefficients[0]);
+    for (u32 i = 1; i < count; i++) {
+        result = _mm_add_ps(_mm_mul_ps(result, x), _mm_set1_ps(coefficients[i]));
+    }
+    return result;
+}
+
+SSE4_TARGET void ReciprocalSqrtSSE4(const f32* x, f32* out, u32 count)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const __m128 v = _mm_loadu_ps(x + n);
+        const __m128 y = _mm_rsqrt_ps(v);
+        const __m128 step = _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(half, v), y), y));
+        _mm_storeu_ps(out + n, _mm_mul_ps(y, step));
+    }
+    FastMathScalar::ReciprocalSqrt(x + n, out + n, count - n);
+}
+
+SSE4_TARGET void SinCosSSE4(const f32* x, f32* sine, f32* cosine, u32 count)
+{
+    const f32 sinCoefficients[] = {Math::Fast::SIN_C3, Math::Fast::SIN_C2, Math::Fast::SIN_C1};
+    const f32 cosCoefficients[] = {Math::Fast::COS_C3, Math::Fast::COS_C2, Math::Fast::COS_C1};
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const __m128 v = _mm_loadu_ps(x + n);
+        const __m128i quadrant = RoundToIntSSE4(_mm_mul_ps(v, _mm_set1_ps(Math::Fast::TWO_OVER_PI)));
+        const __m128 q = _mm_cvtepi32_ps(quadrant);
+        __m128 r = _mm_sub_ps(v, _mm_mul_ps(q, _mm_set1_ps(Math::Fast::PIO2_HIGH)));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(Math::Fast::PIO2_MIDDLE)));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(Math::Fast::PIO2_LOW)));
+        const __m128 z = _mm_mul_ps(r, r);
+        const __m128 s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(Polynomial(z, sinCoefficients, 3), z), r), r);
+        __m128 c = _mm_mul_ps(_mm_mul_ps(Polynomial(z, cosCoefficients, 3), z), z);
+        c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+        const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+        if (sine != nullptr) {
+            const __m128 sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+            _mm_storeu_ps(sine + n, _mm_xor_ps(_mm_blendv_ps(s, c, swap), sign));
+        }
+        if (cosine != nullptr) {
+            const __m128 sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+            _mm_storeu_ps(cosine + n, _mm_xor_ps(_mm_blendv_ps(c, s, swap), sign));
+        }
+    }
+    FastMathScalar::SinCos(x + n, sine == nullptr ? nullptr : sine + n, cosine == nullptr ? nullptr : cosine + n,
+        count - n);
+}
+
+SSE4_TARGET void Atan2SSE4(const f32* y, const f32* x, f32* out, u32 count)
+{
+    const f32 coefficients[] = {Math::Fast::ATAN_C4, Math::Fast::ATAN_C3, Math::Fast::ATAN_C2, Math::Fast::ATAN_C1};
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const __m128 vy = _mm_loadu_ps(y + n);
+        const __m128 vx = _mm_loadu_ps(x + n);
+        const __m128 ax = _mm_andnot_ps(signBit, vx);
+        const __m128 ay = _mm_andnot_ps(signBit, vy);
+        const __m128 larger = _mm_max_ps(ax, ay);
+        const __m128 smaller = _mm_min_ps(ax, ay);
+        const __m128 ratio = _mm_and_ps(_mm_div_ps(smaller, larger), _mm_cmpgt_ps(larger, _mm_setzero_ps()));
+        const __m128 far = _mm_cmpgt_ps(ratio, _mm_set1_ps(Math::Fast::TAN_PI_8));
+        const __m128 u = _mm_blendv_ps(ratio, _mm_div_ps(_mm_sub_ps(ratio, one), _mm_add_ps(ratio, one)), far);
+        const __m128 z = _mm_mul_ps(u, u);
+        __m128 angle = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(Polynomial(z, coefficients, 4), z), u), u);
+        angle = _mm_blendv_ps(angle, _mm_add_ps(angle, _mm_set1_ps(Math::Fast::QUARTER_PI)), far);
+        angle = _mm_blendv_ps(angle, _mm_sub_ps(_mm_set1_ps(Math::HALF_PI), angle), _mm_cmpgt_ps(ay, ax));
+        // blendv picks by the sign bit, here the one of x
+        angle = _mm_blendv_ps(angle, _mm_sub_ps(_mm_set1_ps(Math::PI), angle), vx);
+        _mm_storeu_ps(out + n, _mm_or_ps(angle, _mm_and_ps(vy, signBit)));
+    }
+    FastMathScalar::Atan2(y + n, x + n, out + n, count - n);
+}
+
+// 2^n from the exponent bits, n within the normal exponents.
+SSE4_TARGET inline __m128 PowerOfTwoSSE4(__m128i n)
+{
+    return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(Math::Fast::EXPONENT_BIAS)),
+        Math::Fast::MANTISSA_BITS));
+}
+
+SSE4_TARGET void Exp2SSE4(const f32* x, f32* out, u32 count)
+{
+    const f32 coefficients[] = {Math::Fast::EXP2_C6, Math::Fast::EXP2_C5, Math::Fast::EXP2_C4, Math::Fast::EXP2_C3,
+        Math::Fast::EXP2_C2, Math::Fast::EXP2_C1};
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        __m128 v = _mm_max_ps(_mm_loadu_ps(x + n), _mm_set1_ps(Math::Fast::EXP2_MIN));
+        v = _mm_min_ps(v, _mm_set1_ps(Math::Fast::EXP2_MAX));
+        const __m128i power = RoundToIntSSE4(v);
+        const __m128 f = _mm_sub_ps(v, _mm_cvtepi32_ps(power));
+        const __m128 p = _mm_add_ps(_mm_mul_ps(Polynomial(f, coefficients, 6), f), _mm_set1_ps(1.0f));
+        // power / 2 rounded toward zero, like the scalar division
+        const __m128i half = _mm_srai_epi32(_mm_add_epi32(power, _mm_srli_epi32(power, 31)), 1);
+        const __m128 scaled = _mm_mul_ps(_mm_mul_ps(p, PowerOfTwoSSE4(half)), PowerOfTwoSSE4(_mm_sub_epi32(power, half)));
+        _mm_storeu_ps(out + n, scaled);
+    }
+    FastMathScalar::Exp2(x + n, out + n, count - n);
+}
+
+SSE4_TARGET void Log2SSE4(const f32* x, f32* out, u32 count)
+{
+    const f32 coefficients[] = {Math::Fast::LOG_C9, Math::Fast::LOG_C8, Math::Fast::LOG_C7, Math::Fast::LOG_C6,
+        Math::Fast::LOG_C5, Math::Fast::LOG_C4, Math::Fast::LOG_C3, Math::Fast::LOG_C2, Math::Fast::LOG_C1};
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 log2E = _mm_set1_ps(Math::Fast::LOG2_E_MINUS_ONE);
+    u32 n = 0;
+    for (; n + QUAD <= count; n += QUAD) {
+        const __m128i bits = _mm_castps_si128(_mm_loadu_ps(x + n));
+        __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(Math::Fast::MANTISSA_MASK)),
+            _mm_castps_si128(one)));
+        __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, Math::Fast::MANTISSA_BITS),
+            _mm_set1_epi32(Math::Fast::EXPONENT_BIAS)));
+        const __m128 high = _mm_cmpgt_ps(m, _mm_set1_ps(Math::Fast::SQRT_2));
+        m = _mm_blendv_ps(m, _mm_mul_ps(m, half), high);
+        e = _mm_blendv_ps(e, _mm_add_ps(e, one), high);
+        const __m128 f = _mm_sub_ps(m, one);
+        const __m128 z = _mm_mul_ps(f, f);
+        const __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(f, z), Polynomial(f, coefficients, 9)), _mm_mul_ps(half, z));
+        __m128 result = _mm_add_ps(_mm_mul_ps(y, log2E), _mm_mul_ps(f, log2E));
+        result = _mm_add_ps(_mm_add_ps(_mm_add_ps(result, y), f), e);
+        _mm_storeu_ps(out + n, result);
+    }
+    FastMathScalar::Log2(x + n, out + n, count - n);
+}
+
+// Two rows of a, or two vectors, per 256-bit register, with the rows of b in both halves.
+AVX2_TARGET inline __m256 PairTimes(__m256 pair, const __m256 b[MATRIX_ROWS])
+{
+    __m256 result = _mm256_mul_ps(_mm256_permute_ps(pair, 0x00), b[0]);
+    result = _mm256_fmadd_ps(_mm256_permute_ps(pair, 0x55), b[1], result);
+    result = _mm256_fmadd_ps(_mm256_permute_ps(pair, 0xAA), b[2], result);
+    return _mm256_fmadd_ps(_mm256_permute_ps(pair, 0xFF), b[3], result);
+}
+
+AVX2_TARGET inline void BroadcastRows(const f32* b, __m256 rows[MATRIX_ROWS])
+{
+    for (u32 row = 0; row < MATRIX_ROWS; row++) {
+        rows[row] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + row * MATRIX_ROWS));
+    }
+}
+
+AVX2_TARGET void MultiplyAVX2(const f32* a, const f32* b, u32 bStride, f32* out, u32 count)
+{
+    if (count == 0) {
+        return;
+    }
+    __m256 right[MATRIX_ROWS];
+    BroadcastRows(b, right);
+    for (u32 n = 0; n < count; n++, a += MATRIX_FLOATS, b += bStride, out += MATRIX_FLOATS) {
+        if (bStride != 0 && n != 0) {
+            BroadcastRows(b, right);
+        }
+        const __m256 top = PairTimes(_mm256_loadu_ps(a), right);
+        const __m256 bottom = PairTimes(_mm256_loadu_ps(a + 8), right);
+        _mm256_storeu_ps(out, top);
+        _mm256_storeu_ps(out + 8, bottom);
+    }
+}
+
+// One vector times the matrix held in the low halves of rows.
+AVX2_TARGET inline __m128 VectorTimes(__m128 v, const __m256 rows[MATRIX_ROWS])
+{
+    __m128 result = _mm_mul_ps(Splat<0>(v), _mm256_castps256_ps128(rows[0]));
+    result = _mm_fmadd_ps(Splat<1>(v), _mm256_castps256_ps128(rows[1]), result);
+    result = _mm_fmadd_ps(Splat<2>(v), _mm256_castps256_ps128(rows[2]), result);
+    return _mm_fmadd_ps(Splat<3>(v), _mm256_castps256_ps128(rows[3]), result);
+}
+
+AVX2_TARGET void TransformAVX2(const f32* matrix, u32 matrixStride, const f32* in, f32* out, u32 count)
+{
+    __m256 rows[MATRIX_ROWS];
+    if (matrixStride != 0) {
+        for (u32 n = 0; n < count; n++, matrix += matrixStride, in += VECTOR4_FLOATS, out += VECTOR4_FLOATS) {
+            BroadcastRows(matrix, rows);
+            _mm_storeu_ps(out, VectorTimes(_mm_loadu_ps(in), rows));
+        }
+        return;
+    }
+    const u32 pair = 2;
+    BroadcastRows(matrix, rows);
+    u32 n = 0;
+    for (; n + pair <= count; n += pair, in += pair * VECTOR4_FLOATS, out += pair * VECTOR4_FLOATS) {
+        _mm256_storeu_ps(out, PairTimes(_mm256_loadu_ps(in), rows));
+    }
+    if (n < count) {
+        _mm_storeu_ps(out, VectorTimes(_mm_loadu_ps(in), rows));
+    }
+}
+
+AVX2_TARGET void TransformVector3SoAAVX2(const f32* matrix, const f32* const in[VECTOR3_FLOATS],
+    f32* const out[VECTOR3_FLOATS], u32 count, f32 w)
+{
+    const u32 octet = 8;
+    __m256 m[VECTOR3_FLOATS][VECTOR3_FLOATS];
+    __m256 translation[VECTOR3_FLOATS];
+    for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+        for (u32 row = 0; row < VECTOR3_FLOATS; row++) {
+            m[row][col] = _mm256_set1_ps(matrix[row * MATRIX_ROWS + col]);
+        }
+        translation[col] = _mm256_set1_ps(w * matrix[(MATRIX_ROWS - 1) * MATRIX_ROWS + col]);
+    }
+    u32 n = 0;
+    for (; n + octet <= count; n += octet) {
+        const __m256 x = _mm256_loadu_ps(in[0] + n);
+        const __m256 y = _mm256_loadu_ps(in[1] + n);
+        const __m256 z = _mm256_loadu_ps(in[2] + n);
+        __m256 result[VECTOR3_FLOATS];
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            result[col] = _mm256_fmadd_ps(z, m[2][col], _mm256_fmadd_ps(y, m[1][col], _mm256_mul_ps(x, m[0][col])));
+            result[col] = _mm256_add_ps(result[col], translation[col]);
+        }
+        for (u32 col = 0; col < VECTOR3_FLOATS; col++) {
+            _mm256_storeu_ps(out[col] + n, result[col]);
+        }
+    }
+    const f32* const tailIn[VECTOR3_FLOATS] = {in[0] + n, in[1] + n, in[2] + n};
+    f32* const tailOut[VECTOR3_FLOATS] = {out[0] + n, out[1] + n, out[2] + n};
+    TransformVector3SoASSE4(matrix, tailIn, tailOut, count - n, w);
+}
+
+struct WideSplatPlane {
+    __m256 normal[VECTOR3_FLOATS];
+    __m256 distance;
+    __m256 absNormal[VECTOR3_FLOATS];
+};
+
+AVX2_TARGET inline void LoadPlane(const f32* plane, WideSplatPlane& splat)
+{
+    for (u32 i = 0; i < VECTOR3_FLOATS; i++) {
+        splat.normal[i] = _mm256_set1_ps(plane[i]);
+        splat.absNormal[i] = _mm256_set1_ps(fabsf(plane[i]));
+    }
+    splat.distance = _mm256_set1_ps(plane[VECTOR3_FLOATS]);
+}
+
+AVX2_TARGET inline __m256 InsideAVX2(const WideSplatPlane& plane, const f32* const boxes[BOX_FLOATS], u32 n)
+{
+    __m256 distance = _mm256_mul_ps(_mm256_loadu_ps(boxes[0] + n), plane.normal[0]);
+    distance = _mm256_fmadd_ps(_mm256_loadu_ps(boxes[1] + n), plane.normal[1], distance);
+    distance = _mm256_fmadd_ps(_mm256_loadu_ps(boxes[2] + n), plane.normal[2], distance);
+    __m256 radius = _mm256_mul_ps(_mm256_loadu_ps(boxes[3] + n), plane.absNormal[0]);
+    radius = _mm256_fmadd_ps(_mm256_loadu_ps(boxes[4] + n), plane.absNormal[1], radius);
+    radius = _mm256_fmadd_ps(_mm256_loadu_ps(boxes[5] + n), plane.absNormal[2], radius);
+    return _mm256_cmp_ps(_mm256_add_ps(_mm256_add_ps(distance, plane.distance), radius), _mm256_setzero_ps(),
+        _CMP_GE_OQ);
+}
+
+// CullBoxesSSE4 eight boxes per step.
+AVX2_TARGET void CullBoxesAVX2(const f32* planes, u32 planeCount, const f32* const boxes[BOX_FLOATS], u32* visible,
+    u32 count)
+{
+    const u32 octet = 8;
+    const u32 steps = MASK_BITS / octet;
+    u32 n = 0;
+    for (; n + MASK_BITS <= count; n += MASK_BITS) {
+        __m256 inside[steps];
+        for (u32 step = 0; step < steps; step++) {
+            inside[step] = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        }
+        for (u32 p = 0; p < planeCount; p++) {
+            WideSplatPlane plane;
+            LoadPlane(planes + p * PLANE_FLOATS, plane);
+            for (u32 step = 0; step < steps; step++) {
+                inside[step] = _mm256_and_ps(inside[step], InsideAVX2(plane, boxes, n + step * octet));
+            }
+        }
+        u32 bits = 0;
+        for (u32 step = 0; step < steps; step++) {
+            bits |= static_cast<u32>(_mm256_movemask_ps(inside[step])) << (step * octet);
+        }
+        visible[n / MASK_BITS] = bits;
+    }
+    const f32* const tail[BOX_FLOATS] = {boxes[0] + n, boxes[1] + n, boxes[2] + n, boxes[3] + n, boxes[4] + n,
+        boxes[5] + n};
+    MatrixScalar::CullBoxes(planes, planeCount, tail, visible + n / MASK_BITS, count - n);
+}
+
+AVX2_TARGET inline __m256 SlerpWeightAVX2(__m256 t, __m256 cosineMinusOne)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 squared = _mm256_mul_ps(t, t);
+    __m256 weight = one;
+    for (u32 i = SLERP_TERMS; i > 0; i--) {
+        const __m256 term = _mm256_fmsub_ps(_mm256_set1_ps(SLERP_U[i - 1]), squared, _mm256_set1_ps(SLERP_V[i - 1]));
+        weight = _mm256_fmadd_ps(_mm256_mul_ps(term, cosineMinusOne), weight, one);
+    }
+    return _mm256_mul_ps(weight, t);
+}
+
+// SlerpSSE4 eight quaternions per step, the polynomial is most of the work.
+AVX2_TARGET void SlerpAVX2(const f32* const a[VECTOR4_FLOATS], const f32* const b[VECTOR4_FLOATS], const f32* t,
+    u32 tStride, f32* const out[VECTOR4_FLOATS], u32 count)
+{
+    const u32 octet = 8;
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    u32 n = 0;
+    for (; n + octet <= count; n += octet) {
+        __m256 qa[VECTOR4_FLOATS];
+        __m256 qb[VECTOR4_FLOATS];
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            qa[i] = _mm256_loadu_ps(a[i] + n);
+            qb[i] = _mm256_loadu_ps(b[i] + n);
+        }
+        const __m256 tb = (tStride == 0) ? _mm256_set1_ps(*t) : _mm256_loadu_ps(t + n);
+        __m256 cosine = _mm256_mul_ps(qa[0], qb[0]);
+        for (u32 i = 1; i < VECTOR4_FLOATS; i++) {
+            cosine = _mm256_fmadd_ps(qa[i], qb[i], cosine);
+        }
+        const __m256 cosineMinusOne = _mm256_sub_ps(_mm256_andnot_ps(signBit, cosine), one);
+        const __m256 weightA = SlerpWeightAVX2(_mm256_sub_ps(one, tb), cosineMinusOne);
+        const __m256 negative = _mm256_and_ps(_mm256_cmp_ps(cosine, _mm256_setzero_ps(), _CMP_LT_OQ), signBit);
+        const __m256 weightB = _mm256_xor_ps(SlerpWeightAVX2(tb, cosineMinusOne), negative);
+        for (u32 i = 0; i < VECTOR4_FLOATS; i++) {
+            _mm256_storeu_ps(out[i] + n, _mm256_fmadd_ps(qa[i], weightA, _mm256_mul_ps(qb[i], weightB)));
+        }
+    }
+    const f32* const tailA[VECTOR4_FLOATS] = {a[0] + n, a[1] + n, a[2] + n, a[3] + n};
+    const f32* const tailB[VECTOR4_FLOATS] = {b[0] + n, b[1] + n, b[2] + n, b[3] + n};
+    f32* const tailOut[VECTOR4_FLOATS] = {out[0] + n, out[1] + n, out[2] + n, out[3] + n};
+    SlerpSSE4(tailA, tailB, t + n * tStride, tStride, tailOut, count - n);
+}
+
+// Math::Fast eight lanes at a time, with fused multiply-adds.
+AVX2_TARGET inline __m256i RoundToIntAVX2(__m256 f)
+{
+    const __m256 half = _mm256_or_ps(_mm256_and_ps(f, _mm256_set1_ps(-0.0f)), _mm256_set1_ps(0.5f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(f, half));
+}
+
+AVX2_TARGET inline __m256 Polynomial(__m256 x, const f32* coefficients, u32 count)
+{
+    __m256 result = _mm256_set1_ps(coefficients[0]);
+    for (u32 i = 1; i < count; i++) {
+        result = _mm256_fmadd_ps(result, x, _mm256_set1_ps(coefficients[i]));
+    }
+    return result;
+}
+
+AVX2_TARGET void ReciprocalSqrtAVX2(const f32* x, f32* out, u32 count)
+{
+    const u32 octet = 8;
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+    u32 n = 0;
+    for (; n + octet <= count; n += octet) {
+        const __m256 v = _mm256_loadu_ps(x + n);
+        const __m256 y = _mm256_rsqrt_ps(v);
+        const __m256 step = _mm256_fnmadd_ps(_mm256_mul_ps(_mm256_mul_ps(half, v), y), y, threeHalves);
+        _mm256_storeu_ps(out + n, _mm256_mul_ps(y, step));
+    }
+    ReciprocalSqrtSSE4(x + n, out + n, count - n);
+}
+
+AVX2_TARGET void SinCosAVX2(const f32* x, f32* sine, f32* cosine, u32 count)
+{
+    const u32 octet = 8;
+    const f32 sinCoefficients[] = {Math::Fast::SIN_C3, Math::Fast::SIN_C2, Math::Fast::SIN_C1};
+    const f32 cosCoefficients[] = {Math::Fast::COS_C3, Math::Fast::COS_C2, Math::Fast::COS_C1};
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    u32 n = 0;
+    for (; n + octet <= count; n += octet) {
+        const __m256 v = _mm256_loadu_ps(x + n);
+        const __m256i quadrant = RoundToIntAVX2(_mm256_mul_ps(v, _mm256_set1_ps(Math::Fast::TWO_OVER_PI)));
+        const __m256 q = _mm256_cvtepi32_ps(quadrant);
+        __m256 r = _mm256_fnmadd_ps(q, _mm256_set1_ps(Math::Fast::PIO2_HIGH), v);
+        r = _mm256_fnmadd_ps(q, _mm256_set1_ps(Math::Fast::PIO2_MIDDLE), r);
+        r = _mm256_fnmadd_ps(q, _mm256_set1_ps(Math::Fast::PIO2_LOW), r);
+        const __m256 z = _mm256_mul_ps(r, r);
+        const __m256 s = _mm256_fmadd_ps(_mm256_mul_ps(Polynomial(z, sinCoefficients, 3), z), r, r);
+        __m256 c = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, _mm256_mul_ps(_mm256_mul_ps(Polynomial(z, cosCoefficients,
+            3), z), z));
+        c = _mm256_add_ps(c, _mm256_set1_ps(1.0f));
+        const __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+        if (sine != nullptr) {
+            const __m256 sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+            _mm256_storeu_ps(sine + n, _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sign));
+        }
+        if (cosine != nullptr) {
+            const __m256 sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, one),
+                two), 30));
+            _mm256_storeu_ps(cosine + n, _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), sign));
+        }
+    }
+    SinCosSSE4(x + n, sine == nullptr ? nullptr : sine + n, cosine == nullptr ? nullptr : cosine + n, count - n);
+}
+
+AVX2_TARGET void Atan2AVX2(const f32* y, const f32* x, f32* out, u32 count)
+{
+    const u32 octet = 8;
+    const f32 coefficients[] = {Math::Fast::ATAN_C4, Math::Fast::ATAN_C3, Math::Fast::ATAN_C2, Math::Fast::ATAN_C1};
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    u32 n = 0;
+    for (; n + octet <= count; n += octet) {
+        const __m256 vy = _mm256_loadu_ps(y + n);
+        const __m256 vx = _mm256_loadu_ps(x + n);
+        const __m256 ax = _mm256_andnot_ps(signBit, vx);
+        const __m256 ay = _mm256_andnot_ps(signBit, vy);
+        const __m256 larger = _mm256_max_ps(ax, ay);
+        const __m256 smaller = _mm256_min_ps(ax, ay);
+        const __m256 ratio = _mm256_and_ps(_mm256_div_ps(smaller, larger),
+            _mm256_cmp_ps(larger, _mm256_setzero_ps(), _CMP_GT_OQ));
+        const __m256 far = _mm256_cmp_ps(ratio, _mm256_set1_ps(Math::Fast::TAN_PI_8), _CMP_GT_OQ);
+        const __m256 u = _mm256_blendv_ps(ratio, _mm256_div_ps(_mm256_sub_ps(ratio, one), _mm256_add_ps(ratio, one)),
+            far);
+        const __m256 z = _mm256_mul_ps(u, u);
+        __m256 angle = _mm256_fmadd_ps(_mm256_mul_ps(Polynomial(z, coefficients, 4), z), u, u);
+        angle = _mm256_blendv_ps(angle, _mm256_add_ps(angle, _mm256_set1_ps(Math::Fast::QUARTER_PI)), far);
+        angle = _mm256_blendv_ps(angle, _mm256_sub_ps(_mm256_set1_ps(Math::HALF_PI), angle),
+            _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+        angle = _mm256_blendv_ps(angle, _mm256_sub_ps(_mm256_set1_ps(Math::PI), angle), vx);
+        _mm256_storeu_ps(out + n, _mm256_or_ps(angle, _mm256_and_ps(vy, signBit)));
+    }
+    Atan2SSE4(y + n, x + n, out + n, count - n);
+}
+
+AVX2_TARGET inline __m256 PowerOfTwoAVX2(__m256i n)
+{
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(Math::Fast::EXPONENT_BIAS)),
+        Math::Fast::MANTISSA_BITS));
+}
+
+AVX2_TARGET void Exp2AVX2(const f32* x, f32* out, u32 count)
+{
+    const u32 octet = 8;
+    const f32 coefficients[] = {Math::Fast::EXP2_C6, Math::Fast::EXP2_C5, Math::Fast::EXP2_C4, Math::Fast::EXP2_C3,
+        Math::Fast::EXP2_C2, Math::Fast::EXP2_C1};
+    u32 n = 0;
+    for (; n + octet <= count; n += octet) {
+        __m256 v = _mm256_max_ps(_mm256_loadu_ps(x + n), _mm256_set1_ps(Math::Fast::EXP2_MIN));
+        v = _mm256_min_ps(v, _mm256_set1_ps(Math::Fast::EXP2_MAX));
+        const __m256i power = RoundToIntAVX2(v);
+        const __m256 f = _mm256_sub_ps(v, _mm256_cvtepi32_ps(power));
+        const __m256 p = _mm256_fmadd_ps(Polynomial(f, coefficients, 6), f, _mm256_set1_ps(1.0f));
+        const __m256i half = _mm256_srai_epi32(_mm256_add_epi32(power, _mm256_srli_epi32(power, 31)), 1);
+        const __m256 scaled = _mm256_mul_ps(_mm256_mul_ps(p, PowerOfTwoAVX2(half)),
+            PowerOfTwoAVX2(_mm256_sub_epi32(power, half)));
+        _mm256_storeu_ps(out + n, scaled);
+    }
+    Exp2SSE4(x + n, out + n, count - n);
+}
+
+AVX2_TARGET void Log2AVX2(const f32* x, f32* out, u32 count)
+{
+    const u32 octet = 8;
+    const f32 coefficients[] = {Math::Fast::LOG_C9, Math::Fast::LOG_C8, Math::Fast::LOG_C7, Math::Fast::LOG_C6,
+        Math::Fast::LOG_C5, Math::Fast::LOG_C4, Math::Fast::LOG_C3, Math::Fast::LOG_C2, Math::Fast::LOG_C1};
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 log2E = _mm256_set1_ps(Math::Fast::LOG2_E_MINUS_ONE);
+    u32 n = 0;
+    for (; n + octet <= count; n += octet) {
+        const __m256i bits = _mm256_castps_si256(_mm256_loadu_ps(x + n));
+        __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits,
+            _mm256_set1_epi32(Math::Fast::MANTISSA_MASK)), _mm256_castps_si256(one)));
+        __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, Math::Fast::MANTISSA_BITS),
+            _mm256_set1_epi32(Math::Fast::EXPONENT_BIAS)));
+        const __m256 high = _mm256_cmp_ps(m, _mm256_set1_ps(Math::Fast::SQRT_2), _CMP_GT_OQ);
+        m = _mm256_blendv_ps(m, _mm256_mul_ps(m, half), high);
+        e = _mm256_blendv_ps(e, _mm256_add_ps(e, one), high);
+        const __m256 f = _mm256_sub_ps(m, one);
+        const __m256 z = _mm256_mul_ps(f, f);
+        const __m256 y = _mm256_fmsub_ps(_mm256_mul_ps(f, z), Polynomial(f, coefficients, 9), _mm256_mul_ps(half, z));
+        __m256 result = _mm256_fmadd_ps(y, log2E, _mm256_mul_ps(f, log2E));
+        result = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(result, y), f), e);
+        _mm256_storeu_ps(out + n, result);
+    }
+    Log2SSE4(x + n, out + n, count - n);
+}
+}
+
+namespace CGKit {
+bool GetSSE4MatrixKernels(MatrixKernels& kernels)
+{
+    if (!__builtin_cpu_supports("sse4.1")) {
+        return false;
+    }
+    kernels.multiply = MultiplySSE4;
+    kernels.transpose = TransposeSSE4;
+    kernels.inverse = InverseSSE4;
+    kernels.inverseAffine = InverseAffineSSE4;
+    kernels.inverseRigid = InverseRigidSSE4;
+    kernels.normalMatrix = NormalMatrixSSE4;
+    kernels.transform = TransformSSE4;
+    kernels.transformVector3 = TransformVector3SSE4;
+    kernels.transformVector3SoA = TransformVector3SoASSE4;
+    kernels.transformBox = TransformBoxSSE4;
+    kernels.bounds = BoundsSSE4;
+    kernels.cullBoxes = CullBoxesSSE4;
+    kernels.makeTransform = MakeTransformSSE4;
+    kernels.makeTransformSoA = MakeTransformSoASSE4;
+    kernels.nlerp = NlerpSSE4;
+    kernels.slerp = SlerpSSE4;
+    return true;
+}
+
+bool GetAVX2MatrixKernels(MatrixKernels& kernels)
+{
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma") || !GetSSE4MatrixKernels(kernels)) {
+        return false;
+    }
+    // transpose, the inverses, MakeTransform and the packed Vector3 and box transforms stay on SSE4, they
+    // are bound by shuffles within 128-bit lanes, and so does nlerp, which is bound by its loads
+    kernels.multiply = MultiplyAVX2;
+    kernels.transform = TransformAVX2;
+    kernels.transformVector3SoA = TransformVector3SoAAVX2;
+    kernels.cullBoxes = CullBoxesAVX2;
+    kernels.slerp = SlerpAVX2;
+    return true;
+}
+
+bool GetSSE4FastMathKernels(FastMathKernels& kernels)
+{
+    if (!__builtin_cpu_supports("sse4.1")) {
+        return false;
+    }
+    kernels.reciprocalSqrt = ReciprocalSqrtSSE4;
+    kernels.sinCos = SinCosSSE4;
+    kernels.atan2 = Atan2SSE4;
+    kernels.exp2 = Exp2SSE4;
+    kernels.log2 = Log2SSE4;
+    return true;
+}
+
+bool GetAVX2FastMathKernels(FastMathKernels& kernels)
+{
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma") || !GetSSE4FastMathKernels(kernels)) {
+        return false;
+    }
+    kernels.reciprocalSqrt = ReciprocalSqrtAVX2;
+    kernels.sinCos = SinCosAVX2;
+    kernels.atan2 = Atan2AVX2;
+    kernels.exp2 = Exp2AVX2;
+    kernels.log2 = Log2AVX2;
+    return true;
+}
+}  // namespace CGKit
+#else
+namespace CGKit {
+bool GetSSE4MatrixKernels(MatrixKernels&)
+{
+    return false;
+}
+
+bool GetAVX2MatrixKernels(MatrixKernels&)
+{
+    return false;
+}
+
+bool GetSSE4FastMathKernels(FastMathKernels&)
+{
+    return false;
+}
+
+bool GetAVX2FastMathKernels(FastMathKernels&)
+{
+    return false;
+}
+}  // namespace CGKit
+#endif
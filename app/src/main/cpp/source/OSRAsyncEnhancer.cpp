@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Asynchronous image enhancing on top of an OSRSession.
+ */
+
+#define CGKIT_LOG
+#include "OSRPlugin/OSRAsyncEnhancer.h"
+
+using namespace std;
+using namespace CGKit;
+
+OSRAsyncEnhancer::OSRAsyncEnhancer(OSRSession& session) : m_session(session)
+{
+    m_worker = thread(&OSRAsyncEnhancer::WorkerLoop, this);
+}
+
+OSRAsyncEnhancer::~OSRAsyncEnhancer()
+{
+    CancelAll();
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    m_worker.join();
+}
+
+OSRAsyncRequest OSRAsyncEnhancer::EnhanceAsync(const BufferDescriptor& inBuffer, const BufferDescriptor& outBuffer,
+    OSRCallback callback, u32 deadlineMs)
+{
+    OSRAsyncRequest handle;
+    shared_ptr<Request> request = make_shared<Request>();
+    request->inBuffer = inBuffer;
+    request->outBuffer = outBuffer;
+    request->callback = callback;
+    request->deadline = chrono::steady_clock::now() + chrono::milliseconds(deadlineMs);
+    request->cancelled = false;
+    handle.result = request->promise.get_future().share();
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (!m_stop) {
+            request->id = m_nextId++;
+            handle.id = request->id;
+            m_queue.push_back(request);
+            m_wakeUp.notify_one();
+            return handle;
+        }
+    }
+    Complete(*request, OSR_REQUEST_CANCELLED);
+    return handle;
+}
+
+bool OSRAsyncEnhancer::Cancel(u64 id)
+{
+    shared_ptr<Request> queued;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_running != nullptr && m_running->id == id) {
+            m_running->cancelled = true;
+            return true;
+        }
+        auto it = find_if(m_queue.begin(), m_queue.end(),
+            [id](const shared_ptr<Request>& request) { return request->id == id; });
+        if (it == m_queue.end()) {
+            return false;
+        }
+        queued = *it;
+        m_queue.erase(it);
+    }
+    Complete(*queued, OSR_REQUEST_CANCELLED);
+    return true;
+}
+
+void OSRAsyncEnhancer::CancelAll()
+{
+    deque<shared_ptr<Request>> queued;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_running != nullptr) {
+            m_running->cancelled = true;
+        }
+        queued.swap(m_queue);
+    }
+    for (shared_ptr<Request>& request : queued) {
+        Complete(*request, OSR_REQUEST_CANCELLED);
+    }
+}
+
+u32 OSRAsyncEnhancer::GetInFlightCount()
+{
+    lock_guard<mutex> lock(m_mutex);
+    return static_cast<u32>(m_queue.size()) + (m_running != nullptr ? 1 : 0);
+}
+
+void OSRAsyncEnhancer::WorkerLoop()
+{
+    unique_lock<mutex> lock(m_mutex);
+    while (true) {
+        m_wakeUp.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return;
+        }
+        shared_ptr<Request> request = m_queue.front();
+        m_queue.pop_front();
+
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (request->deadline <= now) {
+            lock.unlock();
+            LOGWARNING("OSR request %llu expired before it started", static_cast<unsigned long long>(request->id));
+            Complete(*request, OSR_REQUEST_TIMED_OUT);
+            lock.lock();
+            continue;
+        }
+        m_running = request;
+        lock.unlock();
+
+        // round up so that a request with time left never reaches the plugin with a zero timeout
+        u32 timeOut = static_cast<u32>(chrono::duration_cast<chrono::milliseconds>(
+            request->deadline - now + chrono::microseconds(999)).count());
+        bool success = m_session.ImageEnhancingSync(request->inBuffer, request->outBuffer, timeOut);
+
+        lock.lock();
+        m_running.reset();
+        bool cancelled = request->cancelled;
+        lock.unlock();
+
+        OSRRequestStatus status = OSR_REQUEST_DONE;
+        if (cancelled) {
+            status = OSR_REQUEST_CANCELLED;
+        } else if (!success) {
+            status = chrono::steady_clock::now() >= request->deadline ? OSR_REQUEST_TIMED_OUT : OSR_REQUEST_FAILED;
+        }
+        Complete(*request, status);
+        lock.lock();
+    }
+}
+
+void OSRAsyncEnhancer::Complete(Request& request, OSRRequestStatus status)
+{
+    if (request.callback) {
+        request.callback(status, request.inBuffer, request.outBuffer);
+    }
+    request.promise.set_value(status);
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Recycling allocator for plugin image buffers.
+ */
+
+#define CGKIT_LOG
+#include <algorithm>
+#include <cstdlib>
+#include <sys/mman.h>
+#include "Log/Log.h"
+#include "OSRPlugin/OSRBufferPool.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+// size classes per power of two
+constexpr u32 SUB_CLASSES = 4;
+constexpr u32 SIZE_CLASS_COUNT = 33 * SUB_CLASSES;
+constexpr u64 HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+}
+
+// Sits in front of the pixels, padded to ALIGNMENT so that the pixels stay aligned.
+struct alignas(OSRBufferPool::ALIGNMENT) OSRBufferPool::Block {
+    u32 sizeClass;
+    u64 classBytes;
+    /** bytes taken from the system, header included */
+    u64 footprint;
+    bool mapped;
+    bool inUse;
+};
+
+OSRBufferPool::OSRBufferPool(const OSRBufferPoolConfig& config) : m_config(config), m_freeLists(SIZE_CLASS_COUNT) {}
+
+OSRBufferPool::~OSRBufferPool()
+{
+    Trim();
+    if (m_stats.inUseBytes != 0) {
+        LOGERROR("Buffer pool destroyed with %llu bytes still in use",
+                 static_cast<unsigned long long>(m_stats.inUseBytes));
+    }
+}
+
+u32 OSRBufferPool::GetSizeClass(u64 len, u64& classBytes)
+{
+    len = max<u64>(len, ALIGNMENT);
+    u32 exponent = 0;
+    while ((len >> (exponent + 1)) != 0) {
+        exponent++;
+    }
+    u64 step = (1ull << exponent) / SUB_CLASSES;
+    classBytes = (len + step - 1) / step * step;
+    return exponent * SUB_CLASSES + static_cast<u32>((classBytes - (1ull << exponent)) / step);
+}
+
+OSRBufferPool::Block* OSRBufferPool::Allocate(u32 sizeClass, u64 classBytes)
+{
+    u64 footprint = classBytes + sizeof(Block);
+    void* memory = nullptr;
+    bool mapped = m_config.hugePages && footprint >= HUGE_PAGE_SIZE;
+    if (mapped) {
+        footprint = (footprint + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        memory = mmap(nullptr, footprint, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(memory, footprint, MADV_HUGEPAGE);
+#endif
+    } else if (posix_memalign(&memory, ALIGNMENT, footprint) != 0) {
+        return nullptr;
+    }
+    Block* block = static_cast<Block*>(memory);
+    block->sizeClass = sizeClass;
+    block->classBytes = classBytes;
+    block->footprint = footprint;
+    block->mapped = mapped;
+    block->inUse = false;
+    m_blocks.insert(lower_bound(m_blocks.begin(), m_blocks.end(), block), block);
+    m_stats.residentBytes += footprint;
+    return block;
+}
+
+void OSRBufferPool::Free(Block* block)
+{
+    m_blocks.erase(lower_bound(m_blocks.begin(), m_blocks.end(), block));
+    m_stats.residentBytes -= block->footprint;
+    if (block->mapped) {
+        munmap(block, block->footprint);
+    } else {
+        free(block);
+    }
+}
+
+bool OSRBufferPool::Acquire(BufferDescriptor& buffer, u32 len)
+{
+    if (len == 0) {
+        return false;
+    }
+    u64 classBytes = 0;
+    u32 sizeClass = GetSizeClass(len, classBytes);
+    Block* block = nullptr;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        vector<Block*>& freeList = m_freeLists[sizeClass];
+        if (!freeList.empty()) {
+            block = freeList.back();
+            freeList.pop_back();
+            m_cachedBytes -= block->classBytes;
+            m_stats.hits++;
+        } else {
+            block = Allocate(sizeClass, classBytes);
+            if (block == nullptr) {
+                LOGERROR("Buffer pool failed to allocate %llu bytes", static_cast<unsigned long long>(classBytes));
+                return false;
+            }
+            m_stats.misses++;
+        }
+        block->inUse = true;
+        m_stats.inUseBytes += block->classBytes;
+        buffer.addr = static_cast<void*>(reinterpret_cast<u8*>(block) + sizeof(Block));
+    }
+    buffer.len = static_cast<int>(len);
+    return true;
+}
+
+bool OSRBufferPool::Release(BufferDescriptor& buffer)
+{
+    if (buffer.addr == nullptr) {
+        return false;
+    }
+    lock_guard<mutex> lock(m_mutex);
+    // the header is only read once the registry shows the pool owns it, foreign pointers never are
+    Block* block = reinterpret_cast<Block*>(static_cast<u8*>(buffer.addr) - sizeof(Block));
+    auto it = lower_bound(m_blocks.begin(), m_blocks.end(), block);
+    if (it == m_blocks.end() || *it != block || !block->inUse) {
+        return false;
+    }
+    block->inUse = false;
+    m_stats.inUseBytes -= block->classBytes;
+    if (m_cachedBytes + block->classBytes > m_config.maxCachedBytes) {
+        Free(block);
+    } else {
+        m_freeLists[block->sizeClass].push_back(block);
+        m_cachedBytes += block->classBytes;
+    }
+    buffer.addr = nullptr;
+    return true;
+}
+
+void OSRBufferPool::Trim()
+{
+    lock_guard<mutex> lock(m_mutex);
+    for (vector<Block*>& freeList : m_freeLists) {
+        for (Block* block : freeList) {
+            Free(block);
+        }
+        freeList.clear();
+    }
+    m_cachedBytes = 0;
+}
+
+OSRBufferPoolStats OSRBufferPool::GetStats()
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_stats;
+}
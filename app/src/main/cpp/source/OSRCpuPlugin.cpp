@@ -0,0 +1,548 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: CPU implementation of the OfflineSupRes image enhancing.
+ */
+
+#define CGKIT_LOG
+#include <cmath>
+#include "Log/Log.h"
+#include "MathKernels/FastMath.h"
+#include "OSRPlugin/OSRCpuPlugin.h"
+#include "OSRPlugin/PixelConverter.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+// rows per unit of work, small enough to balance the workers and keep the source rows cached
+constexpr u32 BAND_ROWS = 32;
+constexpr f32 DEFAULT_SHARPNESS = 0.9f;
+constexpr f32 DEFAULT_MS_PER_MEGA_PIXEL = 4.0f;
+// per output megapixel, until the first image has been measured
+constexpr f32 DEFAULT_UPSCALE_MS_PER_MEGA_PIXEL[OSR_UPSCALE_MODE_MAX] = {10.0f, 6.0f};
+constexpr f32 PIXELS_PER_MEGA = 1000000.0f;
+constexpr u32 ALPHA_CHANNELS = 4;
+constexpr u32 LUMA_CHANNELS = 3;
+
+BufferDescriptor* GetBuffer(const Param& param, u32 idx)
+{
+    if (!param.IsArray() || param.ArrayLen() <= idx || !param.Get(idx).IsPointer()) {
+        return nullptr;
+    }
+    return static_cast<BufferDescriptor*>(const_cast<void*>(param.Get(idx).Get()));
+}
+
+u32 GetChannels(PixelFormat format)
+{
+    switch (format) {
+        case PIXEL_FORMAT_R8_UNORM:
+            return 1;
+        case PIXEL_FORMAT_R8G8B8_UNORM:
+            return 3;
+        case PIXEL_FORMAT_R8G8B8A8_UNORM:
+            return ALPHA_CHANNELS;
+        default:
+            return 0;
+    }
+}
+
+bool IsValid(const BufferDescriptor* buffer)
+{
+    u32 channels = buffer != nullptr ? GetChannels(buffer->format) : 0;
+    return channels != 0 && buffer->addr != nullptr && buffer->width > 0 && buffer->height > 0 &&
+        static_cast<u64>(buffer->len) >= static_cast<u64>(buffer->width) * buffer->height * channels;
+}
+
+/*
+ * ACES filmic curve (Narkowicz fit) scaled so that white stays white, it lifts the mid tones and rolls
+ * off the highlights.
+ */
+struct ToneTable {
+    u8 values[256];
+
+    ToneTable()
+    {
+        const f32 a = 2.51f;
+        const f32 b = 0.03f;
+        const f32 c = 2.43f;
+        const f32 d = 0.59f;
+        const f32 e = 0.14f;
+        auto curve = [&](f32 x) {
+            return (x * (a * x + b)) / (x * (c * x + d) + e);
+        };
+        const f32 white = curve(1.0f);
+        for (u32 i = 0; i < 256; i++) {
+            f32 mapped = curve(i / 255.0f) / white;
+            values[i] = static_cast<u8>(min(255.0f, max(0.0f, roundf(mapped * 255.0f))));
+        }
+    }
+};
+
+const ToneTable& GetToneTable()
+{
+    static const ToneTable table;
+    return table;
+}
+
+struct KernelTables {
+    EnhanceKernels kernels[PIXEL_ISA_MAX];
+
+    KernelTables()
+    {
+        for (u32 isa = 0; isa < PIXEL_ISA_MAX; isa++) {
+            kernels[isa] = {EnhanceScalar::BlurColumn, EnhanceScalar::SharpenRow, EnhanceScalar::ResampleColumn,
+                EnhanceScalar::SquaredError, EnhanceScalar::SsimWindow};
+        }
+        GetSSE4EnhanceKernels(kernels[PIXEL_ISA_SSE4]);
+        GetAVX2EnhanceKernels(kernels[PIXEL_ISA_AVX2]);
+        GetNEONEnhanceKernels(kernels[PIXEL_ISA_NEON]);
+    }
+};
+
+f32 Lanczos3(f32 t)
+{
+    const f32 pi = 3.14159265358979f;
+    const f32 radius = 3.0f;
+    t = fabsf(t);
+    if (t < 1e-6f) {
+        return 1.0f;
+    }
+    if (t >= radius) {
+        return 0.0f;
+    }
+    f32 x = pi * t;
+    return radius * Math::Fast::Sin(x) * Math::Fast::Sin(x / radius) / (x * x);
+}
+
+/*
+ * Lanczos taps of every output position along one axis. offsets are input positions clamped to the
+ * image, weights are LANCZOS_WEIGHT_SHIFT fixed point and sum to exactly one.
+ */
+struct LanczosAxis {
+    std::vector<u32> offsets;
+    std::vector<s16> weights;
+
+    LanczosAxis(u32 inSize, u32 outSize, u32 stride) : offsets(outSize * LANCZOS_TAPS), weights(outSize * LANCZOS_TAPS)
+    {
+        const s32 one = 1 << LANCZOS_WEIGHT_SHIFT;
+        const s32 firstTap = static_cast<s32>(LANCZOS_TAPS / 2) - 1;
+        const f32 step = static_cast<f32>(inSize) / outSize;
+        for (u32 o = 0; o < outSize; o++) {
+            f32 center = (o + 0.5f) * step - 0.5f;
+            s32 first = static_cast<s32>(floorf(center)) - firstTap;
+            f32 taps[LANCZOS_TAPS];
+            f32 sum = 0.0f;
+            for (u32 k = 0; k < LANCZOS_TAPS; k++) {
+                taps[k] = Lanczos3(center - (first + static_cast<s32>(k)));
+                sum += taps[k];
+            }
+            s32 total = 0;
+            u32 largest = 0;
+            for (u32 k = 0; k < LANCZOS_TAPS; k++) {
+                s32 weight = static_cast<s32>(roundf(taps[k] / sum * one));
+                weights[o * LANCZOS_TAPS + k] = static_cast<s16>(weight);
+                total += weight;
+                largest = taps[k] > taps[largest] ? k : largest;
+                s32 position = min(static_cast<s32>(inSize) - 1, max(0, first + static_cast<s32>(k)));
+                offsets[o * LANCZOS_TAPS + k] = static_cast<u32>(position) * stride;
+            }
+            weights[o * LANCZOS_TAPS + largest] += static_cast<s16>(one - total);
+        }
+    }
+};
+
+// Horizontal Lanczos pass of one row, the channel count is a template argument so the tap loops unroll.
+template <u32 CHANNELS>
+void ResampleRow(const u8* src, const LanczosAxis& axis, s16* dst, u32 outWidth)
+{
+    const s32 shift = LANCZOS_WEIGHT_SHIFT - LANCZOS_FRACTION_SHIFT;
+    for (u32 x = 0; x < outWidth; x++) {
+        const u32* offsets = &axis.offsets[x * LANCZOS_TAPS];
+        const s16* weights = &axis.weights[x * LANCZOS_TAPS];
+        s32 sums[CHANNELS];
+        for (u32 c = 0; c < CHANNELS; c++) {
+            sums[c] = 1 << (shift - 1);
+        }
+        for (u32 k = 0; k < LANCZOS_TAPS; k++) {
+            const u8* pixel = src + offsets[k];
+            for (u32 c = 0; c < CHANNELS; c++) {
+                sums[c] += weights[k] * pixel[c];
+            }
+        }
+        for (u32 c = 0; c < CHANNELS; c++) {
+            dst[x * CHANNELS + c] = static_cast<s16>(sums[c] >> shift);
+        }
+    }
+}
+
+u32 Luma(const u8* pixel, u32 channels)
+{
+    u32 sum = 0;
+    for (u32 c = 0; c < min(channels, LUMA_CHANNELS); c++) {
+        sum += pixel[c];
+    }
+    return sum;
+}
+
+/*
+ * Fills dst from the pixel pairs (p, q) and (r, s) that lie on two crossing lines through it. The pair
+ * with the clearly smaller difference runs along an edge and is averaged alone, otherwise all four are.
+ */
+void InterpolateEdge(const u8* p, const u8* q, const u8* r, const u8* s, u8* dst, u32 channels)
+{
+    const u32 dominance = 2;
+    u32 lp = Luma(p, channels);
+    u32 lq = Luma(q, channels);
+    u32 lr = Luma(r, channels);
+    u32 ls = Luma(s, channels);
+    u32 first = lp > lq ? lp - lq : lq - lp;
+    u32 second = lr > ls ? lr - ls : ls - lr;
+    for (u32 c = 0; c < channels; c++) {
+        if (dominance * first < second) {
+            dst[c] = static_cast<u8>((p[c] + q[c] + 1) >> 1);
+        } else if (dominance * second < first) {
+            dst[c] = static_cast<u8>((r[c] + s[c] + 1) >> 1);
+        } else {
+            dst[c] = static_cast<u8>((p[c] + q[c] + r[c] + s[c] + 2) >> 2);
+        }
+    }
+}
+}
+
+namespace CGKit {
+const EnhanceKernels& GetEnhanceKernels()
+{
+    static const KernelTables tables;
+    return tables.kernels[PixelConverter::GetIsa()];
+}
+
+namespace EnhanceScalar {
+void BlurColumn(const u8* const rows[BLUR_TAPS], u16* columns, u32 count)
+{
+    const u32 inner = 4;
+    const u32 center = 6;
+    for (u32 i = 0; i < count; i++) {
+        columns[i] = static_cast<u16>(rows[0][i] + rows[4][i] + inner * (rows[1][i] + rows[3][i]) +
+            center * rows[2][i]);
+    }
+}
+
+void SharpenRow(const u8* src, const u16* columns, u8* dst, u32 count, u32 channels, s32 amount)
+{
+    const u32 inner = 4;
+    const u32 center = 6;
+    // the blur weights sum to 16 per direction, so the blurred value is the sum divided by 256
+    const u32 blurShift = 8;
+    const u32 c1 = channels;
+    const u32 c2 = channels * BLUR_RADIUS;
+    for (u32 i = 0; i < count; i++) {
+        const u16* p = columns + i;
+        u32 sum = p[-static_cast<s32>(c2)] + p[c2] + inner * (p[-static_cast<s32>(c1)] + p[c1]) + center * p[0];
+        s32 blur = static_cast<s32>((sum + (1u << (blurShift - 1))) >> blurShift);
+        s32 delta = ((src[i] - blur) * amount + (1 << (SHARPEN_SHIFT - 1))) >> SHARPEN_SHIFT;
+        dst[i] = static_cast<u8>(min(255, max(0, src[i] + delta)));
+    }
+}
+
+void ResampleColumn(const s16* const rows[LANCZOS_TAPS], const s16* weights, u8* dst, u32 count)
+{
+    const s32 shift = LANCZOS_WEIGHT_SHIFT + LANCZOS_FRACTION_SHIFT;
+    for (u32 i = 0; i < count; i++) {
+        s32 sum = 1 << (shift - 1);
+        for (u32 k = 0; k < LANCZOS_TAPS; k++) {
+            sum += weights[k] * rows[k][i];
+        }
+        dst[i] = static_cast<u8>(min(255, max(0, sum >> shift)));
+    }
+}
+}
+}  // namespace CGKit
+
+OSRCpuPlugin::OSRCpuPlugin(u32 workers, u32 scale)
+    : m_scale(scale > 0 ? scale : 1), m_upscaleMode(OSR_UPSCALE_LANCZOS3), m_pool(workers),
+      m_msPerMegaPixel(DEFAULT_MS_PER_MEGA_PIXEL)
+{
+    for (u32 mode = 0; mode < OSR_UPSCALE_MODE_MAX; mode++) {
+        m_upscaleMsPerMegaPixel[mode] = DEFAULT_UPSCALE_MS_PER_MEGA_PIXEL[mode];
+    }
+}
+
+OSRCpuPlugin::~OSRCpuPlugin() {}
+
+const String& OSRCpuPlugin::GetPluginInfo() const
+{
+    return m_info;
+}
+
+bool OSRCpuPlugin::Initialize()
+{
+    return true;
+}
+
+void OSRCpuPlugin::Uninitialize() {}
+
+bool OSRCpuPlugin::IsSupported(PixelFormat format)
+{
+    return GetChannels(format) != 0;
+}
+
+bool OSRCpuPlugin::Execute(const Param& paramIn, Param& paramOut)
+{
+    if (!paramIn.IsArray() || paramIn.ArrayLen() == 0 || !paramIn.Get(0).IsInt()) {
+        return false;
+    }
+    switch (paramIn.Get(0).Get<s32>()) {
+        case SET_ASSETS_DIR:
+            return true;
+        case QUERY_SUPER_SAMPLING:
+            return Query(paramIn, paramOut, m_scale);
+        case QUERY_IMAGE_ENHANCING:
+            return Query(paramIn, paramOut, 1);
+        case SYNC_SUPER_SAMPLING:
+            return UpscaleImage(paramIn, paramOut);
+        case SYNC_IMAGE_ENHANCING:
+            return EnhanceImage(paramIn, paramOut);
+        default:
+            return false;
+    }
+}
+
+bool OSRCpuPlugin::Query(const Param& paramIn, const Param& paramOut, u32 scale)
+{
+    const u32 argCount = 4;
+    if (paramIn.ArrayLen() < argCount || !paramOut.IsArray() || paramOut.ArrayLen() == 0) {
+        return false;
+    }
+    PluginConfig* config = static_cast<PluginConfig*>(const_cast<void*>(paramOut.Get(0).Get()));
+    PixelFormat format = static_cast<PixelFormat>(paramIn.Get(3).Get<s32>());
+    if (config == nullptr || !IsSupported(format)) {
+        return false;
+    }
+    config->input.width = paramIn.Get(1).Get<s32>();
+    config->input.height = paramIn.Get(2).Get<s32>();
+    config->input.format = format;
+    config->output.width = config->input.width * scale;
+    config->output.height = config->input.height * scale;
+    config->output.format = format;
+    f32 megaPixels = static_cast<f32>(config->output.width) * config->output.height / PIXELS_PER_MEGA;
+    if (scale == 1) {
+        config->estimatedCostTime = m_msPerMegaPixel * megaPixels;
+        return true;
+    }
+    OSRUpscaleMode mode = (scale == 2) ? m_upscaleMode.load() : OSR_UPSCALE_LANCZOS3;
+    config->estimatedCostTime = m_upscaleMsPerMegaPixel[mode] * megaPixels;
+    return true;
+}
+
+bool OSRCpuPlugin::EnhanceImage(const Param& paramIn, const Param& paramOut)
+{
+    const u32 sharpnessIdx = 2;
+    const u32 toneMappingIdx = 3;
+    BufferDescriptor* in = GetBuffer(paramIn, 1);
+    BufferDescriptor* out = GetBuffer(paramOut, 0);
+    if (in == nullptr || out == nullptr) {
+        return false;
+    }
+    f32 sharpness = DEFAULT_SHARPNESS;
+    if (paramIn.ArrayLen() > sharpnessIdx && paramIn.Get(sharpnessIdx).IsFloat()) {
+        sharpness = paramIn.Get(sharpnessIdx).Get<f32>();
+    }
+    bool toneMapping = true;
+    if (paramIn.ArrayLen() > toneMappingIdx && paramIn.Get(toneMappingIdx).IsBool()) {
+        toneMapping = paramIn.Get(toneMappingIdx).Get<bool>();
+    }
+    return Enhance(*in, *out, sharpness, toneMapping);
+}
+
+bool OSRCpuPlugin::Enhance(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer, f32 sharpness,
+    bool toneMapping)
+{
+    if (!IsValid(&inBuffer) || !IsValid(&outBuffer) || inBuffer.width != outBuffer.width ||
+        inBuffer.height != outBuffer.height || inBuffer.format != outBuffer.format) {
+        LOGERROR("Cannot enhance %dx%d format %d on the CPU", inBuffer.width, inBuffer.height, inBuffer.format);
+        return false;
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    const f32 fixedOne = static_cast<f32>(1 << SHARPEN_SHIFT);
+    s32 amount = static_cast<s32>(roundf(min(max(sharpness, 0.0f), 2.0f) * fixedOne));
+    const EnhanceKernels& kernels = GetEnhanceKernels();
+    const u32 height = static_cast<u32>(inBuffer.height);
+    const u32 bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+    vector<vector<u16>> columns(m_pool.GetWorkerCount());
+    m_pool.ParallelFor(bands, [&](u32 band, u32 worker) {
+        u32 y0 = band * BAND_ROWS;
+        EnhanceRows(inBuffer, outBuffer, y0, min(height, y0 + BAND_ROWS), kernels, amount, toneMapping,
+            columns[worker]);
+    });
+
+    f32 elapsedMs = chrono::duration<f32, milli>(chrono::steady_clock::now() - start).count();
+    m_msPerMegaPixel = elapsedMs * PIXELS_PER_MEGA / (static_cast<f32>(inBuffer.width) * inBuffer.height);
+    return true;
+}
+
+bool OSRCpuPlugin::UpscaleImage(const Param& paramIn, const Param& paramOut)
+{
+    BufferDescriptor* in = GetBuffer(paramIn, 1);
+    BufferDescriptor* out = GetBuffer(paramOut, 0);
+    if (in == nullptr || out == nullptr) {
+        return false;
+    }
+    return Upscale(*in, *out);
+}
+
+bool OSRCpuPlugin::Upscale(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer)
+{
+    if (!IsValid(&inBuffer) || !IsValid(&outBuffer) || outBuffer.width < inBuffer.width ||
+        outBuffer.height < inBuffer.height || inBuffer.format != outBuffer.format) {
+        LOGERROR("Cannot upscale %dx%d to %dx%d format %d on the CPU", inBuffer.width, inBuffer.height,
+                 outBuffer.width, outBuffer.height, outBuffer.format);
+        return false;
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    const s32 edgeScale = 2;
+    OSRUpscaleMode mode = m_upscaleMode;
+    if (mode == OSR_UPSCALE_EDGE_DIRECTED &&
+        (outBuffer.width != inBuffer.width * edgeScale || outBuffer.height != inBuffer.height * edgeScale)) {
+        mode = OSR_UPSCALE_LANCZOS3;
+    }
+    if (mode == OSR_UPSCALE_EDGE_DIRECTED) {
+        UpscaleEdgeDirected(inBuffer, outBuffer);
+    } else {
+        UpscaleLanczos(inBuffer, outBuffer);
+    }
+    f32 elapsedMs = chrono::duration<f32, milli>(chrono::steady_clock::now() - start).count();
+    m_upscaleMsPerMegaPixel[mode] = elapsedMs * PIXELS_PER_MEGA /
+        (static_cast<f32>(outBuffer.width) * outBuffer.height);
+    return true;
+}
+
+void OSRCpuPlugin::UpscaleLanczos(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer)
+{
+    const u32 channels = GetChannels(inBuffer.format);
+    const u32 inWidth = static_cast<u32>(inBuffer.width);
+    const u32 inHeight = static_cast<u32>(inBuffer.height);
+    const u32 outWidth = static_cast<u32>(outBuffer.width);
+    const u32 outHeight = static_cast<u32>(outBuffer.height);
+    const u32 inCount = inWidth * channels;
+    const u32 outCount = outWidth * channels;
+    const LanczosAxis axisX(inWidth, outWidth, channels);
+    const LanczosAxis axisY(inHeight, outHeight, outCount);
+    const EnhanceKernels& kernels = GetEnhanceKernels();
+    const u8* src = static_cast<const u8*>(inBuffer.addr);
+    u8* dst = static_cast<u8*>(outBuffer.addr);
+    // input rows resampled to the output width, with LANCZOS_FRACTION_SHIFT fraction bits
+    vector<s16> rows(static_cast<size_t>(inHeight) * outCount);
+
+    // horizontal pass, the taps gather from different input positions for every output pixel
+    void (*resampleRow)(const u8*, const LanczosAxis&, s16*, u32) = ResampleRow<1>;
+    if (channels == LUMA_CHANNELS) {
+        resampleRow = ResampleRow<LUMA_CHANNELS>;
+    } else if (channels == ALPHA_CHANNELS) {
+        resampleRow = ResampleRow<ALPHA_CHANNELS>;
+    }
+    m_pool.ParallelFor((inHeight + BAND_ROWS - 1) / BAND_ROWS, [&](u32 band, u32) {
+        for (u32 y = band * BAND_ROWS; y < min(inHeight, (band + 1) * BAND_ROWS); y++) {
+            resampleRow(src + static_cast<u64>(y) * inCount, axisX, rows.data() + static_cast<u64>(y) * outCount,
+                outWidth);
+        }
+    });
+
+    // vertical pass, six whole rows per output row, which the SIMD kernels handle
+    m_pool.ParallelFor((outHeight + BAND_ROWS - 1) / BAND_ROWS, [&](u32 band, u32) {
+        for (u32 y = band * BAND_ROWS; y < min(outHeight, (band + 1) * BAND_ROWS); y++) {
+            const s16* taps[LANCZOS_TAPS];
+            for (u32 k = 0; k < LANCZOS_TAPS; k++) {
+                taps[k] = rows.data() + axisY.offsets[y * LANCZOS_TAPS + k];
+            }
+            kernels.resampleColumn(taps, &axisY.weights[y * LANCZOS_TAPS], dst + static_cast<u64>(y) * outCount,
+                outCount);
+        }
+    });
+}
+
+void OSRCpuPlugin::UpscaleEdgeDirected(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer)
+{
+    const u32 channels = GetChannels(inBuffer.format);
+    const u32 width = static_cast<u32>(inBuffer.width);
+    const u32 height = static_cast<u32>(inBuffer.height);
+    const u32 inStride = width * channels;
+    const u32 outStride = 2 * inStride;
+    const u8* src = static_cast<const u8*>(inBuffer.addr);
+    u8* dst = static_cast<u8*>(outBuffer.addr);
+    auto in = [&](u32 x, u32 y) {
+        return src + static_cast<u64>(y) * inStride + x * channels;
+    };
+    auto out = [&](u32 x, u32 y) {
+        return dst + static_cast<u64>(y) * outStride + x * channels;
+    };
+    const u32 bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+
+    // input pixels land on even positions, the centres between four of them along their diagonals
+    m_pool.ParallelFor(bands, [&](u32 band, u32) {
+        for (u32 y = band * BAND_ROWS; y < min(height, (band + 1) * BAND_ROWS); y++) {
+            u32 y1 = min(y + 1, height - 1);
+            for (u32 x = 0; x < width; x++) {
+                u32 x1 = min(x + 1, width - 1);
+                memcpy(out(2 * x, 2 * y), in(x, y), channels);
+                InterpolateEdge(in(x, y), in(x1, y1), in(x1, y), in(x, y1), out(2 * x + 1, 2 * y + 1), channels);
+            }
+        }
+    });
+
+    // the remaining pixels sit between two input pixels and two centres of the first pass
+    m_pool.ParallelFor(bands, [&](u32 band, u32) {
+        for (u32 y = band * BAND_ROWS; y < min(height, (band + 1) * BAND_ROWS); y++) {
+            u32 y1 = min(y + 1, height - 1);
+            u32 above = (y == 0) ? 1 : 2 * y - 1;
+            for (u32 x = 0; x < width; x++) {
+                u32 x1 = min(x + 1, width - 1);
+                u32 left = (x == 0) ? 1 : 2 * x - 1;
+                InterpolateEdge(in(x, y), in(x1, y), out(2 * x + 1, above), out(2 * x + 1, 2 * y + 1),
+                    out(2 * x + 1, 2 * y), channels);
+                InterpolateEdge(in(x, y), in(x, y1), out(left, 2 * y + 1), out(2 * x + 1, 2 * y + 1),
+                    out(2 * x, 2 * y + 1), channels);
+            }
+        }
+    });
+}
+
+void OSRCpuPlugin::EnhanceRows(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer, u32 y0, u32 y1,
+    const EnhanceKernels& kernels, s32 amount, bool toneMapping, vector<u16>& columns) const
+{
+    const u32 channels = GetChannels(inBuffer.format);
+    const u32 count = static_cast<u32>(inBuffer.width) * channels;
+    const u32 padding = BLUR_RADIUS * channels;
+    const s32 lastRow = inBuffer.height - 1;
+    const u8* src = static_cast<const u8*>(inBuffer.addr);
+    u8* dst = static_cast<u8*>(outBuffer.addr);
+    const u8* tone = GetToneTable().values;
+    columns.resize(count + 2 * padding);
+    u16* inner = columns.data() + padding;
+
+    for (u32 y = y0; y < y1; y++) {
+        const u8* rows[BLUR_TAPS];
+        for (u32 k = 0; k < BLUR_TAPS; k++) {
+            s32 row = min(lastRow, max(0, static_cast<s32>(y + k) - static_cast<s32>(BLUR_RADIUS)));
+            rows[k] = src + static_cast<u64>(row) * count;
+        }
+        kernels.blurColumn(rows, inner, count);
+        // repeat the edge pixels into the padding, the blur clamps at the image border
+        for (u32 i = 0; i < padding; i++) {
+            inner[static_cast<s32>(i) - static_cast<s32>(padding)] = inner[i % channels];
+            inner[count + i] = inner[count - channels + i % channels];
+        }
+        const u8* srcRow = rows[BLUR_RADIUS];
+        u8* dstRow = dst + static_cast<u64>(y) * count;
+        kernels.sharpenRow(srcRow, inner, dstRow, count, channels, amount);
+        if (toneMapping) {
+            for (u32 i = 0; i < count; i++) {
+                dstRow[i] = tone[dstRow[i]];
+            }
+        }
+        if (channels == ALPHA_CHANNELS) {
+            for (u32 i = ALPHA_CHANNELS - 1; i < count; i += ALPHA_CHANNELS) {
+                dstRow[i] = srcRow[i];
+            }
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Bounded three-stage read -> enhance -> write pipeline for batch super-resolution.
+ */
+
+#define CGKIT_LOG
+#include <thread>
+#include "Log/Log.h"
+#include "OSRPlugin/OSRPipeline.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+using Clock = chrono::steady_clock;
+
+f64 ElapsedMs(const Clock::time_point& start)
+{
+    return chrono::duration<f64, milli>(Clock::now() - start).count();
+}
+
+u64 PixelCount(const BufferDescriptor& buffer)
+{
+    return static_cast<u64>(buffer.width) * static_cast<u64>(buffer.height);
+}
+
+void LogStage(const char* name, const OSRStageStats& stage)
+{
+    LOGINFO("OSR %s: frames %u failed %u busy %.2fms %.2ffps %.2fMPix/s", name, stage.frames, stage.failures,
+            stage.busyMs, stage.FramesPerSecond(), stage.MegaPixelsPerSecond());
+}
+}
+
+OSRPipeline::OSRPipeline(const OSRPipelineConfig& config) : m_config(config) {}
+
+OSRPipeline::~OSRPipeline() {}
+
+bool OSRPipeline::Run(vector<OSRFrame>& frames, const Stage& read, const Stage& enhance, const Stage& write,
+    OSRPipelineStats* stats)
+{
+    OSRPipelineStats local;
+    BoundedQueue<u32> decoded(m_config.queueDepth);
+    BoundedQueue<u32> enhanced(m_config.queueDepth);
+    Clock::time_point start = Clock::now();
+
+    thread reader([&]() {
+        for (u32 i = 0; i < frames.size(); i++) {
+            Clock::time_point t = Clock::now();
+            bool ok = read(frames[i]);
+            local.read.busyMs += ElapsedMs(t);
+            if (!ok) {
+                local.read.failures++;
+                continue;
+            }
+            local.read.frames++;
+            local.read.pixels += PixelCount(frames[i].inBuffer);
+            if (!decoded.Push(i)) {
+                break;
+            }
+        }
+        decoded.Close();
+    });
+
+    thread writer([&]() {
+        u32 i = 0;
+        while (enhanced.Pop(i)) {
+            u64 pixels = PixelCount(frames[i].outBuffer);
+            Clock::time_point t = Clock::now();
+            bool ok = write(frames[i]);
+            local.write.busyMs += ElapsedMs(t);
+            if (!ok) {
+                local.write.failures++;
+                continue;
+            }
+            local.write.frames++;
+            local.write.pixels += pixels;
+        }
+    });
+
+    u32 i = 0;
+    while (decoded.Pop(i)) {
+        Clock::time_point t = Clock::now();
+        bool ok = enhance(frames[i]);
+        local.enhance.busyMs += ElapsedMs(t);
+        if (!ok) {
+            local.enhance.failures++;
+            continue;
+        }
+        local.enhance.frames++;
+        local.enhance.pixels += PixelCount(frames[i].outBuffer);
+        enhanced.Push(i);
+    }
+    enhanced.Close();
+
+    reader.join();
+    writer.join();
+    local.wallMs = ElapsedMs(start);
+    if (stats != nullptr) {
+        *stats = local;
+    }
+    return local.write.frames == frames.size();
+}
+
+void OSRPipeline::LogStats(const OSRPipelineStats& stats)
+{
+    LogStage("read", stats.read);
+    LogStage("enhance", stats.enhance);
+    LogStage("write", stats.write);
+    f64 fps = stats.wallMs > 0.0 ? stats.write.frames * 1000.0 / stats.wallMs : 0.0;
+    LOGINFO("OSR pipeline: %u frames in %.2fms, %.2ffps", stats.write.frames, stats.wallMs, fps);
+}
@@ -5,358 +5,151 @@
 
 #define CGKIT_LOG
 #include <thread>
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include <dirent.h>
 #include "OSRPlugin/OSRPlugin.h"
+#include "OSRPlugin/PNMCodec.h"
+#include "OSRPlugin/PixelConverter.h"
 
 #ifdef CG_ANDROID_PLATFORM
 using namespace std;
 using namespace CGKit;
-static constexpr s32 CHANNELS_RGB = 3;
 static constexpr u32 MAX_WIDTH = 4096;
 static constexpr u32 MAX_HEIGHT = 4096;
 
 OSRPlugin::OSRPlugin() {}
 
-OSRPlugin::~OSRPlugin() {}
+OSRPlugin::OSRPlugin(IPlugin* standIn) : session(standIn) {}
 
-void CallBack(bool success)
+OSRPlugin::~OSRPlugin()
 {
-    return;
+    CG_SAFE_DELETE(enhancer);
 }
 
-u8* OSRPlugin::ReadPPM(const String& path, u32& width, u32& height)
+void CallBack(bool success)
 {
-    ifstream fIn(path, ios::in | ios::binary);
-    if (!fIn.is_open()) {
-        return nullptr;
-    }
-    u8* pixels = nullptr;
-    u32 pixelsSize = 0;
-    String line;
-    if (getline(fIn, line) && getline(fIn, line)) {
-        stringstream ss(line);
-        if ((ss >> width) && (width > 0) && (width <= MAX_WIDTH) &&
-            (ss >> height) && (height > 0) && (height <= MAX_HEIGHT) &&
-            getline(fIn, line)) {
-            pixelsSize = width * height * CHANNELS_RGB;
-            pixels = CG_NEW_ARRAY(u8, pixelsSize);
-            if (pixels == nullptr) {
-                fIn.close();
-                return nullptr;
-            }
-        } else {
-            fIn.close();
-            return nullptr;
-        }
-    } else {
-        fIn.close();
-        return nullptr;
-    }
-
-    if (fIn.read(reinterpret_cast<c8*>(pixels), pixelsSize)) {
-        fIn.close();
-        return pixels;
-    } else {
-        CG_DELETE_ARRAY(u8, pixels);
-        fIn.close();
-        return nullptr;
-    }
+    return;
 }
 
-bool OSRPlugin::WritePPM(const String& path, const u8* pixels, u32 width, u32 height)
+bool OSRPlugin::CreateBuffer(BufferDescriptor& buffer, u32 w, u32 h, PixelFormat format)
 {
-    if (pixels == nullptr || width <= 0 || height <= 0 ||
-        width > MAX_WIDTH || height > MAX_HEIGHT) {
+    u32 bytesPerPixel = PixelConverter::GetBytesPerPixel(format);
+    if (w <= 0 || h <= 0 || bytesPerPixel == 0) {
         return false;
     }
-    ofstream fOut(path, ios::out | ios::binary);
-    if (!fOut.is_open()) {
+    if (!bufferPool.Acquire(buffer, w * h * bytesPerPixel)) {
         return false;
     }
-    fOut << "P6\n" << width << ' ' << height << "\n255\n";
-    fOut.write(reinterpret_cast<const c8*>(pixels), width * height * CHANNELS_RGB);
-    fOut.close();
+    buffer.width = w;
+    buffer.height = h;
+    buffer.format = format;
     return true;
 }
 
-s32 OSRPlugin::Format2Channel(PixelFormat format)
-{
-    if (format == PIXEL_FORMAT_R8G8B8_UNORM) {
-        return CHANNELS_RGB;
-    } else {
-        return -1;
-    }
-}
-
-bool OSRPlugin::CreateBuffer(BufferDescriptor& buffer, u32 w, u32 h, PixelFormat format)
+bool OSRPlugin::ConvertBuffer(const BufferDescriptor& buffer, PixelFormat format, BufferDescriptor& converted)
 {
-    s32 c = Format2Channel(format);
-    if (w <= 0 || h <= 0 || c < 0) {
+    if (!CreateBuffer(converted, buffer.width, buffer.height, format)) {
         return false;
     }
-    u8* pixels = CG_NEW_ARRAY(u8, w * h * c);
-    if (pixels == nullptr) {
+    if (!PixelConverter::Convert(buffer, converted)) {
+        LOGERROR("Cannot convert pixel format %d to %d", buffer.format, format);
+        DeleteBuffer(converted);
         return false;
     }
-    buffer.addr = static_cast<void *>(pixels);
-    buffer.width = w;
-    buffer.height = h;
-    buffer.len = w * h * c;
-    buffer.format = format;
     return true;
 }
 
 bool OSRPlugin::ReadBuffer(BufferDescriptor& buffer, const String& path)
 {
-    u32 w, h;
-    u8* pixels = ReadPPM(path, w, h);
-    if (pixels == nullptr) {
+    // mapped, so images of any size are fine here, the plugin limit is handled by tiling
+    if (!PNMCodec::Read(path, buffer)) {
         return false;
     }
-    buffer.addr = static_cast<void*>(pixels);
-    buffer.width = w;
-    buffer.height = h;
-    buffer.len = w * h * CHANNELS_RGB;
-    buffer.format = PIXEL_FORMAT_R8G8B8_UNORM;
-    return true;
+    // the plugin works on packed RGB, P5 and 16-bit files are converted
+    if (buffer.format == PIXEL_FORMAT_R8G8B8_UNORM) {
+        return true;
+    }
+    BufferDescriptor converted;
+    bool ret = ConvertBuffer(buffer, PIXEL_FORMAT_R8G8B8_UNORM, converted);
+    DeleteBuffer(buffer);
+    buffer = converted;
+    return ret;
 }
 
 bool OSRPlugin::WriteBuffer(const BufferDescriptor& buffer, const String& path)
 {
-    if (WritePPM(path, static_cast<u8*>(buffer.addr), buffer.width, buffer.height)) {
-        return true;
-    } else {
-        return false;
-    }
+    return PNMCodec::Write(path, buffer);
 }
 
 void OSRPlugin::DeleteBuffer(BufferDescriptor& buffer)
 {
-    if (buffer.addr != nullptr) {
-        CG_DELETE_ARRAY(u8, buffer.addr);
+    if (buffer.addr != nullptr && !PNMCodec::Release(buffer) && !bufferPool.Release(buffer)) {
+        LOGERROR("Buffer %p was not created by OSRPlugin", buffer.addr);
     }
     buffer.addr = nullptr;
     buffer.width = buffer.height = buffer.len = 0;
     buffer.format = PIXEL_FORMAT_MAX;
 }
 
-bool OSRPlugin::SetAssetsDir(const String& localDir)
-{
-    Param paramIn, paramOut;
-    c8* dir = const_cast<c8*>(localDir.c_str());
-
-    Param pi0;
-    // set opCode
-    pi0.Set<s32>(SET_ASSETS_DIR);
-    Param pi1;
-    // set val
-    pi1.Set<void*>(static_cast<void*>(dir));
-    // set paramIn
-    paramIn.Set(0, pi0);
-    paramIn.Set(1, pi1);
-
-    Param po0;
-    // set val
-    po0.Set<void*>(static_cast<void*>(dir));
-    // set paramOut
-    paramOut.Set(0, po0);
-
-    // call fn:SET_ASSETS_DIR
-    bool success = plugin->Execute(paramIn, paramOut);
-    if (success) {
-        LOGINFO("Set assets dir %s success", dir);
-        return true;
-    } else {
-        LOGERROR("Set assets dir %s failed", dir);
-        return false;
-    }
-}
-
-bool OSRPlugin::QueryImage(BufferDescriptor& inBuffer, PluginConfig* pluginConfig)
-{
-    Param paramIn, paramOut;
-
-    Param pi0;
-    // set opcode
-    pi0.Set<s32>(QUERY_IMAGE_ENHANCING);
-    // set val
-    Param pi1;
-    pi1.Set<s32>(inBuffer.width);
-    Param pi2;
-    pi2.Set<s32>(inBuffer.height);
-    Param pi3;
-    pi3.Set<s32>(inBuffer.format);
-    // set paramIn
-    paramIn.Set(0, pi0);
-    paramIn.Set(1, pi1);
-    paramIn.Set(2, pi2);
-    paramIn.Set(3, pi3);
-
-    Param po0;
-    // set val
-    po0.Set<void*>(static_cast<void*>(pluginConfig));
-    // set paramOut
-    paramOut.Set(0, po0);
-
-    // call fn:QUERY_IMAGE_ENHANCING
-    bool success = plugin->Execute(paramIn, paramOut);
-    if (success) {
-        LOGINFO("Query ImageEnhancing success");
-        return true;
-    } else {
-        LOGERROR("Query ImageEnhancing failed");
-        return false;
-    }
-}
-
-bool OSRPlugin::ImageEnhancingSync(BufferDescriptor& inBuffer, BufferDescriptor& outBuffer)
-{
-    Param paramIn, paramOut;
-    const f32 sharpness = 0.9f;
-    const bool toneMapping = true;
-    const u32 timeOut = 10000;
-
-    Param pi0;
-    // set opcode
-    pi0.Set<s32>(SYNC_IMAGE_ENHANCING);
-    // set val
-    Param pi1;
-    pi1.Set<void*>(static_cast<void*>(&inBuffer));
-    Param pi2;
-    pi2.Set<f32>(sharpness);
-    Param pi3;
-    pi3.Set<bool>(toneMapping);
-    Param pi4;
-    pi4.Set<s32>(timeOut);
-    // set paramIn
-    paramIn.Set(0, pi0);
-    paramIn.Set(1, pi1);
-    paramIn.Set(2, pi2);
-    paramIn.Set(3, pi3);
-    paramIn.Set(4, pi4);
-
-    Param po0;
-    // set val
-    po0.Set<void*>(static_cast<void*>(&outBuffer));
-    // set paramOut
-    paramOut.Set(0, po0);
-
-    // call fn:SYNC_IMAGE_ENHANCING
-    bool success = plugin->Execute(paramIn, paramOut);
-    if (success) {
-        LOGINFO("Sync ImageEnhancing success");
-        return true;
-    } else {
-        LOGERROR("Sync ImageEnhancing failed");
-        return false;
-    }
-}
-
-bool OSRPlugin::PluginInit()
-{
-    vector<String> pluginList;
-
-    gPluginManager.Initialize();
-    pluginList = gPluginManager.GetPluginList();
-    if (find(pluginList.begin(), pluginList.end(), pluginName) == pluginList.end()) {
-        LOGERROR("Cannot find plugin %s!", pluginName.c_str());
-        gPluginManager.Uninitialize();
-        return false;
-    }
-
-    plugin = gPluginManager.LoadPlugin(pluginName);
-    if (plugin == nullptr) {
-        LOGERROR("No plugin loaded!");
-        gPluginManager.Uninitialize();
-        return false;
-    }
-    LOGINFO("Load Plugin %s successfully!", pluginName.c_str());
-
-    if (!plugin->IsPluginActive()) {
-        LOGERROR("Plugin %s was not activated!", pluginName.c_str());
-        PluginDeInit();
-        return false;
-    }
-    return true;
-}
-
-void OSRPlugin::PluginDeInit()
-{
-    gPluginManager.UnloadPlugin(pluginName);
-    gPluginManager.Uninitialize();
-}
-
 void OSRPlugin::ExecuteOSR(const String localDir)
 {
     bool ret = false;
-    ret = PluginInit();
-    if (!ret) {
-        return;
-    }
-
     // push ie_data.bin & input image here
-    ret = SetAssetsDir(localDir);
+    ret = session.Open(localDir);
     if (!ret) {
-        PluginDeInit();
         return;
     }
 
     // setup inBuffer
     const String inputFn = "input.ppm";
-    String imgPath = localDir;
-    if(imgPath.length() != 0 && imgPath[imgPath.length() - 1] != '/') {
-        imgPath += "/";
-    }
-    imgPath += inputFn;
+    String imgPath = JoinPath(localDir, inputFn);
     BufferDescriptor inBuffer, outBuffer;
     if (!ReadBuffer(inBuffer, imgPath)) {
         LOGERROR("Setup inBuffer failed!");
-        PluginDeInit();
         return;
     }
     LOGINFO("inBuffer info:\ninput.width %d\ninput.height %d\ninput.len %d\n",
             inBuffer.width, inBuffer.height, inBuffer.len);
-
-    // query image
-    PluginConfig* pluginConfig = static_cast<PluginConfig*>(malloc(sizeof(PluginConfig)));
-    if (pluginConfig == nullptr) {
-        LOGERROR("malloc failed!");
-        DeleteBuffer(inBuffer);
-        PluginDeInit();
+    if (NeedsTiling(inBuffer)) {
+        OSRFrame frame;
+        frame.inPath = imgPath;
+        frame.outPath = JoinPath(localDir, "output_ie_sync.ppm");
+        frame.inBuffer = inBuffer;
+        if (EnhanceTiled(frame)) {
+            LOGINFO("Save to %s", frame.outPath.c_str());
+        }
+        DeleteBuffer(frame.inBuffer);
+        DeleteBuffer(frame.outBuffer);
         return;
     }
-    ret = QueryImage(inBuffer, pluginConfig);
+
+    // query image
+    PluginConfig pluginConfig;
+    ret = session.QueryImage(inBuffer, pluginConfig);
     if (!ret) {
-        free(pluginConfig);
         DeleteBuffer(inBuffer);
-        PluginDeInit();
         return;
     }
 
     // setup outBuffer
     u32 outW, outH, estimatedTime;
     PixelFormat outFormat;
-    outW = pluginConfig->output.width;
-    outH = pluginConfig->output.height;
-    outFormat = pluginConfig->output.format;
-    estimatedTime = pluginConfig->estimatedCostTime;
-    free(pluginConfig);
+    outW = pluginConfig.output.width;
+    outH = pluginConfig.output.height;
+    outFormat = pluginConfig.output.format;
+    estimatedTime = pluginConfig.estimatedCostTime;
     LOGINFO("Query ImageEnhancing Info:\noutput.width %d\noutput.height %d\noutput.time %d\n",
             outW, outH, estimatedTime);
     if (!CreateBuffer(outBuffer, outW, outH, outFormat)) {
         LOGERROR("Setup outBuffer failed!");
         DeleteBuffer(inBuffer);
-        PluginDeInit();
         return;
     }
 
     // output image with ppm format
     const String outputFnIESync = "output_ie_sync.ppm"; /* sync image enhance */
     LOGINFO("Test Sync ImageEnhancing!");
-    String outPath = localDir + "/" + outputFnIESync;
-    ret = ImageEnhancingSync(inBuffer, outBuffer);
+    String outPath = JoinPath(localDir, outputFnIESync);
+    ret = session.ImageEnhancingSync(inBuffer, outBuffer);
     if (ret) {
         WriteBuffer(outBuffer, outPath);
         LOGINFO("Save to %s", outPath.c_str());
@@ -364,6 +157,285 @@ void OSRPlugin::ExecuteOSR(const String localDir)
 
     DeleteBuffer(inBuffer);
     DeleteBuffer(outBuffer);
-    PluginDeInit();
 }
-#endif
\ No newline at end of file
+
+bool OSRPlugin::CreateEnhancer()
+{
+    if (enhancer == nullptr) {
+        enhancer = CG_NEW(OSRAsyncEnhancer, session);
+        if (enhancer == nullptr) {
+            LOG_ALLOC_ERROR("Failed to create OSR async enhancer.");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OSRPlugin::ExecuteOSRAsync(const String& localDir, const String& outputName)
+{
+    if (!session.Open(localDir) || !CreateEnhancer()) {
+        return false;
+    }
+
+    OSRFrame frame;
+    frame.inPath = JoinPath(localDir, "input.ppm");
+    frame.outPath = JoinPath(localDir, outputName);
+    if (!ReadBuffer(frame.inBuffer, frame.inPath)) {
+        LOGERROR("Setup inBuffer failed!");
+        return false;
+    }
+    if (NeedsTiling(frame.inBuffer)) {
+        LOGERROR("%dx%d is too large for one async call, use ExecuteOSR", frame.inBuffer.width,
+                 frame.inBuffer.height);
+        DeleteBuffer(frame.inBuffer);
+        return false;
+    }
+    PluginConfig pluginConfig;
+    if (!session.QueryImage(frame.inBuffer, pluginConfig) ||
+        !CreateBuffer(frame.outBuffer, pluginConfig.output.width, pluginConfig.output.height,
+                      pluginConfig.output.format)) {
+        LOGERROR("Setup outBuffer failed!");
+        DeleteBuffer(frame.inBuffer);
+        return false;
+    }
+
+    const String outPath = frame.outPath;
+    OSRAsyncRequest request = enhancer->EnhanceAsync(frame.inBuffer, frame.outBuffer,
+        [this, outPath](OSRRequestStatus status, BufferDescriptor& inBuffer, BufferDescriptor& outBuffer) {
+            if (status == OSR_REQUEST_DONE && WriteBuffer(outBuffer, outPath)) {
+                LOGINFO("Save to %s", outPath.c_str());
+            } else {
+                LOGERROR("Async ImageEnhancing finished with status %d", status);
+            }
+            DeleteBuffer(inBuffer);
+            DeleteBuffer(outBuffer);
+        });
+    return request.id != 0;
+}
+
+bool OSRPlugin::SaveFrame(const BufferDescriptor& frame, const String& localDir, const String& name)
+{
+    const String path = JoinPath(localDir, name);
+    if (!PNMCodec::Write(path, frame)) {
+        LOGERROR("Failed to save %s", path.c_str());
+        return false;
+    }
+    LOGINFO("Save to %s", path.c_str());
+    return true;
+}
+
+BufferDescriptor OSRPlugin::WrapSnapshot(const BaseApplication& app)
+{
+    const s32 bytesPerPixel = 4;
+    BufferDescriptor snapshot {nullptr, 0, 0, 0, PIXEL_FORMAT_R8G8B8A8_UNORM};
+    snapshot.addr = const_cast<u8*>(app.GetSnapshotData());
+    snapshot.width = static_cast<int>(app.GetScreenWidth());
+    snapshot.height = static_cast<int>(app.GetScreenHeight());
+    snapshot.len = snapshot.width * snapshot.height * bytesPerPixel;
+    return snapshot;
+}
+
+bool OSRPlugin::ExecuteOSRFrame(const String& localDir, const BufferDescriptor& frame, OSRFrameCallback callback)
+{
+    if (frame.addr == nullptr || frame.width <= 0 || frame.height <= 0 || NeedsTiling(frame)) {
+        LOGERROR("Cannot enhance a %dx%d frame in memory", frame.width, frame.height);
+        return false;
+    }
+    if (!session.Open(localDir) || !CreateEnhancer()) {
+        return false;
+    }
+
+    // the frame is only copied when the plugin needs another format, which takes one SIMD pass
+    BufferDescriptor inBuffer = frame;
+    bool ownsInput = (frame.format != PIXEL_FORMAT_R8G8B8_UNORM);
+    if (ownsInput && !ConvertBuffer(frame, PIXEL_FORMAT_R8G8B8_UNORM, inBuffer)) {
+        return false;
+    }
+    BufferDescriptor outBuffer;
+    PluginConfig pluginConfig;
+    if (!session.QueryImage(inBuffer, pluginConfig) ||
+        !CreateBuffer(outBuffer, pluginConfig.output.width, pluginConfig.output.height, pluginConfig.output.format)) {
+        LOGERROR("Setup outBuffer failed!");
+        if (ownsInput) {
+            DeleteBuffer(inBuffer);
+        }
+        return false;
+    }
+
+    u64 startMs = GetCurrentTimeMilliSecond();
+    OSRAsyncRequest request = enhancer->EnhanceAsync(inBuffer, outBuffer,
+        [this, callback, ownsInput, startMs](OSRRequestStatus status, BufferDescriptor& in, BufferDescriptor& out) {
+            bool success = (status == OSR_REQUEST_DONE);
+            LOGINFO("In-memory ImageEnhancing of %dx%d finished with status %d in %llums", in.width, in.height,
+                    status, static_cast<unsigned long long>(GetCurrentTimeMilliSecond() - startMs));
+            if (callback != nullptr) {
+                callback(success, out);
+            }
+            if (ownsInput) {
+                DeleteBuffer(in);
+            }
+            DeleteBuffer(out);
+        });
+    return request.id != 0;
+}
+
+bool OSRPlugin::IsEnhancing()
+{
+    return enhancer != nullptr && enhancer->GetInFlightCount() != 0;
+}
+
+bool OSRPlugin::NeedsTiling(const BufferDescriptor& buffer) const
+{
+    return static_cast<u32>(buffer.width) > MAX_WIDTH || static_cast<u32>(buffer.height) > MAX_HEIGHT;
+}
+
+bool OSRPlugin::EnhanceTiled(OSRFrame& frame)
+{
+    OSRTiledEnhancer tiler(session, tileConfig);
+    PluginConfig pluginConfig;
+    if (!tiler.QueryImage(frame.inBuffer, pluginConfig) ||
+        !PNMCodec::Create(frame.outPath, pluginConfig.output.width, pluginConfig.output.height,
+                          pluginConfig.output.format, frame.outBuffer)) {
+        LOGERROR("Setup tiled outBuffer for %s failed!", frame.inPath.c_str());
+        return false;
+    }
+    frame.outMapped = true;
+    LOGINFO("Tiled ImageEnhancing of %s into %dx%d, %u tiles, %llu tile bytes", frame.inPath.c_str(),
+            frame.outBuffer.width, frame.outBuffer.height, tiler.GetTileCount(),
+            static_cast<unsigned long long>(tiler.GetTileBytes(frame.inBuffer)));
+    return tiler.Enhance(frame.inBuffer, frame.outBuffer);
+}
+
+bool OSRPlugin::EnhanceFrame(OSRFrame& frame)
+{
+    if (NeedsTiling(frame.inBuffer)) {
+        bool tiled = EnhanceTiled(frame);
+        DeleteBuffer(frame.inBuffer);
+        if (!tiled) {
+            DeleteBuffer(frame.outBuffer);
+        }
+        return tiled;
+    }
+    PluginConfig pluginConfig;
+    if (!session.QueryImage(frame.inBuffer, pluginConfig) ||
+        !CreateBuffer(frame.outBuffer, pluginConfig.output.width, pluginConfig.output.height,
+                      pluginConfig.output.format)) {
+        LOGERROR("Setup outBuffer for %s failed!", frame.inPath.c_str());
+        DeleteBuffer(frame.inBuffer);
+        return false;
+    }
+    bool ret = session.ImageEnhancingSync(frame.inBuffer, frame.outBuffer);
+    DeleteBuffer(frame.inBuffer);
+    if (!ret) {
+        DeleteBuffer(frame.outBuffer);
+    }
+    return ret;
+}
+
+String OSRPlugin::JoinPath(const String& dir, const String& name)
+{
+    String path = dir;
+    if (path.length() != 0 && path[path.length() - 1] != '/') {
+        path += "/";
+    }
+    return path + name;
+}
+
+String OSRPlugin::OutputPath(const String& outputDir, const String& inPath)
+{
+    size_t slash = inPath.find_last_of('/');
+    String name = (slash == String::npos) ? inPath : inPath.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != String::npos) {
+        name = name.substr(0, dot);
+    }
+    return JoinPath(outputDir, name + "_ie_sync.ppm");
+}
+
+vector<String> OSRPlugin::ListPPMFiles(const String& dir)
+{
+    vector<String> files;
+    DIR* handle = opendir(dir.c_str());
+    if (handle == nullptr) {
+        LOGERROR("Cannot open directory %s", dir.c_str());
+        return files;
+    }
+    const String ext = ".ppm";
+    for (dirent* entry = readdir(handle); entry != nullptr; entry = readdir(handle)) {
+        String name = entry->d_name;
+        if (name.length() > ext.length() && name.compare(name.length() - ext.length(), ext.length(), ext) == 0) {
+            files.push_back(JoinPath(dir, name));
+        }
+    }
+    closedir(handle);
+    sort(files.begin(), files.end());
+    return files;
+}
+
+bool OSRPlugin::ExecuteOSRBatch(const String& localDir, const vector<String>& inputs, const String& outputDir,
+    const OSRPipelineConfig& config, OSRPipelineStats* stats)
+{
+    if (inputs.empty()) {
+        LOGERROR("No input image for OSR batch!");
+        return false;
+    }
+    if (!session.Open(localDir)) {
+        return false;
+    }
+
+    vector<OSRFrame> frames(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        frames[i].inPath = inputs[i];
+        frames[i].outPath = OutputPath(outputDir, inputs[i]);
+    }
+
+    OSRPipeline pipeline(config);
+    OSRPipelineStats pipelineStats;
+    bool ret = pipeline.Run(frames,
+        [this](OSRFrame& frame) {
+            if (!ReadBuffer(frame.inBuffer, frame.inPath)) {
+                LOGERROR("Read %s failed!", frame.inPath.c_str());
+                return false;
+            }
+            return true;
+        },
+        [this](OSRFrame& frame) {
+            return EnhanceFrame(frame);
+        },
+        [this](OSRFrame& frame) {
+            bool written = frame.outMapped || WriteBuffer(frame.outBuffer, frame.outPath);
+            DeleteBuffer(frame.outBuffer);
+            if (!written) {
+                LOGERROR("Write %s failed!", frame.outPath.c_str());
+            }
+            return written;
+        },
+        &pipelineStats);
+    OSRPipeline::LogStats(pipelineStats);
+    OSRBufferPoolStats poolStats = bufferPool.GetStats();
+    LOGINFO("buffer pool: hit rate %.2f (%llu/%llu), resident %llu bytes", poolStats.HitRate(),
+            static_cast<unsigned long long>(poolStats.hits),
+            static_cast<unsigned long long>(poolStats.hits + poolStats.misses),
+            static_cast<unsigned long long>(poolStats.residentBytes));
+    if (stats != nullptr) {
+        *stats = pipelineStats;
+    }
+    return ret;
+}
+
+void OSRPlugin::SetTileConfig(const OSRTileConfig& config)
+{
+    tileConfig = config;
+}
+
+OSRBufferPoolStats OSRPlugin::GetBufferPoolStats()
+{
+    return bufferPool.GetStats();
+}
+
+bool OSRPlugin::ExecuteOSRDirectory(const String& localDir, const String& inputDir, const String& outputDir,
+    const OSRPipelineConfig& config, OSRPipelineStats* stats)
+{
+    return ExecuteOSRBatch(localDir, ListPPMFiles(inputDir), outputDir, config, stats);
+}
+#endif
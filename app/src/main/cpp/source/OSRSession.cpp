@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Long-lived connection to the OfflineSupRes plugin.
+ */
+
+#define CGKIT_LOG
+#include "OSRPlugin/OSRSession.h"
+
+using namespace std;
+using namespace CGKit;
+
+OSRSession::OSRSession() {}
+
+OSRSession::OSRSession(IPlugin* standIn) : standInPlugin(standIn) {}
+
+OSRSession::~OSRSession()
+{
+    Close();
+}
+
+bool OSRSession::Open(const String& localDir)
+{
+    {
+        lock_guard<mutex> stateLock(stateMutex);
+        if (IsOpen() && localDir == assetsDir) {
+            return true;
+        }
+    }
+    lock_guard<mutex> callLock(callMutex);
+    lock_guard<mutex> stateLock(stateMutex);
+    if (!IsOpen() && !PluginInit()) {
+        return false;
+    }
+    if (IsOpen() && localDir == assetsDir) {
+        return true;
+    }
+
+    ClearQueryCacheLocked();
+    // push ie_data.bin here
+    if (!SetAssetsDir(localDir)) {
+        CloseLocked();
+        return false;
+    }
+    assetsDir = localDir;
+    return true;
+}
+
+void OSRSession::Close()
+{
+    lock_guard<mutex> callLock(callMutex);
+    lock_guard<mutex> stateLock(stateMutex);
+    CloseLocked();
+}
+
+void OSRSession::CloseLocked()
+{
+    if (!IsOpen()) {
+        return;
+    }
+    PluginDeInit();
+    assetsDir.clear();
+    ClearQueryCacheLocked();
+}
+
+void OSRSession::ClearQueryCacheLocked()
+{
+    queryCache.clear();
+    queryCacheHits = 0;
+    queryCacheMisses = 0;
+}
+
+bool OSRSession::SetAssetsDir(const String& localDir)
+{
+    c8* dir = const_cast<c8*>(localDir.c_str());
+
+    // set opCode
+    assetsFrame.Set<s32>(0, SET_ASSETS_DIR);
+    // set val
+    assetsFrame.Set<void*>(1, static_cast<void*>(dir));
+    assetsFrame.SetOut<void*>(0, static_cast<void*>(dir));
+
+    // call fn:SET_ASSETS_DIR
+    bool success = assetsFrame.Execute(*plugin);
+    if (success) {
+        LOGINFO("Set assets dir %s success", dir);
+        return true;
+    } else {
+        LOGERROR("Set assets dir %s failed", dir);
+        return false;
+    }
+}
+
+bool OSRSession::QueryImage(const BufferDescriptor& inBuffer, PluginConfig& pluginConfig)
+{
+    return Query(QUERY_IMAGE_ENHANCING, inBuffer, pluginConfig);
+}
+
+bool OSRSession::QuerySuperSampling(const BufferDescriptor& inBuffer, PluginConfig& pluginConfig)
+{
+    return Query(QUERY_SUPER_SAMPLING, inBuffer, pluginConfig);
+}
+
+bool OSRSession::Query(OSROperationCode opCode, const BufferDescriptor& inBuffer, PluginConfig& pluginConfig)
+{
+    const c8* name = (opCode == QUERY_SUPER_SAMPLING) ? "SuperSampling" : "ImageEnhancing";
+    QueryKey key {opCode, inBuffer.width, inBuffer.height, inBuffer.format};
+    if (FindCachedQuery(key, pluginConfig)) {
+        return true;
+    }
+
+    // a miss waits for the plugin, another thread may have filled the entry meanwhile
+    lock_guard<mutex> callLock(callMutex);
+    if (FindCachedQuery(key, pluginConfig)) {
+        return true;
+    }
+    if (!IsOpen()) {
+        return false;
+    }
+    {
+        lock_guard<mutex> stateLock(stateMutex);
+        queryCacheMisses++;
+    }
+
+    // set opcode
+    queryFrame.Set<s32>(0, opCode);
+    // set val
+    queryFrame.Set<s32>(1, inBuffer.width);
+    queryFrame.Set<s32>(2, inBuffer.height);
+    queryFrame.Set<s32>(3, inBuffer.format);
+    queryFrame.SetOut<void*>(0, static_cast<void*>(&pluginConfig));
+
+    // call fn:QUERY_IMAGE_ENHANCING or QUERY_SUPER_SAMPLING
+    bool success = queryFrame.Execute(*plugin);
+    if (success) {
+        LOGINFO("Query %s success", name);
+        lock_guard<mutex> stateLock(stateMutex);
+        queryCache[key] = pluginConfig;
+        return true;
+    } else {
+        LOGERROR("Query %s failed", name);
+        return false;
+    }
+}
+
+bool OSRSession::FindCachedQuery(const QueryKey& key, PluginConfig& pluginConfig)
+{
+    lock_guard<mutex> stateLock(stateMutex);
+    if (!IsOpen()) {
+        return false;
+    }
+    auto cached = queryCache.find(key);
+    if (cached == queryCache.end()) {
+        return false;
+    }
+    queryCacheHits++;
+    pluginConfig = cached->second;
+    return true;
+}
+
+bool OSRSession::ImageEnhancingSync(BufferDescriptor& inBuffer, BufferDescriptor& outBuffer, u32 timeOut)
+{
+    lock_guard<mutex> lock(callMutex);
+    if (!IsOpen()) {
+        return false;
+    }
+    const f32 sharpness = 0.9f;
+    const bool toneMapping = true;
+
+    // set opcode
+    enhanceFrame.Set<s32>(0, SYNC_IMAGE_ENHANCING);
+    // set val
+    enhanceFrame.Set<void*>(1, static_cast<void*>(&inBuffer));
+    enhanceFrame.Set<f32>(2, sharpness);
+    enhanceFrame.Set<bool>(3, toneMapping);
+    enhanceFrame.Set<s32>(4, timeOut);
+    enhanceFrame.SetOut<void*>(0, static_cast<void*>(&outBuffer));
+
+    // call fn:SYNC_IMAGE_ENHANCING
+    bool success = enhanceFrame.Execute(*plugin);
+    if (success) {
+        LOGINFO("Sync ImageEnhancing success");
+        return true;
+    } else {
+        LOGERROR("Sync ImageEnhancing failed");
+        return false;
+    }
+}
+
+bool OSRSession::SuperSamplingSync(BufferDescriptor& inBuffer, BufferDescriptor& outBuffer, u32 timeOut)
+{
+    lock_guard<mutex> lock(callMutex);
+    if (!IsOpen()) {
+        return false;
+    }
+    // set opcode
+    superSamplingFrame.Set<s32>(0, SYNC_SUPER_SAMPLING);
+    // set val
+    superSamplingFrame.Set<void*>(1, static_cast<void*>(&inBuffer));
+    superSamplingFrame.Set<s32>(2, timeOut);
+    superSamplingFrame.SetOut<void*>(0, static_cast<void*>(&outBuffer));
+
+    // call fn:SYNC_SUPER_SAMPLING
+    bool success = superSamplingFrame.Execute(*plugin);
+    if (success) {
+        LOGINFO("Sync SuperSampling success");
+        return true;
+    } else {
+        LOGERROR("Sync SuperSampling failed");
+        return false;
+    }
+}
+
+bool OSRSession::PluginInit()
+{
+    if (standInPlugin != nullptr) {
+        plugin = standInPlugin;
+        return true;
+    }
+
+    vector<String> pluginList;
+
+    gPluginManager.Initialize();
+    pluginList = gPluginManager.GetPluginList();
+    if (find(pluginList.begin(), pluginList.end(), pluginName) == pluginList.end()) {
+        LOGERROR("Cannot find plugin %s!", pluginName.c_str());
+        gPluginManager.Uninitialize();
+        return FallBackToCpu();
+    }
+
+    plugin = gPluginManager.LoadPlugin(pluginName);
+    if (plugin == nullptr) {
+        LOGERROR("No plugin loaded!");
+        gPluginManager.Uninitialize();
+        return FallBackToCpu();
+    }
+    LOGINFO("Load Plugin %s successfully!", pluginName.c_str());
+
+    if (!plugin->IsPluginActive()) {
+        LOGERROR("Plugin %s was not activated!", pluginName.c_str());
+        PluginDeInit();
+        return FallBackToCpu();
+    }
+    return true;
+}
+
+bool OSRSession::FallBackToCpu()
+{
+    if (!cpuFallback) {
+        return false;
+    }
+    LOGINFO("Enhancing with %s instead of %s", cpuPlugin.GetPluginInfo().c_str(), pluginName.c_str());
+    plugin = &cpuPlugin;
+    return true;
+}
+
+void OSRSession::PluginDeInit()
+{
+    bool loaded = (plugin != standInPlugin && plugin != &cpuPlugin);
+    plugin = nullptr;
+    if (!loaded) {
+        return;
+    }
+    gPluginManager.UnloadPlugin(pluginName);
+    gPluginManager.Uninitialize();
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Local stand-in for the OfflineSupRes plugin.
+ */
+
+#include <thread>
+#include "OSRPlugin/OSRPlugin.h"
+#include "OSRPlugin/OSRStandInPlugin.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+u64 GetCurrentTimeMicroSecond()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BufferDescriptor* GetBuffer(const Param& param, u32 idx)
+{
+    if (!param.IsArray() || param.ArrayLen() <= idx || !param.Get(idx).IsPointer()) {
+        return nullptr;
+    }
+    return static_cast<BufferDescriptor*>(const_cast<void*>(param.Get(idx).Get()));
+}
+
+bool IsValid(const BufferDescriptor* buffer)
+{
+    return buffer != nullptr && buffer->addr != nullptr && buffer->width > 0 && buffer->height > 0 &&
+        buffer->len >= buffer->width * buffer->height;
+}
+}
+
+OSRStandInPlugin::OSRStandInPlugin(f32 costMs, u32 scale) : m_costMs(costMs), m_scale(scale > 0 ? scale : 1) {}
+
+OSRStandInPlugin::~OSRStandInPlugin() {}
+
+const String& OSRStandInPlugin::GetPluginInfo() const
+{
+    return m_info;
+}
+
+bool OSRStandInPlugin::Initialize()
+{
+    return true;
+}
+
+void OSRStandInPlugin::Uninitialize() {}
+
+bool OSRStandInPlugin::Execute(const Param& paramIn, Param& paramOut)
+{
+    if (!paramIn.IsArray() || paramIn.ArrayLen() == 0 || !paramIn.Get(0).IsInt()) {
+        return false;
+    }
+    switch (paramIn.Get(0).Get<s32>()) {
+        case SET_ASSETS_DIR:
+            return LoadModel(paramIn);
+        case QUERY_SUPER_SAMPLING:
+            return Query(paramIn, paramOut, m_scale);
+        case QUERY_IMAGE_ENHANCING:
+            return Query(paramIn, paramOut, 1);
+        case SYNC_SUPER_SAMPLING:
+            return SuperSample(paramIn, paramOut);
+        case SYNC_IMAGE_ENHANCING:
+            return Enhance(paramIn, paramOut);
+        default:
+            return false;
+    }
+}
+
+bool OSRStandInPlugin::LoadModel(const Param& paramIn)
+{
+    if (paramIn.ArrayLen() < 2 || !paramIn.Get(1).IsPointer() || paramIn.Get(1).Get() == nullptr) {
+        return false;
+    }
+    String path = static_cast<const c8*>(paramIn.Get(1).Get());
+    if (path.length() != 0 && path[path.length() - 1] != '/') {
+        path += "/";
+    }
+    path += "ie_data.bin";
+    ifstream fIn(path, ios::in | ios::binary | ios::ate);
+    if (!fIn.is_open()) {
+        // the stand-in does not need the model, missing data only makes cold starts cheaper
+        m_model.clear();
+        return true;
+    }
+    m_model.resize(static_cast<size_t>(fIn.tellg()));
+    fIn.seekg(0, ios::beg);
+    return static_cast<bool>(fIn.read(reinterpret_cast<c8*>(m_model.data()), m_model.size()));
+}
+
+bool OSRStandInPlugin::Query(const Param& paramIn, const Param& paramOut, u32 scale)
+{
+    const u32 argCount = 4;
+    if (paramIn.ArrayLen() < argCount || !paramOut.IsArray() || paramOut.ArrayLen() == 0) {
+        return false;
+    }
+    PluginConfig* config = static_cast<PluginConfig*>(const_cast<void*>(paramOut.Get(0).Get()));
+    if (config == nullptr) {
+        return false;
+    }
+    config->input.width = paramIn.Get(1).Get<s32>();
+    config->input.height = paramIn.Get(2).Get<s32>();
+    config->input.format = static_cast<PixelFormat>(paramIn.Get(3).Get<s32>());
+    config->output.width = config->input.width * scale;
+    config->output.height = config->input.height * scale;
+    config->output.format = config->input.format;
+    config->estimatedCostTime = m_costMs;
+    return true;
+}
+
+bool OSRStandInPlugin::Enhance(const Param& paramIn, const Param& paramOut)
+{
+    u64 startUs = GetCurrentTimeMicroSecond();
+    BufferDescriptor* in = GetBuffer(paramIn, 1);
+    BufferDescriptor* out = GetBuffer(paramOut, 0);
+    if (!IsValid(in) || !IsValid(out) || in->width != out->width || in->height != out->height) {
+        return false;
+    }
+    memcpy(out->addr, in->addr, min(in->len, out->len));
+    Stall(startUs);
+    return true;
+}
+
+bool OSRStandInPlugin::SuperSample(const Param& paramIn, const Param& paramOut)
+{
+    u64 startUs = GetCurrentTimeMicroSecond();
+    BufferDescriptor* in = GetBuffer(paramIn, 1);
+    BufferDescriptor* out = GetBuffer(paramOut, 0);
+    if (!IsValid(in) || !IsValid(out)) {
+        return false;
+    }
+    u32 bpp = in->len / (in->width * in->height);
+    if (bpp == 0 || out->len < out->width * out->height * static_cast<s32>(bpp)) {
+        return false;
+    }
+    const u8* src = static_cast<const u8*>(in->addr);
+    u8* dst = static_cast<u8*>(out->addr);
+    for (s32 y = 0; y < out->height; y++) {
+        const u8* srcRow = src + static_cast<u64>(y * in->height / out->height) * in->width * bpp;
+        for (s32 x = 0; x < out->width; x++) {
+            memcpy(dst, srcRow + static_cast<u64>(x * in->width / out->width) * bpp, bpp);
+            dst += bpp;
+        }
+    }
+    Stall(startUs);
+    return true;
+}
+
+void OSRStandInPlugin::Stall(u64 startUs) const
+{
+    u64 costUs = static_cast<u64>(m_costMs * 1000.0f);
+    u64 elapsedUs = GetCurrentTimeMicroSecond() - startUs;
+    if (elapsedUs < costUs) {
+        this_thread::sleep_for(chrono::microseconds(costUs - elapsedUs));
+    }
+}
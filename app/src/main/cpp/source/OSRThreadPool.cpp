@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Fixed set of worker threads for data parallel loops.
+ */
+
+#include "OSRPlugin/OSRThreadPool.h"
+
+using namespace std;
+using namespace CGKit;
+
+OSRThreadPool::OSRThreadPool(u32 workers) : m_workers(workers > 0 ? workers : max(1u, thread::hardware_concurrency()))
+{
+}
+
+OSRThreadPool::~OSRThreadPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (thread& t : m_threads) {
+        t.join();
+    }
+}
+
+void OSRThreadPool::Start()
+{
+    for (u32 worker = 1; worker < m_workers; worker++) {
+        m_threads.emplace_back(&OSRThreadPool::WorkerLoop, this, worker);
+    }
+}
+
+void OSRThreadPool::ParallelFor(u32 count, const function<void(u32 index, u32 worker)>& task)
+{
+    if (count == 0) {
+        return;
+    }
+    lock_guard<mutex> loopLock(m_loopMutex);
+    if (m_workers == 1 || count == 1) {
+        for (u32 i = 0; i < count; i++) {
+            task(i, 0);
+        }
+        return;
+    }
+    if (m_threads.empty()) {
+        Start();
+    }
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_next = 0;
+        m_running = m_workers;
+        m_generation++;
+    }
+    m_wakeUp.notify_all();
+    RunTasks(0);
+    unique_lock<mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_running == 0; });
+    m_task = nullptr;
+}
+
+void OSRThreadPool::WorkerLoop(u32 worker)
+{
+    u64 seen = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [this, seen]() { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+        }
+        RunTasks(worker);
+    }
+}
+
+void OSRThreadPool::RunTasks(u32 worker)
+{
+    unique_lock<mutex> lock(m_mutex);
+    while (m_next < m_count) {
+        u32 index = m_next++;
+        lock.unlock();
+        (*m_task)(index, worker);
+        lock.lock();
+    }
+    if (--m_running == 0) {
+        m_done.notify_one();
+    }
+}
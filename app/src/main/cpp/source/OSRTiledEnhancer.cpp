@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Tiled image enhancing for images larger than one plugin call can take.
+ */
+
+#define CGKIT_LOG
+#include "OSRPlugin/OSRTiledEnhancer.h"
+#include "OSRPlugin/PNMCodec.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+/*
+ * Output pixels a tile contributes to along one axis: the weight ramps up over [lo, rampInEnd), stays 1
+ * up to rampOutStart and ramps down until hi. The ramps of two neighbours cover the same window and add
+ * up to 1, so every output pixel ends up with a total weight of 1.
+ */
+struct Span {
+    u32 lo;
+    u32 rampInEnd;
+    u32 rampOutStart;
+    u32 hi;
+};
+
+bool MakeSpans(const vector<u32>& starts, u32 tileSize, u32 size, u32 overlap, u32 scale, vector<Span>& spans)
+{
+    size_t count = starts.size();
+    spans.assign(count, Span {0, 0, size * scale, size * scale});
+    for (size_t i = 0; i + 1 < count; i++) {
+        // the blend window is centred in what the two tiles share
+        u32 shareStart = starts[i + 1] * scale;
+        u32 shareEnd = (starts[i] + tileSize) * scale;
+        u32 window = min(overlap * scale, shareEnd - shareStart);
+        u32 windowStart = shareStart + (shareEnd - shareStart - window) / 2;
+        spans[i].rampOutStart = windowStart;
+        spans[i].hi = windowStart + window;
+        spans[i + 1].lo = windowStart;
+        spans[i + 1].rampInEnd = windowStart + window;
+    }
+    for (const Span& span : spans) {
+        if (span.rampInEnd > span.rampOutStart) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Weight of every output pixel of a tile along one axis, zero outside its span.
+vector<f32> MakeWeights(const Span& span, u32 origin, u32 length)
+{
+    vector<f32> weights(length, 0.0f);
+    for (u32 i = 0; i < length; i++) {
+        u32 pos = origin + i;
+        if (pos < span.lo || pos >= span.hi) {
+            continue;
+        }
+        if (pos < span.rampInEnd) {
+            weights[i] = (pos - span.lo + 0.5f) / (span.rampInEnd - span.lo);
+        } else if (pos >= span.rampOutStart) {
+            weights[i] = (span.hi - pos - 0.5f) / (span.hi - span.rampOutStart);
+        } else {
+            weights[i] = 1.0f;
+        }
+    }
+    return weights;
+}
+
+template <typename T>
+void Accumulate(f32* acc, const T* src, const f32* weights, u32 count, u32 channels)
+{
+    for (u32 x = 0; x < count; x++) {
+        f32 weight = weights[x];
+        for (u32 c = 0; c < channels; c++) {
+            acc[c] += src[c] * weight;
+        }
+        acc += channels;
+        src += channels;
+    }
+}
+
+// Rounds the sums of every contribution to a pixel once, they add up to at most maxVal plus rounding.
+template <typename T>
+void Store(T* dst, const f32* acc, size_t samples)
+{
+    const f32 maxVal = static_cast<f32>(numeric_limits<T>::max());
+    for (size_t i = 0; i < samples; i++) {
+        f32 value = acc[i] + 0.5f;
+        dst[i] = static_cast<T>(value < maxVal ? value : maxVal);
+    }
+}
+
+/*
+ * Fades from the blend the tile row above left in dst to blend, weight being that of the tile row below.
+ * The weights of two neighbouring tile rows add up to 1.
+ */
+template <typename T, typename S>
+void Fade(T* dst, const S* blend, size_t samples, f32 weight)
+{
+    const f32 maxVal = static_cast<f32>(numeric_limits<T>::max());
+    const f32 aboveWeight = 1.0f - weight;
+    for (size_t i = 0; i < samples; i++) {
+        f32 value = dst[i] * aboveWeight + blend[i] * weight + 0.5f;
+        dst[i] = static_cast<T>(value < maxVal ? value : maxVal);
+    }
+}
+
+void AccumulateRow(f32* acc, const u8* src, const f32* weights, u32 count, u32 channels, u32 bytesPerSample)
+{
+    if (bytesPerSample == 1) {
+        Accumulate<u8>(acc, src, weights, count, channels);
+    } else {
+        Accumulate<u16>(acc, reinterpret_cast<const u16*>(src), weights, count, channels);
+    }
+}
+
+// Stores the sums of acc, faded into dst by weight unless it is 1.
+void StoreRow(u8* dst, const f32* acc, size_t samples, u32 bytesPerSample, f32 weight)
+{
+    if (weight < 1.0f && bytesPerSample == 1) {
+        Fade<u8, f32>(dst, acc, samples, weight);
+    } else if (weight < 1.0f) {
+        Fade<u16, f32>(reinterpret_cast<u16*>(dst), acc, samples, weight);
+    } else if (bytesPerSample == 1) {
+        Store<u8>(dst, acc, samples);
+    } else {
+        Store<u16>(reinterpret_cast<u16*>(dst), acc, samples);
+    }
+}
+
+// Copies the samples of src, faded into dst by weight unless it is 1.
+void CopyRow(u8* dst, const u8* src, size_t samples, u32 bytesPerSample, f32 weight)
+{
+    if (weight >= 1.0f) {
+        memcpy(dst, src, samples * bytesPerSample);
+    } else if (bytesPerSample == 1) {
+        Fade<u8, u8>(dst, src, samples, weight);
+    } else {
+        Fade<u16, u16>(reinterpret_cast<u16*>(dst), reinterpret_cast<const u16*>(src), samples, weight);
+    }
+}
+}
+
+OSRTiledEnhancer::OSRTiledEnhancer(OSRSession& session, const OSRTileConfig& config)
+    : m_session(session), m_config(config), m_pool(max(config.workers, 1u))
+{
+    m_config.workers = max(m_config.workers, 1u);
+}
+
+OSRTiledEnhancer::~OSRTiledEnhancer() {}
+
+OSRTiledEnhancer::Axis OSRTiledEnhancer::PlanAxis(u32 size, u32 tileSize, u32 overlap)
+{
+    Axis axis;
+    axis.tileSize = min(tileSize, size);
+    if (size <= tileSize) {
+        axis.starts.push_back(0);
+        return axis;
+    }
+    // fewest tiles that keep at least overlap pixels shared, then spread them evenly
+    u32 step = tileSize - overlap;
+    u32 count = (size - overlap + step - 1) / step;
+    for (u32 i = 0; i < count; i++) {
+        axis.starts.push_back(static_cast<u32>((static_cast<u64>(i) * (size - tileSize) + (count - 1) / 2) /
+            (count - 1)));
+    }
+    return axis;
+}
+
+bool OSRTiledEnhancer::Plan(const BufferDescriptor& inBuffer, Layout& layout)
+{
+    if (inBuffer.width <= 0 || inBuffer.height <= 0 ||
+        !PNMCodec::GetSampleLayout(inBuffer.format, layout.channels, layout.bytesPerSample)) {
+        LOGERROR("Cannot tile a %dx%d image of format %d", inBuffer.width, inBuffer.height, inBuffer.format);
+        return false;
+    }
+    u32 width = static_cast<u32>(inBuffer.width);
+    u32 height = static_cast<u32>(inBuffer.height);
+    const u32 minTilesPerOverlap = 4;
+    if ((width > m_config.tileWidth && m_config.tileWidth < m_config.overlap * minTilesPerOverlap) ||
+        (height > m_config.tileHeight && m_config.tileHeight < m_config.overlap * minTilesPerOverlap) ||
+        m_config.tileWidth <= m_config.overlap || m_config.tileHeight <= m_config.overlap) {
+        LOGERROR("Overlap %u is too large for %ux%u tiles", m_config.overlap, m_config.tileWidth,
+                 m_config.tileHeight);
+        return false;
+    }
+    layout.x = PlanAxis(width, m_config.tileWidth, m_config.overlap);
+    layout.y = PlanAxis(height, m_config.tileHeight, m_config.overlap);
+    m_tileCount = static_cast<u32>(layout.x.starts.size() * layout.y.starts.size());
+
+    BufferDescriptor tile {nullptr, 0, static_cast<int>(layout.x.tileSize), static_cast<int>(layout.y.tileSize),
+        inBuffer.format};
+    tile.len = static_cast<int>(layout.x.tileSize * layout.y.tileSize * layout.channels * layout.bytesPerSample);
+    if (!m_session.QueryImage(tile, layout.tileConfig)) {
+        return false;
+    }
+    const PluginConfig& tileConfig = layout.tileConfig;
+    if (tileConfig.output.width <= 0 || tileConfig.output.height <= 0 ||
+        tileConfig.output.width % tile.width != 0 || tileConfig.output.height % tile.height != 0 ||
+        tileConfig.output.format != inBuffer.format) {
+        LOGERROR("Cannot blend %dx%d tiles enhanced into %dx%d of format %d", tile.width, tile.height,
+                 tileConfig.output.width, tileConfig.output.height, tileConfig.output.format);
+        return false;
+    }
+    layout.scaleX = static_cast<u32>(tileConfig.output.width / tile.width);
+    layout.scaleY = static_cast<u32>(tileConfig.output.height / tile.height);
+    return true;
+}
+
+bool OSRTiledEnhancer::QueryImage(const BufferDescriptor& inBuffer, PluginConfig& pluginConfig)
+{
+    Layout layout;
+    if (!Plan(inBuffer, layout)) {
+        return false;
+    }
+    pluginConfig = layout.tileConfig;
+    pluginConfig.input.width = inBuffer.width;
+    pluginConfig.input.height = inBuffer.height;
+    pluginConfig.input.format = inBuffer.format;
+    pluginConfig.output.width = inBuffer.width * layout.scaleX;
+    pluginConfig.output.height = inBuffer.height * layout.scaleY;
+    pluginConfig.estimatedCostTime = layout.tileConfig.estimatedCostTime * m_tileCount;
+    return true;
+}
+
+u64 OSRTiledEnhancer::GetTileBytes(const BufferDescriptor& inBuffer)
+{
+    Layout layout;
+    if (!Plan(inBuffer, layout)) {
+        return 0;
+    }
+    u64 pixelBytes = layout.channels * layout.bytesPerSample;
+    u64 tileBytes = static_cast<u64>(layout.x.tileSize) * layout.y.tileSize * pixelBytes +
+        static_cast<u64>(layout.tileConfig.output.width) * layout.tileConfig.output.height * pixelBytes;
+    // one strip of blend sums as high as an output tile
+    u64 strips = min<u64>(layout.x.starts.size() - 1, 1);
+    u64 sampleSums = strips * m_config.overlap * layout.scaleX * layout.tileConfig.output.height * layout.channels;
+    return tileBytes + sampleSums * sizeof(f32);
+}
+
+bool OSRTiledEnhancer::Enhance(const BufferDescriptor& inBuffer, BufferDescriptor& outBuffer)
+{
+    Layout layout;
+    if (inBuffer.addr == nullptr || outBuffer.addr == nullptr || !Plan(inBuffer, layout)) {
+        return false;
+    }
+    const u32 inWidth = static_cast<u32>(inBuffer.width);
+    const u32 inHeight = static_cast<u32>(inBuffer.height);
+    const u32 outWidth = inWidth * layout.scaleX;
+    const u32 outHeight = inHeight * layout.scaleY;
+    const size_t pixelBytes = layout.channels * layout.bytesPerSample;
+    if (outBuffer.width != static_cast<int>(outWidth) || outBuffer.height != static_cast<int>(outHeight) ||
+        outBuffer.format != inBuffer.format ||
+        static_cast<size_t>(outBuffer.len) < static_cast<size_t>(outWidth) * outHeight * pixelBytes ||
+        static_cast<size_t>(inBuffer.len) < static_cast<size_t>(inWidth) * inHeight * pixelBytes) {
+        LOGERROR("OutBuffer does not match the tiled output size %ux%u", outWidth, outHeight);
+        return false;
+    }
+
+    vector<Span> spansX;
+    vector<Span> spansY;
+    if (!MakeSpans(layout.x.starts, layout.x.tileSize, inWidth, m_config.overlap, layout.scaleX, spansX) ||
+        !MakeSpans(layout.y.starts, layout.y.tileSize, inHeight, m_config.overlap, layout.scaleY, spansY)) {
+        LOGERROR("Tiles of %ux%u are too small to blend", layout.x.tileSize, layout.y.tileSize);
+        return false;
+    }
+    const u32 tileOutWidth = layout.x.tileSize * layout.scaleX;
+    const u32 tileOutHeight = layout.y.tileSize * layout.scaleY;
+    vector<vector<f32>> weightsX;
+    vector<vector<f32>> weightsY;
+    for (size_t i = 0; i < spansX.size(); i++) {
+        weightsX.push_back(MakeWeights(spansX[i], layout.x.starts[i] * layout.scaleX, tileOutWidth));
+    }
+    for (size_t i = 0; i < spansY.size(); i++) {
+        weightsY.push_back(MakeWeights(spansY[i], layout.y.starts[i] * layout.scaleY, tileOutHeight));
+    }
+
+    /*
+     * Everything outside the blend windows is copied from exactly one tile. Each tile row is first blended
+     * across its vertical seams: the columns a tile shares with its right neighbour are summed in f32 in
+     * the strip, which that neighbour completes and stores. The rows a tile row shares with the next one
+     * are stored as this blend, and the next tile row fades its own blend into them. Tiles run in row
+     * order, so one strip as high as a tile is all the blending holds, whatever the image size. Sums are
+     * rounded once, except where a vertical and a horizontal seam cross: there the tile row above leaves
+     * a rounded blend, which can move the pixel by one step.
+     */
+    const u8* src = static_cast<const u8*>(inBuffer.addr);
+    u8* dst = static_cast<u8*>(outBuffer.addr);
+    const size_t inStride = inWidth * pixelBytes;
+    const size_t outStride = outWidth * pixelBytes;
+    const u32 channels = layout.channels;
+    const u32 bytesPerSample = layout.bytesPerSample;
+    const u32 tilesX = static_cast<u32>(layout.x.starts.size());
+    const size_t stripStride = static_cast<size_t>(m_config.overlap) * layout.scaleX * channels;
+    vector<f32> strip(tilesX > 1 ? stripStride * tileOutHeight : 0);
+    const size_t tileInStride = layout.x.tileSize * pixelBytes;
+    const size_t tileOutStride = tileOutWidth * pixelBytes;
+    vector<u8> tileIn(tileInStride * layout.y.tileSize);
+    vector<u8> tileOut(tileOutStride * tileOutHeight);
+
+    LOGINFO("Enhancing %ux%u in %u tiles of %ux%u", inWidth, inHeight, m_tileCount, layout.x.tileSize,
+            layout.y.tileSize);
+    for (u32 t = 0; t < m_tileCount; t++) {
+        const u32 ix = t % tilesX;
+        const u32 iy = t / tilesX;
+        const u32 x0 = layout.x.starts[ix];
+        const u32 y0 = layout.y.starts[iy];
+        for (u32 y = 0; y < layout.y.tileSize; y++) {
+            memcpy(tileIn.data() + y * tileInStride, src + (y0 + y) * inStride + x0 * pixelBytes, tileInStride);
+        }
+        BufferDescriptor in {tileIn.data(), static_cast<int>(tileIn.size()), static_cast<int>(layout.x.tileSize),
+            static_cast<int>(layout.y.tileSize), inBuffer.format};
+        BufferDescriptor out {tileOut.data(), static_cast<int>(tileOut.size()), static_cast<int>(tileOutWidth),
+            static_cast<int>(tileOutHeight), inBuffer.format};
+        if (!m_session.ImageEnhancingSync(in, out)) {
+            LOGERROR("Enhancing tile %u of %u failed", t, m_tileCount);
+            return false;
+        }
+
+        // plugin calls are serialised by the session, only blending the rows of a tile runs in parallel
+        const Span& spanX = spansX[ix];
+        const Span& spanY = spansY[iy];
+        const u32 originX = x0 * layout.scaleX;
+        const u32 originY = y0 * layout.scaleY;
+        const f32* rowWeightsX = weightsX[ix].data();
+        m_pool.ParallelFor(spanY.hi - spanY.lo, [&](u32 index, u32) {
+            const u32 y = spanY.lo + index;
+            const u8* srcRow = tileOut.data() + (y - originY) * tileOutStride;
+            u8* dstRow = dst + y * outStride;
+            // the ramp down of the tile row above is already stored, the ramp down of this one is stored as is
+            const f32 weightY = (y < spanY.rampInEnd) ? weightsY[iy][y - originY] : 1.0f;
+            f32* stripRow = strip.data() + (y - originY) * stripStride;
+            if (spanX.lo != spanX.rampInEnd) {
+                AccumulateRow(stripRow, srcRow + (spanX.lo - originX) * pixelBytes, rowWeightsX + (spanX.lo - originX),
+                    spanX.rampInEnd - spanX.lo, channels, bytesPerSample);
+                StoreRow(dstRow + spanX.lo * pixelBytes, stripRow, (spanX.rampInEnd - spanX.lo) * channels,
+                    bytesPerSample, weightY);
+            }
+            CopyRow(dstRow + spanX.rampInEnd * pixelBytes, srcRow + (spanX.rampInEnd - originX) * pixelBytes,
+                (spanX.rampOutStart - spanX.rampInEnd) * channels, bytesPerSample, weightY);
+            if (spanX.rampOutStart != spanX.hi) {
+                fill(stripRow, stripRow + (spanX.hi - spanX.rampOutStart) * channels, 0.0f);
+                AccumulateRow(stripRow, srcRow + (spanX.rampOutStart - originX) * pixelBytes,
+                    rowWeightsX + (spanX.rampOutStart - originX), spanX.hi - spanX.rampOutStart, channels,
+                    bytesPerSample);
+            }
+        });
+    }
+    return true;
+}
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Memory-mapped PNM(P5/P6) reader and writer for plugin buffers.
+ */
+
+#define CGKIT_LOG
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "Log/Log.h"
+#include "OSRPlugin/PNMCodec.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+constexpr u32 MAX_VAL_8BIT = 255;
+constexpr u32 MAX_VAL_16BIT = 65535;
+
+struct Mapping {
+    void* base;
+    size_t length;
+    /** 16-bit samples of a shared mapping still need swapping back to big-endian */
+    bool swapOnRelease;
+};
+
+// Mappings handed out by Read, keyed by the pixel address stored in BufferDescriptor.addr.
+mutex& GetMappingMutex()
+{
+    static mutex mappingMutex;
+    return mappingMutex;
+}
+
+map<void*, Mapping>& GetMappings()
+{
+    static map<void*, Mapping> mappings;
+    return mappings;
+}
+
+bool IsSpace(u8 c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+bool IsDigit(u8 c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool SkipSpaceAndComments(const u8* data, size_t size, size_t& pos)
+{
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n') {
+                pos++;
+            }
+        } else if (IsSpace(data[pos])) {
+            pos++;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReadNumber(const u8* data, size_t size, size_t& pos, u32& value)
+{
+    if (!SkipSpaceAndComments(data, size, pos) || !IsDigit(data[pos])) {
+        return false;
+    }
+    u64 number = 0;
+    while (pos < size && IsDigit(data[pos])) {
+        number = number * 10 + (data[pos] - '0');
+        if (number > numeric_limits<u32>::max()) {
+            return false;
+        }
+        pos++;
+    }
+    value = static_cast<u32>(number);
+    return true;
+}
+
+// PNM stores 16-bit samples big-endian, swapping is its own inverse.
+void SwapBytes16(u8* dst, const u8* src, size_t size)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    if (dst != src) {
+        memcpy(dst, src, size);
+    }
+#else
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        u8 high = src[i];
+        dst[i] = src[i + 1];
+        dst[i + 1] = high;
+    }
+#endif
+}
+
+/*
+ * Scales samples of maxVal to the full range of their size, 255 or 65535, rounding to nearest. Samples
+ * above maxVal are out of spec and clamped. Runs after the byte swap, so 16-bit samples are native.
+ */
+void ScaleToFullRange(u8* pixels, size_t size, u32 maxVal)
+{
+    if (maxVal <= MAX_VAL_8BIT) {
+        u8 table[MAX_VAL_8BIT + 1];
+        for (u32 value = 0; value <= MAX_VAL_8BIT; value++) {
+            table[value] = static_cast<u8>((min(value, maxVal) * MAX_VAL_8BIT + maxVal / 2) / maxVal);
+        }
+        for (size_t i = 0; i < size; i++) {
+            pixels[i] = table[pixels[i]];
+        }
+        return;
+    }
+    vector<u16> table(MAX_VAL_16BIT + 1);
+    for (u32 value = 0; value <= MAX_VAL_16BIT; value++) {
+        table[value] = static_cast<u16>((min(value, maxVal) * MAX_VAL_16BIT + maxVal / 2) / maxVal);
+    }
+    // the samples follow a header of any length, so they may not be 2-byte aligned
+    for (size_t i = 0; i + 1 < size; i += sizeof(u16)) {
+        u16 sample;
+        memcpy(&sample, pixels + i, sizeof(sample));
+        sample = table[sample];
+        memcpy(pixels + i, &sample, sizeof(sample));
+    }
+}
+
+PixelFormat ToPixelFormat(u32 channels, u32 bytesPerSample)
+{
+    if (channels == 1) {
+        return bytesPerSample == 1 ? PIXEL_FORMAT_R8_UNORM : PIXEL_FORMAT_R16_UINT;
+    }
+    return bytesPerSample == 1 ? PIXEL_FORMAT_R8G8B8_UNORM : PIXEL_FORMAT_R16G16B16_UINT;
+}
+
+int FormatHeader(c8* header, size_t size, u32 channels, u32 bytesPerSample, u32 width, u32 height)
+{
+    int headerSize = snprintf(header, size, "P%c\n%u %u\n%u\n", channels == 1 ? '5' : '6', width, height,
+        bytesPerSample == 1 ? MAX_VAL_8BIT : MAX_VAL_16BIT);
+    return (headerSize > 0 && static_cast<size_t>(headerSize) < size) ? headerSize : -1;
+}
+
+// Creates path with the given size and maps it shared, the file starts zero filled.
+u8* MapOutput(const String& path, size_t length)
+{
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        LOGERROR("mmap %s failed", path.c_str());
+        return nullptr;
+    }
+    return static_cast<u8*>(base);
+}
+}
+
+bool PNMCodec::ParseHeader(const u8* data, size_t size, PNMHeader& header)
+{
+    const size_t magicSize = 2;
+    if (data == nullptr || size < magicSize || data[0] != 'P' || (data[1] != '5' && data[1] != '6')) {
+        return false;
+    }
+    size_t pos = magicSize;
+    if (!ReadNumber(data, size, pos, header.width) || !ReadNumber(data, size, pos, header.height) ||
+        !ReadNumber(data, size, pos, header.maxVal)) {
+        return false;
+    }
+    // exactly one whitespace separates maxval from the samples
+    if (pos >= size || !IsSpace(data[pos])) {
+        return false;
+    }
+    pos++;
+    if (header.width == 0 || header.height == 0 || header.maxVal == 0 || header.maxVal > MAX_VAL_16BIT) {
+        return false;
+    }
+    header.channels = (data[1] == '5') ? 1 : 3;
+    u64 bytesPerSample = (header.maxVal > MAX_VAL_8BIT) ? 2 : 1;
+    u64 dataSize = static_cast<u64>(header.width) * header.height * header.channels * bytesPerSample;
+    if (dataSize > size - pos) {
+        return false;
+    }
+    header.dataOffset = pos;
+    header.dataSize = static_cast<size_t>(dataSize);
+    return true;
+}
+
+bool PNMCodec::Read(const String& path, BufferDescriptor& buffer)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t length = static_cast<size_t>(fileStat.st_size);
+    // private and writable: callers may scribble on input buffers without touching the file
+    void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        LOGERROR("mmap %s failed", path.c_str());
+        return false;
+    }
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    PNMHeader header;
+    if (!ParseHeader(static_cast<const u8*>(base), length, header) ||
+        header.dataSize > static_cast<size_t>(numeric_limits<int>::max())) {
+        LOGERROR("%s is not a supported PNM file", path.c_str());
+        munmap(base, length);
+        return false;
+    }
+    u8* pixels = static_cast<u8*>(base) + header.dataOffset;
+    u32 bytesPerSample = (header.maxVal > MAX_VAL_8BIT) ? 2 : 1;
+    if (bytesPerSample == 2) {
+        SwapBytes16(pixels, pixels, header.dataSize);
+    }
+    if (header.maxVal != MAX_VAL_8BIT && header.maxVal != MAX_VAL_16BIT) {
+        ScaleToFullRange(pixels, header.dataSize, header.maxVal);
+    }
+    {
+        lock_guard<mutex> lock(GetMappingMutex());
+        GetMappings()[pixels] = Mapping {base, length, false};
+    }
+    buffer.addr = static_cast<void*>(pixels);
+    buffer.width = static_cast<int>(header.width);
+    buffer.height = static_cast<int>(header.height);
+    buffer.len = static_cast<int>(header.dataSize);
+    buffer.format = ToPixelFormat(header.channels, bytesPerSample);
+    return true;
+}
+
+bool PNMCodec::Write(const String& path, const BufferDescriptor& buffer)
+{
+    u32 channels = 0;
+    u32 bytesPerSample = 0;
+    if (buffer.addr == nullptr || buffer.width <= 0 || buffer.height <= 0 ||
+        !GetSampleLayout(buffer.format, channels, bytesPerSample)) {
+        return false;
+    }
+    size_t dataSize = static_cast<size_t>(buffer.width) * buffer.height * channels * bytesPerSample;
+    if (static_cast<size_t>(buffer.len) < dataSize) {
+        return false;
+    }
+    c8 header[64];
+    int headerSize = FormatHeader(header, sizeof(header), channels, bytesPerSample, buffer.width, buffer.height);
+    if (headerSize < 0) {
+        return false;
+    }
+    size_t length = headerSize + dataSize;
+    u8* dst = MapOutput(path, length);
+    if (dst == nullptr) {
+        return false;
+    }
+    memcpy(dst, header, headerSize);
+    if (bytesPerSample == 2) {
+        SwapBytes16(dst + headerSize, static_cast<const u8*>(buffer.addr), dataSize);
+    } else {
+        memcpy(dst + headerSize, buffer.addr, dataSize);
+    }
+    return munmap(dst, length) == 0;
+}
+
+bool PNMCodec::Create(const String& path, u32 width, u32 height, PixelFormat format, BufferDescriptor& buffer)
+{
+    u32 channels = 0;
+    u32 bytesPerSample = 0;
+    if (width == 0 || height == 0 || !GetSampleLayout(format, channels, bytesPerSample)) {
+        return false;
+    }
+    u64 dataSize = static_cast<u64>(width) * height * channels * bytesPerSample;
+    c8 header[64];
+    int headerSize = FormatHeader(header, sizeof(header), channels, bytesPerSample, width, height);
+    if (headerSize < 0 || dataSize > static_cast<u64>(numeric_limits<int>::max())) {
+        return false;
+    }
+    size_t length = headerSize + static_cast<size_t>(dataSize);
+    u8* base = MapOutput(path, length);
+    if (base == nullptr) {
+        return false;
+    }
+    memcpy(base, header, headerSize);
+    u8* pixels = base + headerSize;
+    {
+        lock_guard<mutex> lock(GetMappingMutex());
+        GetMappings()[pixels] = Mapping {base, length, bytesPerSample == 2};
+    }
+    buffer.addr = static_cast<void*>(pixels);
+    buffer.width = static_cast<int>(width);
+    buffer.height = static_cast<int>(height);
+    buffer.len = static_cast<int>(dataSize);
+    buffer.format = format;
+    return true;
+}
+
+bool PNMCodec::Release(BufferDescriptor& buffer)
+{
+    Mapping mapping;
+    {
+        lock_guard<mutex> lock(GetMappingMutex());
+        map<void*, Mapping>& mappings = GetMappings();
+        auto it = mappings.find(buffer.addr);
+        if (it == mappings.end()) {
+            return false;
+        }
+        mapping = it->second;
+        mappings.erase(it);
+    }
+    if (mapping.swapOnRelease) {
+        u8* pixels = static_cast<u8*>(buffer.addr);
+        SwapBytes16(pixels, pixels, mapping.length - (pixels - static_cast<u8*>(mapping.base)));
+    }
+    munmap(mapping.base, mapping.length);
+    buffer.addr = nullptr;
+    return true;
+}
+
+bool PNMCodec::GetSampleLayout(PixelFormat format, u32& channels, u32& bytesPerSample)
+{
+    switch (format) {
+        case PIXEL_FORMAT_R8_UNORM:
+            channels = 1;
+            bytesPerSample = 1;
+            return true;
+        case PIXEL_FORMAT_R16_UINT:
+            channels = 1;
+            bytesPerSample = 2;
+            return true;
+        case PIXEL_FORMAT_R8G8B8_UNORM:
+            channels = 3;
+            bytesPerSample = 1;
+            return true;
+        case PIXEL_FORMAT_R16G16B16_UINT:
+            channels = 3;
+            bytesPerSample = 2;
+            return true;
+        default:
+            return false;
+    }
+}
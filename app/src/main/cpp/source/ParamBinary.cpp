@@ -0,0 +1,642 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Binary encoding of parameter trees, read in place from memory-mapped files.
+ */
+
+#define CGKIT_LOG
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Log/Log.h"
+#include "Param/ParamBinary.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+constexpr u32 HEADER_MAGIC = 0;
+constexpr u32 HEADER_VERSION = 4;
+constexpr u32 HEADER_SIZE = 8;
+constexpr u32 HEADER_ROOT = 12;
+constexpr u32 HEADER_STRINGS = 16;
+constexpr u32 HEADER_LENGTH = 20;
+constexpr u32 ALIGNMENT = 4;
+constexpr u32 VECTOR2_SIZE = 2;
+constexpr u32 VECTOR3_SIZE = 3;
+constexpr u32 VECTOR4_SIZE = 4;
+constexpr u32 MATRIX4_SIZE = MATRIX4_ROW_SIZE * MATRIX4_COLUMN_SIZE;
+
+/*
+ * Writes the nodes of one tree depth first, collecting strings on the way, then appends the string
+ * table. P is Param or CompactParam, only the API they share is used.
+ */
+class Encoder {
+public:
+    explicit Encoder(vector<u8>& blob) : blob(blob) {}
+
+    template<typename P>
+    void Run(const P& param)
+    {
+        blob.assign(HEADER_LENGTH, 0);
+        u32 root = Node(param);
+        u32 table = WriteStrings();
+        Patch(HEADER_MAGIC, ParamBinary::MAGIC);
+        Patch(HEADER_VERSION, ParamBinary::VERSION);
+        Patch(HEADER_SIZE, static_cast<u32>(blob.size()));
+        Patch(HEADER_ROOT, root);
+        Patch(HEADER_STRINGS, table);
+    }
+
+private:
+    template<typename P>
+    u32 Node(const P& param)
+    {
+        u32 node = static_cast<u32>(blob.size());
+        s32 type = param.IsPointer() ? PARAMETER_TYPE_MAX : static_cast<s32>(param.ParameterType());
+        Append<s32>(type);
+        switch (type) {
+            case PARAMETER_TYPE_BOOLEAN:
+                Append<u32>(param.template Get<bool>() ? 1 : 0);
+                break;
+            case PARAMETER_TYPE_INT:
+                Append<s32>(param.template Get<s32>());
+                break;
+            case PARAMETER_TYPE_FLOAT:
+                Append<f32>(param.template Get<f32>());
+                break;
+            case PARAMETER_TYPE_DOUBLE:
+                Append<f64>(param.template Get<f64>());
+                break;
+            case PARAMETER_TYPE_VECTOR2: {
+                const Vector2& v = param.template Get<Vector2>();
+                AppendFloats({v.x, v.y});
+                break;
+            }
+            case PARAMETER_TYPE_VECTOR3: {
+                const Vector3& v = param.template Get<Vector3>();
+                AppendFloats({v.x, v.y, v.z});
+                break;
+            }
+            case PARAMETER_TYPE_VECTOR4: {
+                const Vector4& v = param.template Get<Vector4>();
+                AppendFloats({v.x, v.y, v.z, v.w});
+                break;
+            }
+            case PARAMETER_TYPE_QUATERNION: {
+                const Quaternion& q = param.template Get<Quaternion>();
+                AppendFloats({q.x, q.y, q.z, q.w});
+                break;
+            }
+            case PARAMETER_TYPE_MATRIX: {
+                const Matrix4& m = param.template Get<Matrix4>();
+                for (u32 i = 0; i < MATRIX4_SIZE; i++) {
+                    Append<f32>(m.m[i]);
+                }
+                break;
+            }
+            case PARAMETER_TYPE_COLOR:
+                Append<u32>(param.template Get<Color>().color);
+                break;
+            case PARAMETER_TYPE_STRING:
+                Append<u32>(StringIndex(param.template Get<String>()));
+                break;
+            case PARAMETER_TYPE_ARRAY:
+                Array(param);
+                break;
+            case PARAMETER_TYPE_OBJECT:
+                Object(param);
+                break;
+            default:
+                break;
+        }
+        return node;
+    }
+
+    template<typename P>
+    void Array(const P& param)
+    {
+        u32 count = static_cast<u32>(param.ArrayLen());
+        Append<u32>(count);
+        u32 offsets = static_cast<u32>(blob.size());
+        blob.resize(blob.size() + count * sizeof(u32));
+        for (u32 i = 0; i < count; i++) {
+            Patch(offsets + i * sizeof(u32), Node(param.Get(i)));
+        }
+    }
+
+    template<typename P>
+    void Object(const P& param)
+    {
+        // Param keeps its members sorted, CompactParam in insertion order
+        vector<String> keys = param.Keys();
+        sort(keys.begin(), keys.end());
+        u32 count = static_cast<u32>(keys.size());
+        Append<u32>(count);
+        u32 members = static_cast<u32>(blob.size());
+        blob.resize(blob.size() + count * 2 * sizeof(u32));
+        for (u32 i = 0; i < count; i++) {
+            u32 member = members + i * 2 * sizeof(u32);
+            Patch(member, StringIndex(keys[i]));
+            Patch(member + sizeof(u32), Node(param.Get(keys[i])));
+        }
+    }
+
+    u32 StringIndex(const String& value)
+    {
+        auto it = stringIndices.find(value);
+        if (it != stringIndices.end()) {
+            return it->second;
+        }
+        u32 idx = static_cast<u32>(strings.size());
+        strings.push_back(&stringIndices.emplace(value, idx).first->first);
+        return idx;
+    }
+
+    u32 WriteStrings()
+    {
+        u32 table = static_cast<u32>(blob.size());
+        u32 count = static_cast<u32>(strings.size());
+        Append<u32>(count);
+        u32 entries = static_cast<u32>(blob.size());
+        blob.resize(blob.size() + count * 2 * sizeof(u32));
+        for (u32 i = 0; i < count; i++) {
+            u32 entry = entries + i * 2 * sizeof(u32);
+            Patch(entry, static_cast<u32>(blob.size()));
+            Patch(entry + sizeof(u32), static_cast<u32>(strings[i]->size()));
+            blob.insert(blob.end(), strings[i]->begin(), strings[i]->end());
+            blob.push_back(0);
+        }
+        blob.resize((blob.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, 0);
+        return table;
+    }
+
+    template<typename T>
+    void Append(T value)
+    {
+        size_t offset = blob.size();
+        blob.resize(offset + sizeof(T));
+        memcpy(blob.data() + offset, &value, sizeof(T));
+    }
+
+    void AppendFloats(initializer_list<f32> values)
+    {
+        for (f32 value : values) {
+            Append<f32>(value);
+        }
+    }
+
+    void Patch(u32 offset, u32 value)
+    {
+        memcpy(blob.data() + offset, &value, sizeof(u32));
+    }
+
+private:
+    vector<u8>& blob;
+    unordered_map<String, u32> stringIndices;
+    // in index order, pointing at the keys of stringIndices
+    vector<const String*> strings;
+};
+
+bool WriteFile(const String& path, const vector<u8>& blob)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOGERROR("Cannot create %s", path.c_str());
+        return false;
+    }
+    size_t written = 0;
+    while (written < blob.size()) {
+        ssize_t n = write(fd, blob.data() + written, blob.size() - written);
+        if (n <= 0) {
+            LOGERROR("Write %s failed", path.c_str());
+            close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return close(fd) == 0;
+}
+
+template<typename P>
+void Decode(const ParamView& view, P& param);
+
+template<typename P>
+void DecodeArray(const ParamView& view, P& param)
+{
+    u32 count = view.ArrayLen();
+    typename P::Array elements(count);
+    for (u32 i = 0; i < count; i++) {
+        Decode(view.Get(i), elements[i]);
+    }
+    param.template Set<typename P::Array>(std::move(elements));
+}
+
+template<typename P>
+void Decode(const ParamView& view, P& param)
+{
+    switch (view.Type()) {
+        case PARAMETER_TYPE_BOOLEAN:
+            param.template Set<bool>(view.Get<bool>());
+            break;
+        case PARAMETER_TYPE_INT:
+            param.template Set<s32>(view.Get<s32>());
+            break;
+        case PARAMETER_TYPE_FLOAT:
+            param.template Set<f32>(view.Get<f32>());
+            break;
+        case PARAMETER_TYPE_DOUBLE:
+            param.template Set<f64>(view.Get<f64>());
+            break;
+        case PARAMETER_TYPE_VECTOR2:
+            param.template Set<Vector2>(view.Get<Vector2>());
+            break;
+        case PARAMETER_TYPE_VECTOR3:
+            param.template Set<Vector3>(view.Get<Vector3>());
+            break;
+        case PARAMETER_TYPE_VECTOR4:
+            param.template Set<Vector4>(view.Get<Vector4>());
+            break;
+        case PARAMETER_TYPE_MATRIX:
+            param.template Set<Matrix4>(view.Get<Matrix4>());
+            break;
+        case PARAMETER_TYPE_QUATERNION:
+            param.template Set<Quaternion>(view.Get<Quaternion>());
+            break;
+        case PARAMETER_TYPE_COLOR:
+            param.template Set<Color>(view.Get<Color>());
+            break;
+        case PARAMETER_TYPE_STRING:
+            param.template Set<String>(view.Get<String>());
+            break;
+        case PARAMETER_TYPE_ARRAY:
+            DecodeArray(view, param);
+            break;
+        case PARAMETER_TYPE_OBJECT:
+            param.template Set<typename P::Object>(typename P::Object());
+            for (s32 i = 0; i < view.Size(); i++) {
+                const c8* key = view.KeyAt(i);
+                if (key != nullptr) {
+                    Decode(view.ValueAt(i), param.template Get<typename P::Object>()[key]);
+                }
+            }
+            break;
+        default:
+            param.Clear();
+            break;
+    }
+}
+}
+
+void ParamBinary::Encode(const Param& param, vector<u8>& blob)
+{
+    Encoder(blob).Run(param);
+}
+
+void ParamBinary::Encode(const CompactParam& param, vector<u8>& blob)
+{
+    Encoder(blob).Run(param);
+}
+
+bool ParamBinary::Save(const String& path, const Param& param)
+{
+    vector<u8> blob;
+    Encode(param, blob);
+    return WriteFile(path, blob);
+}
+
+bool ParamBinary::Save(const String& path, const CompactParam& param)
+{
+    vector<u8> blob;
+    Encode(param, blob);
+    return WriteFile(path, blob);
+}
+
+bool ParamView::Read(u32 offset, void* value, u32 length) const
+{
+    if (data == nullptr || offset > size || length > size - offset) {
+        return false;
+    }
+    memcpy(value, data + offset, length);
+    return true;
+}
+
+u32 ParamView::Read32(u32 offset) const
+{
+    u32 value = 0;
+    return Read(offset, &value, sizeof(value)) ? value : 0;
+}
+
+s32 ParamView::Type() const
+{
+    s32 type = PARAMETER_TYPE_MAX;
+    if (node == 0 || !Read(node, &type, sizeof(type)) || type < 0 || type > PARAMETER_TYPE_MAX) {
+        return PARAMETER_TYPE_MAX;
+    }
+    return type;
+}
+
+u32 ParamView::Count() const
+{
+    u32 count = Read32(node + sizeof(u32));
+    // every element or member takes at least one u32, so a larger count is corrupt
+    return (count <= (size - node) / sizeof(u32)) ? count : 0;
+}
+
+ParamView ParamView::Child(u32 offset) const
+{
+    // children follow their parent, which rules out cycles in a corrupt blob
+    if (offset <= node || offset >= size || offset % ALIGNMENT != 0) {
+        return ParamView();
+    }
+    return ParamView(data, size, offset);
+}
+
+const c8* ParamView::StringAt(u32 idx, u32* length) const
+{
+    u32 table = Read32(HEADER_STRINGS);
+    u32 count = Read32(table);
+    if (table == 0 || idx >= count) {
+        return nullptr;
+    }
+    u32 entry = table + sizeof(u32) + idx * 2 * sizeof(u32);
+    u32 offset = Read32(entry);
+    u32 chars = Read32(entry + sizeof(u32));
+    // the terminating NUL must be inside the blob too
+    if (offset == 0 || offset >= size || chars >= size - offset || data[offset + chars] != 0) {
+        return nullptr;
+    }
+    if (length != nullptr) {
+        *length = chars;
+    }
+    return reinterpret_cast<const c8*>(data + offset);
+}
+
+const c8* ParamView::CString(u32* length) const
+{
+    return IsString() ? StringAt(Read32(node + sizeof(u32)), length) : nullptr;
+}
+
+u32 ParamView::ArrayLen() const
+{
+    return IsArray() ? Count() : 0;
+}
+
+ParamView ParamView::Get(u32 idx) const
+{
+    if (idx >= ArrayLen()) {
+        return ParamView();
+    }
+    return Child(Read32(node + (2 + idx) * sizeof(u32)));
+}
+
+ParamView ParamView::Get(const c8* key) const
+{
+    u32 low = 0;
+    u32 high = IsObject() ? Count() : 0;
+    while (low < high) {
+        u32 mid = low + (high - low) / 2;
+        const c8* midKey = KeyAt(mid);
+        if (midKey == nullptr) {
+            return ParamView();
+        }
+        s32 order = strcmp(midKey, key);
+        if (order == 0) {
+            return ValueAt(mid);
+        }
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return ParamView();
+}
+
+s32 ParamView::Size() const
+{
+    if (IsArray()) {
+        return static_cast<s32>(Count());
+    }
+    return IsObject() ? static_cast<s32>(Count()) : 0;
+}
+
+const c8* ParamView::KeyAt(u32 idx) const
+{
+    if (!IsObject() || idx >= Count()) {
+        return nullptr;
+    }
+    return StringAt(Read32(node + (2 + idx * 2) * sizeof(u32)), nullptr);
+}
+
+ParamView ParamView::ValueAt(u32 idx) const
+{
+    if (!IsObject() || idx >= Count()) {
+        return ParamView();
+    }
+    return Child(Read32(node + (3 + idx * 2) * sizeof(u32)));
+}
+
+void ParamView::ToParam(Param& param) const
+{
+    Decode(*this, param);
+}
+
+void ParamView::ToCompactParam(CompactParam& param) const
+{
+    Decode(*this, param);
+}
+
+namespace CGKit {
+template<>
+bool ParamView::Get<bool>() const
+{
+    return Type() == PARAMETER_TYPE_BOOLEAN && Read32(node + sizeof(u32)) != 0;
+}
+
+template<>
+s32 ParamView::Get<s32>() const
+{
+    s32 value = 0;
+    return (Type() == PARAMETER_TYPE_INT && Read(node + sizeof(u32), &value, sizeof(value))) ? value : 0;
+}
+
+template<>
+f32 ParamView::Get<f32>() const
+{
+    f32 value = 0.0f;
+    return (Type() == PARAMETER_TYPE_FLOAT && Read(node + sizeof(u32), &value, sizeof(value))) ? value : 0.0f;
+}
+
+template<>
+f64 ParamView::Get<f64>() const
+{
+    f64 value = 0.0;
+    return (Type() == PARAMETER_TYPE_DOUBLE && Read(node + sizeof(u32), &value, sizeof(value))) ? value : 0.0;
+}
+
+template<>
+Vector2 ParamView::Get<Vector2>() const
+{
+    f32 v[VECTOR2_SIZE] = {};
+    if (Type() == PARAMETER_TYPE_VECTOR2) {
+        Read(node + sizeof(u32), v, sizeof(v));
+    }
+    Vector2 value;
+    value.x = v[0];
+    value.y = v[1];
+    return value;
+}
+
+template<>
+Vector3 ParamView::Get<Vector3>() const
+{
+    f32 v[VECTOR3_SIZE] = {};
+    if (Type() == PARAMETER_TYPE_VECTOR3) {
+        Read(node + sizeof(u32), v, sizeof(v));
+    }
+    Vector3 value;
+    value.x = v[0];
+    value.y = v[1];
+    value.z = v[2];
+    return value;
+}
+
+template<>
+Vector4 ParamView::Get<Vector4>() const
+{
+    f32 v[VECTOR4_SIZE] = {};
+    if (Type() == PARAMETER_TYPE_VECTOR4) {
+        Read(node + sizeof(u32), v, sizeof(v));
+    }
+    Vector4 value;
+    value.x = v[0];
+    value.y = v[1];
+    value.z = v[2];
+    value.w = v[3];
+    return value;
+}
+
+template<>
+Matrix4 ParamView::Get<Matrix4>() const
+{
+    Matrix4 value;
+    f32 m[MATRIX4_SIZE] = {};
+    if (Type() == PARAMETER_TYPE_MATRIX && Read(node + sizeof(u32), m, sizeof(m))) {
+        for (u32 i = 0; i < MATRIX4_SIZE; i++) {
+            value.m[i] = m[i];
+        }
+    }
+    return value;
+}
+
+template<>
+Quaternion ParamView::Get<Quaternion>() const
+{
+    f32 q[VECTOR4_SIZE] = {};
+    if (Type() == PARAMETER_TYPE_QUATERNION) {
+        Read(node + sizeof(u32), q, sizeof(q));
+    }
+    Quaternion value;
+    value.x = q[0];
+    value.y = q[1];
+    value.z = q[2];
+    value.w = q[3];
+    return value;
+}
+
+template<>
+Color ParamView::Get<Color>() const
+{
+    Color value;
+    value.color = (Type() == PARAMETER_TYPE_COLOR) ? Read32(node + sizeof(u32)) : 0;
+    return value;
+}
+
+template<>
+String ParamView::Get<String>() const
+{
+    u32 length = 0;
+    const c8* chars = CString(&length);
+    return (chars != nullptr) ? String(chars, length) : String();
+}
+}  // namespace CGKit
+
+ParamFile::~ParamFile()
+{
+    Close();
+}
+
+bool ParamFile::Open(const String& path)
+{
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t length = static_cast<size_t>(fileStat.st_size);
+    void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        LOGERROR("mmap %s failed", path.c_str());
+        return false;
+    }
+    if (!CheckHeader(static_cast<const u8*>(base), length)) {
+        LOGERROR("%s is not a binary param file", path.c_str());
+        munmap(base, length);
+        return false;
+    }
+    mapping = base;
+    mappingLength = length;
+    return true;
+}
+
+bool ParamFile::Open(const void* blob, size_t length)
+{
+    Close();
+    return blob != nullptr && CheckHeader(static_cast<const u8*>(blob), length);
+}
+
+void ParamFile::Close()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mappingLength);
+    }
+    mapping = nullptr;
+    mappingLength = 0;
+    data = nullptr;
+    size = 0;
+    root = 0;
+}
+
+ParamView ParamFile::Root() const
+{
+    return IsOpen() ? ParamView(data, size, root) : ParamView();
+}
+
+bool ParamFile::CheckHeader(const u8* blob, size_t length)
+{
+    u32 header[HEADER_LENGTH / sizeof(u32)];
+    if (length < HEADER_LENGTH) {
+        return false;
+    }
+    memcpy(header, blob, HEADER_LENGTH);
+    u32 blobSize = header[HEADER_SIZE / sizeof(u32)];
+    u32 rootNode = header[HEADER_ROOT / sizeof(u32)];
+    if (header[HEADER_MAGIC / sizeof(u32)] != ParamBinary::MAGIC || header[HEADER_VERSION / sizeof(u32)] != ParamBinary::VERSION ||
+        blobSize > length || blobSize < HEADER_LENGTH || rootNode < HEADER_LENGTH || rootNode >= blobSize) {
+        return false;
+    }
+    data = blob;
+    size = blobSize;
+    root = rootNode;
+    return true;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Process wide interned keys of parameter objects.
+ */
+
+#include "Param/ParamKey.h"
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+const u32 FNV_OFFSET_BASIS = 2166136261u;
+const u32 FNV_PRIME = 16777619u;
+
+struct KeyHash {
+    size_t operator()(const String& key) const
+    {
+        return ParamKey::Hash(key);
+    }
+};
+
+mutex g_keysMutex;
+// node based, so the String keys and ParamKey values never move once added
+unordered_map<String, ParamKey, KeyHash> g_keys;
+}
+
+u32 ParamKey::Hash(const String& key)
+{
+    // FNV-1a, keys are short and this keeps the hash identical on every ABI
+    u32 hash = FNV_OFFSET_BASIS;
+    for (c8 c : key) {
+        hash = (hash ^ static_cast<u8>(c)) * FNV_PRIME;
+    }
+    return hash;
+}
+
+const ParamKey* ParamKey::Intern(const String& key)
+{
+    lock_guard<mutex> lock(g_keysMutex);
+    auto it = g_keys.find(key);
+    if (it == g_keys.end()) {
+        it = g_keys.emplace(key, ParamKey()).first;
+        it->second.name = &it->first;
+        it->second.hash = Hash(key);
+    }
+    return &it->second;
+}
@@ -0,0 +1,535 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Pixel format conversion for plugin buffers.
+ */
+
+#include <cmath>
+#include "OSRPlugin/PixelConverter.h"
+#include "OSRPlugin/PixelKernels.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+constexpr u32 RGB_BYTES = 3;
+constexpr u32 RGBA_BYTES = 4;
+constexpr u8 OPAQUE = 255;
+constexpr u16 HALF_ONE = 0x3C00;
+
+u8 ClampToU8(s32 value)
+{
+    return static_cast<u8>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// BT.601 luma of an RGB pixel, the SIMD kernels take the same steps in 16-bit lanes.
+u8 Luma(const u8* rgb)
+{
+    return static_cast<u8>((RGB_Y_R * rgb[0] + RGB_Y_G * rgb[1] + RGB_Y_B * rgb[2] + (1 << (RGB_SHIFT - 1))) >>
+        RGB_SHIFT);
+}
+
+// Same steps as the SIMD kernels: scale in f32, clamp, round to nearest even.
+u8 FloatToU8(f32 value)
+{
+    f32 scaled = value * 255.0f;
+    if (!(scaled > 0.0f)) {
+        return 0;
+    }
+    return static_cast<u8>(lrintf(scaled < 255.0f ? scaled : 255.0f));
+}
+
+struct HalfTable {
+    u16 values[256];
+
+    HalfTable()
+    {
+        for (u32 i = 0; i < 256; i++) {
+            values[i] = PixelScalar::FloatToHalf(static_cast<f32>(i) * (1.0f / 255.0f));
+        }
+    }
+};
+
+const HalfTable& GetHalfTable()
+{
+    static const HalfTable table;
+    return table;
+}
+
+// Every half value mapped to u8, 64KB, replaces a float decode per channel.
+struct HalfToU8Table {
+    u8 values[65536];
+
+    HalfToU8Table()
+    {
+        for (u32 i = 0; i < 65536; i++) {
+            values[i] = FloatToU8(PixelScalar::HalfToFloat(static_cast<u16>(i)));
+        }
+    }
+};
+
+const HalfToU8Table& GetHalfToU8Table()
+{
+    static const HalfToU8Table table;
+    return table;
+}
+
+struct Dispatch {
+    PixelKernels kernels;
+    PixelIsa isa;
+
+    Dispatch()
+    {
+        Select(PIXEL_ISA_MAX);
+    }
+
+    // PIXEL_ISA_MAX picks the best available instruction set.
+    bool Select(PixelIsa wanted)
+    {
+        PixelKernels selected = {PixelScalar::RgbaToRgb, PixelScalar::BgraToRgb, PixelScalar::RgbToRgba,
+            PixelScalar::RgbToBgra, PixelScalar::Rgba16fToRgb, PixelScalar::RgbToRgba16f, PixelScalar::YuvToRgb,
+            PixelScalar::RgbToYuv};
+        PixelIsa selectedIsa = PIXEL_ISA_SCALAR;
+        bool found = (wanted == PIXEL_ISA_SCALAR);
+        if (wanted == PIXEL_ISA_MAX) {
+            PixelKernels candidate = selected;
+            if (GetAVX2Kernels(candidate)) {
+                selectedIsa = PIXEL_ISA_AVX2;
+            } else if (GetSSE4Kernels(candidate)) {
+                selectedIsa = PIXEL_ISA_SSE4;
+            } else if (GetNEONKernels(candidate)) {
+                selectedIsa = PIXEL_ISA_NEON;
+            }
+            selected = candidate;
+            found = true;
+        } else if (wanted == PIXEL_ISA_SSE4) {
+            found = GetSSE4Kernels(selected);
+        } else if (wanted == PIXEL_ISA_AVX2) {
+            found = GetAVX2Kernels(selected);
+        } else if (wanted == PIXEL_ISA_NEON) {
+            found = GetNEONKernels(selected);
+        }
+        if (!found) {
+            return false;
+        }
+        kernels = selected;
+        isa = (wanted == PIXEL_ISA_MAX) ? selectedIsa : wanted;
+        return true;
+    }
+};
+
+Dispatch& GetDispatch()
+{
+    static Dispatch dispatch;
+    return dispatch;
+}
+
+// Converts count pixels of format into packed RGB.
+void ToRGB(PixelFormat format, const u8* src, u8* dst, u32 count)
+{
+    const PixelKernels& kernels = GetDispatch().kernels;
+    switch (format) {
+        case PIXEL_FORMAT_R8G8B8_UNORM:
+        case PIXEL_FORMAT_R8G8B8_UINT:
+            memcpy(dst, src, static_cast<size_t>(count) * RGB_BYTES);
+            return;
+        case PIXEL_FORMAT_R8G8B8A8_UNORM:
+        case PIXEL_FORMAT_R8G8B8A8_UINT:
+            kernels.rgbaToRgb(src, dst, count);
+            return;
+        case PIXEL_FORMAT_B8G8R8A8_UNORM:
+            kernels.bgraToRgb(src, dst, count);
+            return;
+        case PIXEL_FORMAT_R16G16B16A16_FLOAT:
+            kernels.rgba16fToRgb(reinterpret_cast<const u16*>(src), dst, count);
+            return;
+        default:
+            break;
+    }
+    for (u32 i = 0; i < count; i++, dst += RGB_BYTES) {
+        switch (format) {
+            case PIXEL_FORMAT_R8_UNORM:
+                dst[0] = dst[1] = dst[2] = src[i];
+                break;
+            case PIXEL_FORMAT_R16_UINT: {
+                const u16* gray = reinterpret_cast<const u16*>(src);
+                dst[0] = dst[1] = dst[2] = static_cast<u8>((gray[i] + 128u) / 257u);
+                break;
+            }
+            case PIXEL_FORMAT_R16G16B16_UINT: {
+                const u16* rgb = reinterpret_cast<const u16*>(src) + i * RGB_BYTES;
+                for (u32 c = 0; c < RGB_BYTES; c++) {
+                    dst[c] = static_cast<u8>((rgb[c] + 128u) / 257u);
+                }
+                break;
+            }
+            case PIXEL_FORMAT_R16G16B16_FLOAT: {
+                const u16* rgb = reinterpret_cast<const u16*>(src) + i * RGB_BYTES;
+                for (u32 c = 0; c < RGB_BYTES; c++) {
+                    dst[c] = GetHalfToU8Table().values[rgb[c]];
+                }
+                break;
+            }
+            case PIXEL_FORMAT_R32G32B32A32_FLOAT: {
+                const f32* rgba = reinterpret_cast<const f32*>(src) + i * RGBA_BYTES;
+                for (u32 c = 0; c < RGB_BYTES; c++) {
+                    dst[c] = FloatToU8(rgba[c]);
+                }
+                break;
+            }
+            default:
+                return;
+        }
+    }
+}
+
+// Converts count packed RGB pixels into format, alpha becomes opaque.
+void FromRGB(PixelFormat format, const u8* src, u8* dst, u32 count)
+{
+    const PixelKernels& kernels = GetDispatch().kernels;
+    switch (format) {
+        case PIXEL_FORMAT_R8G8B8_UNORM:
+        case PIXEL_FORMAT_R8G8B8_UINT:
+            memcpy(dst, src, static_cast<size_t>(count) * RGB_BYTES);
+            return;
+        case PIXEL_FORMAT_R8G8B8A8_UNORM:
+        case PIXEL_FORMAT_R8G8B8A8_UINT:
+            kernels.rgbToRgba(src, dst, count);
+            return;
+        case PIXEL_FORMAT_B8G8R8A8_UNORM:
+            kernels.rgbToBgra(src, dst, count);
+            return;
+        case PIXEL_FORMAT_R16G16B16A16_FLOAT:
+            kernels.rgbToRgba16f(src, reinterpret_cast<u16*>(dst), count);
+            return;
+        default:
+            break;
+    }
+    const HalfTable& halfTable = GetHalfTable();
+    for (u32 i = 0; i < count; i++, src += RGB_BYTES) {
+        switch (format) {
+            case PIXEL_FORMAT_R8_UNORM:
+                // BT.601 luma, the same weights RGBToYUV uses
+                dst[i] = Luma(src);
+                break;
+            case PIXEL_FORMAT_R16_UINT:
+                reinterpret_cast<u16*>(dst)[i] = static_cast<u16>(Luma(src) * 257);
+                break;
+            case PIXEL_FORMAT_R16G16B16_UINT:
+                for (u32 c = 0; c < RGB_BYTES; c++) {
+                    reinterpret_cast<u16*>(dst)[i * RGB_BYTES + c] = static_cast<u16>(src[c] * 257);
+                }
+                break;
+            case PIXEL_FORMAT_R16G16B16_FLOAT:
+                for (u32 c = 0; c < RGB_BYTES; c++) {
+                    reinterpret_cast<u16*>(dst)[i * RGB_BYTES + c] = halfTable.values[src[c]];
+                }
+                break;
+            case PIXEL_FORMAT_R32G32B32A32_FLOAT:
+                for (u32 c = 0; c < RGB_BYTES; c++) {
+                    reinterpret_cast<f32*>(dst)[i * RGBA_BYTES + c] = src[c] * (1.0f / 255.0f);
+                }
+                reinterpret_cast<f32*>(dst)[i * RGBA_BYTES + RGB_BYTES] = 1.0f;
+                break;
+            default:
+                return;
+        }
+    }
+}
+
+bool IsRGB(PixelFormat format)
+{
+    return format == PIXEL_FORMAT_R8G8B8_UNORM || format == PIXEL_FORMAT_R8G8B8_UINT;
+}
+
+bool IsValid(const BufferDescriptor& buffer)
+{
+    u32 bytesPerPixel = PixelConverter::GetBytesPerPixel(buffer.format);
+    return buffer.addr != nullptr && buffer.width > 0 && buffer.height > 0 && bytesPerPixel != 0 &&
+        static_cast<u64>(buffer.len) >= static_cast<u64>(buffer.width) * buffer.height * bytesPerPixel;
+}
+}
+
+namespace CGKit {
+namespace PixelScalar {
+void RgbaToRgb(const u8* src, u8* dst, u32 count)
+{
+    for (u32 i = 0; i < count; i++, src += RGBA_BYTES, dst += RGB_BYTES) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+    }
+}
+
+void BgraToRgb(const u8* src, u8* dst, u32 count)
+{
+    for (u32 i = 0; i < count; i++, src += RGBA_BYTES, dst += RGB_BYTES) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+    }
+}
+
+void RgbToRgba(const u8* src, u8* dst, u32 count)
+{
+    for (u32 i = 0; i < count; i++, src += RGB_BYTES, dst += RGBA_BYTES) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = OPAQUE;
+    }
+}
+
+void RgbToBgra(const u8* src, u8* dst, u32 count)
+{
+    for (u32 i = 0; i < count; i++, src += RGB_BYTES, dst += RGBA_BYTES) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = OPAQUE;
+    }
+}
+
+void Rgba16fToRgb(const u16* src, u8* dst, u32 count)
+{
+    const HalfToU8Table& table = GetHalfToU8Table();
+    for (u32 i = 0; i < count; i++, src += RGBA_BYTES, dst += RGB_BYTES) {
+        dst[0] = table.values[src[0]];
+        dst[1] = table.values[src[1]];
+        dst[2] = table.values[src[2]];
+    }
+}
+
+void RgbToRgba16f(const u8* src, u16* dst, u32 count)
+{
+    const HalfTable& halfTable = GetHalfTable();
+    for (u32 i = 0; i < count; i++, src += RGB_BYTES, dst += RGBA_BYTES) {
+        dst[0] = halfTable.values[src[0]];
+        dst[1] = halfTable.values[src[1]];
+        dst[2] = halfTable.values[src[2]];
+        dst[3] = HALF_ONE;
+    }
+}
+
+void YuvToRgb(const u8* y, const u8* uv, u8* dst, u32 count, bool nv21)
+{
+    const s32 round = 1 << (YUV_SHIFT - 1);
+    for (u32 i = 0; i < count; i++, dst += RGB_BYTES) {
+        const u8* chroma = uv + (i & ~1u);
+        s32 u = static_cast<s32>(chroma[nv21 ? 1 : 0]) - 128;
+        s32 v = static_cast<s32>(chroma[nv21 ? 0 : 1]) - 128;
+        s32 luma = static_cast<s32>(y[i]) << YUV_SHIFT;
+        dst[0] = ClampToU8((luma + YUV_R_V * v + round) >> YUV_SHIFT);
+        dst[1] = ClampToU8((luma - YUV_G_U * u - YUV_G_V * v + round) >> YUV_SHIFT);
+        dst[2] = ClampToU8((luma + YUV_B_U * u + round) >> YUV_SHIFT);
+    }
+}
+
+void RgbToYuv(const u8* top, const u8* bottom, u8* yTop, u8* yBottom, u8* uv, u32 count, bool nv21)
+{
+    const s32 round = 1 << (RGB_SHIFT - 1);
+    const u32 uIndex = nv21 ? 1 : 0;
+    for (u32 i = 0; i < count; i++) {
+        yTop[i] = Luma(top + i * RGB_BYTES);
+        yBottom[i] = Luma(bottom + i * RGB_BYTES);
+    }
+    for (u32 i = 0; i < count; i += 2, uv += 2) {
+        // the last column of an odd width pairs with itself, like the last row of an odd height
+        const u32 left = i * RGB_BYTES;
+        const u32 right = (i + 1 < count ? i + 1 : i) * RGB_BYTES;
+        s32 average[RGB_BYTES];
+        for (u32 c = 0; c < RGB_BYTES; c++) {
+            average[c] = (top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c] + 2) >> 2;
+        }
+        uv[uIndex] = ClampToU8(((-RGB_U_R * average[0] - RGB_U_G * average[1] + RGB_U_B * average[2] + round) >>
+            RGB_SHIFT) + 128);
+        uv[1 - uIndex] = ClampToU8(((RGB_V_R * average[0] - RGB_V_G * average[1] - RGB_V_B * average[2] + round) >>
+            RGB_SHIFT) + 128);
+    }
+}
+
+u16 FloatToHalf(f32 value)
+{
+    u32 bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    u32 sign = (bits >> 16) & 0x8000;
+    s32 exponent = static_cast<s32>((bits >> 23) & 0xFF) - 127 + 15;
+    u32 mantissa = bits & 0x7FFFFF;
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        return static_cast<u16>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+    }
+    if (exponent >= 31) {
+        return static_cast<u16>(sign | 0x7C00);
+    }
+    u32 half = 0;
+    u32 rest = 0;
+    u32 middle = 0;
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return static_cast<u16>(sign);
+        }
+        // subnormal half
+        mantissa |= 0x800000;
+        u32 shift = static_cast<u32>(14 - exponent);
+        half = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1);
+        middle = 1u << (shift - 1);
+    } else {
+        half = (static_cast<u32>(exponent) << 10) | (mantissa >> 13);
+        rest = mantissa & 0x1FFF;
+        middle = 0x1000;
+    }
+    // round to nearest even, a carry into the exponent is still correct
+    if (rest > middle || (rest == middle && (half & 1))) {
+        half++;
+    }
+    return static_cast<u16>(sign | half);
+}
+
+f32 HalfToFloat(u16 value)
+{
+    u32 sign = static_cast<u32>(value & 0x8000) << 16;
+    u32 exponent = (value >> 10) & 0x1F;
+    u32 mantissa = value & 0x3FF;
+    u32 bits = 0;
+    if (exponent == 0x1F) {
+        // NaNs come out quiet, as the hardware converters do
+        bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa != 0) {
+        // normalise a subnormal half
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    } else {
+        bits = sign;
+    }
+    f32 result = 0.0f;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+}  // namespace PixelScalar
+}  // namespace CGKit
+
+u32 PixelConverter::GetBytesPerPixel(PixelFormat format)
+{
+    switch (format) {
+        case PIXEL_FORMAT_R8_UNORM:
+            return 1;
+        case PIXEL_FORMAT_R16_UINT:
+            return 2;
+        case PIXEL_FORMAT_R8G8B8_UNORM:
+        case PIXEL_FORMAT_R8G8B8_UINT:
+            return 3;
+        case PIXEL_FORMAT_R8G8B8A8_UNORM:
+        case PIXEL_FORMAT_R8G8B8A8_UINT:
+        case PIXEL_FORMAT_B8G8R8A8_UNORM:
+            return 4;
+        case PIXEL_FORMAT_R16G16B16_UINT:
+        case PIXEL_FORMAT_R16G16B16_FLOAT:
+            return 6;
+        case PIXEL_FORMAT_R16G16B16A16_FLOAT:
+            return 8;
+        case PIXEL_FORMAT_R32G32B32A32_FLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+bool PixelConverter::Convert(const BufferDescriptor& src, BufferDescriptor& dst)
+{
+    if (!IsValid(src) || !IsValid(dst) || src.width != dst.width || src.height != dst.height) {
+        return false;
+    }
+    const u32 width = static_cast<u32>(src.width);
+    const size_t srcStride = static_cast<size_t>(width) * GetBytesPerPixel(src.format);
+    const size_t dstStride = static_cast<size_t>(width) * GetBytesPerPixel(dst.format);
+    const u8* srcRow = static_cast<const u8*>(src.addr);
+    u8* dstRow = static_cast<u8*>(dst.addr);
+    if (src.format == dst.format) {
+        memcpy(dstRow, srcRow, srcStride * src.height);
+        return true;
+    }
+    vector<u8> rgbRow;
+    if (!IsRGB(src.format) && !IsRGB(dst.format)) {
+        rgbRow.resize(static_cast<size_t>(width) * RGB_BYTES);
+    }
+    for (s32 y = 0; y < src.height; y++, srcRow += srcStride, dstRow += dstStride) {
+        if (IsRGB(dst.format)) {
+            ToRGB(src.format, srcRow, dstRow, width);
+        } else if (IsRGB(src.format)) {
+            FromRGB(dst.format, srcRow, dstRow, width);
+        } else {
+            ToRGB(src.format, srcRow, rgbRow.data(), width);
+            FromRGB(dst.format, rgbRow.data(), dstRow, width);
+        }
+    }
+    return true;
+}
+
+bool PixelConverter::YUVToRGB(const u8* yPlane, const u8* uvPlane, YUVLayout layout, BufferDescriptor& dst)
+{
+    if (yPlane == nullptr || uvPlane == nullptr || !IsValid(dst) || !IsRGB(dst.format)) {
+        return false;
+    }
+    const u32 width = static_cast<u32>(dst.width);
+    const size_t uvStride = static_cast<size_t>((width + 1) / 2) * 2;
+    const PixelKernels& kernels = GetDispatch().kernels;
+    u8* dstRow = static_cast<u8*>(dst.addr);
+    for (u32 y = 0; y < static_cast<u32>(dst.height); y++, dstRow += static_cast<size_t>(width) * RGB_BYTES) {
+        kernels.yuvToRgb(yPlane + static_cast<size_t>(y) * width, uvPlane + (y / 2) * uvStride, dstRow, width,
+            layout == YUV_LAYOUT_NV21);
+    }
+    return true;
+}
+
+bool PixelConverter::RGBToYUV(const BufferDescriptor& src, YUVLayout layout, u8* yPlane, u8* uvPlane)
+{
+    if (yPlane == nullptr || uvPlane == nullptr || !IsValid(src) || !IsRGB(src.format)) {
+        return false;
+    }
+    const u32 width = static_cast<u32>(src.width);
+    const u32 height = static_cast<u32>(src.height);
+    const size_t rgbStride = static_cast<size_t>(width) * RGB_BYTES;
+    const size_t uvStride = static_cast<size_t>((width + 1) / 2) * 2;
+    const PixelKernels& kernels = GetDispatch().kernels;
+    const u8* rgb = static_cast<const u8*>(src.addr);
+    for (u32 y = 0; y < height; y += 2) {
+        // the last row of an odd height is its own pair, it stores its luma twice
+        const u32 bottom = (y + 1 < height) ? y + 1 : y;
+        kernels.rgbToYuv(rgb + y * rgbStride, rgb + bottom * rgbStride, yPlane + static_cast<size_t>(y) * width,
+            yPlane + static_cast<size_t>(bottom) * width, uvPlane + (y / 2) * uvStride, width,
+            layout == YUV_LAYOUT_NV21);
+    }
+    return true;
+}
+
+PixelIsa PixelConverter::GetIsa()
+{
+    return GetDispatch().isa;
+}
+
+bool PixelConverter::SetIsa(PixelIsa isa)
+{
+    return isa < PIXEL_ISA_MAX && GetDispatch().Select(isa);
+}
+
+const c8* PixelConverter::GetIsaName(PixelIsa isa)
+{
+    switch (isa) {
+        case PIXEL_ISA_SCALAR:
+            return "scalar";
+        case PIXEL_ISA_SSE4:
+            return "sse4";
+        case PIXEL_ISA_AVX2:
+            return "avx2";
+        case PIXEL_ISA_NEON:
+            return "neon";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: NEON kernels of PixelConverter.
+ */
+
+#include "OSRPlugin/PixelKernels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+using namespace CGKit;
+
+namespace {
+constexpr u32 RGB_BYTES = 3;
+constexpr u32 RGBA_BYTES = 4;
+constexpr u32 BLOCK = 16;
+
+void RgbaToRgbNEON(const u8* src, u8* dst, u32 count)
+{
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK, src += BLOCK * RGBA_BYTES, dst += BLOCK * RGB_BYTES) {
+        uint8x16x4_t rgba = vld4q_u8(src);
+        uint8x16x3_t rgb = {{rgba.val[0], rgba.val[1], rgba.val[2]}};
+        vst3q_u8(dst, rgb);
+    }
+    PixelScalar::RgbaToRgb(src, dst, count - i);
+}
+
+void BgraToRgbNEON(const u8* src, u8* dst, u32 count)
+{
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK, src += BLOCK * RGBA_BYTES, dst += BLOCK * RGB_BYTES) {
+        uint8x16x4_t bgra = vld4q_u8(src);
+        uint8x16x3_t rgb = {{bgra.val[2], bgra.val[1], bgra.val[0]}};
+        vst3q_u8(dst, rgb);
+    }
+    PixelScalar::BgraToRgb(src, dst, count - i);
+}
+
+void RgbToRgbaNEON(const u8* src, u8* dst, u32 count)
+{
+    const uint8x16_t alpha = vdupq_n_u8(255);
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK, src += BLOCK * RGB_BYTES, dst += BLOCK * RGBA_BYTES) {
+        uint8x16x3_t rgb = vld3q_u8(src);
+        uint8x16x4_t rgba = {{rgb.val[0], rgb.val[1], rgb.val[2], alpha}};
+        vst4q_u8(dst, rgba);
+    }
+    PixelScalar::RgbToRgba(src, dst, count - i);
+}
+
+void RgbToBgraNEON(const u8* src, u8* dst, u32 count)
+{
+    const uint8x16_t alpha = vdupq_n_u8(255);
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK, src += BLOCK * RGB_BYTES, dst += BLOCK * RGBA_BYTES) {
+        uint8x16x3_t rgb = vld3q_u8(src);
+        uint8x16x4_t bgra = {{rgb.val[2], rgb.val[1], rgb.val[0], alpha}};
+        vst4q_u8(dst, bgra);
+    }
+    PixelScalar::RgbToBgra(src, dst, count - i);
+}
+
+// luma << 6 plus (or minus) a chroma term shared by pixel pairs, rounded, shifted and saturated
+uint8x16_t CombineYuv(uint8x16_t luma, int16x8_t term, bool subtract)
+{
+    int16x8x2_t pairs = vzipq_s16(term, term);
+    int16x8_t lo = vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(luma), YUV_SHIFT));
+    int16x8_t hi = vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(luma), YUV_SHIFT));
+    lo = subtract ? vsubq_s16(lo, pairs.val[0]) : vaddq_s16(lo, pairs.val[0]);
+    hi = subtract ? vsubq_s16(hi, pairs.val[1]) : vaddq_s16(hi, pairs.val[1]);
+    return vcombine_u8(vqrshrun_n_s16(lo, YUV_SHIFT), vqrshrun_n_s16(hi, YUV_SHIFT));
+}
+
+void YuvToRgbNEON(const u8* y, const u8* uv, u8* dst, u32 count, bool nv21)
+{
+    const int16x8_t bias = vdupq_n_s16(128);
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK, dst += BLOCK * RGB_BYTES) {
+        uint8x16_t luma = vld1q_u8(y + i);
+        uint8x8x2_t chroma = vld2_u8(uv + i);
+        int16x8_t first = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(chroma.val[0])), bias);
+        int16x8_t second = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(chroma.val[1])), bias);
+        int16x8_t u = nv21 ? second : first;
+        int16x8_t v = nv21 ? first : second;
+        int16x8_t guv = vaddq_s16(vmulq_n_s16(u, YUV_G_U), vmulq_n_s16(v, YUV_G_V));
+        uint8x16x3_t rgb;
+        rgb.val[0] = CombineYuv(luma, vmulq_n_s16(v, YUV_R_V), false);
+        rgb.val[1] = CombineYuv(luma, guv, true);
+        rgb.val[2] = CombineYuv(luma, vmulq_n_s16(u, YUV_B_U), false);
+        vst3q_u8(dst, rgb);
+    }
+    PixelScalar::YuvToRgb(y + i, uv + i, dst, count - i, nv21);
+}
+
+// BT.601 luma of 8 pixels; the rounding narrow keeps the 16-bit sum from overflowing
+uint8x8_t LumaNEON(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+    uint16x8_t sum = vmull_u8(r, vdup_n_u8(RGB_Y_R));
+    sum = vmlal_u8(sum, g, vdup_n_u8(RGB_Y_G));
+    sum = vmlal_u8(sum, b, vdup_n_u8(RGB_Y_B));
+    return vrshrn_n_u16(sum, RGB_SHIFT);
+}
+
+uint8x8_t ChromaNEON(const int16x8_t average[RGB_BYTES], s16 wr, s16 wg, s16 wb)
+{
+    int16x8_t sum = vmulq_n_s16(average[0], wr);
+    sum = vmlaq_n_s16(sum, average[1], wg);
+    sum = vmlaq_n_s16(sum, average[2], wb);
+    return vqmovun_s16(vaddq_s16(vrshrq_n_s16(sum, RGB_SHIFT), vdupq_n_s16(128)));
+}
+
+void RgbToYuvNEON(const u8* top, const u8* bottom, u8* yTop, u8* yBottom, u8* uv, u32 count, bool nv21)
+{
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK) {
+        uint8x16x3_t upper = vld3q_u8(top + i * RGB_BYTES);
+        uint8x16x3_t lower = vld3q_u8(bottom + i * RGB_BYTES);
+        vst1q_u8(yTop + i, vcombine_u8(
+            LumaNEON(vget_low_u8(upper.val[0]), vget_low_u8(upper.val[1]), vget_low_u8(upper.val[2])),
+            LumaNEON(vget_high_u8(upper.val[0]), vget_high_u8(upper.val[1]), vget_high_u8(upper.val[2]))));
+        vst1q_u8(yBottom + i, vcombine_u8(
+            LumaNEON(vget_low_u8(lower.val[0]), vget_low_u8(lower.val[1]), vget_low_u8(lower.val[2])),
+            LumaNEON(vget_high_u8(lower.val[0]), vget_high_u8(lower.val[1]), vget_high_u8(lower.val[2]))));
+        int16x8_t average[RGB_BYTES];
+        for (u32 c = 0; c < RGB_BYTES; c++) {
+            uint16x8_t sum = vpadalq_u8(vpaddlq_u8(upper.val[c]), lower.val[c]);
+            average[c] = vreinterpretq_s16_u16(vrshrq_n_u16(sum, 2));
+        }
+        uint8x8_t u = ChromaNEON(average, -RGB_U_R, -RGB_U_G, RGB_U_B);
+        uint8x8_t v = ChromaNEON(average, RGB_V_R, -RGB_V_G, -RGB_V_B);
+        uint8x8x2_t chroma = {{nv21 ? v : u, nv21 ? u : v}};
+        vst2_u8(uv + i, chroma);
+    }
+    PixelScalar::RgbToYuv(top + i * RGB_BYTES, bottom + i * RGB_BYTES, yTop + i, yBottom + i, uv + i, count - i,
+        nv21);
+}
+
+#if defined(__aarch64__)
+constexpr u32 HALF_STEP = 4;
+
+// one RGBA16F pixel per step: widen, scale, clamp and round to nearest even like the scalar kernel
+void Rgba16fToRgbNEON(const u16* src, u8* dst, u32 count)
+{
+    const float32x4_t scale = vdupq_n_f32(255.0f);
+    const float32x4_t maxVal = vdupq_n_f32(255.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    u32 i = 0;
+    for (; i + HALF_STEP <= count; i += HALF_STEP, src += HALF_STEP * RGBA_BYTES, dst += HALF_STEP * RGB_BYTES) {
+        uint16x4_t words[HALF_STEP];
+        for (u32 p = 0; p < HALF_STEP; p++) {
+            float32x4_t values = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + p * RGBA_BYTES)));
+            values = vminq_f32(vmaxq_f32(vmulq_f32(values, scale), zero), maxVal);
+            words[p] = vmovn_u32(vcvtnq_u32_f32(values));
+        }
+        uint8x16_t rgba = vcombine_u8(vmovn_u16(vcombine_u16(words[0], words[1])),
+            vmovn_u16(vcombine_u16(words[2], words[3])));
+        u8 staged[HALF_STEP * RGBA_BYTES];
+        vst1q_u8(staged, rgba);
+        PixelScalar::RgbaToRgb(staged, dst, HALF_STEP);
+    }
+    PixelScalar::Rgba16fToRgb(src, dst, count - i);
+}
+
+void RgbToRgba16fNEON(const u8* src, u16* dst, u32 count)
+{
+    const float32x4_t scale = vdupq_n_f32(1.0f / 255.0f);
+    const uint8x16_t alpha = vdupq_n_u8(255);
+    u32 i = 0;
+    for (; i + BLOCK <= count; i += BLOCK, src += BLOCK * RGB_BYTES, dst += BLOCK * RGBA_BYTES) {
+        uint8x16x3_t rgb = vld3q_u8(src);
+        uint8x16x4_t planar = {{rgb.val[0], rgb.val[1], rgb.val[2], alpha}};
+        u8 rgba[BLOCK * RGBA_BYTES];
+        vst4q_u8(rgba, planar);
+        for (u32 q = 0; q < BLOCK * RGBA_BYTES; q += 8) {
+            uint16x8_t wide = vmovl_u8(vld1_u8(rgba + q));
+            float32x4_t lo = vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide))), scale);
+            float32x4_t hi = vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(wide))), scale);
+            vst1_u16(dst + q, vreinterpret_u16_f16(vcvt_f16_f32(lo)));
+            vst1_u16(dst + q + 4, vreinterpret_u16_f16(vcvt_f16_f32(hi)));
+        }
+    }
+    PixelScalar::RgbToRgba16f(src, dst, count - i);
+}
+#endif
+}
+
+namespace CGKit {
+bool GetNEONKernels(PixelKernels& kernels)
+{
+    // NEON is mandatory on arm64-v8a and enabled by default for armeabi-v7a by the NDK
+    kernels.rgbaToRgb = RgbaToRgbNEON;
+    kernels.bgraToRgb = BgraToRgbNEON;
+    kernels.rgbToRgba = RgbToRgbaNEON;
+    kernels.rgbToBgra = RgbToBgraNEON;
+    kernels.yuvToRgb = YuvToRgbNEON;
+    kernels.rgbToYuv = RgbToYuvNEON;
+#if defined(__aarch64__)
+    kernels.rgba16fToRgb = Rgba16fToRgbNEON;
+    kernels.rgbToRgba16f = RgbToRgba16fNEON;
+#endif
+    return true;
+}
+}  // namespace CGKit
+#else
+namespace CGKit {
+bool GetNEONKernels(PixelKernels&)
+{
+    return false;
+}
+}  // namespace CGKit
+#endif
@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: SSE4.1 and AVX2 kernels of PixelConverter.
+ */
+
+#include "OSRPlugin/PixelKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+using namespace CGKit;
+
+// Kernels are compiled per function for their instruction set, dispatch only calls them on CPUs that
+// support it, so the rest of the library keeps the baseline flags.
+#define SSE4_TARGET __attribute__((target("sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2,f16c")))
+
+namespace {
+constexpr u32 RGB_BYTES = 3;
+constexpr u32 RGBA_BYTES = 4;
+// pixels per f16 conversion chunk, the staging buffers live on the stack
+constexpr u32 HALF_CHUNK = 64;
+
+// pshufb masks, -1 clears the byte
+alignas(16) const s8 RGBA_TO_RGB[16] = {0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1};
+alignas(16) const s8 BGRA_TO_RGB[16] = {2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1};
+alignas(16) const s8 RGB_TO_RGBA[16] = {0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1};
+alignas(16) const s8 RGB_TO_BGRA[16] = {2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1};
+
+// Packs four registers of 4 pixels, reduced to 12 bytes each, into 48 contiguous bytes.
+SSE4_TARGET void StorePacked(u8* dst, __m128i a, __m128i b, __m128i c, __m128i d)
+{
+    const s32 quarter = 4;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_or_si128(a, _mm_slli_si128(b, 12)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16),
+        _mm_or_si128(_mm_srli_si128(b, quarter), _mm_slli_si128(c, 8)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32),
+        _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, quarter)));
+}
+
+SSE4_TARGET void SwizzleToRgbSSE4(const u8* src, u8* dst, u32 count, const s8* maskBytes)
+{
+    const u32 block = 16;
+    const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(maskBytes));
+    u32 i = 0;
+    for (; i + block <= count; i += block, src += block * RGBA_BYTES, dst += block * RGB_BYTES) {
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), mask);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)), mask);
+        __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32)), mask);
+        __m128i d = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48)), mask);
+        StorePacked(dst, a, b, c, d);
+    }
+    if (maskBytes == BGRA_TO_RGB) {
+        PixelScalar::BgraToRgb(src, dst, count - i);
+    } else {
+        PixelScalar::RgbaToRgb(src, dst, count - i);
+    }
+}
+
+SSE4_TARGET void SwizzleFromRgbSSE4(const u8* src, u8* dst, u32 count, const s8* maskBytes)
+{
+    const u32 block = 16;
+    const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(maskBytes));
+    const __m128i alpha = _mm_set1_epi32(static_cast<s32>(0xFF000000u));
+    u32 i = 0;
+    for (; i + block <= count; i += block, src += block * RGB_BYTES, dst += block * RGBA_BYTES) {
+        __m128i in0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i in1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+        __m128i in2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+        __m128i quads[4] = {in0, _mm_alignr_epi8(in1, in0, 12), _mm_alignr_epi8(in2, in1, 8),
+            _mm_srli_si128(in2, 4)};
+        for (u32 q = 0; q < 4; q++) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + q * 16),
+                _mm_or_si128(_mm_shuffle_epi8(quads[q], mask), alpha));
+        }
+    }
+    if (maskBytes == RGB_TO_BGRA) {
+        PixelScalar::RgbToBgra(src, dst, count - i);
+    } else {
+        PixelScalar::RgbToRgba(src, dst, count - i);
+    }
+}
+
+SSE4_TARGET void RgbaToRgbSSE4(const u8* src, u8* dst, u32 count)
+{
+    SwizzleToRgbSSE4(src, dst, count, RGBA_TO_RGB);
+}
+
+SSE4_TARGET void BgraToRgbSSE4(const u8* src, u8* dst, u32 count)
+{
+    SwizzleToRgbSSE4(src, dst, count, BGRA_TO_RGB);
+}
+
+SSE4_TARGET void RgbToRgbaSSE4(const u8* src, u8* dst, u32 count)
+{
+    SwizzleFromRgbSSE4(src, dst, count, RGB_TO_RGBA);
+}
+
+SSE4_TARGET void RgbToBgraSSE4(const u8* src, u8* dst, u32 count)
+{
+    SwizzleFromRgbSSE4(src, dst, count, RGB_TO_BGRA);
+}
+
+/*
+ * Byte masks that gather 16 R, G and B bytes into three 16-byte RGB registers: output register o takes
+ * byte k from plane k % 3, pixel (16 * o + k) / 3.
+ */
+struct PlanarMasks {
+    alignas(16) s8 masks[3][3][16];
+
+    PlanarMasks()
+    {
+        for (u32 o = 0; o < 3; o++) {
+            for (u32 plane = 0; plane < 3; plane++) {
+                for (u32 k = 0; k < 16; k++) {
+                    u32 index = 16 * o + k;
+                    masks[o][plane][k] = (index % 3 == plane) ? static_cast<s8>(index / 3) : -1;
+                }
+            }
+        }
+    }
+};
+
+const PlanarMasks& GetPlanarMasks()
+{
+    static const PlanarMasks masks;
+    return masks;
+}
+
+SSE4_TARGET void YuvToRgbSSE4(const u8* y, const u8* uv, u8* dst, u32 count, bool nv21)
+{
+    const u32 block = 16;
+    const PlanarMasks& planar = GetPlanarMasks();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i round = _mm_set1_epi16(1 << (YUV_SHIFT - 1));
+    const __m128i lowBytes = _mm_set1_epi16(0xFF);
+    const __m128i zero = _mm_setzero_si128();
+    u32 i = 0;
+    for (; i + block <= count; i += block, dst += block * RGB_BYTES) {
+        __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i));
+        __m128i chroma = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + i));
+        __m128i first = _mm_sub_epi16(_mm_and_si128(chroma, lowBytes), bias);
+        __m128i second = _mm_sub_epi16(_mm_srli_epi16(chroma, 8), bias);
+        __m128i u = nv21 ? second : first;
+        __m128i v = nv21 ? first : second;
+        __m128i rv = _mm_mullo_epi16(v, _mm_set1_epi16(YUV_R_V));
+        __m128i guv = _mm_add_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(YUV_G_U)),
+            _mm_mullo_epi16(v, _mm_set1_epi16(YUV_G_V)));
+        __m128i bu = _mm_mullo_epi16(u, _mm_set1_epi16(YUV_B_U));
+        __m128i planes[3];
+        __m128i terms[3] = {rv, guv, bu};
+        __m128i lumaHalves[2] = {_mm_slli_epi16(_mm_unpacklo_epi8(luma, zero), YUV_SHIFT),
+            _mm_slli_epi16(_mm_unpackhi_epi8(luma, zero), YUV_SHIFT)};
+        for (u32 p = 0; p < 3; p++) {
+            // every chroma term serves two neighbouring pixels
+            __m128i lo = _mm_unpacklo_epi16(terms[p], terms[p]);
+            __m128i hi = _mm_unpackhi_epi16(terms[p], terms[p]);
+            if (p == 1) {
+                lo = _mm_sub_epi16(lumaHalves[0], lo);
+                hi = _mm_sub_epi16(lumaHalves[1], hi);
+            } else {
+                lo = _mm_add_epi16(lumaHalves[0], lo);
+                hi = _mm_add_epi16(lumaHalves[1], hi);
+            }
+            lo = _mm_srai_epi16(_mm_add_epi16(lo, round), YUV_SHIFT);
+            hi = _mm_srai_epi16(_mm_add_epi16(hi, round), YUV_SHIFT);
+            planes[p] = _mm_packus_epi16(lo, hi);
+        }
+        for (u32 o = 0; o < 3; o++) {
+            __m128i out = zero;
+            for (u32 p = 0; p < 3; p++) {
+                out = _mm_or_si128(out, _mm_shuffle_epi8(planes[p],
+                    _mm_load_si128(reinterpret_cast<const __m128i*>(planar.masks[o][p]))));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + o * 16), out);
+        }
+    }
+    PixelScalar::YuvToRgb(y + i, uv + i, dst, count - i, nv21);
+}
+
+/*
+ * Byte masks that split three 16-byte registers of RGB into R, G and B registers, the inverse of
+ * PlanarMasks: plane p takes byte k from register (3 * k + p) / 16.
+ */
+struct PackedMasks {
+    alignas(16) s8 masks[3][3][16];
+
+    PackedMasks()
+    {
+        for (u32 plane = 0; plane < 3; plane++) {
+            for (u32 o = 0; o < 3; o++) {
+                for (u32 k = 0; k < 16; k++) {
+                    u32 index = 3 * k + plane;
+                    masks[plane][o][k] = (index / 16 == o) ? static_cast<s8>(index % 16) : -1;
+                }
+            }
+        }
+    }
+};
+
+const PackedMasks& GetPackedMasks()
+{
+    static const PackedMasks masks;
+    return masks;
+}
+
+// Loads 16 RGB pixels as R, G and B registers.
+SSE4_TARGET void LoadPlanes(const u8* src, const PackedMasks& packed, __m128i planes[3])
+{
+    __m128i in[3];
+    for (u32 o = 0; o < 3; o++) {
+        in[o] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + o * 16));
+    }
+    for (u32 p = 0; p < 3; p++) {
+        planes[p] = _mm_setzero_si128();
+        for (u32 o = 0; o < 3; o++) {
+            planes[p] = _mm_or_si128(planes[p], _mm_shuffle_epi8(in[o],
+                _mm_load_si128(reinterpret_cast<const __m128i*>(packed.masks[p][o]))));
+        }
+    }
+}
+
+// (RGB_Y_R * r + RGB_Y_G * g + RGB_Y_B * b + round) >> 8 of 8 pixels, the sum fits in 16 unsigned bits.
+SSE4_TARGET __m128i LumaSSE4(__m128i r, __m128i g, __m128i b)
+{
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(RGB_Y_R)),
+        _mm_mullo_epi16(g, _mm_set1_epi16(RGB_Y_G)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(RGB_Y_B)));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(1 << (RGB_SHIFT - 1))), RGB_SHIFT);
+}
+
+SSE4_TARGET __m128i LumaSSE4(const __m128i planes[3])
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = LumaSSE4(_mm_cvtepu8_epi16(planes[0]), _mm_cvtepu8_epi16(planes[1]), _mm_cvtepu8_epi16(planes[2]));
+    __m128i hi = LumaSSE4(_mm_unpackhi_epi8(planes[0], zero), _mm_unpackhi_epi8(planes[1], zero),
+        _mm_unpackhi_epi8(planes[2], zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+/*
+ * ((wr * r + wg * g + wb * b + round) >> 8) + 128 of 8 averages. The sum reaches +-32640, so the rounding
+ * constant would overflow 16 bits: (x + 128) >> 8 is taken as ((x >> 1) + 64) >> 7, which is the same.
+ */
+SSE4_TARGET __m128i ChromaSSE4(const __m128i average[3], s16 wr, s16 wg, s16 wb)
+{
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(average[0], _mm_set1_epi16(wr)),
+        _mm_mullo_epi16(average[1], _mm_set1_epi16(wg)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(average[2], _mm_set1_epi16(wb)));
+    sum = _mm_srai_epi16(_mm_add_epi16(_mm_srai_epi16(sum, 1), _mm_set1_epi16(1 << (RGB_SHIFT - 2))), RGB_SHIFT - 1);
+    return _mm_add_epi16(sum, _mm_set1_epi16(128));
+}
+
+SSE4_TARGET void RgbToYuvSSE4(const u8* top, const u8* bottom, u8* yTop, u8* yBottom, u8* uv, u32 count, bool nv21)
+{
+    const u32 block = 16;
+    const PackedMasks& packed = GetPackedMasks();
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi16(2);
+    u32 i = 0;
+    for (; i + block <= count; i += block) {
+        __m128i upper[3];
+        __m128i lower[3];
+        LoadPlanes(top + i * RGB_BYTES, packed, upper);
+        LoadPlanes(bottom + i * RGB_BYTES, packed, lower);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(yTop + i), LumaSSE4(upper));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(yBottom + i), LumaSSE4(lower));
+        // pmaddubsw adds the horizontal pairs, 8 rounded 2x2 averages per plane
+        __m128i average[3];
+        for (u32 p = 0; p < 3; p++) {
+            __m128i sum = _mm_add_epi16(_mm_maddubs_epi16(upper[p], ones), _mm_maddubs_epi16(lower[p], ones));
+            average[p] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+        }
+        __m128i u = ChromaSSE4(average, -RGB_U_R, -RGB_U_G, RGB_U_B);
+        __m128i v = ChromaSSE4(average, RGB_V_R, -RGB_V_G, -RGB_V_B);
+        __m128i chroma = nv21 ? _mm_packus_epi16(v, u) : _mm_packus_epi16(u, v);
+        // u0..u7 v0..v7 to u0 v0 u1 v1 ...
+        chroma = _mm_unpacklo_epi8(chroma, _mm_srli_si128(chroma, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + i), chroma);
+    }
+    PixelScalar::RgbToYuv(top + i * RGB_BYTES, bottom + i * RGB_BYTES, yTop + i, yBottom + i, uv + i, count - i,
+        nv21);
+}
+
+// Gathers the RGB bytes of 8 pixels into the low 12 bytes of each 128-bit lane and packs them to 24.
+AVX2_TARGET void StoreRgb8(u8* dst, __m256i pixels, __m256i mask)
+{
+    const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    __m256i rgb = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels, mask), pack);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(rgb));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16), _mm256_extracti128_si256(rgb, 1));
+}
+
+AVX2_TARGET void SwizzleToRgbAVX2(const u8* src, u8* dst, u32 count, const s8* maskBytes)
+{
+    const u32 block = 32;
+    const u32 step = 8;
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(maskBytes)));
+    u32 i = 0;
+    for (; i + block <= count; i += block, src += block * RGBA_BYTES, dst += block * RGB_BYTES) {
+        for (u32 s = 0; s < block / step; s++) {
+            StoreRgb8(dst + s * step * RGB_BYTES,
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + s * step * RGBA_BYTES)), mask);
+        }
+    }
+    if (maskBytes == BGRA_TO_RGB) {
+        BgraToRgbSSE4(src, dst, count - i);
+    } else {
+        RgbaToRgbSSE4(src, dst, count - i);
+    }
+}
+
+AVX2_TARGET void SwizzleFromRgbAVX2(const u8* src, u8* dst, u32 count, const s8* maskBytes)
+{
+    const u32 step = 8;
+    // a 32-byte load of 8 RGB pixels reads 8 bytes past them
+    const u32 readAhead = 3;
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(maskBytes)));
+    const __m256i spread = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<s32>(0xFF000000u));
+    u32 i = 0;
+    for (; i + step + readAhead <= count; i += step, src += step * RGB_BYTES, dst += step * RGBA_BYTES) {
+        __m256i rgb = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)),
+            spread);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_or_si256(_mm256_shuffle_epi8(rgb, mask), alpha));
+    }
+    if (maskBytes == RGB_TO_BGRA) {
+        RgbToBgraSSE4(src, dst, count - i);
+    } else {
+        RgbToRgbaSSE4(src, dst, count - i);
+    }
+}
+
+AVX2_TARGET void RgbaToRgbAVX2(const u8* src, u8* dst, u32 count)
+{
+    SwizzleToRgbAVX2(src, dst, count, RGBA_TO_RGB);
+}
+
+AVX2_TARGET void BgraToRgbAVX2(const u8* src, u8* dst, u32 count)
+{
+    SwizzleToRgbAVX2(src, dst, count, BGRA_TO_RGB);
+}
+
+AVX2_TARGET void RgbToRgbaAVX2(const u8* src, u8* dst, u32 count)
+{
+    SwizzleFromRgbAVX2(src, dst, count, RGB_TO_RGBA);
+}
+
+AVX2_TARGET void RgbToBgraAVX2(const u8* src, u8* dst, u32 count)
+{
+    SwizzleFromRgbAVX2(src, dst, count, RGB_TO_BGRA);
+}
+
+// Loads 32 RGB pixels as R, G and B registers, pixels 0-15 in the low lane and 16-31 in the high one.
+AVX2_TARGET void LoadPlanesAVX2(const u8* src, const PackedMasks& packed, __m256i planes[3])
+{
+    const u32 half = 48;
+    __m256i in[3];
+    for (u32 o = 0; o < 3; o++) {
+        in[o] = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + o * 16))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + half + o * 16)), 1);
+    }
+    for (u32 p = 0; p < 3; p++) {
+        planes[p] = _mm256_setzero_si256();
+        for (u32 o = 0; o < 3; o++) {
+            planes[p] = _mm256_or_si256(planes[p], _mm256_shuffle_epi8(in[o],
+                _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(packed.masks[p][o])))));
+        }
+    }
+}
+
+AVX2_TARGET __m256i LumaAVX2(__m256i r, __m256i g, __m256i b)
+{
+    __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(RGB_Y_R)),
+        _mm256_mullo_epi16(g, _mm256_set1_epi16(RGB_Y_G)));
+    sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(b, _mm256_set1_epi16(RGB_Y_B)));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(1 << (RGB_SHIFT - 1))), RGB_SHIFT);
+}
+
+// Unpacking and packing both work per lane, so the 32 luma bytes come out in pixel order.
+AVX2_TARGET __m256i LumaAVX2(const __m256i planes[3])
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = LumaAVX2(_mm256_unpacklo_epi8(planes[0], zero), _mm256_unpacklo_epi8(planes[1], zero),
+        _mm256_unpacklo_epi8(planes[2], zero));
+    __m256i hi = LumaAVX2(_mm256_unpackhi_epi8(planes[0], zero), _mm256_unpackhi_epi8(planes[1], zero),
+        _mm256_unpackhi_epi8(planes[2], zero));
+    return _mm256_packus_epi16(lo, hi);
+}
+
+// ChromaSSE4 on 16 averages.
+AVX2_TARGET __m256i ChromaAVX2(const __m256i average[3], s16 wr, s16 wg, s16 wb)
+{
+    __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(average[0], _mm256_set1_epi16(wr)),
+        _mm256_mullo_epi16(average[1], _mm256_set1_epi16(wg)));
+    sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(average[2], _mm256_set1_epi16(wb)));
+    sum = _mm256_srai_epi16(_mm256_add_epi16(_mm256_srai_epi16(sum, 1), _mm256_set1_epi16(1 << (RGB_SHIFT - 2))),
+        RGB_SHIFT - 1);
+    return _mm256_add_epi16(sum, _mm256_set1_epi16(128));
+}
+
+AVX2_TARGET void RgbToYuvAVX2(const u8* top, const u8* bottom, u8* yTop, u8* yBottom, u8* uv, u32 count, bool nv21)
+{
+    const u32 block = 32;
+    const PackedMasks& packed = GetPackedMasks();
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi16(2);
+    u32 i = 0;
+    for (; i + block <= count; i += block) {
+        __m256i upper[3];
+        __m256i lower[3];
+        LoadPlanesAVX2(top + i * RGB_BYTES, packed, upper);
+        LoadPlanesAVX2(bottom + i * RGB_BYTES, packed, lower);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(yTop + i), LumaAVX2(upper));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(yBottom + i), LumaAVX2(lower));
+        __m256i average[3];
+        for (u32 p = 0; p < 3; p++) {
+            __m256i sum = _mm256_add_epi16(_mm256_maddubs_epi16(upper[p], ones),
+                _mm256_maddubs_epi16(lower[p], ones));
+            average[p] = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+        }
+        __m256i u = ChromaAVX2(average, -RGB_U_R, -RGB_U_G, RGB_U_B);
+        __m256i v = ChromaAVX2(average, RGB_V_R, -RGB_V_G, -RGB_V_B);
+        // each lane holds the 8 U and 8 V bytes of its 16 pixels, interleaved in place
+        __m256i chroma = nv21 ? _mm256_packus_epi16(v, u) : _mm256_packus_epi16(u, v);
+        chroma = _mm256_unpacklo_epi8(chroma, _mm256_srli_si256(chroma, 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + i), chroma);
+    }
+    RgbToYuvSSE4(top + i * RGB_BYTES, bottom + i * RGB_BYTES, yTop + i, yBottom + i, uv + i, count - i, nv21);
+}
+
+AVX2_TARGET void Rgba16fToRgbAVX2(const u16* src, u8* dst, u32 count)
+{
+    const u32 step = 2;
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256 maxVal = _mm256_set1_ps(255.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    alignas(32) u8 rgba[HALF_CHUNK * RGBA_BYTES];
+    while (count > 0) {
+        u32 chunk = count < HALF_CHUNK ? count : HALF_CHUNK;
+        u32 i = 0;
+        for (; i + step <= chunk; i += step) {
+            __m256 values = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * RGBA_BYTES)));
+            values = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(values, scale), zero), maxVal);
+            __m256i words = _mm256_cvtps_epi32(values);
+            __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(rgba + i * RGBA_BYTES), _mm_packus_epi16(packed, packed));
+        }
+        RgbaToRgbAVX2(rgba, dst, i);
+        PixelScalar::Rgba16fToRgb(src + i * RGBA_BYTES, dst + i * RGB_BYTES, chunk - i);
+        src += chunk * RGBA_BYTES;
+        dst += chunk * RGB_BYTES;
+        count -= chunk;
+    }
+}
+
+AVX2_TARGET void RgbToRgba16fAVX2(const u8* src, u16* dst, u32 count)
+{
+    const u32 step = 2;
+    const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+    alignas(32) u8 rgba[HALF_CHUNK * RGBA_BYTES];
+    while (count > 0) {
+        u32 chunk = count < HALF_CHUNK ? count : HALF_CHUNK;
+        RgbToRgbaAVX2(src, rgba, chunk);
+        u32 i = 0;
+        for (; i + step <= chunk; i += step) {
+            __m256i words = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rgba + i * RGBA_BYTES)));
+            __m256 values = _mm256_mul_ps(_mm256_cvtepi32_ps(words), scale);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * RGBA_BYTES),
+                _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+        }
+        PixelScalar::RgbToRgba16f(src + i * RGB_BYTES, dst + i * RGBA_BYTES, chunk - i);
+        src += chunk * RGB_BYTES;
+        dst += chunk * RGBA_BYTES;
+        count -= chunk;
+    }
+}
+}
+
+namespace CGKit {
+bool GetSSE4Kernels(PixelKernels& kernels)
+{
+    if (!__builtin_cpu_supports("sse4.1")) {
+        return false;
+    }
+    kernels.rgbaToRgb = RgbaToRgbSSE4;
+    kernels.bgraToRgb = BgraToRgbSSE4;
+    kernels.rgbToRgba = RgbToRgbaSSE4;
+    kernels.rgbToBgra = RgbToBgraSSE4;
+    kernels.yuvToRgb = YuvToRgbSSE4;
+    kernels.rgbToYuv = RgbToYuvSSE4;
+    return true;
+}
+
+bool GetAVX2Kernels(PixelKernels& kernels)
+{
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("f16c") || !GetSSE4Kernels(kernels)) {
+        return false;
+    }
+    // YUV decoding stays on the SSE4 kernel, it is bound by the byte shuffles rather than by register width
+    kernels.rgbaToRgb = RgbaToRgbAVX2;
+    kernels.bgraToRgb = BgraToRgbAVX2;
+    kernels.rgbToRgba = RgbToRgbaAVX2;
+    kernels.rgbToBgra = RgbToBgraAVX2;
+    kernels.rgba16fToRgb = Rgba16fToRgbAVX2;
+    kernels.rgbToRgba16f = RgbToRgba16fAVX2;
+    kernels.rgbToYuv = RgbToYuvAVX2;
+    return true;
+}
+}  // namespace CGKit
+#else
+namespace CGKit {
+bool GetSSE4Kernels(PixelKernels&)
+{
+    return false;
+}
+
+bool GetAVX2Kernels(PixelKernels&)
+{
+    return false;
+}
+}  // namespace CGKit
+#endif
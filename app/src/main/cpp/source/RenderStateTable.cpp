@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Process wide tables of distinct pipeline render states.
+ */
+
+#define CGKIT_LOG
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "Log/Log.h"
+#include "Material/RenderStateTable.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+constexpr u64 FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr u64 FNV_PRIME = 1099511628211ull;
+
+/*
+ * A state flattened into u32 words, floats by their bits. Two states are the same when their words are,
+ * whatever padding and the hash field hold.
+ */
+typedef vector<u32> StateWords;
+
+struct StateWordsHash {
+    size_t operator()(const StateWords& words) const
+    {
+        u64 hash = FNV_OFFSET_BASIS;
+        for (u32 word : words) {
+            hash = (hash ^ word) * FNV_PRIME;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+u32 Bits(f32 value)
+{
+    u32 bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void Flatten(const RasterizationState& state, StateWords& words)
+{
+    words = {state.depthClampEnable, state.rasterizerDiscardEnable, static_cast<u32>(state.polygonMode),
+        static_cast<u32>(state.cullmode), static_cast<u32>(state.frontFace), state.depthBiasEnable,
+        Bits(state.depthBiasConstantFactor), Bits(state.depthBiasClamp), Bits(state.depthBiasSlopeFactor),
+        Bits(state.lineWidth)};
+}
+
+void Flatten(const DepthStencilOp& op, StateWords& words)
+{
+    words.insert(words.end(), {static_cast<u32>(op.stencilFail), static_cast<u32>(op.stencilDepthFail),
+        static_cast<u32>(op.stencilPass), static_cast<u32>(op.stencilFunc), op.stencilCompareMask,
+        op.stencilReference, op.stencilReadMask, op.stencilWriteMask});
+}
+
+void Flatten(const DepthStencilState& state, StateWords& words)
+{
+    words = {state.depthTestEnable, state.depthWriteEnable, static_cast<u32>(state.depthFunc),
+        state.depthBoundsTestEnable, state.stencilTestEnable};
+    Flatten(state.front, words);
+    Flatten(state.back, words);
+}
+
+void Flatten(const ColorBlendState& state, StateWords& words)
+{
+    words = {state.logicOpEnable, static_cast<u32>(state.logicOp), static_cast<u32>(state.attachments.size())};
+    for (const BlendAttachmentState& attachment : state.attachments) {
+        words.insert(words.end(), {attachment.blendingEnable, static_cast<u32>(attachment.srcColorBlend),
+            static_cast<u32>(attachment.dstColorBlend), static_cast<u32>(attachment.colorBlendOp),
+            static_cast<u32>(attachment.srcAlphaBlend), static_cast<u32>(attachment.dstAlphaBlend),
+            static_cast<u32>(attachment.alphaBlendOp), attachment.colorMask, Bits(attachment.blendFactor)});
+    }
+    words.push_back(static_cast<u32>(state.blendConstants.size()));
+    for (f32 constant : state.blendConstants) {
+        words.push_back(Bits(constant));
+    }
+}
+
+/*
+ * States live in fixed chunks that never move, so Get reads without the lock: a chunk pointer and the
+ * state are written before size is published, and ids are only handed out below size.
+ */
+template<typename T>
+class StateTable {
+public:
+    StateTable()
+    {
+        u16 id = 0;
+        Intern(T(), id);
+    }
+
+    bool Intern(const T& state, u16& id)
+    {
+        StateWords words;
+        Flatten(state, words);
+        lock_guard<mutex> lock(tableMutex);
+        auto it = ids.find(words);
+        if (it != ids.end()) {
+            id = it->second;
+            return true;
+        }
+        u32 count = size.load(memory_order_relaxed);
+        if (count >= RenderStateTable::MAX_STATES) {
+            LOGERROR("Render state table is full");
+            return false;
+        }
+        unique_ptr<T[]>& chunk = chunks[count / CHUNK_SIZE];
+        if (chunk == nullptr) {
+            chunk.reset(new T[CHUNK_SIZE]);
+        }
+        T& stored = chunk[count % CHUNK_SIZE];
+        stored = state;
+        stored.hash = StateWordsHash()(words);
+        ids.emplace(std::move(words), static_cast<u16>(count));
+        size.store(count + 1, memory_order_release);
+        id = static_cast<u16>(count);
+        return true;
+    }
+
+    const T& Get(u16 id) const
+    {
+        u32 index = (id < size.load(memory_order_acquire)) ? id : 0;
+        return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+    }
+
+private:
+    static constexpr u32 CHUNK_SIZE = 256;
+
+    mutex tableMutex;
+    unique_ptr<T[]> chunks[RenderStateTable::MAX_STATES / CHUNK_SIZE];
+    atomic<u32> size {0};
+    unordered_map<StateWords, u16, StateWordsHash> ids;
+};
+
+StateTable<RasterizationState>& Rasterizations()
+{
+    static StateTable<RasterizationState> table;
+    return table;
+}
+
+StateTable<DepthStencilState>& DepthStencils()
+{
+    static StateTable<DepthStencilState> table;
+    return table;
+}
+
+StateTable<ColorBlendState>& ColorBlends()
+{
+    static StateTable<ColorBlendState> table;
+    return table;
+}
+}
+
+constexpr u32 RenderStateTable::MAX_STATES;
+
+bool RenderStateTable::Intern(const RasterizationState& state, u16& id)
+{
+    return Rasterizations().Intern(state, id);
+}
+
+bool RenderStateTable::Intern(const DepthStencilState& state, u16& id)
+{
+    return DepthStencils().Intern(state, id);
+}
+
+bool RenderStateTable::Intern(const ColorBlendState& state, u16& id)
+{
+    return ColorBlends().Intern(state, id);
+}
+
+bool RenderStateTable::Intern(const PipelineCreateInfo& pipeline, RenderStateIds& ids)
+{
+    return Intern(pipeline.rasterizationState, ids.rasterization) &&
+        Intern(pipeline.depthStencilState, ids.depthStencil) && Intern(pipeline.colorBlendState, ids.colorBlend);
+}
+
+const RasterizationState& RenderStateTable::Rasterization(u16 id)
+{
+    return Rasterizations().Get(id);
+}
+
+const DepthStencilState& RenderStateTable::DepthStencil(u16 id)
+{
+    return DepthStencils().Get(id);
+}
+
+const ColorBlendState& RenderStateTable::ColorBlend(u16 id)
+{
+    return ColorBlends().Get(id);
+}
+
+void RenderStateTable::Expand(const RenderStateIds& ids, PipelineCreateInfo& pipeline)
+{
+    pipeline.rasterizationState = Rasterization(ids.rasterization);
+    pipeline.depthStencilState = DepthStencil(ids.depthStencil);
+    pipeline.colorBlendState = ColorBlend(ids.colorBlend);
+}
@@ -0,0 +1,746 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2020. All rights reserved.
+ * Description: Checks the SIMD kernels behind MatrixBatch against the scalar kernels, the pose kernels
+ * against the engine math and Math::Fast against libm within its documented bounds, on every instruction
+ * set the build and the CPU support. Prints each failed check and exits with 1 if any failed.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "Math/Matrix4.h"
+#include "MathKernels/FastMath.h"
+#include "MathKernels/MatrixKernels.h"
+
+using namespace std;
+using namespace CGKit;
+
+namespace {
+/*
+ * The SIMD kernels compute the scalar expressions and differ from them in rounding only, AVX2 fuses
+ * multiply-adds: results agree within MATRIX_TOLERANCE relative to their magnitude, absolute below 1.
+ * Inverses pass the rounding of the determinant on, INVERSE_TOLERANCE allows for that.
+ */
+constexpr f32 MATRIX_TOLERANCE = 1e-5f;
+constexpr f32 INVERSE_TOLERANCE = 1e-4f;
+/*
+ * Culling may decide boxes that touch a plane differently from scalar: a box may only be culled by one
+ * kernel and not the other if it clears a plane by no more than CULL_TOLERANCE relative to the terms.
+ */
+constexpr f32 CULL_TOLERANCE = 1e-5f;
+/*
+ * Poses are checked against Matrix4::MakeTransform and Quaternion, and slerp, which Quaternion lacks,
+ * against a double precision slerp through acos and sin. The slerp weights come from a polynomial within
+ * 2e-5 of the exact ones, SLERP_TOLERANCE adds the rounding of the blend to that.
+ */
+constexpr f32 POSE_TOLERANCE = 1e-5f;
+constexpr f32 SLERP_TOLERANCE = 4e-5f;
+/*
+ * The bounds FastMath.h documents, in ulp against the correctly rounded result. Sine and cosine below
+ * SIN_COS_ULP_FROM in magnitude are bounded absolutely instead.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+constexpr u32 RECIPROCAL_SQRT_ULP = 4;
+#else
+constexpr u32 RECIPROCAL_SQRT_ULP = 2;
+#endif
+constexpr u32 SIN_COS_ULP = 2;
+constexpr f32 SIN_COS_ULP_FROM = 0.01f;
+constexpr f64 SIN_COS_ABSOLUTE = 1e-7;
+constexpr u32 ATAN2_ULP = 3;
+// the ARMv7 arrays divide through the reciprocal estimate
+constexpr u32 ATAN2_ARMV7_ULP = 4;
+constexpr u32 EXP2_ULP = 1;
+constexpr u32 LOG2_ULP = 1;
+constexpr f32 SIN_COS_DOMAIN = 8192.0f;
+// an odd count, so every SIMD kernel runs its tail as well
+constexpr u32 FAST_MATH_COUNT = 10007;
+// filled past the outputs to catch kernels writing beyond count
+constexpr f32 GUARD = 12345.0f;
+constexpr u32 GUARD_WORD = 0xdeadbeefu;
+// no elements, a partial, a whole and several SIMD blocks and their tails
+const u32 COUNTS[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 16, 33, 100};
+
+struct IsaKernels {
+    const c8* name;
+    bool (*getMatrixKernels)(MatrixKernels& kernels);
+    bool (*getFastMathKernels)(FastMathKernels& kernels);
+};
+
+const IsaKernels ISAS[] = {
+    {"sse4", GetSSE4MatrixKernels, GetSSE4FastMathKernels},
+    {"avx2", GetAVX2MatrixKernels, GetAVX2FastMathKernels},
+    {"neon", GetNEONMatrixKernels, GetNEONFastMathKernels},
+};
+
+u32 g_failures = 0;
+u32 g_seed = 1;
+
+void Expect(bool passed, const c8* isa, const c8* check, u32 count)
+{
+    if (!passed) {
+        printf("FAIL %s: %s, count %u\n", isa, check, count);
+        g_failures++;
+    }
+}
+
+f32 Random(f32 low, f32 high)
+{
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return low + (high - low) * static_cast<f32>(g_seed >> 8) / static_cast<f32>(1u << 24);
+}
+
+vector<f32> RandomFloats(u32 size, f32 low, f32 high)
+{
+    vector<f32> floats(size);
+    for (f32& f : floats) {
+        f = Random(low, high);
+    }
+    return floats;
+}
+
+// count unit quaternions, x, y, z, w each
+vector<f32> RandomQuaternions(u32 count)
+{
+    vector<f32> quaternions = RandomFloats(count * VECTOR4_FLOATS, -1.0f, 1.0f);
+    for (u32 i = 0; i < count; i++) {
+        f32* q = &quaternions[i * VECTOR4_FLOATS];
+        const f32 length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+            q[c] /= length;
+        }
+    }
+    return quaternions;
+}
+
+// Well conditioned general matrices: random elements on top of a dominant diagonal.
+vector<f32> RandomMatrices(u32 count)
+{
+    vector<f32> matrices = RandomFloats(count * MATRIX_FLOATS, -1.0f, 1.0f);
+    for (u32 i = 0; i < count; i++) {
+        for (u32 d = 0; d < MATRIX_ROWS; d++) {
+            matrices[i * MATRIX_FLOATS + d * (MATRIX_ROWS + 1)] += 4.0f;
+        }
+    }
+    return matrices;
+}
+
+// Affine matrices as MakeTransform builds them, scaled by 0.25 to 4.
+vector<f32> RandomTransforms(u32 count, bool rigid)
+{
+    vector<f32> position = RandomFloats(count * VECTOR3_FLOATS, -10.0f, 10.0f);
+    vector<f32> scale = rigid ? vector<f32>(count * VECTOR3_FLOATS, 1.0f) :
+        RandomFloats(count * VECTOR3_FLOATS, 0.25f, 4.0f);
+    vector<f32> orientation = RandomQuaternions(count);
+    vector<f32> matrices(count * MATRIX_FLOATS);
+    MatrixScalar::MakeTransform(position.data(), scale.data(), orientation.data(), matrices.data(), count);
+    return matrices;
+}
+
+// outputs sized for count elements of size floats plus the guard element
+vector<f32> GuardedOutput(u32 count, u32 size)
+{
+    return vector<f32>((count + 1) * size, GUARD);
+}
+
+bool Near(f32 expected, f32 actual, f32 tolerance)
+{
+    return fabsf(actual - expected) <= tolerance * max(1.0f, fabsf(expected));
+}
+
+// The first count * size floats agree and the guard element after them is untouched.
+bool Matches(const vector<f32>& expected, const vector<f32>& actual, u32 count, u32 size, f32 tolerance)
+{
+    for (u32 i = 0; i < count * size; i++) {
+        if (!Near(expected[i], actual[i], tolerance)) {
+            return false;
+        }
+    }
+    for (u32 i = count * size; i < (count + 1) * size; i++) {
+        if (actual[i] != GUARD) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MatrixKernels ScalarMatrixKernels()
+{
+    return {MatrixScalar::Multiply, MatrixScalar::Transpose, MatrixScalar::Inverse, MatrixScalar::InverseAffine,
+        MatrixScalar::InverseRigid, MatrixScalar::NormalMatrix, MatrixScalar::Transform,
+        MatrixScalar::TransformVector3, MatrixScalar::TransformVector3SoA, MatrixScalar::TransformBox,
+        MatrixScalar::Bounds, MatrixScalar::CullBoxes, MatrixScalar::MakeTransform, MatrixScalar::MakeTransformSoA,
+        MatrixScalar::Nlerp, MatrixScalar::Slerp};
+}
+
+void CheckMultiply(const c8* isa, const MatrixKernels& kernels, u32 count)
+{
+    const vector<f32> a = RandomFloats((count + 1) * MATRIX_FLOATS, -2.0f, 2.0f);
+    const vector<f32> b = RandomFloats((count + 1) * MATRIX_FLOATS, -2.0f, 2.0f);
+    for (u32 bStride : {MATRIX_FLOATS, 0u}) {
+        vector<f32> expected = GuardedOutput(count, MATRIX_FLOATS);
+        vector<f32> actual = GuardedOutput(count, MATRIX_FLOATS);
+        MatrixScalar::Multiply(a.data(), b.data(), bStride, expected.data(), count);
+        kernels.multiply(a.data(), b.data(), bStride, actual.data(), count);
+        Expect(Matches(expected, actual, count, MATRIX_FLOATS, MATRIX_TOLERANCE), isa,
+            bStride == 0 ? "multiply by one matrix" : "multiply", count);
+        // out may be a
+        vector<f32> inPlace = a;
+        kernels.multiply(inPlace.data(), b.data(), bStride, inPlace.data(), count);
+        Expect(equal(inPlace.begin(), inPlace.begin() + count * MATRIX_FLOATS, actual.begin()), isa,
+            "multiply in place", count);
+    }
+}
+
+void CheckInverses(const c8* isa, const MatrixKernels& kernels, u32 count)
+{
+    const vector<f32> general = RandomMatrices(count);
+    const vector<f32> affine = RandomTransforms(count, false);
+    const vector<f32> rigid = RandomTransforms(count, true);
+    struct {
+        const c8* name;
+        void (*scalar)(const f32* in, f32* out, u32 count);
+        void (*kernel)(const f32* in, f32* out, u32 count);
+        const vector<f32>& in;
+        f32 tolerance;
+    } cases[] = {
+        {"transpose", MatrixScalar::Transpose, kernels.transpose, general, 0.0f},
+        {"inverse", MatrixScalar::Inverse, kernels.inverse, general, INVERSE_TOLERANCE},
+        {"inverse affine", MatrixScalar::InverseAffine, kernels.inverseAffine, affine, INVERSE_TOLERANCE},
+        {"inverse rigid", MatrixScalar::InverseRigid, kernels.inverseRigid, rigid, MATRIX_TOLERANCE},
+        {"normal matrix", MatrixScalar::NormalMatrix, kernels.normalMatrix, affine, INVERSE_TOLERANCE},
+    };
+    for (const auto& test : cases) {
+        vector<f32> expected = GuardedOutput(count, MATRIX_FLOATS);
+        vector<f32> actual = GuardedOutput(count, MATRIX_FLOATS);
+        test.scalar(test.in.data(), expected.data(), count);
+        test.kernel(test.in.data(), actual.data(), count);
+        Expect(Matches(expected, actual, count, MATRIX_FLOATS, test.tolerance), isa, test.name, count);
+        vector<f32> inPlace = test.in;
+        test.kernel(inPlace.data(), inPlace.data(), count);
+        Expect(equal(inPlace.begin(), inPlace.end(), actual.begin()), isa, test.name, count);
+    }
+}
+
+void CheckSingular(const c8* isa, const MatrixKernels& kernels)
+{
+    // the second row is twice the first, the 3x3 part is singular too
+    const f32 singular[MATRIX_FLOATS] = {1, 2, 3, 0, 2, 4, 6, 0, 0, 0, 1, 0, 5, 6, 7, 1};
+    void (*inverses[])(const f32* in, f32* out, u32 count) = {kernels.inverse, kernels.inverseAffine,
+        kernels.normalMatrix};
+    for (auto inverse : inverses) {
+        f32 out[MATRIX_FLOATS];
+        inverse(singular, out, 1);
+        Expect(all_of(out, out + MATRIX_FLOATS, [](f32 f) { return f == 0.0f; }), isa,
+            "singular matrices give the zero matrix", 1);
+    }
+}
+
+void CheckTransforms(const c8* isa, const MatrixKernels& kernels, u32 count)
+{
+    const vector<f32> matrices = RandomFloats((count + 1) * MATRIX_FLOATS, -2.0f, 2.0f);
+    const vector<f32> vectors = RandomFloats(count * VECTOR4_FLOATS, -5.0f, 5.0f);
+    const vector<f32> points = RandomFloats(count * VECTOR3_FLOATS, -5.0f, 5.0f);
+    for (u32 matrixStride : {MATRIX_FLOATS, 0u}) {
+        vector<f32> expected = GuardedOutput(count, VECTOR4_FLOATS);
+        vector<f32> actual = GuardedOutput(count, VECTOR4_FLOATS);
+        MatrixScalar::Transform(matrices.data(), matrixStride, vectors.data(), expected.data(), count);
+        kernels.transform(matrices.data(), matrixStride, vectors.data(), actual.data(), count);
+        Expect(Matches(expected, actual, count, VECTOR4_FLOATS, MATRIX_TOLERANCE), isa, "transform", count);
+        for (f32 w : {1.0f, 0.0f}) {
+            expected = GuardedOutput(count, VECTOR3_FLOATS);
+            actual = GuardedOutput(count, VECTOR3_FLOATS);
+            MatrixScalar::TransformVector3(matrices.data(), matrixStride, points.data(), expected.data(), count, w);
+            kernels.transformVector3(matrices.data(), matrixStride, points.data(), actual.data(), count, w);
+            Expect(Matches(expected, actual, count, VECTOR3_FLOATS, MATRIX_TOLERANCE), isa,
+                w == 0.0f ? "transform directions" : "transform points", count);
+            vector<f32> inPlace = points;
+            kernels.transformVector3(matrices.data(), matrixStride, inPlace.data(), inPlace.data(), count, w);
+            Expect(equal(inPlace.begin(), inPlace.end(), actual.begin()), isa, "transform points in place", count);
+        }
+    }
+    // SoA against the packed scalar kernel
+    for (f32 w : {1.0f, 0.0f}) {
+        vector<f32> expected(count * VECTOR3_FLOATS);
+        MatrixScalar::TransformVector3(matrices.data(), 0, points.data(), expected.data(), count, w);
+        vector<f32> components[VECTOR3_FLOATS];
+        vector<f32> outputs[VECTOR3_FLOATS];
+        for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+            components[c].resize(count);
+            for (u32 i = 0; i < count; i++) {
+                components[c][i] = points[i * VECTOR3_FLOATS + c];
+            }
+            outputs[c] = GuardedOutput(count, 1);
+        }
+        const f32* const in[VECTOR3_FLOATS] = {components[0].data(), components[1].data(), components[2].data()};
+        f32* const out[VECTOR3_FLOATS] = {outputs[0].data(), outputs[1].data(), outputs[2].data()};
+        kernels.transformVector3SoA(matrices.data(), in, out, count, w);
+        for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+            vector<f32> component = GuardedOutput(count, 1);
+            for (u32 i = 0; i < count; i++) {
+                component[i] = expected[i * VECTOR3_FLOATS + c];
+            }
+            Expect(Matches(component, outputs[c], count, 1, MATRIX_TOLERANCE), isa, "transform SoA", count);
+        }
+    }
+}
+
+void CheckBoxes(const c8* isa, const MatrixKernels& kernels, u32 count)
+{
+    const vector<f32> matrices = RandomTransforms(count + 1, false);
+    vector<f32> boxes(count * BOX_FLOATS);
+    for (u32 i = 0; i < count; i++) {
+        for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+            const f32 low = Random(-5.0f, 5.0f);
+            boxes[i * BOX_FLOATS + c] = low;
+            boxes[i * BOX_FLOATS + VECTOR3_FLOATS + c] = low + Random(0.0f, 5.0f);
+        }
+    }
+    for (u32 matrixStride : {MATRIX_FLOATS, 0u}) {
+        vector<f32> expected = GuardedOutput(count, BOX_FLOATS);
+        vector<f32> actual = GuardedOutput(count, BOX_FLOATS);
+        MatrixScalar::TransformBox(matrices.data(), matrixStride, boxes.data(), expected.data(), count);
+        kernels.transformBox(matrices.data(), matrixStride, boxes.data(), actual.data(), count);
+        Expect(Matches(expected, actual, count, BOX_FLOATS, MATRIX_TOLERANCE), isa, "transform boxes", count);
+    }
+    // the corners of the boxes as points, an odd number as well; min and max are exact
+    const f32 start[BOX_FLOATS] = {0.0f, 0.0f, 0.0f, 0.5f, 0.5f, 0.5f};
+    for (u32 points : {count, 2 * count}) {
+        vector<f32> expected = GuardedOutput(1, BOX_FLOATS);
+        copy(start, start + BOX_FLOATS, expected.begin());
+        vector<f32> actual = expected;
+        MatrixScalar::Bounds(boxes.data(), points, expected.data());
+        kernels.bounds(boxes.data(), points, actual.data());
+        Expect(Matches(expected, actual, 1, BOX_FLOATS, 0.0f), isa, "bounds", points);
+    }
+}
+
+void CheckMakeTransform(const c8* isa, const MatrixKernels& kernels, u32 count)
+{
+    const vector<f32> position = RandomFloats(count * VECTOR3_FLOATS, -10.0f, 10.0f);
+    const vector<f32> scale = RandomFloats(count * VECTOR3_FLOATS, 0.25f, 4.0f);
+    const vector<f32> orientation = RandomQuaternions(count);
+    vector<f32> expected = GuardedOutput(count, MATRIX_FLOATS);
+    vector<f32> actual = GuardedOutput(count, MATRIX_FLOATS);
+    MatrixScalar::MakeTransform(position.data(), scale.data(), orientation.data(), expected.data(), count);
+    kernels.makeTransform(position.data(), scale.data(), orientation.data(), actual.data(), count);
+    Expect(Matches(expected, actual, count, MATRIX_FLOATS, MATRIX_TOLERANCE), isa, "make transform", count);
+}
+
+// Whether box n touches one of the planes within CULL_TOLERANCE, so that rounding may decide it.
+bool TouchesPlane(const f32* planes, u32 planeCount, const vector<f32> boxes[BOX_FLOATS], u32 n)
+{
+    for (u32 p = 0; p < planeCount; p++) {
+        const f32* plane = planes + p * PLANE_FLOATS;
+        f64 margin = plane[3];
+        f64 magnitude = fabs(plane[3]);
+        for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+            const f64 distance = static_cast<f64>(boxes[c][n]) * plane[c];
+            const f64 radius = static_cast<f64>(boxes[VECTOR3_FLOATS + c][n]) * fabs(plane[c]);
+            margin += distance + radius;
+            magnitude += fabs(distance) + radius;
+        }
+        if (fabs(margin) <= CULL_TOLERANCE * magnitude) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CheckCullBoxes(const c8* isa, const MatrixKernels& kernels, u32 count)
+{
+    // frustums have 6 planes, 7 checks the kernels handle any count
+    const u32 maxPlanes = 7;
+    f32 planes[maxPlanes * PLANE_FLOATS];
+    for (u32 p = 0; p < maxPlanes; p++) {
+        f32* plane = planes + p * PLANE_FLOATS;
+        f32 length = 0.0f;
+        for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+            plane[c] = Random(-1.0f, 1.0f);
+            length += plane[c] * plane[c];
+        }
+        for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+            plane[c] /= sqrtf(length);
+        }
+        plane[3] = Random(-2.0f, 15.0f);
+    }
+    // centers within 20 of the origin and extents up to 3, about half of them culled by 6 planes
+    vector<f32> boxes[BOX_FLOATS];
+    for (u32 c = 0; c < BOX_FLOATS; c++) {
+        boxes[c] = c < VECTOR3_FLOATS ? RandomFloats(count, -20.0f, 20.0f) : RandomFloats(count, 0.0f, 3.0f);
+    }
+    // a few boxes exactly touching the first plane
+    for (u32 n = 0; n < count; n += 5) {
+        f32 distance = planes[3];
+        f32 radius = 0.0f;
+        for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+            distance += boxes[c][n] * planes[c];
+            radius += fabsf(planes[c]);
+        }
+        const f32 extent = -distance / radius;
+        for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+            boxes[VECTOR3_FLOATS + c][n] = max(extent, 0.0f);
+        }
+    }
+    const f32* const arrays[BOX_FLOATS] = {boxes[0].data(), boxes[1].data(), boxes[2].data(), boxes[3].data(),
+        boxes[4].data(), boxes[5].data()};
+    const u32 words = (count + MASK_BITS - 1) / MASK_BITS;
+    for (u32 planeCount : {0u, 6u, maxPlanes}) {
+        vector<u32> expected(words + 1, GUARD_WORD);
+        vector<u32> actual(words + 1, GUARD_WORD);
+        MatrixScalar::CullBoxes(planes, planeCount, arrays, expected.data(), count);
+        kernels.cullBoxes(planes, planeCount, arrays, actual.data(), count);
+        bool agrees = true;
+        for (u32 n = 0; n < count; n++) {
+            const u32 bit = 1u << (n % MASK_BITS);
+            if ((expected[n / MASK_BITS] & bit) != (actual[n / MASK_BITS] & bit)) {
+                agrees = agrees && TouchesPlane(planes, planeCount, boxes, n);
+            }
+        }
+        Expect(agrees, isa, "cull boxes", count);
+        Expect(planeCount != 0 || all_of(actual.begin(), actual.begin() + count / MASK_BITS,
+            [](u32 word) { return word == ~0u; }), isa, "no planes cull no boxes", count);
+        Expect(count % MASK_BITS == 0 || (actual[words - 1] >> (count % MASK_BITS)) == 0, isa,
+            "cull boxes leaves the bits past count 0", count);
+        Expect(actual[words] == GUARD_WORD, isa, "cull boxes writes (count + 31) / 32 words", count);
+    }
+}
+
+// Component c of count packed elements of size floats as its own array, followed by a guard.
+vector<f32> Component(const vector<f32>& packed, u32 size, u32 c, u32 count)
+{
+    vector<f32> component = GuardedOutput(count, 1);
+    for (u32 i = 0; i < count; i++) {
+        component[i] = packed[i * size + c];
+    }
+    return component;
+}
+
+// Slerp through acos and sin in double precision, along the shorter arc.
+void ExactSlerp(const Quaternion& a, const Quaternion& b, f32 t, f64 out[VECTOR4_FLOATS])
+{
+    const f64 qa[VECTOR4_FLOATS] = {a.x, a.y, a.z, a.w};
+    const f64 qb[VECTOR4_FLOATS] = {b.x, b.y, b.z, b.w};
+    f64 cosine = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3];
+    const f64 sign = cosine < 0.0 ? -1.0 : 1.0;
+    cosine = min(fabs(cosine), 1.0);
+    const f64 angle = acos(cosine);
+    f64 weightA = 1.0 - t;
+    f64 weightB = t;
+    if (angle > 1e-6) {
+        weightA = sin((1.0 - t) * angle) / sin(angle);
+        weightB = sin(t * angle) / sin(angle);
+    }
+    for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+        out[c] = qa[c] * weightA + sign * qb[c] * weightB;
+    }
+}
+
+void CheckPoses(const c8* isa, const MatrixKernels& kernels, u32 count)
+{
+    const vector<f32> position = RandomFloats(count * VECTOR3_FLOATS, -10.0f, 10.0f);
+    const vector<f32> scale = RandomFloats(count * VECTOR3_FLOATS, 0.25f, 4.0f);
+    const vector<f32> a = RandomQuaternions(count);
+    vector<f32> b = RandomQuaternions(count);
+    // every third b close to its a, every other one on the other hemisphere to take the shorter arc
+    for (u32 i = 0; i < count; i++) {
+        Quaternion qa(a[i * 4], a[i * 4 + 1], a[i * 4 + 2], a[i * 4 + 3]);
+        Quaternion qb(b[i * 4], b[i * 4 + 1], b[i * 4 + 2], b[i * 4 + 3]);
+        if (i % 3 == 0) {
+            qb = (qa + qb * 0.05f).Normalized();
+        }
+        if (i % 2 == 1) {
+            qb = qb * -1.0f;
+        }
+        b[i * 4] = qb.x;
+        b[i * 4 + 1] = qb.y;
+        b[i * 4 + 2] = qb.z;
+        b[i * 4 + 3] = qb.w;
+    }
+    vector<f32> t = RandomFloats(count, 0.0f, 1.0f);
+    if (count > 1) {
+        t[0] = 0.0f;
+        t[1] = 1.0f;
+    }
+
+    vector<f32> expected = GuardedOutput(count, MATRIX_FLOATS);
+    for (u32 i = 0; i < count; i++) {
+        Matrix4 matrix;
+        matrix.MakeTransform(Vector3(position[i * 3], position[i * 3 + 1], position[i * 3 + 2]),
+            Vector3(scale[i * 3], scale[i * 3 + 1], scale[i * 3 + 2]),
+            Quaternion(a[i * 4], a[i * 4 + 1], a[i * 4 + 2], a[i * 4 + 3]));
+        copy(matrix.m, matrix.m + MATRIX_FLOATS, expected.begin() + i * MATRIX_FLOATS);
+    }
+    vector<f32> actual = GuardedOutput(count, MATRIX_FLOATS);
+    kernels.makeTransform(position.data(), scale.data(), a.data(), actual.data(), count);
+    Expect(Matches(expected, actual, count, MATRIX_FLOATS, POSE_TOLERANCE), isa, "make transform against Matrix4",
+        count);
+    vector<f32> positions[VECTOR3_FLOATS];
+    vector<f32> scales[VECTOR3_FLOATS];
+    for (u32 c = 0; c < VECTOR3_FLOATS; c++) {
+        positions[c] = Component(position, VECTOR3_FLOATS, c, count);
+        scales[c] = Component(scale, VECTOR3_FLOATS, c, count);
+    }
+    vector<f32> as[VECTOR4_FLOATS];
+    vector<f32> bs[VECTOR4_FLOATS];
+    for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+        as[c] = Component(a, VECTOR4_FLOATS, c, count);
+        bs[c] = Component(b, VECTOR4_FLOATS, c, count);
+    }
+    const f32* const p[VECTOR3_FLOATS] = {positions[0].data(), positions[1].data(), positions[2].data()};
+    const f32* const s[VECTOR3_FLOATS] = {scales[0].data(), scales[1].data(), scales[2].data()};
+    const f32* const qa[VECTOR4_FLOATS] = {as[0].data(), as[1].data(), as[2].data(), as[3].data()};
+    const f32* const qb[VECTOR4_FLOATS] = {bs[0].data(), bs[1].data(), bs[2].data(), bs[3].data()};
+    actual = GuardedOutput(count, MATRIX_FLOATS);
+    kernels.makeTransformSoA(p, s, qa, actual.data(), count);
+    Expect(Matches(expected, actual, count, MATRIX_FLOATS, POSE_TOLERANCE), isa,
+        "make transform SoA against Matrix4", count);
+
+    for (u32 tStride : {1u, 0u}) {
+        vector<f32> nlerped[VECTOR4_FLOATS];
+        vector<f32> slerped[VECTOR4_FLOATS];
+        for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+            nlerped[c] = GuardedOutput(count, 1);
+            slerped[c] = GuardedOutput(count, 1);
+        }
+        f32* const nlerpOut[VECTOR4_FLOATS] = {nlerped[0].data(), nlerped[1].data(), nlerped[2].data(),
+            nlerped[3].data()};
+        f32* const slerpOut[VECTOR4_FLOATS] = {slerped[0].data(), slerped[1].data(), slerped[2].data(),
+            slerped[3].data()};
+        kernels.nlerp(qa, qb, t.data(), tStride, nlerpOut, count);
+        kernels.slerp(qa, qb, t.data(), tStride, slerpOut, count);
+        vector<f32> nlerpExpected[VECTOR4_FLOATS];
+        vector<f32> slerpExpected[VECTOR4_FLOATS];
+        for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+            nlerpExpected[c] = GuardedOutput(count, 1);
+            slerpExpected[c] = GuardedOutput(count, 1);
+        }
+        for (u32 i = 0; i < count; i++) {
+            const f32 factor = t[i * tStride];
+            const Quaternion from(as[0][i], as[1][i], as[2][i], as[3][i]);
+            Quaternion to(bs[0][i], bs[1][i], bs[2][i], bs[3][i]);
+            f64 exact[VECTOR4_FLOATS];
+            ExactSlerp(from, to, factor, exact);
+            if (from.Dot(to) < 0.0f) {
+                to = to * -1.0f;
+            }
+            const Quaternion blend = (from * (1.0f - factor) + to * factor).Normalized();
+            const f32 nlerp[VECTOR4_FLOATS] = {blend.x, blend.y, blend.z, blend.w};
+            for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+                nlerpExpected[c][i] = nlerp[c];
+                slerpExpected[c][i] = static_cast<f32>(exact[c]);
+            }
+        }
+        for (u32 c = 0; c < VECTOR4_FLOATS; c++) {
+            Expect(Matches(nlerpExpected[c], nlerped[c], count, 1, POSE_TOLERANCE), isa,
+                tStride == 0 ? "nlerp by one factor against Quaternion" : "nlerp against Quaternion", count);
+            Expect(Matches(slerpExpected[c], slerped[c], count, 1, SLERP_TOLERANCE), isa,
+                tStride == 0 ? "slerp by one factor against acos and sin" : "slerp against acos and sin", count);
+        }
+    }
+}
+
+void CheckMatrixKernels(const c8* isa, const MatrixKernels& kernels)
+{
+    for (u32 count : COUNTS) {
+        CheckMultiply(isa, kernels, count);
+        CheckInverses(isa, kernels, count);
+        CheckTransforms(isa, kernels, count);
+        CheckBoxes(isa, kernels, count);
+        CheckMakeTransform(isa, kernels, count);
+        CheckCullBoxes(isa, kernels, count);
+        CheckPoses(isa, kernels, count);
+    }
+    CheckSingular(isa, kernels);
+}
+
+FastMathKernels ScalarFastMathKernels()
+{
+    return {FastMathScalar::ReciprocalSqrt, FastMathScalar::SinCos, FastMathScalar::Atan2, FastMathScalar::Exp2,
+        FastMathScalar::Log2};
+}
+
+// f32 bits mapped to integers in the order of the values, so that adjacent floats differ by 1
+s64 OrderedBits(f32 f)
+{
+    s32 bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits < 0 ? -static_cast<s64>(bits & 0x7fffffff) : bits;
+}
+
+// Distance of actual from the correctly rounded f32 of exact, in ulp.
+u64 UlpError(f32 actual, f64 exact)
+{
+    if (std::isnan(actual)) {
+        return ~0ull;
+    }
+    const s64 distance = OrderedBits(actual) - OrderedBits(static_cast<f32>(exact));
+    return static_cast<u64>(distance < 0 ? -distance : distance);
+}
+
+// Checks the FAST_MATH_COUNT results against exact within maxUlp, skipping where skip is true.
+template<typename Skip>
+void ExpectUlp(const c8* isa, const c8* check, const vector<f32>& actual, const vector<f64>& exact, u64 maxUlp,
+    Skip skip)
+{
+    u64 worst = 0;
+    for (u32 i = 0; i < FAST_MATH_COUNT; i++) {
+        if (!skip(exact[i])) {
+            worst = max(worst, UlpError(actual[i], exact[i]));
+        }
+    }
+    Expect(worst <= maxUlp, isa, check, FAST_MATH_COUNT);
+    Expect(actual[FAST_MATH_COUNT] == GUARD, isa, check, FAST_MATH_COUNT);
+}
+
+void ExpectUlp(const c8* isa, const c8* check, const vector<f32>& actual, const vector<f64>& exact, u64 maxUlp)
+{
+    ExpectUlp(isa, check, actual, exact, maxUlp, [](f64) { return false; });
+}
+
+vector<f64> Exactly(const vector<f32>& in, f64 (*function)(f64))
+{
+    vector<f64> exact(in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        exact[i] = function(in[i]);
+    }
+    return exact;
+}
+
+void CheckSinCos(const c8* isa, const FastMathKernels& kernels)
+{
+    vector<f32> x = RandomFloats(FAST_MATH_COUNT, -SIN_COS_DOMAIN, SIN_COS_DOMAIN);
+    // a third near 0, where the remainder is not reduced
+    for (u32 i = 0; i < FAST_MATH_COUNT; i += 3) {
+        x[i] *= 1e-3f;
+    }
+    x[0] = SIN_COS_DOMAIN;
+    x[1] = -SIN_COS_DOMAIN;
+    const vector<f64> exactSine = Exactly(x, sin);
+    const vector<f64> exactCosine = Exactly(x, cos);
+    vector<f32> sine = GuardedOutput(FAST_MATH_COUNT, 1);
+    vector<f32> cosine = GuardedOutput(FAST_MATH_COUNT, 1);
+    kernels.sinCos(x.data(), sine.data(), cosine.data(), FAST_MATH_COUNT);
+    auto small = [](f64 exact) { return fabs(exact) < SIN_COS_ULP_FROM; };
+    ExpectUlp(isa, "sin", sine, exactSine, SIN_COS_ULP, small);
+    ExpectUlp(isa, "cos", cosine, exactCosine, SIN_COS_ULP, small);
+    bool absolute = true;
+    for (u32 i = 0; i < FAST_MATH_COUNT; i++) {
+        if (small(exactSine[i])) {
+            absolute = absolute && fabs(sine[i] - exactSine[i]) <= SIN_COS_ABSOLUTE;
+        }
+        if (small(exactCosine[i])) {
+            absolute = absolute && fabs(cosine[i] - exactCosine[i]) <= SIN_COS_ABSOLUTE;
+        }
+    }
+    Expect(absolute, isa, "sin and cos near 0", FAST_MATH_COUNT);
+    // either output may be skipped, and the input may be an output
+    vector<f32> only = GuardedOutput(FAST_MATH_COUNT, 1);
+    kernels.sinCos(x.data(), nullptr, only.data(), FAST_MATH_COUNT);
+    Expect(only == cosine, isa, "cos without sin", FAST_MATH_COUNT);
+    vector<f32> inPlace = x;
+    kernels.sinCos(inPlace.data(), inPlace.data(), nullptr, FAST_MATH_COUNT);
+    Expect(equal(inPlace.begin(), inPlace.end(), sine.begin()), isa, "sin in place", FAST_MATH_COUNT);
+}
+
+void CheckAtan2(const c8* isa, const FastMathKernels& kernels, u32 maxUlp)
+{
+    vector<f32> y = RandomFloats(FAST_MATH_COUNT, -50.0f, 50.0f);
+    vector<f32> x = RandomFloats(FAST_MATH_COUNT, -50.0f, 50.0f);
+    // the signed zeros libm defines: 0, pi and -pi
+    y[0] = 0.0f;
+    x[0] = 0.0f;
+    y[1] = 0.0f;
+    x[1] = -0.0f;
+    y[2] = -0.0f;
+    x[2] = -1.0f;
+    vector<f64> exact(FAST_MATH_COUNT);
+    for (u32 i = 0; i < FAST_MATH_COUNT; i++) {
+        exact[i] = atan2(static_cast<f64>(y[i]), static_cast<f64>(x[i]));
+    }
+    vector<f32> out = GuardedOutput(FAST_MATH_COUNT, 1);
+    kernels.atan2(y.data(), x.data(), out.data(), FAST_MATH_COUNT);
+    ExpectUlp(isa, "atan2", out, exact, maxUlp);
+    Expect(out[0] == 0.0f && out[1] == Math::PI && out[2] == -Math::PI, isa, "atan2 of signed zeros",
+        FAST_MATH_COUNT);
+}
+
+void CheckExp2(const c8* isa, const FastMathKernels& kernels)
+{
+    vector<f32> x = RandomFloats(FAST_MATH_COUNT, -160.0f, 130.0f);
+    const vector<f64> exact = Exactly(x, exp2);
+    vector<f32> out = GuardedOutput(FAST_MATH_COUNT, 1);
+    kernels.exp2(x.data(), out.data(), FAST_MATH_COUNT);
+    // the bound holds for normal results, denormals underflow gradually and large x gives infinity
+    auto outsideNormals = [](f64 exact) {
+        return exact < numeric_limits<f32>::min() || exact > numeric_limits<f32>::max();
+    };
+    ExpectUlp(isa, "exp2", out, exact, EXP2_ULP, outsideNormals);
+    bool overflows = true;
+    for (u32 i = 0; i < FAST_MATH_COUNT; i++) {
+        overflows = overflows && (x[i] < 128.0f || std::isinf(out[i]));
+    }
+    Expect(overflows, isa, "exp2 of 128 or more is infinity", FAST_MATH_COUNT);
+    kernels.exp2(x.data(), x.data(), FAST_MATH_COUNT);
+    Expect(equal(x.begin(), x.end(), out.begin()), isa, "exp2 in place", FAST_MATH_COUNT);
+}
+
+void CheckLogarithms(const c8* isa, const FastMathKernels& kernels)
+{
+    // positive normals over the whole exponent range
+    vector<f32> x = RandomFloats(FAST_MATH_COUNT, -125.0f, 127.0f);
+    for (f32& f : x) {
+        f = exp2f(f);
+    }
+    vector<f32> out = GuardedOutput(FAST_MATH_COUNT, 1);
+    kernels.log2(x.data(), out.data(), FAST_MATH_COUNT);
+    ExpectUlp(isa, "log2", out, Exactly(x, log2), LOG2_ULP);
+    out = GuardedOutput(FAST_MATH_COUNT, 1);
+    kernels.reciprocalSqrt(x.data(), out.data(), FAST_MATH_COUNT);
+    ExpectUlp(isa, "reciprocal sqrt", out, Exactly(x, [](f64 f) { return 1.0 / sqrt(f); }), RECIPROCAL_SQRT_ULP);
+}
+
+void CheckFastMathKernels(const c8* isa, const FastMathKernels& kernels, u32 atan2Ulp)
+{
+    CheckSinCos(isa, kernels);
+    CheckAtan2(isa, kernels, atan2Ulp);
+    CheckExp2(isa, kernels);
+    CheckLogarithms(isa, kernels);
+}
+}
+
+int main()
+{
+    const MatrixKernels scalar = ScalarMatrixKernels();
+    const FastMathKernels scalarFastMath = ScalarFastMathKernels();
+    CheckSingular("scalar", scalar);
+    for (u32 count : COUNTS) {
+        CheckPoses("scalar", scalar, count);
+    }
+    CheckFastMathKernels("scalar", scalarFastMath, ATAN2_ULP);
+    for (const IsaKernels& isa : ISAS) {
+        MatrixKernels kernels = scalar;
+        FastMathKernels fastMath = scalarFastMath;
+        if (!isa.getMatrixKernels(kernels) || !isa.getFastMathKernels(fastMath)) {
+            printf("%s: not supported, skipped\n", isa.name);
+            continue;
+        }
+        CheckMatrixKernels(isa.name, kernels);
+#if defined(__arm__)
+        const bool armv7 = (isa.getFastMathKernels == GetNEONFastMathKernels);
+#else
+        const bool armv7 = false;
+#endif
+        CheckFastMathKernels(isa.name, fastMath, armv7 ? ATAN2_ARMV7_ULP : ATAN2_ULP);
+        printf("%s: checked\n", isa.name);
+    }
+    if (g_failures != 0) {
+        printf("%u checks failed\n", g_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}